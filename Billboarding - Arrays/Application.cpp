@@ -16,6 +16,14 @@
 using namespace DirectX;
 
 #include <windowsx.h>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+	// Forest sizes to cycle through
+	const uint32_t forest_sizes[] = { 100000, 250000, 1000000 };
+}
 
 Application::Application()
 {
@@ -54,6 +62,10 @@ int Application::Execute()
 	// Billboard
 	m_Sprite = std::make_unique<Billboard>(m_Renderer.get());
 	m_Sprite->Create();
+	m_Sprite->CreateForest(forest_sizes[m_ForestSizeIndex]);
+	m_Sprite->GetForest().Print();
+
+	std::cout << "Scroll to zoom, F to change the number of trees, L to toggle merging distant trees, any other key for wireframe\n";
 
 	// Raster state
 	m_RasterState = std::make_unique<RasterState>(m_Renderer.get());
@@ -102,6 +114,10 @@ int Application::Execute()
 			m_SpriteShader->Use();
 			this->UpdateSpriteWorldConstantBuffer();
 
+			// Stream the trees in view into the billboard's vertex buffer
+			DirectX::XMFLOAT4 camera_position = m_Camera->GetPosition();
+			m_Sprite->Update(m_Camera->GetView(), m_Camera->GetProjection(), DirectX::XMFLOAT3(camera_position.x, camera_position.y, camera_position.z));
+
 			// Render the billboard
 			m_Sprite->Render();
 
@@ -129,6 +145,10 @@ LRESULT Application::HandleMessage(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lP
 			this->OnMouseMove(hwnd, msg, wParam, lParam);
 			return 0;
 
+		case WM_MOUSEWHEEL:
+			this->OnMouseWheel(hwnd, msg, wParam, lParam);
+			return 0;
+
 		case WM_KEYDOWN:
 			this->OnKeyDown(hwnd, msg, wParam, lParam);
 			return 0;
@@ -178,6 +198,13 @@ void Application::OnMouseMove(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	previous_mouse_y = mouse_y;
 }
 
+void Application::OnMouseWheel(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+	// Zoom the camera in or out ten units a notch
+	float notches = static_cast<float>(GET_WHEEL_DELTA_WPARAM(wParam)) / WHEEL_DELTA;
+	m_Camera->Zoom(-notches * 10.0f);
+}
+
 void Application::OnKeyDown(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
 	WORD flags = HIWORD(lParam);
@@ -185,7 +212,21 @@ void Application::OnKeyDown(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
 	if (!key_repeat)
 	{
-		m_RasterState->ToggleWireframe();
+		switch (wParam)
+		{
+			case 'F':
+				m_ForestSizeIndex = (m_ForestSizeIndex + 1) % static_cast<uint32_t>(std::size(forest_sizes));
+				m_Sprite->CreateForest(forest_sizes[m_ForestSizeIndex]);
+				m_Sprite->GetForest().Print();
+				break;
+			case 'L':
+				m_Sprite->ToggleLod();
+				std::cout << "Merging distant trees: " << (m_Sprite->IsLodEnabled() ? "on" : "off") << '\n';
+				break;
+			default:
+				m_RasterState->ToggleWireframe();
+				break;
+		}
 	}
 }
 
@@ -199,7 +240,9 @@ void Application::CalculateFrameStats(float delta_time)
 	// Update window title every second with FPS
 	if (time > 1.0f)
 	{
-		std::string frame_title = "(FPS: " + std::to_string(m_FrameCount) + ")";
+		const ForestStats& stats = m_Sprite->GetForest().GetStats();
+		std::string frame_title = "(FPS: " + std::to_string(m_FrameCount) + ") (Trees: " + std::to_string(stats.tree_count) + ", Visible cells: "
+			+ std::to_string(stats.visible_cells) + ", Points: " + std::to_string(stats.point_count) + ")";
 		m_Window->SetTitle(m_ApplicationTitle + " " + frame_title);
 
 		time = 0.0f;
@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <string>
+#include <cstdint>
 
 class Window;
 class Renderer;
@@ -56,6 +57,9 @@ private:
 	// On mouse move event
 	void OnMouseMove(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
+	// On mouse wheel event
+	void OnMouseWheel(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
 	// On keydown event
 	void OnKeyDown(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
@@ -66,4 +70,7 @@ private:
 	// Compute model view projection of the camera
 	void ComputeModelViewProjectionMatrix();
 	void UpdateSpriteWorldConstantBuffer();
+
+	// Trees in the forest, cycled through with F
+	uint32_t m_ForestSizeIndex = 1;
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <filesystem>
+#include <cstring>
 
 #include "../External/WICTextureLoader.h"
 
@@ -13,32 +14,66 @@ Billboard::Billboard(Renderer* renderer) : m_Renderer(renderer)
 
 void Billboard::Create()
 {
-	CreateVertexBuffer();
 	LoadTextureArray();
 }
 
-void Billboard::CreateVertexBuffer()
+void Billboard::CreateForest(uint32_t tree_count)
 {
-	ID3D11Device* device = m_Renderer->GetDevice();
+	m_Forest.Build(tree_count, m_TextureCount);
+	m_VertexCount = 0;
+}
 
-	// Set vertex data
-	m_Vertices =
-	{
-		{ 0.0f, 1.0f, 0.0f, 2.0f, 2.0f },
-		{ -3.0f, 1.0f, 0.0f, 2.0f, 2.0f },
-		{ 3.0f, 1.0f, 0.0f, 2.0f, 2.0f },
-	};
+void Billboard::CreateVertexBuffer(UINT capacity)
+{
+	ID3D11Device* device = m_Renderer->GetDevice();
 
-	// Create index buffer
+	// Create a vertex buffer the CPU rewrites every frame
 	D3D11_BUFFER_DESC vertex_buffer_desc = {};
-	vertex_buffer_desc.Usage = D3D11_USAGE_DEFAULT;
-	vertex_buffer_desc.ByteWidth = static_cast<UINT>(sizeof(BillboardVertex) * m_Vertices.size());
+	vertex_buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
+	vertex_buffer_desc.ByteWidth = static_cast<UINT>(sizeof(BillboardVertex) * capacity);
 	vertex_buffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vertex_buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 
-	D3D11_SUBRESOURCE_DATA vertex_subdata = {};
-	vertex_subdata.pSysMem = m_Vertices.data();
+	DX::Check(device->CreateBuffer(&vertex_buffer_desc, nullptr, m_VertexBuffer.ReleaseAndGetAddressOf()));
+	m_VertexCapacity = capacity;
+}
+
+void Billboard::Update(const DirectX::XMMATRIX& view, const DirectX::XMMATRIX& projection, const DirectX::XMFLOAT3& camera_position)
+{
+	// Ranges of trees and cards in view
+	m_Forest.Cull(view, projection, camera_position, !m_UseLod, m_Ranges);
+	m_VertexCount = m_Forest.GetStats().point_count;
 
-	DX::Check(device->CreateBuffer(&vertex_buffer_desc, &vertex_subdata, m_VertexBuffer.ReleaseAndGetAddressOf()));
+	if (m_VertexCount == 0)
+		return;
+
+	// Grow the vertex buffer to the next power of two that holds them
+	if (m_VertexCount > m_VertexCapacity)
+	{
+		UINT capacity = 1024;
+		while (capacity < m_VertexCount)
+		{
+			capacity *= 2;
+		}
+
+		CreateVertexBuffer(capacity);
+	}
+
+	// Discard last frame's points and copy the ranges in
+	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
+
+	D3D11_MAPPED_SUBRESOURCE mapped_resource = {};
+	DX::Check(context->Map(m_VertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped_resource));
+
+	BillboardVertex* vertices = static_cast<BillboardVertex*>(mapped_resource.pData);
+	const std::vector<BillboardVertex>& points = m_Forest.GetPoints();
+	for (const ForestRange& range : m_Ranges)
+	{
+		std::memcpy(vertices, points.data() + range.first, sizeof(BillboardVertex) * range.count);
+		vertices += range.count;
+	}
+
+	context->Unmap(m_VertexBuffer.Get(), 0);
 }
 
 void Billboard::LoadTextureArray()
@@ -46,6 +81,8 @@ void Billboard::LoadTextureArray()
     // Define the texture paths
     std::vector<std::wstring> paths = { L"oaktree_billboard.png", L"ginko_billboard.png", L"maple_billboard.png", L"willow_billboard.png" };
 
+    m_TextureCount = static_cast<uint32_t>(paths.size());
+
     // Check if files exist
     for (const auto& path : paths)
     {
@@ -113,6 +150,9 @@ void Billboard::LoadTextureArray()
 
 void Billboard::Render()
 {
+	if (m_VertexCount == 0)
+		return;
+
 	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
 
 	// We need the stride and offset for the vertex
@@ -129,5 +169,5 @@ void Billboard::Render()
 	context->PSSetShaderResources(0, 1, m_DiffuseTexture.GetAddressOf());
 
 	// Render geometry
-	context->Draw(static_cast<UINT>(m_Vertices.size()), 0);
+	context->Draw(m_VertexCount, 0);
 }
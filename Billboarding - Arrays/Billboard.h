@@ -3,24 +3,14 @@
 #include <d3d11.h>
 #include <vector>
 
+#include "BillboardForest.h"
+
 // This include is requires for using DirectX smart pointers (ComPtr)
 #include <wrl\client.h>
 using Microsoft::WRL::ComPtr;
 
 class Renderer;
 
-struct BillboardVertex
-{
-	// Vertex position
-	float x = 0;
-	float y = 0;
-	float z = 0;
-
-	// Size
-	float width = 0;
-	float height = 0;
-};
-
 class Billboard
 {
 	Renderer* m_Renderer = nullptr;
@@ -32,19 +22,36 @@ public:
 	// Create device
 	void Create();
 
+	// Scatter a new forest of this many trees
+	void CreateForest(uint32_t tree_count);
+
+	// Cull the forest as seen from the camera and stream the points left into the vertex buffer
+	void Update(const DirectX::XMMATRIX& view, const DirectX::XMMATRIX& projection, const DirectX::XMFLOAT3& camera_position);
+
 	// Render the model
 	void Render();
 
+	// Draw every tree in view instead of merging distant cells into cards
+	inline void ToggleLod() { m_UseLod = !m_UseLod; }
+	inline bool IsLodEnabled() const { return m_UseLod; }
+
+	inline const BillboardForest& GetForest() const { return m_Forest; }
+
 private:
 
-	// Vertex buffer
+	// Dynamic vertex buffer holding the points drawn this frame, grown to a power of two when they don't fit
 	ComPtr<ID3D11Buffer> m_VertexBuffer = nullptr;
-	void CreateVertexBuffer();
+	void CreateVertexBuffer(UINT capacity);
+	UINT m_VertexCapacity = 0;
+	UINT m_VertexCount = 0;
 
-	// Vertices
-	std::vector<BillboardVertex> m_Vertices;
+	// Trees and their merged cards, and the ranges of them in view
+	BillboardForest m_Forest;
+	std::vector<ForestRange> m_Ranges;
+	bool m_UseLod = true;
 
 	// Texture buffer
 	void LoadTextureArray();
 	ComPtr<ID3D11ShaderResourceView> m_DiffuseTexture = nullptr;
+	uint32_t m_TextureCount = 0;
 };
\ No newline at end of file
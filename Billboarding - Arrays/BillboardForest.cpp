@@ -0,0 +1,392 @@
+#include "BillboardForest.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	// Trees or cards being merged into one card
+	struct CardBounds
+	{
+		uint32_t count = 0;
+		float sum_x = 0.0f;
+		float sum_z = 0.0f;
+		float min_x = FLT_MAX;
+		float min_z = FLT_MAX;
+		float max_x = -FLT_MAX;
+		float max_z = -FLT_MAX;
+
+		// Half height and texture of the tallest tree
+		float height = 0.0f;
+		uint32_t texture = 0;
+	};
+
+	void AddTree(CardBounds& card, const BillboardVertex& tree)
+	{
+		card.count++;
+		card.sum_x += tree.x;
+		card.sum_z += tree.z;
+		card.min_x = std::min(card.min_x, tree.x - tree.width);
+		card.min_z = std::min(card.min_z, tree.z - tree.width);
+		card.max_x = std::max(card.max_x, tree.x + tree.width);
+		card.max_z = std::max(card.max_z, tree.z + tree.width);
+
+		if (tree.height > card.height)
+		{
+			card.height = tree.height;
+			card.texture = tree.texture;
+		}
+	}
+
+	void MergeCard(CardBounds& card, const CardBounds& other)
+	{
+		if (other.count == 0)
+			return;
+
+		card.count += other.count;
+		card.sum_x += other.sum_x;
+		card.sum_z += other.sum_z;
+		card.min_x = std::min(card.min_x, other.min_x);
+		card.min_z = std::min(card.min_z, other.min_z);
+		card.max_x = std::max(card.max_x, other.max_x);
+		card.max_z = std::max(card.max_z, other.max_z);
+
+		if (other.height > card.height)
+		{
+			card.height = other.height;
+			card.texture = other.texture;
+		}
+	}
+
+	// Card at the middle of its trees, as wide as they spread and as tall as the tallest
+	BillboardVertex CreateCard(const CardBounds& card, float ground_height)
+	{
+		BillboardVertex vertex;
+		vertex.x = card.sum_x / card.count;
+		vertex.z = card.sum_z / card.count;
+		vertex.width = std::max(card.max_x - card.min_x, card.max_z - card.min_z) * 0.5f;
+		vertex.height = card.height;
+		vertex.y = ground_height + card.height;
+		vertex.texture = card.texture;
+		return vertex;
+	}
+
+	// Squared distance from a point to the nearest point of a box
+	float DistanceSquared(const BoundingBox& box, const XMFLOAT3& point)
+	{
+		float dx = std::max(std::abs(point.x - box.Center.x) - box.Extents.x, 0.0f);
+		float dy = std::max(std::abs(point.y - box.Center.y) - box.Extents.y, 0.0f);
+		float dz = std::max(std::abs(point.z - box.Center.z) - box.Extents.z, 0.0f);
+		return dx * dx + dy * dy + dz * dz;
+	}
+}
+
+void BillboardForest::Build(uint32_t tree_count, uint32_t texture_count)
+{
+	auto start_time = std::chrono::high_resolution_clock::now();
+
+	m_Points.clear();
+	m_Cells.clear();
+	m_Blocks.clear();
+	m_Stats = ForestStats();
+
+	if (tree_count == 0 || texture_count == 0)
+		return;
+
+	// Whole cells covering the area the trees need, with the forest centred on the origin
+	float side = std::sqrt(tree_count * AREA_PER_TREE);
+	uint32_t cells_per_side = std::max(1u, static_cast<uint32_t>(std::ceil(side / CELL_SIZE)));
+	uint32_t blocks_per_side = (cells_per_side + BLOCK_CELLS - 1) / BLOCK_CELLS;
+	float half_size = cells_per_side * CELL_SIZE * 0.5f;
+
+	// Number the cells block by block so each block's cells are stored together
+	std::vector<uint32_t> cell_order(cells_per_side * cells_per_side);
+	uint32_t cell_count = 0;
+	for (uint32_t block_z = 0; block_z < blocks_per_side; ++block_z)
+	{
+		for (uint32_t block_x = 0; block_x < blocks_per_side; ++block_x)
+		{
+			Block block;
+			block.first_cell = cell_count;
+
+			for (uint32_t z = block_z * BLOCK_CELLS; z < std::min(cells_per_side, (block_z + 1) * BLOCK_CELLS); ++z)
+			{
+				for (uint32_t x = block_x * BLOCK_CELLS; x < std::min(cells_per_side, (block_x + 1) * BLOCK_CELLS); ++x)
+				{
+					cell_order[z * cells_per_side + x] = cell_count++;
+				}
+			}
+
+			block.cell_count = cell_count - block.first_cell;
+			m_Blocks.push_back(block);
+		}
+	}
+
+	// Scatter the trees outside the clearing
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<float> position_distribution(-half_size, half_size);
+	std::uniform_real_distribution<float> width_distribution(1.5f, 2.5f);
+	std::uniform_real_distribution<float> height_distribution(1.0f, 1.4f);
+	std::uniform_int_distribution<uint32_t> texture_distribution(0, texture_count - 1);
+
+	std::vector<BillboardVertex> trees(tree_count);
+	std::vector<uint32_t> tree_cells(tree_count);
+	std::vector<uint32_t> cell_starts(cell_count + 1, 0);
+
+	for (uint32_t i = 0; i < tree_count; ++i)
+	{
+		BillboardVertex& tree = trees[i];
+		do
+		{
+			tree.x = position_distribution(generator);
+			tree.z = position_distribution(generator);
+		} while (tree.x * tree.x + tree.z * tree.z < CLEARING_RADIUS * CLEARING_RADIUS);
+
+		tree.width = width_distribution(generator);
+		tree.height = tree.width * height_distribution(generator);
+		tree.y = GROUND_HEIGHT + tree.height;
+		tree.texture = texture_distribution(generator);
+
+		uint32_t x = std::min(cells_per_side - 1, static_cast<uint32_t>((tree.x + half_size) / CELL_SIZE));
+		uint32_t z = std::min(cells_per_side - 1, static_cast<uint32_t>((tree.z + half_size) / CELL_SIZE));
+		tree_cells[i] = cell_order[z * cells_per_side + x];
+		cell_starts[tree_cells[i] + 1]++;
+	}
+
+	// Sort the trees by cell, they are the first level of detail
+	for (uint32_t i = 0; i < cell_count; ++i)
+	{
+		cell_starts[i + 1] += cell_starts[i];
+	}
+
+	m_Points.resize(tree_count);
+	std::vector<uint32_t> cell_fill(cell_starts.begin(), cell_starts.end() - 1);
+	for (uint32_t i = 0; i < tree_count; ++i)
+	{
+		m_Points[cell_fill[tree_cells[i]]++] = trees[i];
+	}
+
+	// Merge each cell's trees into a square of cards, then merge the squares in twos until one card is left
+	const uint32_t first_cards_per_side = 1 << (FOREST_LOD_COUNT - 2);
+	std::vector<std::vector<BillboardVertex>> level_cards(FOREST_LOD_COUNT);
+	std::vector<uint32_t> level_starts(FOREST_LOD_COUNT * cell_count);
+	std::vector<CardBounds> cards;
+	std::vector<CardBounds> merged_cards;
+
+	m_Cells.resize(cell_count);
+	for (uint32_t z = 0; z < cells_per_side; ++z)
+	{
+		for (uint32_t x = 0; x < cells_per_side; ++x)
+		{
+			uint32_t index = cell_order[z * cells_per_side + x];
+			Cell& cell = m_Cells[index];
+			cell.first[0] = cell_starts[index];
+			cell.count[0] = cell_starts[index + 1] - cell_starts[index];
+
+			float cell_x = -half_size + x * CELL_SIZE;
+			float cell_z = -half_size + z * CELL_SIZE;
+			XMFLOAT3 bounds_min(FLT_MAX, GROUND_HEIGHT, FLT_MAX);
+			XMFLOAT3 bounds_max(-FLT_MAX, GROUND_HEIGHT, -FLT_MAX);
+
+			// Bounds of the trees and the first cards
+			cards.assign(first_cards_per_side * first_cards_per_side, CardBounds());
+			for (uint32_t i = cell.first[0]; i < cell.first[0] + cell.count[0]; ++i)
+			{
+				const BillboardVertex& tree = m_Points[i];
+				bounds_min.x = std::min(bounds_min.x, tree.x - tree.width);
+				bounds_min.z = std::min(bounds_min.z, tree.z - tree.width);
+				bounds_max.x = std::max(bounds_max.x, tree.x + tree.width);
+				bounds_max.y = std::max(bounds_max.y, tree.y + tree.height);
+				bounds_max.z = std::max(bounds_max.z, tree.z + tree.width);
+
+				uint32_t card_x = std::min(first_cards_per_side - 1, static_cast<uint32_t>((tree.x - cell_x) / (CELL_SIZE / first_cards_per_side)));
+				uint32_t card_z = std::min(first_cards_per_side - 1, static_cast<uint32_t>((tree.z - cell_z) / (CELL_SIZE / first_cards_per_side)));
+				AddTree(cards[card_z * first_cards_per_side + card_x], tree);
+			}
+
+			for (uint32_t level = 1, cards_per_side = first_cards_per_side; level < FOREST_LOD_COUNT; ++level, cards_per_side /= 2)
+			{
+				// Merge the previous level's cards in twos along each side
+				if (level > 1)
+				{
+					uint32_t merged_per_side = cards_per_side;
+					merged_cards.assign(merged_per_side * merged_per_side, CardBounds());
+					for (uint32_t card_z = 0; card_z < merged_per_side * 2; ++card_z)
+					{
+						for (uint32_t card_x = 0; card_x < merged_per_side * 2; ++card_x)
+						{
+							MergeCard(merged_cards[(card_z / 2) * merged_per_side + card_x / 2], cards[card_z * merged_per_side * 2 + card_x]);
+						}
+					}
+
+					cards.swap(merged_cards);
+				}
+
+				// Cards with trees behind them, widening the bounds to hold them
+				std::vector<BillboardVertex>& points = level_cards[level];
+				level_starts[level * cell_count + index] = static_cast<uint32_t>(points.size());
+				for (const CardBounds& card : cards)
+				{
+					if (card.count == 0)
+						continue;
+
+					BillboardVertex vertex = CreateCard(card, GROUND_HEIGHT);
+					bounds_min.x = std::min(bounds_min.x, vertex.x - vertex.width);
+					bounds_min.z = std::min(bounds_min.z, vertex.z - vertex.width);
+					bounds_max.x = std::max(bounds_max.x, vertex.x + vertex.width);
+					bounds_max.z = std::max(bounds_max.z, vertex.z + vertex.width);
+					points.push_back(vertex);
+				}
+
+				cell.count[level] = static_cast<uint32_t>(points.size()) - level_starts[level * cell_count + index];
+			}
+
+			if (cell.count[0] > 0)
+			{
+				BoundingBox::CreateFromPoints(cell.bounds, XMLoadFloat3(&bounds_min), XMLoadFloat3(&bounds_max));
+			}
+		}
+	}
+
+	// Store the cards level after level behind the trees
+	for (uint32_t level = 1; level < FOREST_LOD_COUNT; ++level)
+	{
+		uint32_t level_first = static_cast<uint32_t>(m_Points.size());
+		m_Points.insert(m_Points.end(), level_cards[level].begin(), level_cards[level].end());
+
+		for (uint32_t i = 0; i < cell_count; ++i)
+		{
+			m_Cells[i].first[level] = level_first + level_starts[level * cell_count + i];
+		}
+	}
+
+	// Bounds of each block's cells that have trees
+	for (Block& block : m_Blocks)
+	{
+		bool empty = true;
+		for (uint32_t i = block.first_cell; i < block.first_cell + block.cell_count; ++i)
+		{
+			if (m_Cells[i].count[0] == 0)
+				continue;
+
+			if (empty)
+			{
+				block.bounds = m_Cells[i].bounds;
+				empty = false;
+			}
+			else
+			{
+				BoundingBox::CreateMerged(block.bounds, block.bounds, m_Cells[i].bounds);
+			}
+		}
+
+		if (empty)
+		{
+			block.cell_count = 0;
+		}
+	}
+
+	auto end_time = std::chrono::high_resolution_clock::now();
+
+	m_Stats.tree_count = tree_count;
+	m_Stats.card_count = static_cast<uint32_t>(m_Points.size()) - tree_count;
+	m_Stats.cell_count = cell_count;
+	m_Stats.block_count = static_cast<uint32_t>(m_Blocks.size());
+	m_Stats.build_milliseconds = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+}
+
+void BillboardForest::Cull(const XMMATRIX& view, const XMMATRIX& projection, const XMFLOAT3& camera_position, bool all_trees, std::vector<ForestRange>& ranges)
+{
+	auto start_time = std::chrono::high_resolution_clock::now();
+
+	ranges.clear();
+	m_Stats.visible_blocks = 0;
+	m_Stats.visible_cells = 0;
+	std::fill(std::begin(m_Stats.lod_cells), std::end(m_Stats.lod_cells), 0);
+	m_Stats.point_count = 0;
+
+	// The camera's frustum in world space
+	BoundingFrustum frustum;
+	BoundingFrustum::CreateFromMatrix(frustum, projection);
+	frustum.Transform(frustum, XMMatrixInverse(nullptr, view));
+
+	for (const Block& block : m_Blocks)
+	{
+		if (block.cell_count == 0)
+			continue;
+
+		// Cells of a block inside the frustum are all visible and the cells of one outside it are all hidden
+		ContainmentType block_containment = frustum.Contains(block.bounds);
+		if (block_containment == DISJOINT)
+			continue;
+
+		m_Stats.visible_blocks++;
+
+		for (uint32_t i = block.first_cell; i < block.first_cell + block.cell_count; ++i)
+		{
+			const Cell& cell = m_Cells[i];
+			if (cell.count[0] == 0)
+				continue;
+
+			if (block_containment == INTERSECTS && !frustum.Intersects(cell.bounds))
+				continue;
+
+			// Coarser levels of detail the further the cell is
+			uint32_t level = 0;
+			if (!all_trees)
+			{
+				float distance_squared = DistanceSquared(cell.bounds, camera_position);
+				while (level < FOREST_LOD_COUNT - 1 && distance_squared > m_LodDistances[level] * m_LodDistances[level])
+				{
+					level++;
+				}
+			}
+
+			AddRange(ranges, cell.first[level], cell.count[level]);
+
+			m_Stats.visible_cells++;
+			m_Stats.lod_cells[level]++;
+			m_Stats.point_count += cell.count[level];
+		}
+	}
+
+	auto end_time = std::chrono::high_resolution_clock::now();
+
+	m_Stats.range_count = static_cast<uint32_t>(ranges.size());
+	m_Stats.cull_milliseconds = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+}
+
+void BillboardForest::AddRange(std::vector<ForestRange>& ranges, uint32_t first, uint32_t count)
+{
+	if (count == 0)
+		return;
+
+	if (!ranges.empty() && ranges.back().first + ranges.back().count == first)
+	{
+		ranges.back().count += count;
+	}
+	else
+	{
+		ranges.push_back({ first, count });
+	}
+}
+
+void BillboardForest::Print() const
+{
+	std::cout << "Forest: " << m_Stats.tree_count << " trees and " << m_Stats.card_count << " cards in " << m_Stats.cell_count << " cells and "
+		<< m_Stats.block_count << " blocks, built in " << m_Stats.build_milliseconds << " ms\n";
+
+	std::cout << "  Visible: " << m_Stats.visible_blocks << " blocks, " << m_Stats.visible_cells << " cells (";
+	for (uint32_t level = 0; level < FOREST_LOD_COUNT; ++level)
+	{
+		std::cout << (level == 0 ? "" : ", ") << m_Stats.lod_cells[level] << " at level " << level;
+	}
+
+	std::cout << "), " << m_Stats.point_count << " points in " << m_Stats.range_count << " ranges, culled in " << m_Stats.cull_milliseconds << " ms\n";
+}
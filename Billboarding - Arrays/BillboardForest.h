@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+#include "Vertex.h"
+
+// Levels of detail of a cell, the first is every tree and each one after it merges the cards of the one before in twos along x and z
+const uint32_t FOREST_LOD_COUNT = 4;
+
+// Counters of the last cull
+struct ForestStats
+{
+	uint32_t tree_count = 0;
+	uint32_t card_count = 0;
+	uint32_t cell_count = 0;
+	uint32_t block_count = 0;
+
+	// Blocks and cells inside the frustum, and the cells drawn at each level of detail
+	uint32_t visible_blocks = 0;
+	uint32_t visible_cells = 0;
+	uint32_t lod_cells[FOREST_LOD_COUNT] = {};
+
+	// Points streamed out and the separate ranges they were copied from
+	uint32_t point_count = 0;
+	uint32_t range_count = 0;
+
+	double build_milliseconds = 0.0;
+	double cull_milliseconds = 0.0;
+};
+
+// Range of points to draw
+struct ForestRange
+{
+	uint32_t first = 0;
+	uint32_t count = 0;
+};
+
+// Trees scattered over a square grid of cells, so only the cells in view are drawn and distant ones as a few merged cards
+//
+// Each cell keeps the bounds of its trees and, for every level of detail past the first, cards that each stand in for the
+// trees of a part of the cell. The cards are merged once when the forest is built: the trees of a square of the cell become
+// one card at their middle, as wide as they spread and as tall and textured as the tallest of them. Cells are grouped into
+// square blocks which are tested against the frustum first, a block outside skips its cells and a block inside takes them
+// without testing. The points of each level are stored one level after another and cell by cell inside a block, so
+// neighbouring cells at the same level come out as one range to copy
+class BillboardForest
+{
+public:
+	// Size of a cell and cells along each side of a block
+	static constexpr float CELL_SIZE = 40.0f;
+	static constexpr uint32_t BLOCK_CELLS = 8;
+
+	// Ground area per tree, the forest grows outwards as trees are added
+	static constexpr float AREA_PER_TREE = 25.0f;
+
+	// Radius kept clear of trees around the middle
+	static constexpr float CLEARING_RADIUS = 10.0f;
+
+	// Height of the ground
+	static constexpr float GROUND_HEIGHT = -1.0f;
+
+	BillboardForest() = default;
+	virtual ~BillboardForest() = default;
+
+	// Scatter trees with a fixed seed over a square sized to hold them and merge their cards, textures are chosen from texture_count slices
+	void Build(uint32_t tree_count, uint32_t texture_count);
+
+	// Ranges of points to draw as seen from the camera. Cells nearer than each distance use that level of detail and the
+	// rest use the last, all_trees draws every tree in view instead
+	void Cull(const DirectX::XMMATRIX& view, const DirectX::XMMATRIX& projection, const DirectX::XMFLOAT3& camera_position, bool all_trees, std::vector<ForestRange>& ranges);
+
+	// Points of every tree then every card, in the order the ranges index
+	inline const std::vector<BillboardVertex>& GetPoints() const { return m_Points; }
+
+	// Distances at which a cell drops to the next level of detail
+	inline void SetLodDistances(float level_1, float level_2, float level_3) { m_LodDistances[0] = level_1; m_LodDistances[1] = level_2; m_LodDistances[2] = level_3; }
+
+	inline const ForestStats& GetStats() const { return m_Stats; }
+
+	// Print the counters
+	void Print() const;
+
+private:
+	// Bounds of the trees in a cell and its points at each level of detail
+	struct Cell
+	{
+		DirectX::BoundingBox bounds;
+		uint32_t first[FOREST_LOD_COUNT];
+		uint32_t count[FOREST_LOD_COUNT];
+	};
+
+	// Bounds of a block's cells, which are stored one after another
+	struct Block
+	{
+		DirectX::BoundingBox bounds;
+		uint32_t first_cell = 0;
+		uint32_t cell_count = 0;
+	};
+
+	std::vector<BillboardVertex> m_Points;
+	std::vector<Cell> m_Cells;
+	std::vector<Block> m_Blocks;
+
+	float m_LodDistances[FOREST_LOD_COUNT - 1] = { 120.0f, 240.0f, 480.0f };
+
+	// Add a range, joining it to the last when it follows on from it
+	static void AddRange(std::vector<ForestRange>& ranges, uint32_t first, uint32_t count);
+
+	ForestStats m_Stats;
+};
@@ -1,7 +1,7 @@
 #include "BillboardShaderData.hlsli"
 
 [maxvertexcount(4)]
-void main(point GeometryInput input[1], uint primID : SV_PrimitiveID, inout TriangleStream<PixelInput> output)
+void main(point GeometryInput input[1], inout TriangleStream<PixelInput> output)
 {
 	// Calculate vector perpendicular to the camera
     float3 plane_normal = input[0].position - cCameraPosition;
@@ -41,7 +41,7 @@ void main(point GeometryInput input[1], uint primID : SV_PrimitiveID, inout Tria
         element.position = mul(element.position, cProjection);
 
         element.texture_coord = uv[i];
-        element.primitiveId = primID;
+        element.texture_index = input[0].texture_index;
         
         output.Append(element);
     }
@@ -3,8 +3,12 @@
 // Entry point for the vertex shader - will be executed for each pixel
 float4 main(PixelInput input) : SV_TARGET
 {
-    float3 coord = float3(input.texture_coord.xy, input.primitiveId);
+    float3 coord = float3(input.texture_coord.xy, input.texture_index);
     
     float4 sprite_texture = gTextureSprite.Sample(gSampler, coord);
+
+    // Discard the transparent parts so they don't hide the trees behind
+    clip(sprite_texture.a - 0.5f);
+
     return sprite_texture;
 }
\ No newline at end of file
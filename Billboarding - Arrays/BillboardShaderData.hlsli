@@ -3,6 +3,7 @@ struct VertexInput
 {
     float3 position : POSITION;
     float2 size : SIZE;
+    uint texture_index : TEXTURE_INDEX;
 };
 
 // Vertex output / Geometry input
@@ -10,6 +11,7 @@ struct GeometryInput
 {
     float3 position : POSITION;
     float2 size : SIZE;
+    uint texture_index : TEXTURE_INDEX;
 };
 
 // Geometry output / Pixel input structure
@@ -17,7 +19,7 @@ struct PixelInput
 {
     float4 position : SV_POSITION;
     float2 texture_coord : TEXTURE;
-    uint primitiveId : SV_PrimitiveID;
+    nointerpolation uint texture_index : TEXTURE_INDEX;
 };
 
 // World constant buffer
@@ -8,6 +8,7 @@ GeometryInput main(VertexInput input)
 	// Pass through the vertex shader
     output.position = input.position;
     output.size = input.size;
+    output.texture_index = input.texture_index;
 
     return output;
 }
\ No newline at end of file
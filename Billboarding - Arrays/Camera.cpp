@@ -14,11 +14,20 @@ void Camera::Rotate(float pitch_radians, float yaw_radians)
 	m_PitchRadians += pitch_radians;
 	m_YawRadians += yaw_radians;
 	m_PitchRadians = std::clamp<float>(m_PitchRadians, -(DirectX::XM_PIDIV2 - 0.1f), DirectX::XM_PIDIV2 - 0.1f);
+	CalculateView();
+}
 
+void Camera::Zoom(float distance)
+{
+	m_Radius = std::clamp(m_Radius + distance, 4.0f, 600.0f);
+	CalculateView();
+}
+
+void Camera::CalculateView()
+{
 	// Convert Spherical to Cartesian coordinates.
-	const float radius = -8.0f;
 	DirectX::XMMATRIX rotation_matrix = DirectX::XMMatrixRotationRollPitchYaw(m_PitchRadians, m_YawRadians, 0);
-	DirectX::XMVECTOR position = DirectX::XMVectorSet(0.0f, 0.0f, radius, 0.0f);
+	DirectX::XMVECTOR position = DirectX::XMVectorSet(0.0f, 0.0f, -m_Radius, 0.0f);
 	position = XMVector3TransformCoord(position, rotation_matrix);
 
 	// Store the camera's position as a XMFLOAT3
@@ -50,6 +59,6 @@ void Camera::CalculateProjection()
 	// Convert degrees to radians
 	float field_of_view_radians = DirectX::XMConvertToRadians(m_FieldOfViewDegrees);
 
-	// Calculate camera's perspective
-	m_Projection = DirectX::XMMatrixPerspectiveFovLH(field_of_view_radians, m_AspectRatio, 0.01f, 100.0f);
+	// Calculate camera's perspective, far enough to see over the forest
+	m_Projection = DirectX::XMMatrixPerspectiveFovLH(field_of_view_radians, m_AspectRatio, 0.1f, 1000.0f);
 }
\ No newline at end of file
@@ -12,6 +12,9 @@ public:
 	// Recalculates the view based on the pitch and yaw
 	void Rotate(float pitch, float yaw);
 
+	// Move towards or away from the centre
+	void Zoom(float distance);
+
 	// Update aspect ratio
 	void UpdateAspectRatio(int width, int height);
 
@@ -43,6 +46,9 @@ private:
 	// Camera yaw in radians
 	float m_YawRadians = 0.0f;
 
+	// Distance from the centre
+	float m_Radius = 8.0f;
+
 	// Camera field of view in degrees
 	float m_FieldOfViewDegrees = 50.0f;
 
@@ -51,4 +57,7 @@ private:
 
 	// Recalculates the projection based on the new window size
 	void CalculateProjection();
+
+	// Recalculates the position and view from the pitch, yaw and radius
+	void CalculateView();
 };
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 struct VertexPosition
 {
 	VertexPosition(float x, float y, float z) : x(x), y(y), z(z) {}
@@ -21,4 +23,19 @@ struct Vertex
 {
 	VertexPosition position;
 	VertexTextureUV texture;
+};
+
+struct BillboardVertex
+{
+	// Vertex position
+	float x = 0;
+	float y = 0;
+	float z = 0;
+
+	// Size
+	float width = 0;
+	float height = 0;
+
+	// Slice of the texture array
+	uint32_t texture = 0;
 };
\ No newline at end of file
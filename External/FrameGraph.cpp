@@ -0,0 +1,479 @@
+#include "FrameGraph.h"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+	// Pixel shader slots the unbinds are tracked for
+	const uint32_t MAX_TRACKED_SLOTS = 16;
+
+	const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+	// Set on the binding keys of imported textures so they never match a physical texture
+	const uint32_t IMPORTED_KEY_BIT = 0x80000000;
+}
+
+void FrameGraph::Reset()
+{
+	m_Textures.clear();
+	m_Passes.clear();
+	m_Accesses.clear();
+}
+
+FrameGraphHandle FrameGraph::CreateTexture(const char* name, const FrameGraphTextureDesc& desc)
+{
+	m_Textures.push_back({ name, desc, false });
+	return static_cast<FrameGraphHandle>(m_Textures.size() - 1);
+}
+
+FrameGraphHandle FrameGraph::ImportTexture(const char* name)
+{
+	m_Textures.push_back({ name, FrameGraphTextureDesc(), true });
+	return static_cast<FrameGraphHandle>(m_Textures.size() - 1);
+}
+
+uint32_t FrameGraph::AddPass(const char* name, std::function<void()> execute)
+{
+	m_Passes.push_back({ name, std::move(execute), false });
+	return static_cast<uint32_t>(m_Passes.size() - 1);
+}
+
+void FrameGraph::Read(uint32_t pass, FrameGraphHandle texture, uint32_t slot)
+{
+	m_Accesses.push_back({ pass, texture, FrameGraphAccess::ShaderResource, slot });
+}
+
+void FrameGraph::Write(uint32_t pass, FrameGraphHandle texture, FrameGraphAccess access)
+{
+	m_Accesses.push_back({ pass, texture, access, 0 });
+}
+
+void FrameGraph::SetSideEffects(uint32_t pass)
+{
+	m_Passes[pass].side_effects = true;
+}
+
+uint32_t FrameGraph::GetPhysicalTexture(FrameGraphHandle texture) const
+{
+	return (texture < m_TexturePhysical.size()) ? m_TexturePhysical[texture] : INVALID_INDEX;
+}
+
+bool FrameGraph::IsSameAsCompiled() const
+{
+	if (m_Textures != m_CompiledTextures || m_Accesses != m_CompiledAccesses || m_Passes.size() != m_CompiledSideEffects.size())
+		return false;
+
+	for (size_t i = 0; i < m_Passes.size(); ++i)
+	{
+		if (m_Passes[i].side_effects != m_CompiledSideEffects[i])
+			return false;
+	}
+
+	return true;
+}
+
+bool FrameGraph::Compile()
+{
+	// Same graph as last frame, only the pass callbacks have been replaced
+	if (m_Compiled && this->IsSameAsCompiled())
+	{
+		m_Stats.cached_count++;
+		return m_Acyclic;
+	}
+
+	this->CullPasses();
+	m_Acyclic = this->OrderPasses();
+	this->AssignPhysicalTextures();
+	this->BuildBarriers();
+
+	// Keep the declarations to compare the next frames against
+	m_CompiledTextures = m_Textures;
+	m_CompiledAccesses = m_Accesses;
+	m_CompiledSideEffects.resize(m_Passes.size());
+	for (size_t i = 0; i < m_Passes.size(); ++i)
+	{
+		m_CompiledSideEffects[i] = m_Passes[i].side_effects;
+	}
+
+	m_Compiled = true;
+
+	// Counters
+	m_Stats.pass_count = static_cast<uint32_t>(m_Passes.size());
+	m_Stats.culled_pass_count = static_cast<uint32_t>(m_Passes.size() - m_Order.size());
+	m_Stats.texture_count = 0;
+	for (const TextureEntry& texture : m_Textures)
+	{
+		if (!texture.imported)
+			m_Stats.texture_count++;
+	}
+
+	m_Stats.physical_texture_count = 0;
+	for (const PhysicalTexture& physical : m_PhysicalTextures)
+	{
+		if (physical.in_use)
+			m_Stats.physical_texture_count++;
+	}
+
+	m_Stats.barrier_count = static_cast<uint32_t>(m_Barriers.size());
+	m_Stats.compile_count++;
+
+	return m_Acyclic;
+}
+
+bool FrameGraph::IsWriter(uint32_t pass, FrameGraphHandle texture) const
+{
+	for (const AccessEntry& access : m_Accesses)
+	{
+		if (access.pass == pass && access.texture == texture && access.access != FrameGraphAccess::ShaderResource)
+			return true;
+	}
+
+	return false;
+}
+
+void FrameGraph::CullPasses()
+{
+	const uint32_t pass_count = static_cast<uint32_t>(m_Passes.size());
+	m_Kept.assign(pass_count, false);
+
+	// Passes with visible results
+	for (uint32_t pass = 0; pass < pass_count; ++pass)
+	{
+		m_Kept[pass] = m_Passes[pass].side_effects;
+	}
+
+	for (const AccessEntry& access : m_Accesses)
+	{
+		if (access.access != FrameGraphAccess::ShaderResource && m_Textures[access.texture].imported)
+			m_Kept[access.pass] = true;
+	}
+
+	// Keep the writers of everything a kept pass reads, and earlier writers of what it draws on top of, until nothing changes
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (const AccessEntry& access : m_Accesses)
+		{
+			if (!m_Kept[access.pass])
+				continue;
+
+			bool is_read = (access.access == FrameGraphAccess::ShaderResource);
+			for (uint32_t writer = 0; writer < pass_count; ++writer)
+			{
+				if (m_Kept[writer] || (!is_read && writer > access.pass))
+					continue;
+
+				if (this->IsWriter(writer, access.texture))
+				{
+					m_Kept[writer] = true;
+					changed = true;
+				}
+			}
+		}
+	}
+}
+
+bool FrameGraph::IsReady(uint32_t pass) const
+{
+	const uint32_t pass_count = static_cast<uint32_t>(m_Passes.size());
+
+	for (const AccessEntry& access : m_Accesses)
+	{
+		if (access.pass != pass)
+			continue;
+
+		// Reads wait for every writer, writes wait for the writers declared before them
+		bool is_read = (access.access == FrameGraphAccess::ShaderResource);
+		for (uint32_t writer = 0; writer < pass_count; ++writer)
+		{
+			if (writer == pass || !m_Kept[writer] || m_Scheduled[writer] || (!is_read && writer > pass))
+				continue;
+
+			if (this->IsWriter(writer, access.texture))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+bool FrameGraph::OrderPasses()
+{
+	const uint32_t pass_count = static_cast<uint32_t>(m_Passes.size());
+	m_Scheduled.assign(pass_count, false);
+	m_Order.clear();
+
+	uint32_t kept_count = static_cast<uint32_t>(std::count(m_Kept.begin(), m_Kept.end(), true));
+	while (m_Order.size() < kept_count)
+	{
+		// The first declared pass with everything it depends on scheduled, so independent passes keep their declared order
+		bool found = false;
+		for (uint32_t pass = 0; pass < pass_count; ++pass)
+		{
+			if (m_Kept[pass] && !m_Scheduled[pass] && this->IsReady(pass))
+			{
+				m_Scheduled[pass] = true;
+				m_Order.push_back(pass);
+				found = true;
+				break;
+			}
+		}
+
+		if (found)
+			continue;
+
+		// The rest depend on each other, run them as declared
+		for (uint32_t pass = 0; pass < pass_count; ++pass)
+		{
+			if (m_Kept[pass] && !m_Scheduled[pass])
+			{
+				m_Scheduled[pass] = true;
+				m_Order.push_back(pass);
+			}
+		}
+
+		return false;
+	}
+
+	return true;
+}
+
+void FrameGraph::AssignPhysicalTextures()
+{
+	const uint32_t texture_count = static_cast<uint32_t>(m_Textures.size());
+	m_FirstUse.assign(texture_count, INVALID_INDEX);
+	m_LastUse.assign(texture_count, 0);
+
+	// Lifetimes in positions of the compiled order, culled passes don't count
+	for (uint32_t position = 0; position < m_Order.size(); ++position)
+	{
+		for (const AccessEntry& access : m_Accesses)
+		{
+			if (access.pass != m_Order[position])
+				continue;
+
+			m_FirstUse[access.texture] = std::min(m_FirstUse[access.texture], position);
+			m_LastUse[access.texture] = std::max(m_LastUse[access.texture], position);
+		}
+	}
+
+	// Transient textures that are used, earliest first
+	m_TextureOrder.clear();
+	for (uint32_t texture = 0; texture < texture_count; ++texture)
+	{
+		if (!m_Textures[texture].imported && m_FirstUse[texture] != INVALID_INDEX)
+			m_TextureOrder.push_back(texture);
+	}
+
+	std::sort(m_TextureOrder.begin(), m_TextureOrder.end(), [this](uint32_t a, uint32_t b) { return m_FirstUse[a] < m_FirstUse[b]; });
+
+	m_TexturePhysical.assign(texture_count, INVALID_INDEX);
+	for (PhysicalTexture& physical : m_PhysicalTextures)
+	{
+		physical.in_use = false;
+	}
+
+	for (uint32_t texture : m_TextureOrder)
+	{
+		const FrameGraphTextureDesc& desc = m_Textures[texture].desc;
+		uint32_t chosen = INVALID_INDEX;
+
+		// Alias a texture this frame has finished with, or take back one created for an earlier frame
+		for (uint32_t i = 0; i < m_PhysicalTextures.size() && chosen == INVALID_INDEX; ++i)
+		{
+			const PhysicalTexture& physical = m_PhysicalTextures[i];
+			if (physical.in_use && physical.desc == desc && physical.last_use < m_FirstUse[texture])
+				chosen = i;
+			else if (!physical.in_use && physical.created && physical.created_desc == desc)
+				chosen = i;
+		}
+
+		// Otherwise recreate an unused one, or add one
+		for (uint32_t i = 0; i < m_PhysicalTextures.size() && chosen == INVALID_INDEX; ++i)
+		{
+			if (!m_PhysicalTextures[i].in_use)
+				chosen = i;
+		}
+
+		if (chosen == INVALID_INDEX)
+		{
+			chosen = static_cast<uint32_t>(m_PhysicalTextures.size());
+			m_PhysicalTextures.push_back(PhysicalTexture());
+		}
+
+		PhysicalTexture& physical = m_PhysicalTextures[chosen];
+		physical.desc = desc;
+		physical.in_use = true;
+		physical.last_use = m_LastUse[texture];
+		m_TexturePhysical[texture] = chosen;
+	}
+}
+
+uint32_t FrameGraph::GetBindingKey(FrameGraphHandle texture) const
+{
+	// Aliased textures are the same texture to Direct3D, so transient textures are tracked by their physical texture
+	if (m_Textures[texture].imported)
+		return texture | IMPORTED_KEY_BIT;
+
+	return m_TexturePhysical[texture];
+}
+
+bool FrameGraph::WritesBinding(uint32_t pass, uint32_t key) const
+{
+	for (const AccessEntry& access : m_Accesses)
+	{
+		if (access.pass == pass && access.access != FrameGraphAccess::ShaderResource && this->GetBindingKey(access.texture) == key)
+			return true;
+	}
+
+	return false;
+}
+
+void FrameGraph::BuildBarriers()
+{
+	uint32_t bound[MAX_TRACKED_SLOTS];
+	std::fill(bound, bound + MAX_TRACKED_SLOTS, INVALID_INDEX);
+	uint32_t previous_pass = INVALID_INDEX;
+
+	// The first run only finds what is left bound at the end of a frame, which is what the next frame starts with
+	for (int run = 0; run < 2; ++run)
+	{
+		bool record = (run == 1);
+		m_Barriers.clear();
+		m_BarrierStart.clear();
+
+		for (uint32_t pass : m_Order)
+		{
+			m_BarrierStart.push_back(static_cast<uint32_t>(m_Barriers.size()));
+
+			// Written textures must not be readable by the pixel shader
+			for (const AccessEntry& access : m_Accesses)
+			{
+				if (access.pass != pass || access.access == FrameGraphAccess::ShaderResource)
+					continue;
+
+				uint32_t key = this->GetBindingKey(access.texture);
+				for (uint32_t slot = 0; slot < MAX_TRACKED_SLOTS; ++slot)
+				{
+					if (bound[slot] == key)
+					{
+						bound[slot] = INVALID_INDEX;
+						if (record)
+							m_Barriers.push_back({ BarrierType::UnbindShaderResource, slot, access.texture });
+					}
+				}
+			}
+
+			// Read textures must not still be bound as the last pass' targets
+			for (const AccessEntry& access : m_Accesses)
+			{
+				if (access.pass != pass || access.access != FrameGraphAccess::ShaderResource || previous_pass == INVALID_INDEX)
+					continue;
+
+				if (this->WritesBinding(previous_pass, this->GetBindingKey(access.texture)))
+				{
+					if (record)
+						m_Barriers.push_back({ BarrierType::UnbindRenderTargets, 0, access.texture });
+					break;
+				}
+			}
+
+			// What the pass leaves bound
+			for (const AccessEntry& access : m_Accesses)
+			{
+				if (access.pass == pass && access.access == FrameGraphAccess::ShaderResource && access.slot < MAX_TRACKED_SLOTS)
+					bound[access.slot] = this->GetBindingKey(access.texture);
+			}
+
+			previous_pass = pass;
+		}
+
+		m_BarrierStart.push_back(static_cast<uint32_t>(m_Barriers.size()));
+	}
+}
+
+void FrameGraph::Execute(FrameGraphBackend& backend)
+{
+	// Create the physical textures that are new or have a new description
+	for (uint32_t i = 0; i < m_PhysicalTextures.size(); ++i)
+	{
+		PhysicalTexture& physical = m_PhysicalTextures[i];
+		if (physical.in_use && (!physical.created || physical.created_desc != physical.desc))
+		{
+			backend.CreateTexture(i, physical.desc);
+			physical.created_desc = physical.desc;
+			physical.created = true;
+		}
+	}
+
+	for (uint32_t position = 0; position < m_Order.size(); ++position)
+	{
+		for (uint32_t i = m_BarrierStart[position]; i < m_BarrierStart[position + 1]; ++i)
+		{
+			const Barrier& barrier = m_Barriers[i];
+			if (barrier.type == BarrierType::UnbindShaderResource)
+			{
+				backend.UnbindShaderResource(barrier.slot);
+			}
+			else
+			{
+				backend.UnbindRenderTargets();
+			}
+		}
+
+		m_Passes[m_Order[position]].execute();
+	}
+}
+
+void FrameGraph::Print() const
+{
+	std::cout << "Frame graph: " << m_Stats.pass_count << " passes (" << m_Stats.culled_pass_count << " culled), " << m_Stats.texture_count
+		<< " transient textures in " << m_Stats.physical_texture_count << " physical, " << m_Stats.barrier_count << " unbinds, "
+		<< m_Stats.compile_count << " compiles, " << m_Stats.cached_count << " cached frames\n";
+
+	for (uint32_t position = 0; position < m_Order.size(); ++position)
+	{
+		std::cout << "  " << m_Passes[m_Order[position]].name << '\n';
+
+		for (uint32_t i = m_BarrierStart[position]; i < m_BarrierStart[position + 1]; ++i)
+		{
+			const Barrier& barrier = m_Barriers[i];
+			if (barrier.type == BarrierType::UnbindShaderResource)
+				std::cout << "    unbind shader resource " << barrier.slot << " (" << m_Textures[barrier.texture].name << ")\n";
+			else
+				std::cout << "    unbind render targets (" << m_Textures[barrier.texture].name << ")\n";
+		}
+
+		for (const AccessEntry& access : m_Accesses)
+		{
+			if (access.pass != m_Order[position])
+				continue;
+
+			if (access.access == FrameGraphAccess::ShaderResource)
+				std::cout << "    read " << m_Textures[access.texture].name << " (slot " << access.slot << ")\n";
+			else
+				std::cout << "    write " << m_Textures[access.texture].name << '\n';
+		}
+	}
+
+	// Culled passes
+	for (uint32_t pass = 0; pass < m_Passes.size(); ++pass)
+	{
+		if (pass >= m_Kept.size() || !m_Kept[pass])
+			std::cout << "  " << m_Passes[pass].name << " (culled)\n";
+	}
+
+	// Where the transient textures live
+	for (uint32_t texture = 0; texture < m_Textures.size(); ++texture)
+	{
+		if (m_Textures[texture].imported)
+			continue;
+
+		uint32_t physical = this->GetPhysicalTexture(texture);
+		if (physical == INVALID_INDEX)
+			std::cout << "  " << m_Textures[texture].name << ": unused\n";
+		else
+			std::cout << "  " << m_Textures[texture].name << ": physical " << physical << '\n';
+	}
+}
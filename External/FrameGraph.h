@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Handle of a texture declared in the frame graph
+typedef uint32_t FrameGraphHandle;
+const FrameGraphHandle INVALID_FRAME_GRAPH_HANDLE = 0xFFFFFFFF;
+
+// Description of a transient texture, the format and bind flags are DXGI_FORMAT and D3D11_BIND_FLAG values
+struct FrameGraphTextureDesc
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t format = 0;
+	uint32_t bind_flags = 0;
+	uint32_t sample_count = 1;
+
+	bool operator==(const FrameGraphTextureDesc& other) const
+	{
+		return width == other.width && height == other.height && format == other.format && bind_flags == other.bind_flags && sample_count == other.sample_count;
+	}
+
+	bool operator!=(const FrameGraphTextureDesc& other) const { return !(*this == other); }
+};
+
+// How a pass uses a texture
+enum class FrameGraphAccess : uint8_t
+{
+	ShaderResource,
+	RenderTarget,
+	DepthStencil,
+};
+
+// What the graph needs from the renderer while executing
+class FrameGraphBackend
+{
+public:
+	virtual ~FrameGraphBackend() = default;
+
+	// Create, or recreate with a new description, the texture behind a physical index
+	virtual void CreateTexture(uint32_t physical_index, const FrameGraphTextureDesc& desc) = 0;
+
+	// Remove a texture from a pixel shader slot before a pass writes it
+	virtual void UnbindShaderResource(uint32_t slot) = 0;
+
+	// Remove the bound targets before a pass reads one of them
+	virtual void UnbindRenderTargets() = 0;
+};
+
+// Counters of the last compile
+struct FrameGraphStats
+{
+	uint32_t pass_count = 0;
+	uint32_t culled_pass_count = 0;
+	uint32_t texture_count = 0;
+	uint32_t physical_texture_count = 0;
+	uint32_t barrier_count = 0;
+
+	// Frames that compiled the graph and frames that reused the last compile
+	uint64_t compile_count = 0;
+	uint64_t cached_count = 0;
+};
+
+// Passes declare the textures they read and write every frame, the graph then
+// - culls passes whose output nobody uses, passes with side effects and passes writing imported textures are always kept
+// - orders the passes so every texture is written before it is read
+// - unbinds shader resources before they are written and render targets before they are read
+// - shares one physical texture between transient textures with the same description and lifetimes that don't overlap
+//
+// Declaring reuses the storage of the last frame, and compiling is skipped when the frame declares the same graph as last time
+class FrameGraph
+{
+public:
+	FrameGraph() = default;
+	virtual ~FrameGraph() = default;
+
+	// Start declaring the frame's textures and passes
+	void Reset();
+
+	// Texture created and owned by the graph, only alive between its first and last use
+	FrameGraphHandle CreateTexture(const char* name, const FrameGraphTextureDesc& desc);
+
+	// Texture owned by the renderer, such as the back buffer
+	FrameGraphHandle ImportTexture(const char* name);
+
+	// Passes and their reads and writes, reads are of pixel shader resource slots
+	uint32_t AddPass(const char* name, std::function<void()> execute);
+	void Read(uint32_t pass, FrameGraphHandle texture, uint32_t slot);
+	void Write(uint32_t pass, FrameGraphHandle texture, FrameGraphAccess access);
+	void SetSideEffects(uint32_t pass);
+
+	// Cull, order and alias, returns false if the passes depend on each other in a cycle, they then run in declaration order
+	bool Compile();
+
+	// Create missing physical textures then run the kept passes with the unbinds they need
+	void Execute(FrameGraphBackend& backend);
+
+	// Physical texture a transient texture was given by the last compile, INVALID_FRAME_GRAPH_HANDLE if unused
+	uint32_t GetPhysicalTexture(FrameGraphHandle texture) const;
+
+	// Counters
+	inline const FrameGraphStats& GetStats() const { return m_Stats; }
+
+	// Print the compiled passes, unbinds and texture assignments
+	void Print() const;
+
+private:
+	struct TextureEntry
+	{
+		const char* name;
+		FrameGraphTextureDesc desc;
+		bool imported;
+		bool operator==(const TextureEntry& other) const { return name == other.name && desc == other.desc && imported == other.imported; }
+	};
+
+	struct PassEntry
+	{
+		const char* name;
+		std::function<void()> execute;
+		bool side_effects;
+	};
+
+	struct AccessEntry
+	{
+		uint32_t pass;
+		FrameGraphHandle texture;
+		FrameGraphAccess access;
+		uint32_t slot;
+		bool operator==(const AccessEntry& other) const { return pass == other.pass && texture == other.texture && access == other.access && slot == other.slot; }
+	};
+
+	enum class BarrierType : uint8_t
+	{
+		UnbindShaderResource,
+		UnbindRenderTargets,
+	};
+
+	struct Barrier
+	{
+		BarrierType type;
+		uint32_t slot;
+		FrameGraphHandle texture;
+	};
+
+	// A physical texture and the description its backend texture was created with
+	struct PhysicalTexture
+	{
+		FrameGraphTextureDesc desc;
+		FrameGraphTextureDesc created_desc;
+		bool created = false;
+		bool in_use = false;
+		uint32_t last_use = 0;
+	};
+
+	// This frame's declarations
+	std::vector<TextureEntry> m_Textures;
+	std::vector<PassEntry> m_Passes;
+	std::vector<AccessEntry> m_Accesses;
+
+	// Declarations of the last compile, compared against to skip compiling
+	std::vector<TextureEntry> m_CompiledTextures;
+	std::vector<AccessEntry> m_CompiledAccesses;
+	std::vector<bool> m_CompiledSideEffects;
+	bool m_Compiled = false;
+	bool m_Acyclic = true;
+	bool IsSameAsCompiled() const;
+
+	// Compiled
+	std::vector<uint32_t> m_Order;
+	std::vector<uint32_t> m_BarrierStart;
+	std::vector<Barrier> m_Barriers;
+	std::vector<uint32_t> m_TexturePhysical;
+	std::vector<PhysicalTexture> m_PhysicalTextures;
+
+	// Scratch, kept to avoid allocating while compiling
+	std::vector<bool> m_Kept;
+	std::vector<bool> m_Scheduled;
+	std::vector<uint32_t> m_FirstUse;
+	std::vector<uint32_t> m_LastUse;
+	std::vector<uint32_t> m_TextureOrder;
+
+	FrameGraphStats m_Stats;
+
+	// Compile steps
+	bool IsWriter(uint32_t pass, FrameGraphHandle texture) const;
+	void CullPasses();
+	bool OrderPasses();
+	bool IsReady(uint32_t pass) const;
+	void AssignPhysicalTextures();
+	void BuildBarriers();
+
+	// What a texture is bound as, the same for textures sharing a physical texture
+	uint32_t GetBindingKey(FrameGraphHandle texture) const;
+	bool WritesBinding(uint32_t pass, uint32_t key) const;
+};
@@ -0,0 +1,402 @@
+#include "ImageDecoder.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Scratch memory handed to stb_image, once it has grown to fit the largest image no more heap allocations are made
+	struct ScratchArena
+	{
+		std::vector<uint8_t> memory;
+		size_t offset = 0;
+		size_t required = 0;
+	};
+
+	thread_local ScratchArena g_ScratchArena;
+
+	// Every allocation stores its size in front of the block, keeps 16 byte alignment
+	const size_t SCRATCH_HEADER_SIZE = 16;
+
+	inline size_t ScratchBlockSize(size_t size)
+	{
+		return SCRATCH_HEADER_SIZE + ((size + 15) & ~static_cast<size_t>(15));
+	}
+
+	inline bool IsScratchMemory(const void* ptr)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(ptr);
+		const uint8_t* begin = g_ScratchArena.memory.data();
+		return bytes >= begin && bytes < begin + g_ScratchArena.memory.size();
+	}
+
+	void* ScratchMalloc(size_t size)
+	{
+		ScratchArena& arena = g_ScratchArena;
+		const size_t block_size = ScratchBlockSize(size);
+		arena.required += block_size;
+
+		uint8_t* block = nullptr;
+		if (arena.offset + block_size <= arena.memory.size())
+		{
+			block = arena.memory.data() + arena.offset;
+			arena.offset += block_size;
+		}
+		else
+		{
+			// Arena is too small for this image, use the heap and grow the arena afterwards
+			block = static_cast<uint8_t*>(std::malloc(block_size));
+			if (block == nullptr)
+				return nullptr;
+		}
+
+		std::memcpy(block, &size, sizeof(size_t));
+		return block + SCRATCH_HEADER_SIZE;
+	}
+
+	void ScratchFree(void* ptr)
+	{
+		if (ptr == nullptr)
+			return;
+
+		uint8_t* block = static_cast<uint8_t*>(ptr) - SCRATCH_HEADER_SIZE;
+		if (!IsScratchMemory(block))
+		{
+			std::free(block);
+			return;
+		}
+
+		// Only the most recent allocation can be given back to the arena
+		size_t size = 0;
+		std::memcpy(&size, block, sizeof(size_t));
+		ScratchArena& arena = g_ScratchArena;
+		if (block + ScratchBlockSize(size) == arena.memory.data() + arena.offset)
+		{
+			arena.offset = static_cast<size_t>(block - arena.memory.data());
+		}
+	}
+
+	void* ScratchRealloc(void* ptr, size_t new_size)
+	{
+		if (ptr == nullptr)
+			return ScratchMalloc(new_size);
+
+		uint8_t* block = static_cast<uint8_t*>(ptr) - SCRATCH_HEADER_SIZE;
+		size_t old_size = 0;
+		std::memcpy(&old_size, block, sizeof(size_t));
+
+		// Grow in place when it is the most recent allocation in the arena
+		ScratchArena& arena = g_ScratchArena;
+		if (IsScratchMemory(block) && block + ScratchBlockSize(old_size) == arena.memory.data() + arena.offset)
+		{
+			const size_t block_offset = static_cast<size_t>(block - arena.memory.data());
+			if (block_offset + ScratchBlockSize(new_size) <= arena.memory.size())
+			{
+				arena.required += ScratchBlockSize(new_size) - std::min(ScratchBlockSize(new_size), ScratchBlockSize(old_size));
+				arena.offset = block_offset + ScratchBlockSize(new_size);
+				std::memcpy(block, &new_size, sizeof(size_t));
+				return ptr;
+			}
+		}
+
+		void* result = ScratchMalloc(new_size);
+		if (result == nullptr)
+			return nullptr;
+
+		std::memcpy(result, ptr, std::min(old_size, new_size));
+		ScratchFree(ptr);
+		return result;
+	}
+
+	void BeginScratch()
+	{
+		g_ScratchArena.offset = 0;
+		g_ScratchArena.required = 0;
+	}
+
+	void EndScratch()
+	{
+		// Grow to fit everything this decode needed so the next one of the same size stays in the arena
+		ScratchArena& arena = g_ScratchArena;
+		if (arena.required > arena.memory.size())
+		{
+			arena.memory.resize(arena.required);
+		}
+
+		arena.offset = 0;
+	}
+
+	// Splits the rows into bands shared out on the shared thread pool, small images are converted on the calling thread
+	template <typename Function>
+	void ParallelRows(uint32_t rows, size_t total_bytes, uint32_t thread_count, Function&& function)
+	{
+		const size_t min_bytes_per_thread = 256 * 1024;
+
+		uint32_t threads = thread_count != 0 ? thread_count : std::max(1u, std::thread::hardware_concurrency());
+		threads = static_cast<uint32_t>(std::min<size_t>(threads, std::max<size_t>(1, total_bytes / min_bytes_per_thread)));
+		threads = std::min(threads, std::max(1u, rows));
+
+		if (threads <= 1)
+		{
+			function(0, rows);
+			return;
+		}
+
+		const uint32_t rows_per_band = (rows + threads - 1) / threads;
+		const uint32_t band_count = (rows + rows_per_band - 1) / rows_per_band;
+
+		// Every thread takes the next band until there are none left, so fewer threads than asked still convert every row
+		std::atomic<uint32_t> next_band(0);
+		ThreadPool::GetShared().Run(band_count, [&]()
+		{
+			for (uint32_t band = next_band++; band < band_count; band = next_band++)
+			{
+				const uint32_t begin = band * rows_per_band;
+				function(begin, std::min(rows, begin + rows_per_band));
+			}
+		});
+	}
+
+	inline uint8_t ToUnorm8(uint8_t value)
+	{
+		return value;
+	}
+
+	inline uint8_t ToUnorm8(uint16_t value)
+	{
+		// Round to nearest rather than truncating the low byte
+		return static_cast<uint8_t>((static_cast<uint32_t>(value) * 255u + 32767u) / 65535u);
+	}
+
+	template <typename T>
+	void ConvertRow(const T* source, uint8_t* destination, uint32_t width, uint32_t channels)
+	{
+		switch (channels)
+		{
+			case 1:
+				for (uint32_t x = 0; x < width; ++x, destination += 4)
+				{
+					const uint8_t grey = ToUnorm8(source[x]);
+					destination[0] = grey;
+					destination[1] = grey;
+					destination[2] = grey;
+					destination[3] = 255;
+				}
+				break;
+
+			case 2:
+				for (uint32_t x = 0; x < width; ++x, source += 2, destination += 4)
+				{
+					const uint8_t grey = ToUnorm8(source[0]);
+					destination[0] = grey;
+					destination[1] = grey;
+					destination[2] = grey;
+					destination[3] = ToUnorm8(source[1]);
+				}
+				break;
+
+			case 3:
+				for (uint32_t x = 0; x < width; ++x, source += 3, destination += 4)
+				{
+					destination[0] = ToUnorm8(source[0]);
+					destination[1] = ToUnorm8(source[1]);
+					destination[2] = ToUnorm8(source[2]);
+					destination[3] = 255;
+				}
+				break;
+
+			case 4:
+				if constexpr (sizeof(T) == 1)
+				{
+					std::memcpy(destination, source, static_cast<size_t>(width) * 4);
+				}
+				else
+				{
+					for (uint32_t x = 0; x < width * 4; ++x)
+					{
+						destination[x] = ToUnorm8(source[x]);
+					}
+				}
+				break;
+		}
+	}
+
+	inline uint32_t ReadBigEndian32(const uint8_t* data)
+	{
+		return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) | (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+	}
+
+	// Works out if a PNG is sRGB the way WIC does, from its sRGB chunk. A PNG without one is also taken as sRGB when its gAMA
+	// is near 1/2.2, which WIC ignores; gAMA holds the encoding gamma times 100000, so 1.0 stays linear. An ICC profile
+	// overrides gAMA but isn't read, so as in WIC a PNG with one and no sRGB chunk stays linear
+	bool IsPngSRGB(const uint8_t* data, size_t size)
+	{
+		static const uint8_t png_signature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+		if (size < 8 || std::memcmp(data, png_signature, 8) != 0)
+			return false;
+
+		// gAMA of 1/2.2, with some room for encoders that round it differently
+		const uint32_t srgb_gamma = 45455;
+		const uint32_t gamma_tolerance = 1000;
+
+		bool has_icc_profile = false;
+		bool has_gamma = false;
+		uint32_t gamma = 0;
+
+		size_t offset = 8;
+		while (offset + 8 <= size)
+		{
+			const uint32_t length = ReadBigEndian32(data + offset);
+			const uint8_t* type = data + offset + 4;
+
+			if (std::memcmp(type, "sRGB", 4) == 0)
+				return true;
+
+			if (std::memcmp(type, "iCCP", 4) == 0)
+			{
+				has_icc_profile = true;
+			}
+			else if (std::memcmp(type, "gAMA", 4) == 0 && length == 4 && offset + 12 <= size)
+			{
+				has_gamma = true;
+				gamma = ReadBigEndian32(data + offset + 8);
+			}
+
+			// Colour space chunks must come before the image data
+			if (std::memcmp(type, "IDAT", 4) == 0)
+				break;
+
+			offset += static_cast<size_t>(length) + 12;
+		}
+
+		if (has_icc_profile)
+			return false;
+
+		return has_gamma && gamma + gamma_tolerance >= srgb_gamma && gamma <= srgb_gamma + gamma_tolerance;
+	}
+}
+
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_MALLOC(size) ScratchMalloc(size)
+#define STBI_REALLOC(ptr, new_size) ScratchRealloc(ptr, new_size)
+#define STBI_FREE(ptr) ScratchFree(ptr)
+#include "TinyGLTF/stb_image.h"
+
+bool ImageDecoder::DecodeFile(const std::wstring& path, ImageBuffer& output, uint32_t flags)
+{
+	std::ifstream file(std::filesystem::path(path), std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	const std::streamsize size = file.tellg();
+	if (size <= 0)
+		return false;
+
+	// Resizing keeps the capacity, so loading many files only grows the buffer to the largest file
+	m_FileData.resize(static_cast<size_t>(size));
+
+	file.seekg(0, std::ios::beg);
+	if (!file.read(reinterpret_cast<char*>(m_FileData.data()), size))
+		return false;
+
+	return this->Decode(m_FileData.data(), m_FileData.size(), output, flags);
+}
+
+void ImageDecoder::SetThreadCount(uint32_t thread_count)
+{
+	m_ThreadCount = thread_count;
+}
+
+void ImageDecoder::ConvertToRGBA8(const void* source, uint32_t width, uint32_t height, uint32_t channels, uint32_t bits_per_channel, ImageBuffer& output)
+{
+	output.width = width;
+	output.height = height;
+	output.row_pitch = width * 4;
+	output.source_channels = channels;
+	output.source_bits_per_channel = bits_per_channel;
+	output.pixels.resize(output.GetSize());
+
+	const size_t source_pitch = static_cast<size_t>(width) * channels * (bits_per_channel / 8);
+	const uint8_t* source_bytes = static_cast<const uint8_t*>(source);
+	uint8_t* destination_bytes = output.pixels.data();
+	const size_t destination_pitch = output.row_pitch;
+
+	ParallelRows(height, output.GetSize(), m_ThreadCount, [=](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t y = begin; y < end; ++y)
+		{
+			const uint8_t* source_row = source_bytes + y * source_pitch;
+			uint8_t* destination_row = destination_bytes + y * destination_pitch;
+
+			if (bits_per_channel == 16)
+			{
+				ConvertRow(reinterpret_cast<const uint16_t*>(source_row), destination_row, width, channels);
+			}
+			else
+			{
+				ConvertRow(source_row, destination_row, width, channels);
+			}
+		}
+	});
+}
+
+bool StbImageDecoder::Decode(const uint8_t* data, size_t size, ImageBuffer& output, uint32_t flags)
+{
+	m_LastError = nullptr;
+
+	const int length = static_cast<int>(size);
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+
+	BeginScratch();
+
+	// Decode in the native layout, conversion to RGBA is done afterwards across threads
+	void* pixels = nullptr;
+	uint32_t bits_per_channel = 8;
+	if (stbi_is_16_bit_from_memory(data, length))
+	{
+		pixels = stbi_load_16_from_memory(data, length, &width, &height, &channels, 0);
+		bits_per_channel = 16;
+	}
+	else
+	{
+		pixels = stbi_load_from_memory(data, length, &width, &height, &channels, 0);
+	}
+
+	if (pixels == nullptr)
+	{
+		m_LastError = stbi_failure_reason();
+		EndScratch();
+		return false;
+	}
+
+	this->ConvertToRGBA8(pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height), static_cast<uint32_t>(channels), bits_per_channel, output);
+
+	// Work out the colour space
+	if (flags & IMAGE_DECODE_FORCE_SRGB)
+	{
+		output.srgb = true;
+	}
+	else if (flags & IMAGE_DECODE_IGNORE_SRGB)
+	{
+		output.srgb = false;
+	}
+	else
+	{
+		output.srgb = IsPngSRGB(data, size);
+	}
+
+	stbi_image_free(pixels);
+	EndScratch();
+
+	return true;
+}
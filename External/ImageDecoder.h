@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <string>
+
+// Flags matching the behaviour of WIC_LOADER_FLAGS
+// Without either flag a PNG is sRGB if it has an sRGB chunk, as in WIC, or a gAMA near 1/2.2 and no ICC profile, which WIC leaves linear
+enum ImageDecodeFlags : uint32_t
+{
+	IMAGE_DECODE_DEFAULT = 0,
+	IMAGE_DECODE_FORCE_SRGB = 0x1,
+	IMAGE_DECODE_IGNORE_SRGB = 0x2,
+};
+
+// Decoded image, always stored as tightly packed 8-bit RGBA
+struct ImageBuffer
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t row_pitch = 0;
+
+	// Source layout before conversion
+	uint32_t source_channels = 0;
+	uint32_t source_bits_per_channel = 0;
+
+	// Should the pixels be sampled as sRGB (DXGI_FORMAT_R8G8B8A8_UNORM_SRGB)
+	bool srgb = false;
+
+	// Pixel storage, keeps its capacity between decodes so the buffer can be reused
+	std::vector<uint8_t> pixels;
+
+	inline size_t GetSize() const { return static_cast<size_t>(row_pitch) * height; }
+};
+
+// Decode backend interface
+class ImageDecoder
+{
+public:
+	ImageDecoder() = default;
+	virtual ~ImageDecoder() = default;
+
+	// Decode an encoded image (png, jpg, tga, bmp...) from memory into the output buffer
+	virtual bool Decode(const uint8_t* data, size_t size, ImageBuffer& output, uint32_t flags = IMAGE_DECODE_DEFAULT) = 0;
+
+	// Reads the file into a reusable staging buffer then decodes it
+	bool DecodeFile(const std::wstring& path, ImageBuffer& output, uint32_t flags = IMAGE_DECODE_DEFAULT);
+
+	// Number of threads used for format conversion, 0 uses all hardware threads
+	void SetThreadCount(uint32_t thread_count);
+
+protected:
+	uint32_t m_ThreadCount = 0;
+
+	// Converts rows in parallel from the source layout into 8-bit RGBA
+	void ConvertToRGBA8(const void* source, uint32_t width, uint32_t height, uint32_t channels, uint32_t bits_per_channel, ImageBuffer& output);
+
+private:
+	std::vector<uint8_t> m_FileData;
+};
+
+// Decode backend using stb_image, works on any platform
+class StbImageDecoder : public ImageDecoder
+{
+public:
+	StbImageDecoder() = default;
+	virtual ~StbImageDecoder() = default;
+
+	bool Decode(const uint8_t* data, size_t size, ImageBuffer& output, uint32_t flags = IMAGE_DECODE_DEFAULT) override;
+
+	// Last error reported by stb_image
+	inline const char* GetLastError() const { return m_LastError; }
+
+private:
+	const char* m_LastError = nullptr;
+};
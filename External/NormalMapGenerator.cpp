@@ -0,0 +1,309 @@
+#include "NormalMapGenerator.h"
+#include "ImageDecoder.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+namespace
+{
+	// Work is split into square tiles, a multiple of the 4x4 block size
+	const uint32_t TILE_SIZE = 64;
+
+	// Runs the function for every tile of the image, threads take the next tile until there are none left
+	template<typename Function>
+	void ParallelTiles(uint32_t width, uint32_t height, uint32_t thread_count, Function&& function)
+	{
+		const uint32_t tiles_wide = (width + TILE_SIZE - 1) / TILE_SIZE;
+		const uint32_t tiles_high = (height + TILE_SIZE - 1) / TILE_SIZE;
+		const uint32_t tile_count = tiles_wide * tiles_high;
+
+		std::atomic<uint32_t> next_tile = 0;
+		auto run = [&]()
+		{
+			for (uint32_t tile = next_tile++; tile < tile_count; tile = next_tile++)
+			{
+				const uint32_t x = (tile % tiles_wide) * TILE_SIZE;
+				const uint32_t y = (tile / tiles_wide) * TILE_SIZE;
+				function(x, y, std::min(x + TILE_SIZE, width), std::min(y + TILE_SIZE, height));
+			}
+		};
+
+		uint32_t threads = thread_count != 0 ? thread_count : std::max(1u, std::thread::hardware_concurrency());
+		threads = std::min(threads, tile_count);
+
+		ThreadPool::GetShared().Run(threads, run);
+	}
+
+	// Map [-1, 1] onto an 8-bit unorm value
+	inline float ToUnormRange(float value)
+	{
+		return std::clamp(value * 127.5f + 127.5f, 0.0f, 255.0f);
+	}
+
+	// Encode 16 values into a BC4 block using the 8 value mode
+	void EncodeBC4(const float(&values)[16], uint8_t* block)
+	{
+		float minimum = values[0];
+		float maximum = values[0];
+		for (float value : values)
+		{
+			minimum = std::min(minimum, value);
+			maximum = std::max(maximum, value);
+		}
+
+		const uint8_t endpoint0 = static_cast<uint8_t>(std::lround(maximum));
+		const uint8_t endpoint1 = static_cast<uint8_t>(std::lround(minimum));
+
+		block[0] = endpoint0;
+		block[1] = endpoint1;
+
+		// Index 0 is the first endpoint, 1 is the second and 2 - 7 step from the first towards the second
+		uint64_t indices = 0;
+		if (endpoint0 > endpoint1)
+		{
+			const float scale = 7.0f / static_cast<float>(endpoint0 - endpoint1);
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				const int step = std::clamp(static_cast<int>(std::lround((values[i] - endpoint1) * scale)), 0, 7);
+				const uint64_t index = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+				indices |= index << (i * 3);
+			}
+		}
+
+		for (uint32_t i = 0; i < 6; ++i)
+		{
+			block[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+		}
+	}
+}
+
+void NormalMapGenerator::Generate(const ImageBuffer& image)
+{
+	m_Levels.clear();
+	if (image.width == 0 || image.height == 0)
+		return;
+
+	this->LoadHeights(image);
+
+	this->ComputeNormals(image.width, image.height);
+
+	// Average each level from the last and renormalise, down to a single texel
+	while (true)
+	{
+		m_Levels.emplace_back();
+		this->Compress(m_Levels.back());
+
+		if (m_Width == 1 && m_Height == 1)
+			break;
+
+		this->DownsampleNormals();
+	}
+}
+
+void NormalMapGenerator::LoadHeights(const ImageBuffer& image)
+{
+	const uint32_t width = image.width;
+	const uint32_t height = image.height;
+
+	// Border of one texel on each side, plus 3 so the last group of 4 can be read past the edge
+	m_HeightPitch = width + 2 + 3;
+	m_Heights.assign(static_cast<size_t>(m_HeightPitch) * (height + 2), 0.0f);
+
+	auto wrap = [this](int value, uint32_t size)
+	{
+		if (m_Wrap)
+			return static_cast<uint32_t>((value + static_cast<int>(size)) % static_cast<int>(size));
+
+		return static_cast<uint32_t>(std::clamp(value, 0, static_cast<int>(size) - 1));
+	};
+
+	// Height is the luminance of the image
+	ParallelTiles(width + 2, height + 2, m_ThreadCount, [&](uint32_t begin_x, uint32_t begin_y, uint32_t end_x, uint32_t end_y)
+	{
+		for (uint32_t y = begin_y; y < end_y; ++y)
+		{
+			const uint8_t* row = image.pixels.data() + static_cast<size_t>(wrap(static_cast<int>(y) - 1, height)) * image.row_pitch;
+			float* destination = m_Heights.data() + static_cast<size_t>(y) * m_HeightPitch;
+
+			for (uint32_t x = begin_x; x < end_x; ++x)
+			{
+				const uint8_t* pixel = row + wrap(static_cast<int>(x) - 1, width) * 4;
+				destination[x] = (0.2126f * pixel[0] + 0.7152f * pixel[1] + 0.0722f * pixel[2]) / 255.0f;
+			}
+		}
+	});
+}
+
+void NormalMapGenerator::ComputeNormals(uint32_t width, uint32_t height)
+{
+	m_Width = width;
+	m_Height = height;
+
+	const size_t texel_count = static_cast<size_t>(width) * height;
+	for (std::vector<float>& plane : m_Normals)
+	{
+		plane.resize(texel_count);
+	}
+
+	// Weights of the outer and centre taps, the gradient is divided by the total weight across two texels
+	const float outer = m_Filter == NormalMapFilter::Sobel ? 1.0f : 3.0f;
+	const float centre = m_Filter == NormalMapFilter::Sobel ? 2.0f : 10.0f;
+	const float scale = m_Strength / (2.0f * (2.0f * outer + centre));
+
+	const XMVECTOR outer_weight = XMVectorReplicate(outer);
+	const XMVECTOR centre_weight = XMVectorReplicate(centre);
+	const XMVECTOR negative_scale = XMVectorReplicate(-scale);
+
+	// 4 texels of a row at a time
+	ParallelTiles(width, height, m_ThreadCount, [&](uint32_t begin_x, uint32_t begin_y, uint32_t end_x, uint32_t end_y)
+	{
+		for (uint32_t y = begin_y; y < end_y; ++y)
+		{
+			// Rows above, on and below the texel in the bordered height map
+			const float* above = m_Heights.data() + static_cast<size_t>(y) * m_HeightPitch;
+			const float* middle = above + m_HeightPitch;
+			const float* below = middle + m_HeightPitch;
+
+			for (uint32_t x = begin_x; x < end_x; x += 4)
+			{
+				auto load = [x](const float* row, uint32_t offset) { return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(row + x + offset)); };
+
+				const XMVECTOR above_left = load(above, 0);
+				const XMVECTOR above_centre = load(above, 1);
+				const XMVECTOR above_right = load(above, 2);
+				const XMVECTOR below_left = load(below, 0);
+				const XMVECTOR below_centre = load(below, 1);
+				const XMVECTOR below_right = load(below, 2);
+
+				// Slope across and down the texture
+				XMVECTOR dx = XMVectorMultiply(XMVectorSubtract(above_right, above_left), outer_weight);
+				dx = XMVectorMultiplyAdd(XMVectorSubtract(load(middle, 2), load(middle, 0)), centre_weight, dx);
+				dx = XMVectorMultiplyAdd(XMVectorSubtract(below_right, below_left), outer_weight, dx);
+
+				XMVECTOR dy = XMVectorMultiply(XMVectorSubtract(below_left, above_left), outer_weight);
+				dy = XMVectorMultiplyAdd(XMVectorSubtract(below_centre, above_centre), centre_weight, dy);
+				dy = XMVectorMultiplyAdd(XMVectorSubtract(below_right, above_right), outer_weight, dy);
+
+				// Normal is (-dx, -dy, 1) normalised
+				const XMVECTOR nx = XMVectorMultiply(dx, negative_scale);
+				const XMVECTOR ny = XMVectorMultiply(dy, negative_scale);
+				const XMVECTOR inverse_length = XMVectorReciprocalSqrt(XMVectorMultiplyAdd(nx, nx, XMVectorMultiplyAdd(ny, ny, XMVectorSplatOne())));
+
+				XMFLOAT4 results[3];
+				XMStoreFloat4(&results[0], XMVectorMultiply(nx, inverse_length));
+				XMStoreFloat4(&results[1], XMVectorMultiply(ny, inverse_length));
+				XMStoreFloat4(&results[2], inverse_length);
+
+				// Only write the texels inside the tile
+				const uint32_t count = std::min(4u, end_x - x);
+				const size_t index = static_cast<size_t>(y) * width + x;
+				for (uint32_t plane = 0; plane < 3; ++plane)
+				{
+					const float* lanes = &results[plane].x;
+					std::copy(lanes, lanes + count, m_Normals[plane].begin() + index);
+				}
+			}
+		}
+	});
+}
+
+void NormalMapGenerator::DownsampleNormals()
+{
+	const uint32_t width = m_Width;
+	const uint32_t height = m_Height;
+	const uint32_t output_width = std::max(1u, width / 2);
+	const uint32_t output_height = std::max(1u, height / 2);
+
+	for (std::vector<float>& plane : m_Scratch)
+	{
+		plane.resize(static_cast<size_t>(output_width) * output_height);
+	}
+
+	ParallelTiles(output_width, output_height, m_ThreadCount, [&](uint32_t begin_x, uint32_t begin_y, uint32_t end_x, uint32_t end_y)
+	{
+		for (uint32_t y = begin_y; y < end_y; ++y)
+		{
+			// A side of 1 texel is not halved
+			const size_t row0 = static_cast<size_t>(std::min(y * 2, height - 1)) * width;
+			const size_t row1 = static_cast<size_t>(std::min(y * 2 + 1, height - 1)) * width;
+
+			for (uint32_t x = begin_x; x < end_x; ++x)
+			{
+				const uint32_t x0 = std::min(x * 2, width - 1);
+				const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+
+				XMVECTOR sum = XMVectorZero();
+				for (size_t index : { row0 + x0, row0 + x1, row1 + x0, row1 + x1 })
+				{
+					sum = XMVectorAdd(sum, XMVectorSet(m_Normals[0][index], m_Normals[1][index], m_Normals[2][index], 0.0f));
+				}
+
+				// Averaging shortens the normal, renormalise so each level is lit correctly
+				XMFLOAT3 normal;
+				XMStoreFloat3(&normal, XMVector3Normalize(sum));
+
+				const size_t output_index = static_cast<size_t>(y) * output_width + x;
+				m_Scratch[0][output_index] = normal.x;
+				m_Scratch[1][output_index] = normal.y;
+				m_Scratch[2][output_index] = normal.z;
+			}
+		}
+	});
+
+	for (uint32_t plane = 0; plane < 3; ++plane)
+	{
+		m_Normals[plane].swap(m_Scratch[plane]);
+	}
+
+	m_Width = output_width;
+	m_Height = output_height;
+}
+
+void NormalMapGenerator::Compress(NormalMapLevel& level)
+{
+	const uint32_t width = m_Width;
+	const uint32_t height = m_Height;
+
+	const uint32_t blocks_wide = (width + 3) / 4;
+	const uint32_t blocks_high = (height + 3) / 4;
+	const size_t block_size = 16;
+
+	level.width = width;
+	level.height = height;
+	level.row_pitch = static_cast<uint32_t>(blocks_wide * block_size);
+	level.blocks.resize(static_cast<size_t>(level.row_pitch) * blocks_high);
+
+	// Tiles are in blocks
+	ParallelTiles(blocks_wide, blocks_high, m_ThreadCount, [&](uint32_t begin_x, uint32_t begin_y, uint32_t end_x, uint32_t end_y)
+	{
+		float red[16];
+		float green[16];
+
+		for (uint32_t by = begin_y; by < end_y; ++by)
+		{
+			for (uint32_t bx = begin_x; bx < end_x; ++bx)
+			{
+				// Texels past the edge of small levels repeat the last row and column
+				for (uint32_t i = 0; i < 16; ++i)
+				{
+					const uint32_t x = std::min(bx * 4 + (i % 4), width - 1);
+					const uint32_t y = std::min(by * 4 + (i / 4), height - 1);
+					const size_t index = static_cast<size_t>(y) * width + x;
+
+					red[i] = ToUnormRange(m_Normals[0][index]);
+					green[i] = ToUnormRange(m_Normals[1][index]);
+				}
+
+				uint8_t* block = level.blocks.data() + static_cast<size_t>(by) * level.row_pitch + bx * block_size;
+				EncodeBC4(red, block);
+				EncodeBC4(green, block + 8);
+			}
+		}
+	});
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct ImageBuffer;
+
+// Gradient kernel used to find the slope of the height map
+enum class NormalMapFilter
+{
+	Sobel,
+	Scharr,
+};
+
+// One BC5 compressed mip level, red holds the tangent x and green the tangent y
+// Upload as DXGI_FORMAT_BC5_UNORM and rebuild z in the shader
+struct NormalMapLevel
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+
+	// Bytes per row of 4x4 blocks
+	uint32_t row_pitch = 0;
+
+	std::vector<uint8_t> blocks;
+};
+
+// Derives a tangent space normal map (DirectX convention, +y points down the texture) from a height or albedo map
+class NormalMapGenerator
+{
+public:
+	NormalMapGenerator() = default;
+	virtual ~NormalMapGenerator() = default;
+
+	// Derive normals from the luminance of the image, then build and compress the full mip chain
+	void Generate(const ImageBuffer& image);
+
+	// Compressed mip chain from the last call to Generate
+	inline const std::vector<NormalMapLevel>& GetLevels() const { return m_Levels; }
+
+	// Settings
+	inline void SetFilter(NormalMapFilter filter) { m_Filter = filter; }
+	inline void SetStrength(float strength) { m_Strength = strength; }
+	inline void SetWrap(bool wrap) { m_Wrap = wrap; }
+
+	// Number of threads used for each pass, 0 uses all hardware threads
+	inline void SetThreadCount(uint32_t thread_count) { m_ThreadCount = thread_count; }
+
+private:
+	NormalMapFilter m_Filter = NormalMapFilter::Scharr;
+	float m_Strength = 4.0f;
+	bool m_Wrap = true;
+	uint32_t m_ThreadCount = 0;
+
+	std::vector<NormalMapLevel> m_Levels;
+
+	// Height map with a border of one texel so the kernel never needs to check the edges
+	void LoadHeights(const ImageBuffer& image);
+	std::vector<float> m_Heights;
+	uint32_t m_HeightPitch = 0;
+
+	// Uncompressed normals of the current level, stored as separate x, y and z planes
+	void ComputeNormals(uint32_t width, uint32_t height);
+	void DownsampleNormals();
+	std::vector<float> m_Normals[3];
+	uint32_t m_Width = 0;
+	uint32_t m_Height = 0;
+	std::vector<float> m_Scratch[3];
+
+	// Pack the current level into BC5 blocks
+	void Compress(NormalMapLevel& level);
+};
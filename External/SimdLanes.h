@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+
+// Four floats at a time through SSE2, or one at a time through the same code where SSE2 isn't available
+//
+// Shared by the structure of arrays loops of the samples, which are written for LANE_COUNT lanes. Every x64 CPU has SSE2 so
+// it needs no check at runtime. AVX isn't used: the projects don't build with /arch:AVX, and picking eight lanes safely would
+// need a second build of each loop chosen by CPUID at runtime
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_LANES_SSE
+#endif
+
+namespace Simd
+{
+#if defined(SIMD_LANES_SSE)
+	typedef __m128 Lanes;
+	const uint32_t LANE_COUNT = 4;
+	const uint32_t ALL_LANES = 0xF;
+	const char* const INSTRUCTION_SET = "SSE2";
+
+	inline Lanes Load(const float* values) { return _mm_loadu_ps(values); }
+	inline void Store(float* values, Lanes a) { _mm_storeu_ps(values, a); }
+	inline Lanes Splat(float value) { return _mm_set1_ps(value); }
+	inline Lanes Add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+	inline Lanes Subtract(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+	inline Lanes Multiply(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+	inline Lanes Divide(Lanes a, Lanes b) { return _mm_div_ps(a, b); }
+	inline Lanes MultiplyAdd(Lanes a, Lanes b, Lanes c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	inline Lanes Min(Lanes a, Lanes b) { return _mm_min_ps(a, b); }
+	inline Lanes Max(Lanes a, Lanes b) { return _mm_max_ps(a, b); }
+	inline Lanes Abs(Lanes a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+	// Comparisons as a bit per lane
+	inline uint32_t NotNegativeMask(Lanes a) { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpge_ps(a, _mm_setzero_ps()))); }
+	inline uint32_t GreaterMask(Lanes a, Lanes b) { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpgt_ps(a, b))); }
+	inline uint32_t GreaterEqualMask(Lanes a, Lanes b) { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpge_ps(a, b))); }
+	inline uint32_t LessMask(Lanes a, Lanes b) { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(a, b))); }
+	inline uint32_t LessEqualMask(Lanes a, Lanes b) { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(a, b))); }
+
+	// Comparisons kept in the lanes with every bit set where true, for choosing between lanes without leaving the registers
+	inline Lanes GreaterThanZero(Lanes a) { return _mm_cmpgt_ps(a, _mm_setzero_ps()); }
+	inline Lanes And(Lanes a, Lanes b) { return _mm_and_ps(a, b); }
+	inline Lanes Select(Lanes mask, Lanes a, Lanes b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	inline bool Any(Lanes mask) { return _mm_movemask_ps(mask) != 0; }
+#else
+	typedef float Lanes;
+	const uint32_t LANE_COUNT = 1;
+	const uint32_t ALL_LANES = 0x1;
+	const char* const INSTRUCTION_SET = "Scalar";
+
+	inline Lanes Load(const float* values) { return *values; }
+	inline void Store(float* values, Lanes a) { *values = a; }
+	inline Lanes Splat(float value) { return value; }
+	inline Lanes Add(Lanes a, Lanes b) { return a + b; }
+	inline Lanes Subtract(Lanes a, Lanes b) { return a - b; }
+	inline Lanes Multiply(Lanes a, Lanes b) { return a * b; }
+	inline Lanes Divide(Lanes a, Lanes b) { return a / b; }
+	inline Lanes MultiplyAdd(Lanes a, Lanes b, Lanes c) { return a * b + c; }
+	inline Lanes Min(Lanes a, Lanes b) { return std::min(a, b); }
+	inline Lanes Max(Lanes a, Lanes b) { return std::max(a, b); }
+	inline Lanes Abs(Lanes a) { return std::fabs(a); }
+
+	// Comparisons as a bit per lane
+	inline uint32_t NotNegativeMask(Lanes a) { return (a >= 0.0f) ? 1 : 0; }
+	inline uint32_t GreaterMask(Lanes a, Lanes b) { return (a > b) ? 1 : 0; }
+	inline uint32_t GreaterEqualMask(Lanes a, Lanes b) { return (a >= b) ? 1 : 0; }
+	inline uint32_t LessMask(Lanes a, Lanes b) { return (a < b) ? 1 : 0; }
+	inline uint32_t LessEqualMask(Lanes a, Lanes b) { return (a <= b) ? 1 : 0; }
+#endif
+}
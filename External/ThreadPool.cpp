@@ -0,0 +1,98 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace
+{
+	// Set on the pool's workers, so work that runs another pool doesn't wait on itself
+	thread_local bool t_IsWorker = false;
+}
+
+ThreadPool::ThreadPool(uint32_t worker_count)
+{
+	m_Workers.reserve(worker_count);
+	for (uint32_t i = 0; i < worker_count; ++i)
+	{
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+
+	m_WorkReady.notify_all();
+
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+ThreadPool& ThreadPool::GetShared()
+{
+	// hardware_concurrency can return 0 when it doesn't know
+	static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+	return pool;
+}
+
+uint32_t ThreadPool::Run(uint32_t thread_count, const std::function<void()>& work)
+{
+	uint32_t extra_threads = std::min(std::max(1u, thread_count) - 1, this->GetWorkerCount());
+
+	// Nested or overlapping runs, or nothing to share, stay on this thread
+	std::unique_lock<std::mutex> run_lock(m_RunMutex, std::defer_lock);
+	if (extra_threads == 0 || t_IsWorker || !run_lock.try_lock())
+	{
+		work();
+		return 1;
+	}
+
+	// Offer the work to the workers then do it here as well
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Work = &work;
+		m_Unclaimed = extra_threads;
+	}
+
+	m_WorkReady.notify_all();
+
+	work();
+
+	// Withdraw the offer from workers that haven't started and wait for the ones that have
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	uint32_t used_threads = 1 + extra_threads - m_Unclaimed;
+	m_Unclaimed = 0;
+	m_WorkDone.wait(lock, [this]() { return m_Running == 0; });
+	m_Work = nullptr;
+
+	return used_threads;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	t_IsWorker = true;
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while (true)
+	{
+		m_WorkReady.wait(lock, [this]() { return m_Stopping || m_Unclaimed > 0; });
+		if (m_Stopping)
+			return;
+
+		m_Unclaimed--;
+		m_Running++;
+		const std::function<void()>* work = m_Work;
+
+		lock.unlock();
+		(*work)();
+		lock.lock();
+
+		if (--m_Running == 0)
+		{
+			m_WorkDone.notify_all();
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Worker threads started once and reused, so splitting a frame's work between threads doesn't pay for creating them each time
+//
+// Run hands the same work to the calling thread and up to thread_count - 1 waiting workers and returns once every copy has
+// finished. The work is expected to share itself out, such as taking chunks from an atomic counter, as it can end up running
+// on fewer threads than asked: workers that haven't picked it up by the time the calling thread is done are skipped, and a Run
+// from inside a worker or while another Run is in progress only uses the calling thread
+class ThreadPool
+{
+public:
+	explicit ThreadPool(uint32_t worker_count);
+	virtual ~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Pool shared by the whole application with a worker for every hardware thread but the calling one, started on first use
+	static ThreadPool& GetShared();
+
+	// Run the work on up to thread_count threads including this one, returns how many ran it
+	uint32_t Run(uint32_t thread_count, const std::function<void()>& work);
+
+	inline uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+
+private:
+	std::vector<std::thread> m_Workers;
+
+	// Held for the whole of a Run so only one runs at a time
+	std::mutex m_RunMutex;
+
+	// Work waiting for workers, how many more may pick it up and how many are still running it
+	std::mutex m_Mutex;
+	std::condition_variable m_WorkReady;
+	std::condition_variable m_WorkDone;
+	const std::function<void()>* m_Work = nullptr;
+	uint32_t m_Unclaimed = 0;
+	uint32_t m_Running = 0;
+	bool m_Stopping = false;
+
+	void WorkerLoop();
+};
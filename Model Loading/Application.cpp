@@ -11,6 +11,92 @@
 using namespace DirectX;
 
 #include <windowsx.h>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Nearest triangle the ray hits by testing every triangle of the index list, what picking did without a hierarchy
+	bool RaycastTriangles(const std::vector<XMFLOAT3>& positions, const std::vector<uint32_t>& indices, const XMFLOAT3& origin, const XMFLOAT3& direction,
+		float max_distance, uint32_t& triangle, float& distance)
+	{
+		XMVECTOR ray_origin = XMLoadFloat3(&origin);
+		XMVECTOR ray_direction = XMLoadFloat3(&direction);
+
+		bool hit = false;
+		distance = max_distance;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			XMVECTOR a = XMLoadFloat3(&positions[indices[i + 0]]);
+			XMVECTOR edge_a = XMVectorSubtract(XMLoadFloat3(&positions[indices[i + 1]]), a);
+			XMVECTOR edge_b = XMVectorSubtract(XMLoadFloat3(&positions[indices[i + 2]]), a);
+
+			// Moller-Trumbore, hitting both sides
+			XMVECTOR p = XMVector3Cross(ray_direction, edge_b);
+			float determinant = XMVectorGetX(XMVector3Dot(edge_a, p));
+			if (std::fabs(determinant) <= 1e-20f)
+				continue;
+
+			float inverse_determinant = 1.0f / determinant;
+			XMVECTOR to_origin = XMVectorSubtract(ray_origin, a);
+			float u = XMVectorGetX(XMVector3Dot(to_origin, p)) * inverse_determinant;
+			if (u < 0.0f || u > 1.0f)
+				continue;
+
+			XMVECTOR q = XMVector3Cross(to_origin, edge_a);
+			float v = XMVectorGetX(XMVector3Dot(ray_direction, q)) * inverse_determinant;
+			if (v < 0.0f || u + v > 1.0f)
+				continue;
+
+			float t = XMVectorGetX(XMVector3Dot(edge_b, q)) * inverse_determinant;
+			if (t >= 0.0f && t < distance)
+			{
+				distance = t;
+				triangle = static_cast<uint32_t>(i / 3);
+				hit = true;
+			}
+		}
+
+		return hit;
+	}
+
+	// Bumpy sphere of radius one with four triangles per segment squared
+	void CreateSphereMesh(uint32_t segments, std::vector<XMFLOAT3>& positions, std::vector<uint32_t>& indices)
+	{
+		const uint32_t rings = segments;
+		const uint32_t slices = segments * 2;
+
+		std::mt19937 generator(42);
+		std::uniform_real_distribution<float> bump_distribution(0.98f, 1.02f);
+
+		positions.clear();
+		for (uint32_t ring = 0; ring <= rings; ++ring)
+		{
+			float theta = XM_PI * ring / rings;
+			for (uint32_t slice = 0; slice <= slices; ++slice)
+			{
+				float phi = XM_2PI * slice / slices;
+				float radius = bump_distribution(generator);
+				positions.push_back(XMFLOAT3(radius * std::sin(theta) * std::cos(phi), radius * std::cos(theta), radius * std::sin(theta) * std::sin(phi)));
+			}
+		}
+
+		indices.clear();
+		for (uint32_t ring = 0; ring < rings; ++ring)
+		{
+			for (uint32_t slice = 0; slice < slices; ++slice)
+			{
+				uint32_t a = ring * (slices + 1) + slice;
+				uint32_t b = a + slices + 1;
+				indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+			}
+		}
+	}
+}
 
 Application::Application()
 {
@@ -42,6 +128,9 @@ int Application::Execute()
 	m_Model = std::make_unique<Model>(m_Renderer.get());
 	m_Model->Create();
 
+	std::cout << "Right click to pick a triangle, B to benchmark picking\n";
+	m_Model->GetBVH().Print();
+
 	// Raster state
 	m_RasterState = std::make_unique<RasterState>(m_Renderer.get());
 	m_RasterState->ToggleWireframe();
@@ -104,6 +193,10 @@ LRESULT Application::HandleMessage(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lP
 			this->OnMouseMove(hwnd, msg, wParam, lParam);
 			return 0;
 
+		case WM_RBUTTONDOWN:
+			this->PickTriangle(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+			return 0;
+
 		case WM_KEYDOWN:
 			this->OnKeyDown(hwnd, msg, wParam, lParam);
 			return 0;
@@ -160,7 +253,147 @@ void Application::OnKeyDown(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
 	if (!key_repeat)
 	{
-		m_RasterState->ToggleWireframe();
+		// B runs the picking benchmark, every other key toggles wireframe
+		if (wParam == 'B')
+		{
+			this->RunPickingBenchmark();
+		}
+		else
+		{
+			m_RasterState->ToggleWireframe();
+		}
+	}
+}
+
+void Application::PickTriangle(int mouse_x, int mouse_y)
+{
+	int width, height;
+	m_Window->GetSize(&width, &height);
+
+	// Ray from the cursor on the near plane to the far plane, the model's world is the identity
+	XMMATRIX view = m_Camera->GetView();
+	XMMATRIX projection = m_Camera->GetProjection();
+	XMVECTOR near_point = XMVector3Unproject(XMVectorSet(static_cast<float>(mouse_x), static_cast<float>(mouse_y), 0.0f, 0.0f), 0.0f, 0.0f,
+		static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f, projection, view, XMMatrixIdentity());
+	XMVECTOR far_point = XMVector3Unproject(XMVectorSet(static_cast<float>(mouse_x), static_cast<float>(mouse_y), 1.0f, 0.0f), 0.0f, 0.0f,
+		static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f, projection, view, XMMatrixIdentity());
+
+	XMFLOAT3 origin, direction;
+	XMStoreFloat3(&origin, near_point);
+	XMStoreFloat3(&direction, XMVectorSubtract(far_point, near_point));
+
+	// Distances are fractions of the way to the far plane
+	uint32_t triangle = 0;
+	float distance = 0.0f;
+
+	auto start_time = std::chrono::high_resolution_clock::now();
+	bool hit = m_Model->Pick(origin, direction, 1.0f, triangle, distance);
+	auto end_time = std::chrono::high_resolution_clock::now();
+	double microseconds = std::chrono::duration<double, std::micro>(end_time - start_time).count();
+
+	if (hit)
+	{
+		std::cout << "Picked triangle " << triangle << ", " << distance * XMVectorGetX(XMVector3Length(XMLoadFloat3(&direction))) << " units away in " << microseconds
+			<< " us\n";
+	}
+	else
+	{
+		std::cout << "No triangle under the cursor, " << microseconds << " us\n";
+	}
+}
+
+void Application::RunPickingBenchmark()
+{
+	const uint32_t sphere_segments[] = { 160, 720 };
+	const uint32_t ray_count = 100000;
+	const uint32_t brute_force_ray_count = 100;
+	const uint32_t thread_count = std::thread::hardware_concurrency();
+
+	std::cout << "Picking benchmark - building the BVH and casting rays through it against testing every triangle (" << MeshBVH::GetInstructionSet() << ")\n";
+
+	// Rays from a sphere of radius four around the model towards points near its middle, like picks from the orbiting camera
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	std::vector<XMFLOAT3> ray_origins(ray_count);
+	std::vector<XMFLOAT3> ray_directions(ray_count);
+	for (uint32_t i = 0; i < ray_count; ++i)
+	{
+		XMVECTOR origin = XMVectorScale(XMVector3Normalize(XMVectorSet(distribution(generator), distribution(generator), distribution(generator), 0.0f)), 4.0f);
+		XMVECTOR target = XMVectorSet(distribution(generator), distribution(generator), distribution(generator), 0.0f);
+		XMStoreFloat3(&ray_origins[i], origin);
+		XMStoreFloat3(&ray_directions[i], XMVectorSubtract(target, origin));
+	}
+
+	// Time one mesh
+	auto benchmark = [&](const std::vector<XMFLOAT3>& positions, const std::vector<uint32_t>& indices)
+	{
+		// Build on one thread then every core
+		MeshBVH bvh;
+		bvh.Build(positions.data(), indices.data(), static_cast<uint32_t>(indices.size()), 1);
+		double serial_build_ms = bvh.GetStats().build_milliseconds;
+
+		bvh.Build(positions.data(), indices.data(), static_cast<uint32_t>(indices.size()), thread_count);
+		std::cout << "    Build: " << serial_build_ms << " ms on one thread, " << bvh.GetStats().build_milliseconds << " ms on " << bvh.GetStats().thread_count << " threads\n";
+		std::cout << "    Memory: " << static_cast<double>(bvh.GetStats().memory_bytes) / bvh.GetTriangleCount() << " bytes per triangle, " << bvh.GetStats().node_count
+			<< " nodes\n";
+
+		// Every ray through the hierarchy
+		uint32_t hit_count = 0;
+		auto start_time = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < ray_count; ++i)
+		{
+			uint32_t triangle = 0;
+			float distance = 0.0f;
+			hit_count += bvh.Raycast(ray_origins[i], ray_directions[i], 1.0f, triangle, distance) ? 1 : 0;
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		double bvh_us = std::chrono::duration<double, std::micro>(end_time - start_time).count() / ray_count;
+
+		// A few rays testing every triangle
+		std::vector<float> distances(brute_force_ray_count, -1.0f);
+		start_time = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < brute_force_ray_count; ++i)
+		{
+			uint32_t triangle = 0;
+			RaycastTriangles(positions, indices, ray_origins[i], ray_directions[i], 1.0f, triangle, distances[i]);
+		}
+		end_time = std::chrono::high_resolution_clock::now();
+		double brute_force_us = std::chrono::duration<double, std::micro>(end_time - start_time).count() / brute_force_ray_count;
+
+		// Both should find the same distance, the triangle can differ where triangles meet
+		uint32_t mismatch_count = 0;
+		for (uint32_t i = 0; i < brute_force_ray_count; ++i)
+		{
+			uint32_t triangle = 0;
+			float distance = 1.0f;
+			bvh.Raycast(ray_origins[i], ray_directions[i], 1.0f, triangle, distance);
+			if (std::fabs(distance - distances[i]) > 1e-5f)
+			{
+				mismatch_count++;
+			}
+		}
+
+		std::cout << "    Pick: BVH " << bvh_us << " us (" << 1.0 / bvh_us << " million rays a second, " << hit_count * 100 / ray_count << "% hit), every triangle "
+			<< brute_force_us << " us, " << mismatch_count << " of " << brute_force_ray_count << " differ\n";
+	};
+
+	// The loaded model
+	std::vector<XMFLOAT3> positions;
+	for (const Vertex& vertex : m_Model->GetVertices())
+	{
+		positions.push_back(XMFLOAT3(vertex.position.x, vertex.position.y, vertex.position.z));
+	}
+
+	std::vector<uint32_t> indices = m_Model->GetIndices();
+	std::cout << "  Model, " << indices.size() / 3 << " triangles\n";
+	benchmark(positions, indices);
+
+	// Spheres of a hundred thousand and two million triangles
+	for (uint32_t segments : sphere_segments)
+	{
+		CreateSphereMesh(segments, positions, indices);
+		std::cout << "  Sphere, " << indices.size() / 3 << " triangles\n";
+		benchmark(positions, indices);
 	}
 }
 
@@ -50,6 +50,12 @@ private:
 	// On keydown event
 	void OnKeyDown(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
+	// Print the triangle of the model under the cursor and how long it took to find
+	void PickTriangle(int mouse_x, int mouse_y);
+
+	// Time building the picking hierarchy and casting rays through it against testing every triangle
+	void RunPickingBenchmark();
+
 	// Calculate frame stats
 	void CalculateFrameStats(float delta_time);
 	int m_FrameCount = 0;
@@ -0,0 +1,755 @@
+#include "MeshBVH.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include "../External/SimdLanes.h"
+#include "../External/ThreadPool.h"
+
+namespace
+{
+	using namespace Simd;
+
+	// Bins along each axis the splits are chosen between
+	const uint32_t BIN_COUNT = 16;
+
+	// Relative cost of stepping into a node and of testing a triangle, for the surface area heuristic
+	const float TRAVERSAL_COST = 1.0f;
+	const float INTERSECTION_COST = 1.0f;
+
+	// Ranges this small are built by whichever thread reaches them rather than being shared out
+	const uint32_t MIN_TASK_SIZE = 4096;
+
+	// Each level pops one node and pushes up to four
+	const uint32_t STACK_SIZE = MAX_BVH_DEPTH * (BVH_WIDTH - 1) + BVH_WIDTH;
+
+	// Grow a box padded out to four components to hold another
+	inline void GrowBox(float* min, float* max, const float* other_min, const float* other_max)
+	{
+#if defined(SIMD_LANES_SSE)
+		_mm_storeu_ps(min, _mm_min_ps(_mm_loadu_ps(min), _mm_loadu_ps(other_min)));
+		_mm_storeu_ps(max, _mm_max_ps(_mm_loadu_ps(max), _mm_loadu_ps(other_max)));
+#else
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			min[axis] = std::min(min[axis], other_min[axis]);
+			max[axis] = std::max(max[axis], other_max[axis]);
+		}
+#endif
+	}
+
+	// Half the surface area of a box, which is all the heuristic needs
+	inline float HalfArea(const float* min, const float* max)
+	{
+		float x = max[0] - min[0];
+		float y = max[1] - min[1];
+		float z = max[2] - min[2];
+		return x * y + y * z + z * x;
+	}
+
+	// Ray ready for the slab tests, the side of each box the ray enters through is chosen by the direction's signs
+	struct Ray
+	{
+		float origin[3];
+		float direction[3];
+		float inverse[3];
+		uint32_t near_bounds[3];
+		uint32_t far_bounds[3];
+	};
+
+	// Returns a bit for each of a node's boxes the ray enters before max_distance and writes where it enters them
+	inline uint32_t IntersectBoxes(const float bounds[6][BVH_WIDTH], const Ray& ray, float max_distance, float* entry)
+	{
+#if defined(SIMD_LANES_SSE)
+		__m128 near_x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bounds[ray.near_bounds[0]]), _mm_set1_ps(ray.origin[0])), _mm_set1_ps(ray.inverse[0]));
+		__m128 near_y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bounds[ray.near_bounds[1]]), _mm_set1_ps(ray.origin[1])), _mm_set1_ps(ray.inverse[1]));
+		__m128 near_z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bounds[ray.near_bounds[2]]), _mm_set1_ps(ray.origin[2])), _mm_set1_ps(ray.inverse[2]));
+		__m128 far_x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bounds[ray.far_bounds[0]]), _mm_set1_ps(ray.origin[0])), _mm_set1_ps(ray.inverse[0]));
+		__m128 far_y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bounds[ray.far_bounds[1]]), _mm_set1_ps(ray.origin[1])), _mm_set1_ps(ray.inverse[1]));
+		__m128 far_z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bounds[ray.far_bounds[2]]), _mm_set1_ps(ray.origin[2])), _mm_set1_ps(ray.inverse[2]));
+
+		__m128 enter = _mm_max_ps(_mm_max_ps(near_x, near_y), _mm_max_ps(near_z, _mm_setzero_ps()));
+		__m128 exit = _mm_min_ps(_mm_min_ps(far_x, far_y), _mm_min_ps(far_z, _mm_set1_ps(max_distance)));
+
+		_mm_storeu_ps(entry, enter);
+		return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(enter, exit)));
+#else
+		uint32_t mask = 0;
+		for (uint32_t i = 0; i < BVH_WIDTH; ++i)
+		{
+			float enter = 0.0f;
+			float exit = max_distance;
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				enter = std::max(enter, (bounds[ray.near_bounds[axis]][i] - ray.origin[axis]) * ray.inverse[axis]);
+				exit = std::min(exit, (bounds[ray.far_bounds[axis]][i] - ray.origin[axis]) * ray.inverse[axis]);
+			}
+
+			entry[i] = enter;
+			mask |= (enter <= exit) ? (1u << i) : 0;
+		}
+
+		return mask;
+#endif
+	}
+}
+
+void MeshBVH::Clear()
+{
+	m_Nodes.clear();
+	m_VertexX.clear();
+	m_VertexY.clear();
+	m_VertexZ.clear();
+	m_EdgeAX.clear();
+	m_EdgeAY.clear();
+	m_EdgeAZ.clear();
+	m_EdgeBX.clear();
+	m_EdgeBY.clear();
+	m_EdgeBZ.clear();
+	m_TriangleIds.clear();
+	m_Stats = MeshBVHStats();
+}
+
+void MeshBVH::Build(const XMFLOAT3* positions, const uint32_t* indices, uint32_t index_count, uint32_t thread_count)
+{
+	auto start_time = std::chrono::high_resolution_clock::now();
+
+	this->Clear();
+	thread_count = std::max(thread_count, 1u);
+
+	uint32_t triangle_count = index_count / 3;
+	m_Stats.triangle_count = triangle_count;
+	if (triangle_count == 0)
+		return;
+
+	// Bounds and centroid of every triangle
+	m_BuildTriangles.resize(triangle_count);
+	for (uint32_t i = 0; i < triangle_count; ++i)
+	{
+		const XMFLOAT3& a = positions[indices[i * 3 + 0]];
+		const XMFLOAT3& b = positions[indices[i * 3 + 1]];
+		const XMFLOAT3& c = positions[indices[i * 3 + 2]];
+
+		BuildTriangle& triangle = m_BuildTriangles[i];
+		triangle.min[0] = std::min({ a.x, b.x, c.x });
+		triangle.min[1] = std::min({ a.y, b.y, c.y });
+		triangle.min[2] = std::min({ a.z, b.z, c.z });
+		triangle.max[0] = std::max({ a.x, b.x, c.x });
+		triangle.max[1] = std::max({ a.y, b.y, c.y });
+		triangle.max[2] = std::max({ a.z, b.z, c.z });
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			triangle.centroid[axis] = (triangle.min[axis] + triangle.max[axis]) * 0.5f;
+		}
+
+		triangle.id = i;
+	}
+
+	BuildRange root;
+	root.begin = 0;
+	root.end = triangle_count;
+	this->CalculateRange(root);
+
+	// Split the top of the tree until there are a few subtrees for each thread
+	uint32_t task_size = std::max(triangle_count / (thread_count * 4), MIN_TASK_SIZE);
+	std::vector<BuildTask> tasks;
+	uint32_t max_depth = 0;
+	if (thread_count > 1 && triangle_count > task_size)
+	{
+		this->BuildTop(root, 0, task_size, tasks, max_depth);
+	}
+	else
+	{
+		this->BuildSubtree(m_Nodes, root, 0, max_depth);
+	}
+
+	// Build the subtrees largest first, each thread into its own list of nodes
+	std::sort(tasks.begin(), tasks.end(), [](const BuildTask& a, const BuildTask& b) { return a.range.end - a.range.begin > b.range.end - b.range.begin; });
+
+	uint32_t worker_count = std::min(thread_count, static_cast<uint32_t>(tasks.size()));
+	std::vector<std::vector<Node>> thread_nodes(worker_count);
+	std::vector<uint32_t> thread_max_depth(worker_count, 0);
+	std::vector<uint32_t> task_thread(tasks.size());
+	std::vector<uint32_t> task_root(tasks.size());
+	std::atomic<uint32_t> next_task(0);
+
+	// Every thread that picks up the work takes its own index for its list of nodes
+	std::atomic<uint32_t> next_thread(0);
+	auto worker = [&]()
+	{
+		const uint32_t thread = next_thread++;
+		for (uint32_t task = next_task++; task < tasks.size(); task = next_task++)
+		{
+			task_thread[task] = thread;
+			task_root[task] = this->BuildSubtree(thread_nodes[thread], tasks[task].range, tasks[task].depth, thread_max_depth[thread]);
+		}
+	};
+
+	uint32_t used_threads = 1;
+	if (worker_count > 0)
+	{
+		used_threads = ThreadPool::GetShared().Run(worker_count, worker);
+	}
+
+	// Append each thread's nodes after the top of the tree and move their child indices along with them
+	std::vector<uint32_t> thread_offset(worker_count);
+	for (uint32_t i = 0; i < worker_count; ++i)
+	{
+		thread_offset[i] = static_cast<uint32_t>(m_Nodes.size());
+		for (Node& node : thread_nodes[i])
+		{
+			for (uint32_t slot = 0; slot < BVH_WIDTH; ++slot)
+			{
+				if (node.count[slot] == 0 && node.child[slot] != INVALID_INDEX)
+				{
+					node.child[slot] += thread_offset[i];
+				}
+			}
+		}
+
+		m_Nodes.insert(m_Nodes.end(), thread_nodes[i].begin(), thread_nodes[i].end());
+		max_depth = std::max(max_depth, thread_max_depth[i]);
+	}
+
+	// Link the subtrees into the top of the tree
+	for (size_t i = 0; i < tasks.size(); ++i)
+	{
+		m_Nodes[tasks[i].parent].child[tasks[i].slot] = thread_offset[task_thread[i]] + task_root[i];
+	}
+
+	// Store the triangles in leaf order, with a set of empty lanes on the end
+	uint32_t padded_count = triangle_count + LANE_COUNT;
+	for (std::vector<float>* values : { &m_VertexX, &m_VertexY, &m_VertexZ, &m_EdgeAX, &m_EdgeAY, &m_EdgeAZ, &m_EdgeBX, &m_EdgeBY, &m_EdgeBZ })
+	{
+		values->assign(padded_count, 0.0f);
+	}
+
+	m_TriangleIds.resize(triangle_count);
+	for (uint32_t i = 0; i < triangle_count; ++i)
+	{
+		uint32_t id = m_BuildTriangles[i].id;
+		const XMFLOAT3& a = positions[indices[id * 3 + 0]];
+		const XMFLOAT3& b = positions[indices[id * 3 + 1]];
+		const XMFLOAT3& c = positions[indices[id * 3 + 2]];
+
+		m_VertexX[i] = a.x;
+		m_VertexY[i] = a.y;
+		m_VertexZ[i] = a.z;
+		m_EdgeAX[i] = b.x - a.x;
+		m_EdgeAY[i] = b.y - a.y;
+		m_EdgeAZ[i] = b.z - a.z;
+		m_EdgeBX[i] = c.x - a.x;
+		m_EdgeBY[i] = c.y - a.y;
+		m_EdgeBZ[i] = c.z - a.z;
+		m_TriangleIds[i] = id;
+	}
+
+	// The build data is no longer needed
+	std::vector<BuildTriangle>().swap(m_BuildTriangles);
+
+	// Counters
+	m_Stats.node_count = static_cast<uint32_t>(m_Nodes.size());
+	for (const Node& node : m_Nodes)
+	{
+		for (uint32_t slot = 0; slot < BVH_WIDTH; ++slot)
+		{
+			m_Stats.leaf_count += (node.count[slot] > 0) ? 1 : 0;
+		}
+	}
+
+	m_Stats.max_depth = max_depth;
+	m_Stats.task_count = static_cast<uint32_t>(tasks.size());
+	m_Stats.thread_count = used_threads;
+	m_Stats.memory_bytes = m_Nodes.size() * sizeof(Node) + padded_count * sizeof(float) * 9 + m_TriangleIds.size() * sizeof(uint32_t);
+
+	auto end_time = std::chrono::high_resolution_clock::now();
+	m_Stats.build_milliseconds = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+}
+
+void MeshBVH::CalculateRange(BuildRange& range) const
+{
+	ResetBounds(range);
+	for (uint32_t i = range.begin; i < range.end; ++i)
+	{
+		GrowBounds(range, m_BuildTriangles[i]);
+	}
+}
+
+void MeshBVH::ResetBounds(BuildRange& range)
+{
+	for (uint32_t axis = 0; axis < 4; ++axis)
+	{
+		range.min[axis] = FLT_MAX;
+		range.max[axis] = -FLT_MAX;
+		range.centroid_min[axis] = FLT_MAX;
+		range.centroid_max[axis] = -FLT_MAX;
+	}
+}
+
+void MeshBVH::GrowBounds(BuildRange& range, const BuildTriangle& triangle)
+{
+	GrowBox(range.min, range.max, triangle.min, triangle.max);
+	GrowBox(range.centroid_min, range.centroid_max, triangle.centroid, triangle.centroid);
+}
+
+void MeshBVH::MergeBounds(BuildRange& range, const BuildRange& other)
+{
+	GrowBox(range.min, range.max, other.min, other.max);
+	GrowBox(range.centroid_min, range.centroid_max, other.centroid_min, other.centroid_max);
+}
+
+bool MeshBVH::SplitRange(const BuildRange& range, uint32_t depth, BuildRange& left, BuildRange& right)
+{
+	uint32_t count = range.end - range.begin;
+	if (count <= 1)
+		return false;
+
+	BuildTriangle* triangles = m_BuildTriangles.data();
+	left.begin = range.begin;
+	right.end = range.end;
+
+	// Deep in the tree the heuristic is given up for splitting at the median, which halves the triangles at every level
+	if (depth < MAX_BVH_DEPTH / 2)
+	{
+		// Bins along each axis, keeping the bounds of their centroids as well so the two sides need no second pass
+		BuildRange bins[3][BIN_COUNT];
+		float scale[3];
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			float extent = range.centroid_max[axis] - range.centroid_min[axis];
+			scale[axis] = (extent > 0.0f) ? BIN_COUNT / extent : 0.0f;
+
+			for (BuildRange& bin : bins[axis])
+			{
+				bin.begin = 0;
+				bin.end = 0;
+				ResetBounds(bin);
+			}
+		}
+
+		// Count the triangles and grow the bounds of each bin, end is used as the count
+		for (uint32_t i = range.begin; i < range.end; ++i)
+		{
+			const BuildTriangle& triangle = triangles[i];
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				uint32_t index = std::min(static_cast<uint32_t>((triangle.centroid[axis] - range.centroid_min[axis]) * scale[axis]), BIN_COUNT - 1);
+
+				BuildRange& bin = bins[axis][index];
+				bin.end++;
+				GrowBounds(bin, triangle);
+			}
+		}
+
+		float best_cost = FLT_MAX;
+		uint32_t best_axis = 3;
+		uint32_t best_bin = 0;
+
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			if (scale[axis] == 0.0f)
+				continue;
+
+			// Sweep from the right to find the area and count on the right of each split
+			float right_area[BIN_COUNT];
+			uint32_t right_count[BIN_COUNT];
+			BuildRange sum;
+			ResetBounds(sum);
+			for (uint32_t i = BIN_COUNT - 1; i > 0; --i)
+			{
+				sum.end += bins[axis][i].end;
+				MergeBounds(sum, bins[axis][i]);
+				right_count[i] = sum.end;
+				right_area[i] = (sum.end > 0) ? HalfArea(sum.min, sum.max) : 0.0f;
+			}
+
+			// Then from the left, splitting before bin i
+			ResetBounds(sum);
+			sum.end = 0;
+			for (uint32_t i = 1; i < BIN_COUNT; ++i)
+			{
+				sum.end += bins[axis][i - 1].end;
+				MergeBounds(sum, bins[axis][i - 1]);
+				if (sum.end == 0 || right_count[i] == 0)
+					continue;
+
+				float cost = HalfArea(sum.min, sum.max) * sum.end + right_area[i] * right_count[i];
+				if (cost < best_cost)
+				{
+					best_cost = cost;
+					best_axis = axis;
+					best_bin = i;
+				}
+			}
+		}
+
+		if (best_axis < 3)
+		{
+			// Keep small ranges as leaves when testing their triangles is cheaper than stepping into children
+			float area = HalfArea(range.min, range.max);
+			float split_cost = TRAVERSAL_COST * area + INTERSECTION_COST * best_cost;
+			float leaf_cost = INTERSECTION_COST * area * count;
+			if (count <= BVH_MAX_LEAF_SIZE && leaf_cost <= split_cost)
+				return false;
+
+			// The sides' bounds are the bins' bounds merged
+			ResetBounds(left);
+			ResetBounds(right);
+			for (uint32_t i = 0; i < BIN_COUNT; ++i)
+			{
+				MergeBounds((i < best_bin) ? left : right, bins[best_axis][i]);
+			}
+
+			float centroid_min = range.centroid_min[best_axis];
+			float best_scale = scale[best_axis];
+			BuildTriangle* middle = std::partition(triangles + range.begin, triangles + range.end, [&](const BuildTriangle& triangle)
+			{
+				return std::min(static_cast<uint32_t>((triangle.centroid[best_axis] - centroid_min) * best_scale), BIN_COUNT - 1) < best_bin;
+			});
+
+			left.end = static_cast<uint32_t>(middle - triangles);
+			right.begin = left.end;
+			return true;
+		}
+	}
+
+	// Every centroid is in the same place or the tree is deep, split at the median along the longest axis of the centroids
+	if (count <= BVH_MAX_LEAF_SIZE)
+		return false;
+
+	uint32_t axis = 0;
+	for (uint32_t a = 1; a < 3; ++a)
+	{
+		if (range.centroid_max[a] - range.centroid_min[a] > range.centroid_max[axis] - range.centroid_min[axis])
+		{
+			axis = a;
+		}
+	}
+
+	uint32_t middle = range.begin + count / 2;
+	std::nth_element(triangles + range.begin, triangles + middle, triangles + range.end, [&](const BuildTriangle& a, const BuildTriangle& b)
+	{
+		return a.centroid[axis] < b.centroid[axis];
+	});
+
+	left.end = middle;
+	right.begin = middle;
+	this->CalculateRange(left);
+	this->CalculateRange(right);
+	return true;
+}
+
+void MeshBVH::FillNode(Node& node, const BuildRange& range, uint32_t depth, BuildRange* inner_ranges, uint32_t* inner_slots, uint32_t& inner_count)
+{
+	// Keep splitting the child with the largest surface area until there are four
+	BuildRange children[BVH_WIDTH];
+	bool leaf[BVH_WIDTH] = {};
+	uint32_t child_count = 1;
+	children[0] = range;
+
+	while (child_count < BVH_WIDTH)
+	{
+		uint32_t largest = BVH_WIDTH;
+		float largest_area = -1.0f;
+		for (uint32_t i = 0; i < child_count; ++i)
+		{
+			float area = HalfArea(children[i].min, children[i].max);
+			if (!leaf[i] && area > largest_area)
+			{
+				largest = i;
+				largest_area = area;
+			}
+		}
+
+		if (largest == BVH_WIDTH)
+			break;
+
+		BuildRange left, right;
+		if (this->SplitRange(children[largest], depth, left, right))
+		{
+			children[largest] = left;
+			children[child_count] = right;
+			child_count++;
+		}
+		else
+		{
+			leaf[largest] = true;
+		}
+	}
+
+	// Write the children, the ones still worth splitting are handed back to be built as nodes
+	inner_count = 0;
+	for (uint32_t i = 0; i < BVH_WIDTH; ++i)
+	{
+		if (i >= child_count)
+		{
+			// Unused, an inverted box no ray can enter
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				node.bounds[axis][i] = FLT_MAX;
+				node.bounds[axis + 3][i] = -FLT_MAX;
+			}
+
+			node.child[i] = INVALID_INDEX;
+			node.count[i] = 0;
+			continue;
+		}
+
+		const BuildRange& child = children[i];
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			node.bounds[axis][i] = child.min[axis];
+			node.bounds[axis + 3][i] = child.max[axis];
+		}
+
+		uint32_t count = child.end - child.begin;
+		if (leaf[i] || count <= BVH_MAX_LEAF_SIZE)
+		{
+			node.child[i] = child.begin;
+			node.count[i] = count;
+		}
+		else
+		{
+			node.child[i] = INVALID_INDEX;
+			node.count[i] = 0;
+			inner_ranges[inner_count] = child;
+			inner_slots[inner_count] = i;
+			inner_count++;
+		}
+	}
+}
+
+uint32_t MeshBVH::BuildSubtree(std::vector<Node>& nodes, const BuildRange& range, uint32_t depth, uint32_t& max_depth)
+{
+	uint32_t node_index = static_cast<uint32_t>(nodes.size());
+	nodes.emplace_back();
+	max_depth = std::max(max_depth, depth);
+
+	BuildRange inner_ranges[BVH_WIDTH];
+	uint32_t inner_slots[BVH_WIDTH];
+	uint32_t inner_count = 0;
+	this->FillNode(nodes[node_index], range, depth, inner_ranges, inner_slots, inner_count);
+
+	for (uint32_t i = 0; i < inner_count; ++i)
+	{
+		uint32_t child = this->BuildSubtree(nodes, inner_ranges[i], depth + 1, max_depth);
+		nodes[node_index].child[inner_slots[i]] = child;
+	}
+
+	return node_index;
+}
+
+uint32_t MeshBVH::BuildTop(const BuildRange& range, uint32_t depth, uint32_t task_size, std::vector<BuildTask>& tasks, uint32_t& max_depth)
+{
+	uint32_t node_index = static_cast<uint32_t>(m_Nodes.size());
+	m_Nodes.emplace_back();
+	max_depth = std::max(max_depth, depth);
+
+	BuildRange inner_ranges[BVH_WIDTH];
+	uint32_t inner_slots[BVH_WIDTH];
+	uint32_t inner_count = 0;
+	this->FillNode(m_Nodes[node_index], range, depth, inner_ranges, inner_slots, inner_count);
+
+	// Large children are split here, the rest are left for the threads
+	for (uint32_t i = 0; i < inner_count; ++i)
+	{
+		if (inner_ranges[i].end - inner_ranges[i].begin > task_size)
+		{
+			uint32_t child = this->BuildTop(inner_ranges[i], depth + 1, task_size, tasks, max_depth);
+			m_Nodes[node_index].child[inner_slots[i]] = child;
+		}
+		else
+		{
+			BuildTask task;
+			task.range = inner_ranges[i];
+			task.depth = depth + 1;
+			task.parent = node_index;
+			task.slot = inner_slots[i];
+			tasks.push_back(task);
+		}
+	}
+
+	return node_index;
+}
+
+bool MeshBVH::Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float max_distance, uint32_t& triangle, float& distance) const
+{
+	if (m_Nodes.empty())
+		return false;
+
+	// Zero components are nudged so the slab tests never multiply zero by infinity
+	Ray ray;
+	const float origin_values[3] = { origin.x, origin.y, origin.z };
+	const float direction_values[3] = { direction.x, direction.y, direction.z };
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		float value = direction_values[axis];
+		if (std::fabs(value) < 1e-30f)
+		{
+			value = std::copysign(1e-30f, value);
+		}
+
+		ray.origin[axis] = origin_values[axis];
+		ray.direction[axis] = direction_values[axis];
+		ray.inverse[axis] = 1.0f / value;
+		ray.near_bounds[axis] = (value < 0.0f) ? axis + 3 : axis;
+		ray.far_bounds[axis] = (value < 0.0f) ? axis : axis + 3;
+	}
+
+	const Lanes origin_x = Splat(ray.origin[0]);
+	const Lanes origin_y = Splat(ray.origin[1]);
+	const Lanes origin_z = Splat(ray.origin[2]);
+	const Lanes direction_x = Splat(ray.direction[0]);
+	const Lanes direction_y = Splat(ray.direction[1]);
+	const Lanes direction_z = Splat(ray.direction[2]);
+	const Lanes zero = Splat(0.0f);
+	const Lanes one = Splat(1.0f);
+	const Lanes epsilon = Splat(1e-20f);
+
+	float closest = max_distance;
+	bool hit = false;
+
+	// Test a leaf's triangles several at a time, both sides of a triangle count as a hit
+	auto intersect_leaf = [&](uint32_t first, uint32_t count)
+	{
+		for (uint32_t i = first; i < first + count; i += LANE_COUNT)
+		{
+			Lanes edge_a_x = Load(&m_EdgeAX[i]);
+			Lanes edge_a_y = Load(&m_EdgeAY[i]);
+			Lanes edge_a_z = Load(&m_EdgeAZ[i]);
+			Lanes edge_b_x = Load(&m_EdgeBX[i]);
+			Lanes edge_b_y = Load(&m_EdgeBY[i]);
+			Lanes edge_b_z = Load(&m_EdgeBZ[i]);
+
+			// Moller-Trumbore, p is the direction crossed with the second edge
+			Lanes p_x = Subtract(Multiply(direction_y, edge_b_z), Multiply(direction_z, edge_b_y));
+			Lanes p_y = Subtract(Multiply(direction_z, edge_b_x), Multiply(direction_x, edge_b_z));
+			Lanes p_z = Subtract(Multiply(direction_x, edge_b_y), Multiply(direction_y, edge_b_x));
+			Lanes determinant = Add(Add(Multiply(edge_a_x, p_x), Multiply(edge_a_y, p_y)), Multiply(edge_a_z, p_z));
+			Lanes inverse_determinant = Divide(one, determinant);
+
+			Lanes to_origin_x = Subtract(origin_x, Load(&m_VertexX[i]));
+			Lanes to_origin_y = Subtract(origin_y, Load(&m_VertexY[i]));
+			Lanes to_origin_z = Subtract(origin_z, Load(&m_VertexZ[i]));
+			Lanes u = Multiply(Add(Add(Multiply(to_origin_x, p_x), Multiply(to_origin_y, p_y)), Multiply(to_origin_z, p_z)), inverse_determinant);
+
+			Lanes q_x = Subtract(Multiply(to_origin_y, edge_a_z), Multiply(to_origin_z, edge_a_y));
+			Lanes q_y = Subtract(Multiply(to_origin_z, edge_a_x), Multiply(to_origin_x, edge_a_z));
+			Lanes q_z = Subtract(Multiply(to_origin_x, edge_a_y), Multiply(to_origin_y, edge_a_x));
+			Lanes v = Multiply(Add(Add(Multiply(direction_x, q_x), Multiply(direction_y, q_y)), Multiply(direction_z, q_z)), inverse_determinant);
+			Lanes t = Multiply(Add(Add(Multiply(edge_b_x, q_x), Multiply(edge_b_y, q_y)), Multiply(edge_b_z, q_z)), inverse_determinant);
+
+			uint32_t mask = GreaterMask(Abs(determinant), epsilon) & GreaterEqualMask(u, zero) & GreaterEqualMask(v, zero) & LessEqualMask(Add(u, v), one) &
+				GreaterEqualMask(t, zero) & LessMask(t, Splat(closest));
+
+			// Lanes past the end of the leaf belong to other leaves
+			uint32_t remaining = first + count - i;
+			if (remaining < LANE_COUNT)
+			{
+				mask &= (1u << remaining) - 1;
+			}
+
+			if (mask == 0)
+				continue;
+
+			float distances[LANE_COUNT];
+			Store(distances, t);
+			for (uint32_t lane = 0; lane < LANE_COUNT; ++lane)
+			{
+				if ((mask & (1u << lane)) && distances[lane] < closest)
+				{
+					closest = distances[lane];
+					triangle = m_TriangleIds[i + lane];
+					hit = true;
+				}
+			}
+		}
+	};
+
+	// Nodes waiting to be visited and where the ray enters them, the nearest is on top
+	uint32_t stack[STACK_SIZE];
+	float stack_entry[STACK_SIZE];
+	uint32_t stack_size = 0;
+	stack[stack_size] = 0;
+	stack_entry[stack_size] = 0.0f;
+	stack_size++;
+
+	while (stack_size > 0)
+	{
+		stack_size--;
+		if (stack_entry[stack_size] > closest)
+			continue;
+
+		const Node& node = m_Nodes[stack[stack_size]];
+
+		float entry[BVH_WIDTH];
+		uint32_t mask = IntersectBoxes(node.bounds, ray, closest, entry);
+		if (mask == 0)
+			continue;
+
+		// Order the children the ray enters from nearest to furthest
+		uint32_t order[BVH_WIDTH];
+		uint32_t order_count = 0;
+		for (uint32_t i = 0; i < BVH_WIDTH; ++i)
+		{
+			if (mask & (1u << i))
+			{
+				uint32_t j = order_count++;
+				while (j > 0 && entry[order[j - 1]] > entry[i])
+				{
+					order[j] = order[j - 1];
+					j--;
+				}
+
+				order[j] = i;
+			}
+		}
+
+		// Leaves are tested straight away, nearest first, which shortens the ray for the nodes after them
+		for (uint32_t i = 0; i < order_count; ++i)
+		{
+			uint32_t slot = order[i];
+			if (node.count[slot] > 0 && entry[slot] <= closest)
+			{
+				intersect_leaf(node.child[slot], node.count[slot]);
+			}
+		}
+
+		// Push the inner nodes furthest first so the nearest is visited next
+		for (uint32_t i = order_count; i > 0; --i)
+		{
+			uint32_t slot = order[i - 1];
+			if (node.count[slot] == 0 && entry[slot] <= closest)
+			{
+				stack[stack_size] = node.child[slot];
+				stack_entry[stack_size] = entry[slot];
+				stack_size++;
+			}
+		}
+	}
+
+	if (hit)
+	{
+		distance = closest;
+	}
+
+	return hit;
+}
+
+const char* MeshBVH::GetInstructionSet()
+{
+	return INSTRUCTION_SET;
+}
+
+void MeshBVH::Print() const
+{
+	double bytes_per_triangle = (m_Stats.triangle_count > 0) ? static_cast<double>(m_Stats.memory_bytes) / m_Stats.triangle_count : 0.0;
+
+	std::cout << "  BVH: " << m_Stats.triangle_count << " triangles in " << m_Stats.node_count << " nodes and " << m_Stats.leaf_count << " leaves, deepest level "
+		<< m_Stats.max_depth << '\n';
+	std::cout << "    Built in " << m_Stats.build_milliseconds << " ms on " << m_Stats.thread_count << " threads from " << m_Stats.task_count << " subtrees, "
+		<< m_Stats.memory_bytes / 1024 << " KB (" << bytes_per_triangle << " bytes per triangle)\n";
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+// Children of each node, their boxes are tested together across SIMD lanes
+const uint32_t BVH_WIDTH = 4;
+
+// Most triangles a leaf holds, the surface area heuristic decides when to stop splitting below it
+const uint32_t BVH_MAX_LEAF_SIZE = 8;
+
+// Deepest a node can be, past half of it nodes are split at the median so the tree can't get deeper
+const uint32_t MAX_BVH_DEPTH = 64;
+
+// Counters of the last build
+struct MeshBVHStats
+{
+	uint32_t triangle_count = 0;
+	uint32_t node_count = 0;
+	uint32_t leaf_count = 0;
+	uint32_t max_depth = 0;
+
+	// Subtrees built on their own threads
+	uint32_t task_count = 0;
+	uint32_t thread_count = 0;
+
+	double build_milliseconds = 0.0;
+	uint64_t memory_bytes = 0;
+};
+
+// Bounding volume hierarchy over a mesh's triangles for ray picking without testing every triangle
+//
+// Every split is chosen with the surface area heuristic over sixteen bins of the triangles' centroids along each axis, and
+// each node splits its largest child again until it has four, so a ray tests the four boxes at once across SIMD lanes. The top
+// of the tree is split on the calling thread until there are enough subtrees to share out, then the subtrees are built on
+// their own threads. Leaves store their triangles together as a vertex and two edges, which are tested several at a time
+class MeshBVH
+{
+public:
+	MeshBVH() = default;
+	virtual ~MeshBVH() = default;
+
+	// Build over the triangles of an indexed triangle list using up to thread_count threads
+	void Build(const XMFLOAT3* positions, const uint32_t* indices, uint32_t index_count, uint32_t thread_count);
+
+	// Remove every triangle
+	void Clear();
+
+	// Nearest triangle the ray hits before max_distance, both sides of a triangle are hit. The direction doesn't need to be
+	// normalised and distances are in its lengths. The triangle is its index in the index list divided by three
+	bool Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float max_distance, uint32_t& triangle, float& distance) const;
+
+	inline uint32_t GetTriangleCount() const { return m_Stats.triangle_count; }
+	inline const MeshBVHStats& GetStats() const { return m_Stats; }
+
+	// Instruction set the triangle tests were compiled for
+	static const char* GetInstructionSet();
+
+	// Print the counters and the memory used per triangle
+	void Print() const;
+
+private:
+	static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+	// Four children, a child with a count is a leaf holding that many triangles from its first, a child without one is an
+	// inner node and unused children are INVALID_INDEX with empty boxes
+	struct Node
+	{
+		// Minimum x, y and z then maximum x, y and z of each child's box
+		float bounds[6][BVH_WIDTH];
+
+		uint32_t child[BVH_WIDTH];
+		uint32_t count[BVH_WIDTH];
+	};
+
+	// Node 0 is the root
+	std::vector<Node> m_Nodes;
+
+	// Triangles in leaf order as a vertex and the edges to the other two, padded so a full set of lanes can always be loaded
+	std::vector<float> m_VertexX;
+	std::vector<float> m_VertexY;
+	std::vector<float> m_VertexZ;
+	std::vector<float> m_EdgeAX;
+	std::vector<float> m_EdgeAY;
+	std::vector<float> m_EdgeAZ;
+	std::vector<float> m_EdgeBX;
+	std::vector<float> m_EdgeBY;
+	std::vector<float> m_EdgeBZ;
+
+	// Index of each triangle in the index list divided by three, in leaf order
+	std::vector<uint32_t> m_TriangleIds;
+
+	// Bounds and centroid of each triangle while building, which are sorted into leaf order as the tree is split. The fourth
+	// components pad them out to a vector, the triangle's id takes the centroid's as the vector code ignores it
+	struct BuildTriangle
+	{
+		float min[4];
+		float max[4];
+		float centroid[3];
+		uint32_t id;
+	};
+
+	// Range of build triangles with their bounds and the bounds of their centroids
+	struct BuildRange
+	{
+		uint32_t begin = 0;
+		uint32_t end = 0;
+		float min[4];
+		float max[4];
+		float centroid_min[4];
+		float centroid_max[4];
+	};
+
+	std::vector<BuildTriangle> m_BuildTriangles;
+
+	// Bounds of a range from its triangles, or grown from a triangle or another range
+	void CalculateRange(BuildRange& range) const;
+	static void ResetBounds(BuildRange& range);
+	static void GrowBounds(BuildRange& range, const BuildTriangle& triangle);
+	static void MergeBounds(BuildRange& range, const BuildRange& other);
+
+	// Split a range in two along the best binned split, returns false when keeping it as a leaf is cheaper
+	bool SplitRange(const BuildRange& range, uint32_t depth, BuildRange& left, BuildRange& right);
+
+	// Fill a node's children from a range, the ranges and slots of the inner children are written for the caller to build
+	void FillNode(Node& node, const BuildRange& range, uint32_t depth, BuildRange* inner_ranges, uint32_t* inner_slots, uint32_t& inner_count);
+
+	// Build a range and everything below it into a list of nodes, returns the index of its node
+	uint32_t BuildSubtree(std::vector<Node>& nodes, const BuildRange& range, uint32_t depth, uint32_t& max_depth);
+
+	// Subtree left for a thread, written into the top of the tree once the threads are done
+	struct BuildTask
+	{
+		BuildRange range;
+		uint32_t depth = 0;
+		uint32_t parent = 0;
+		uint32_t slot = 0;
+	};
+
+	// Split the top of the tree on the calling thread, leaving ranges smaller than task_size as tasks
+	uint32_t BuildTop(const BuildRange& range, uint32_t depth, uint32_t task_size, std::vector<BuildTask>& tasks, uint32_t& max_depth);
+
+	MeshBVHStats m_Stats;
+};
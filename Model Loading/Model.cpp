@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <thread>
 
 #define TINYGLTF_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -18,6 +19,7 @@ void Model::Create()
 	LoadModel();
 	CreateVertexBuffer();
 	CreateIndexBuffer();
+	CreateBVH();
 }
 
 void Model::LoadModel()
@@ -49,6 +51,9 @@ void Model::LoadModel()
 		{
 			const tinygltf::Primitive& primitive = mesh.primitives[i];
 
+			// Indices of each primitive start from its own first vertex
+			UINT base_vertex = static_cast<UINT>(m_Vertices.size());
+
 			if (primitive.attributes.find("POSITION") != primitive.attributes.end())
 			{
 				const tinygltf::Accessor& accessor = model.accessors[primitive.attributes.find("POSITION")->second];
@@ -79,7 +84,7 @@ void Model::LoadModel()
 					const uint8_t* buf = reinterpret_cast<const uint8_t*>(&(buffer.data[accessor.byteOffset + bufferView.byteOffset]));
 					for (size_t index = 0; index < accessor.count; index++)
 					{
-						m_Indices.push_back(static_cast<uint32_t>(buf[index]));
+						m_Indices.push_back(base_vertex + static_cast<uint32_t>(buf[index]));
 					}
 				}
 				else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
@@ -87,7 +92,7 @@ void Model::LoadModel()
 					const uint16_t* buf = reinterpret_cast<const uint16_t*>(&(buffer.data[accessor.byteOffset + bufferView.byteOffset]));
 					for (size_t index = 0; index < accessor.count; index++)
 					{
-						m_Indices.push_back(static_cast<uint32_t>(buf[index]));
+						m_Indices.push_back(base_vertex + static_cast<uint32_t>(buf[index]));
 					}
 				}
 				else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
@@ -95,7 +100,7 @@ void Model::LoadModel()
 					const uint32_t* buf = reinterpret_cast<const uint32_t*>(&(buffer.data[accessor.byteOffset + bufferView.byteOffset]));
 					for (size_t index = 0; index < accessor.count; index++)
 					{
-						m_Indices.push_back(buf[index]);
+						m_Indices.push_back(base_vertex + buf[index]);
 					}
 				}
 			}
@@ -138,6 +143,24 @@ void Model::CreateIndexBuffer()
 	DX::Check(device->CreateBuffer(&index_buffer_desc, &index_subdata, m_IndexBuffer.ReleaseAndGetAddressOf()));
 }
 
+void Model::CreateBVH()
+{
+	// Positions of the vertices on their own
+	std::vector<XMFLOAT3> positions(m_Vertices.size());
+	for (size_t i = 0; i < m_Vertices.size(); ++i)
+	{
+		positions[i] = XMFLOAT3(m_Vertices[i].position.x, m_Vertices[i].position.y, m_Vertices[i].position.z);
+	}
+
+	// Build on every core
+	m_BVH.Build(positions.data(), m_Indices.data(), static_cast<uint32_t>(m_Indices.size()), std::thread::hardware_concurrency());
+}
+
+bool Model::Pick(const XMFLOAT3& origin, const XMFLOAT3& direction, float max_distance, uint32_t& triangle, float& distance) const
+{
+	return m_BVH.Raycast(origin, direction, max_distance, triangle, distance);
+}
+
 void Model::Render()
 {
 	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
@@ -3,6 +3,7 @@
 #include <d3d11.h>
 #include <vector>
 #include "Vertex.h"
+#include "MeshBVH.h"
 
 // This include is requires for using DirectX smart pointers (ComPtr)
 #include <wrl\client.h>
@@ -24,6 +25,16 @@ public:
 	// Render the model
 	void Render();
 
+	// Nearest triangle the ray hits in model space, the triangle is its index in the index list divided by three
+	bool Pick(const XMFLOAT3& origin, const XMFLOAT3& direction, float max_distance, uint32_t& triangle, float& distance) const;
+
+	// Get the picking hierarchy
+	inline const MeshBVH& GetBVH() const { return m_BVH; }
+
+	// Get geometry
+	inline const std::vector<Vertex>& GetVertices() const { return m_Vertices; }
+	inline const std::vector<UINT>& GetIndices() const { return m_Indices; }
+
 private:
 	// Number of indices to draw
 	UINT m_IndexCount = 0;
@@ -40,4 +51,8 @@ private:
 
 	// Load model
 	void LoadModel();
+
+	// Bounding volume hierarchy over the triangles for picking
+	void CreateBVH();
+	MeshBVH m_BVH;
 };
\ No newline at end of file
@@ -6,6 +6,8 @@
 #include <filesystem>
 
 #include "../External/WICTextureLoader.h"
+#include "../External/ImageDecoder.h"
+#include "../External/NormalMapGenerator.h"
 
 Model::Model(Renderer* renderer) : m_Renderer(renderer)
 {
@@ -132,7 +134,8 @@ void Model::LoadTexture()
 
 void Model::LoadNormalTexture()
 {
-	std::wstring path = L"PavingStones142_1K-PNG_NormalDX.png";
+	// The sample has no height map, the height is approximated from the colour texture
+	std::wstring path = L"PavingStones142_1K-PNG_Color.png";
 
 	// Check if file exists
 	if (!std::filesystem::exists(path))
@@ -142,12 +145,54 @@ void Model::LoadNormalTexture()
 		return;
 	}
 
-	// Load texture into a resource shader view
+	StbImageDecoder decoder;
+	ImageBuffer image;
+	if (!decoder.DecodeFile(path, image, IMAGE_DECODE_IGNORE_SRGB))
+	{
+		std::wstring error = L"Could not decode file: " + path;
+		MessageBox(NULL, error.c_str(), L"Error", MB_OK);
+		return;
+	}
+
+	// Block compressed textures must be a multiple of 4 in size
+	if (image.width % 4 != 0 || image.height % 4 != 0)
+	{
+		std::wstring error = L"Height map must be a multiple of 4 in size: " + path;
+		MessageBox(NULL, error.c_str(), L"Error", MB_OK);
+		return;
+	}
+
+	// Derive the normals and compress the mip chain to BC5
+	NormalMapGenerator generator;
+	generator.Generate(image);
+
+	const std::vector<NormalMapLevel>& levels = generator.GetLevels();
+
 	ID3D11Device* device = m_Renderer->GetDevice();
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
 
-	ComPtr<ID3D11Resource> resource = nullptr;
-	DX::Check(DirectX::CreateWICTextureFromFile(device, context, path.c_str(), resource.ReleaseAndGetAddressOf(), m_NormalTexture.ReleaseAndGetAddressOf()));
+	// Describe the texture
+	D3D11_TEXTURE2D_DESC texture_desc = {};
+	texture_desc.Width = image.width;
+	texture_desc.Height = image.height;
+	texture_desc.MipLevels = static_cast<UINT>(levels.size());
+	texture_desc.ArraySize = 1;
+	texture_desc.Format = DXGI_FORMAT_BC5_UNORM;
+	texture_desc.SampleDesc.Count = 1;
+	texture_desc.SampleDesc.Quality = 0;
+	texture_desc.Usage = D3D11_USAGE_IMMUTABLE;
+	texture_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	// Every mip level is uploaded at creation
+	std::vector<D3D11_SUBRESOURCE_DATA> texture_subdata(levels.size());
+	for (size_t i = 0; i < levels.size(); ++i)
+	{
+		texture_subdata[i].pSysMem = levels[i].blocks.data();
+		texture_subdata[i].SysMemPitch = levels[i].row_pitch;
+	}
+
+	ComPtr<ID3D11Texture2D> texture = nullptr;
+	DX::Check(device->CreateTexture2D(&texture_desc, texture_subdata.data(), texture.ReleaseAndGetAddressOf()));
+	DX::Check(device->CreateShaderResourceView(texture.Get(), nullptr, m_NormalTexture.ReleaseAndGetAddressOf()));
 }
 
 void Model::Render()
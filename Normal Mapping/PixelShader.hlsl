@@ -35,10 +35,12 @@ float4 CalculateDirectionalLighting(float3 position, float3 normal)
 
 float3 CalculateNormalsFromNormalMap(float2 texture_uv, float3 normal, float3 tangent)
 {
-    float3 normalMapSample = gTextureNormal.Sample(gTextureSampler, texture_uv).rgb;
+    float2 normalMapSample = gTextureNormal.Sample(gTextureSampler, texture_uv).rg;
 
-	// Uncompress each component from [0,1] to [-1,1].
-    float3 normalT = normalize(normalMapSample * 2.0f - 1.0f);
+	// Uncompress each component from [0,1] to [-1,1], BC5 only stores x and y so rebuild z.
+    float3 normalT;
+    normalT.xy = normalMapSample * 2.0f - 1.0f;
+    normalT.z = sqrt(saturate(1.0f - dot(normalT.xy, normalT.xy)));
     
 	// Build orthonormal basis.
     float3 N = normal; // Normal
@@ -9,11 +9,16 @@
 #include "RasterState.h"
 #include "TextureSampler.h"
 #include "RenderTarget.h"
+#include "FrameGraphTextures.h"
+#include "RenderTargetPool.h"
 
 #include <DirectXMath.h>
+#include <DirectXColors.h>
 using namespace DirectX;
 
 #include <windowsx.h>
+#include <algorithm>
+#include <iostream>
 
 Application::Application()
 {
@@ -36,9 +41,11 @@ Application::Application()
 	m_Camera = std::make_unique<Camera>(window_width, window_height);
 	m_CameraPlane = std::make_unique<Camera>(window_width, window_height);
 
-	// Create render target
-	m_RenderTarget = std::make_unique<RenderTarget>(m_Renderer.get());
-	m_RenderTarget->Create(window_width, window_height);
+	// Creates the frame graph's textures from the pool, sized to the window when the graph is built
+	m_RenderTargetPool = std::make_unique<RenderTargetPool>(m_Renderer.get());
+	m_FrameGraphTextures = std::make_unique<FrameGraphTextures>(m_Renderer.get(), m_RenderTargetPool.get());
+	m_RenderWidth = window_width;
+	m_RenderHeight = window_height;
 }
 
 int Application::Execute()
@@ -88,9 +95,13 @@ int Application::Execute()
 			// Bind texture sampler to the pipeline
 			m_TextureSampler->Use();
 
+			// Resize once for all the size events since the last frame
+			this->ApplyPendingResize();
+
 			// Render the scene to the texture and backbuffer
-			RenderToTexture();
-			RenderToBackBuffer();
+			this->BuildFrameGraph();
+			m_FrameGraph.Execute(*m_FrameGraphTextures);
+			m_RenderTargetPool->EndFrame();
 
 			// Display the rendered scene
 			m_Renderer->Present();
@@ -112,6 +123,14 @@ LRESULT Application::HandleMessage(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lP
 			this->OnResized(hwnd, msg, wParam, lParam);
 			return 0;
 
+		case WM_ENTERSIZEMOVE:
+			m_InSizeMove = true;
+			return 0;
+
+		case WM_EXITSIZEMOVE:
+			m_InSizeMove = false;
+			return 0;
+
 		case WM_MOUSEMOVE:
 			this->OnMouseMove(hwnd, msg, wParam, lParam);
 			return 0;
@@ -130,18 +149,39 @@ void Application::OnResized(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	if (!m_WindowCreated)
 		return;
 
-	// Get window size
-	int window_width = LOWORD(lParam);
-	int window_height = HIWORD(lParam);
+	// Only remember the size, dragging the window edge sends a resize for every mouse move
+	m_PendingWidth = LOWORD(lParam);
+	m_PendingHeight = HIWORD(lParam);
+	m_ResizePending = true;
+	m_ResizeRequestCount++;
+}
+
+void Application::ApplyPendingResize()
+{
+	// Wait until the window edge is let go
+	if (!m_ResizePending || m_InSizeMove)
+		return;
+
+	m_ResizePending = false;
+
+	// Keep the last size while minimised
+	if (m_PendingWidth <= 0 || m_PendingHeight <= 0)
+		return;
+
+	if (m_PendingWidth == m_RenderWidth && m_PendingHeight == m_RenderHeight)
+		return;
+
+	m_RenderWidth = m_PendingWidth;
+	m_RenderHeight = m_PendingHeight;
+	m_ResizeAppliedCount++;
 
 	// Resize renderer
-	m_Renderer->Resize(window_width, window_height);
+	m_Renderer->Resize(m_RenderWidth, m_RenderHeight);
 
 	// Update camera
-	m_Camera->UpdateAspectRatio(window_width, window_height);
+	m_Camera->UpdateAspectRatio(m_RenderWidth, m_RenderHeight);
 
-	// Resize render target
-	m_RenderTarget->Create(window_width, window_height);
+	// The frame graph takes a scene texture of the new size from the pool
 }
 
 void Application::OnMouseMove(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -175,6 +215,15 @@ void Application::OnKeyDown(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
 	if (!key_repeat)
 	{
+		// Print the compiled frame graph and the render target pool
+		if (wParam == 'G')
+		{
+			m_FrameGraph.Print();
+			m_RenderTargetPool->Print();
+			std::cout << "Resizes: " << m_ResizeRequestCount << " requested, " << m_ResizeAppliedCount << " applied\n";
+			return;
+		}
+
 		m_RasterState->ToggleWireframe();
 	}
 }
@@ -217,10 +266,51 @@ void Application::ComputePlaneViewProjectionMatrix()
 	m_Shader->UpdateModelViewProjectionBuffer(matrix);
 }
 
+void Application::BuildFrameGraph()
+{
+	m_FrameGraph.Reset();
+
+	// The scene texture matches the back buffer, which only changes size once a resize is applied
+	FrameGraphTextureDesc colour_desc;
+	colour_desc.width = static_cast<uint32_t>(std::max(m_RenderWidth, 1));
+	colour_desc.height = static_cast<uint32_t>(std::max(m_RenderHeight, 1));
+	colour_desc.format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	colour_desc.bind_flags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+
+	FrameGraphTextureDesc depth_desc = colour_desc;
+	depth_desc.format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	depth_desc.bind_flags = D3D11_BIND_DEPTH_STENCIL;
+
+	m_SceneColour = m_FrameGraph.CreateTexture("Scene colour", colour_desc);
+	m_SceneDepth = m_FrameGraph.CreateTexture("Scene depth", depth_desc);
+	FrameGraphHandle back_buffer = m_FrameGraph.ImportTexture("Back buffer");
+
+	// Render the model into the scene texture
+	uint32_t texture_pass = m_FrameGraph.AddPass("Render to texture", [this]() { this->RenderToTexture(); });
+	m_FrameGraph.Write(texture_pass, m_SceneColour, FrameGraphAccess::RenderTarget);
+	m_FrameGraph.Write(texture_pass, m_SceneDepth, FrameGraphAccess::DepthStencil);
+
+	// Render the model and the plane showing the scene texture
+	uint32_t back_buffer_pass = m_FrameGraph.AddPass("Back buffer", [this]() { this->RenderToBackBuffer(); });
+	m_FrameGraph.Read(back_buffer_pass, m_SceneColour, 0);
+	m_FrameGraph.Write(back_buffer_pass, back_buffer, FrameGraphAccess::RenderTarget);
+
+	// Only compiles again when the window size changes
+	m_FrameGraph.Compile();
+}
+
 void Application::RenderToTexture()
 {
+	RenderTarget* colour = m_FrameGraphTextures->GetRenderTarget(m_FrameGraph.GetPhysicalTexture(m_SceneColour));
+	RenderTarget* depth = m_FrameGraphTextures->GetRenderTarget(m_FrameGraph.GetPhysicalTexture(m_SceneDepth));
+
+	// Clear the scene textures
+	colour->Clear(reinterpret_cast<const float*>(&DirectX::Colors::DarkGreen));
+	depth->ClearDepth();
+
 	// Binds the render-to-texture render target to the pipeline
-	m_RenderTarget->Use();
+	ID3D11RenderTargetView* render_target_view = colour->GetRenderTargetView();
+	m_Renderer->GetDeviceContext()->OMSetRenderTargets(1, &render_target_view, depth->GetDepthStencilView());
 
 	// Update the model view projection constant buffer
 	this->ComputeModelViewProjectionMatrix();
@@ -239,7 +329,8 @@ void Application::RenderToBackBuffer()
 	m_Model->Render();
 
 	// Sets the plane's texture to be the render-to-texture texture
-	m_Plane->SetTexture(m_RenderTarget->GetTexture());
+	RenderTarget* colour = m_FrameGraphTextures->GetRenderTarget(m_FrameGraph.GetPhysicalTexture(m_SceneColour));
+	m_Plane->SetTexture(colour->GetTexture());
 
 	// Update the plane view projection constant buffer and renders the plane
 	this->ComputePlaneViewProjectionMatrix();
@@ -7,6 +7,8 @@
 #include <memory>
 #include <string>
 
+#include "../External/FrameGraph.h"
+
 class Window;
 class Renderer;
 class Shader;
@@ -16,7 +18,8 @@ class Model;
 class Plane;
 class RasterState;
 class TextureSampler;
-class RenderTarget;
+class FrameGraphTextures;
+class RenderTargetPool;
 
 class Application
 {
@@ -41,7 +44,14 @@ private:
 	std::unique_ptr<Camera> m_CameraPlane = nullptr;
 	std::unique_ptr<RasterState> m_RasterState = nullptr;
 	std::unique_ptr<TextureSampler> m_TextureSampler = nullptr;
-	std::unique_ptr<RenderTarget> m_RenderTarget = nullptr;
+
+	// Declares the render to texture and back buffer passes every frame, the scene texture is a transient owned by the graph
+	FrameGraph m_FrameGraph;
+	std::unique_ptr<RenderTargetPool> m_RenderTargetPool = nullptr;
+	std::unique_ptr<FrameGraphTextures> m_FrameGraphTextures = nullptr;
+	FrameGraphHandle m_SceneColour = INVALID_FRAME_GRAPH_HANDLE;
+	FrameGraphHandle m_SceneDepth = INVALID_FRAME_GRAPH_HANDLE;
+	void BuildFrameGraph();
 
 	bool m_Running = true;
 	bool m_WindowCreated = false;
@@ -50,6 +60,17 @@ private:
 	// On resized event
 	void OnResized(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
+	// Resizes are held while the window edge is dragged and only the last size is applied, before the next frame
+	void ApplyPendingResize();
+	bool m_ResizePending = false;
+	bool m_InSizeMove = false;
+	int m_PendingWidth = 0;
+	int m_PendingHeight = 0;
+	int m_RenderWidth = 0;
+	int m_RenderHeight = 0;
+	uint64_t m_ResizeRequestCount = 0;
+	uint64_t m_ResizeAppliedCount = 0;
+
 	// On mouse move event
 	void OnMouseMove(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
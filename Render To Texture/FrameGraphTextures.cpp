@@ -0,0 +1,49 @@
+#include "FrameGraphTextures.h"
+#include "Renderer.h"
+#include "RenderTarget.h"
+#include "RenderTargetPool.h"
+
+FrameGraphTextures::FrameGraphTextures(Renderer* renderer, RenderTargetPool* pool) : m_Renderer(renderer), m_Pool(pool)
+{
+}
+
+FrameGraphTextures::~FrameGraphTextures()
+{
+	for (RenderTarget* target : m_RenderTargets)
+	{
+		if (target != nullptr)
+			m_Pool->Release(target);
+	}
+}
+
+void FrameGraphTextures::CreateTexture(uint32_t physical_index, const FrameGraphTextureDesc& desc)
+{
+	if (physical_index >= m_RenderTargets.size())
+	{
+		m_RenderTargets.resize(physical_index + 1, nullptr);
+	}
+
+	// The last texture goes back to the pool, so resizing back to an earlier size finds it again
+	if (m_RenderTargets[physical_index] != nullptr)
+	{
+		m_Pool->Release(m_RenderTargets[physical_index]);
+	}
+
+	m_RenderTargets[physical_index] = m_Pool->Acquire(desc);
+}
+
+void FrameGraphTextures::UnbindShaderResource(uint32_t slot)
+{
+	ID3D11ShaderResourceView* null_view = nullptr;
+	m_Renderer->GetDeviceContext()->PSSetShaderResources(slot, 1, &null_view);
+}
+
+void FrameGraphTextures::UnbindRenderTargets()
+{
+	m_Renderer->GetDeviceContext()->OMSetRenderTargets(0, nullptr, nullptr);
+}
+
+RenderTarget* FrameGraphTextures::GetRenderTarget(uint32_t physical_index) const
+{
+	return (physical_index < m_RenderTargets.size()) ? m_RenderTargets[physical_index] : nullptr;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../External/FrameGraph.h"
+#include <vector>
+
+class Renderer;
+class RenderTarget;
+class RenderTargetPool;
+
+// Takes the frame graph's physical textures from the render target pool and issues its unbinds on the device context
+class FrameGraphTextures : public FrameGraphBackend
+{
+	Renderer* m_Renderer = nullptr;
+	RenderTargetPool* m_Pool = nullptr;
+
+public:
+	FrameGraphTextures(Renderer* renderer, RenderTargetPool* pool);
+	virtual ~FrameGraphTextures();
+
+	// Frame graph backend
+	void CreateTexture(uint32_t physical_index, const FrameGraphTextureDesc& desc) override;
+	void UnbindShaderResource(uint32_t slot) override;
+	void UnbindRenderTargets() override;
+
+	// Render target of a physical texture
+	RenderTarget* GetRenderTarget(uint32_t physical_index) const;
+
+private:
+	std::vector<RenderTarget*> m_RenderTargets;
+};
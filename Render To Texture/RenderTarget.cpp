@@ -1,5 +1,36 @@
 #include "RenderTarget.h"
-#include <DirectXColors.h>
+
+namespace
+{
+	// Depth textures that are also read by shaders are created typeless, with a typed format for each view
+	void GetDepthFormats(DXGI_FORMAT format, DXGI_FORMAT& texture_format, DXGI_FORMAT& shader_resource_format)
+	{
+		switch (format)
+		{
+			case DXGI_FORMAT_D24_UNORM_S8_UINT:
+				texture_format = DXGI_FORMAT_R24G8_TYPELESS;
+				shader_resource_format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+				break;
+			case DXGI_FORMAT_D32_FLOAT:
+				texture_format = DXGI_FORMAT_R32_TYPELESS;
+				shader_resource_format = DXGI_FORMAT_R32_FLOAT;
+				break;
+			case DXGI_FORMAT_D16_UNORM:
+				texture_format = DXGI_FORMAT_R16_TYPELESS;
+				shader_resource_format = DXGI_FORMAT_R16_UNORM;
+				break;
+			default:
+				texture_format = format;
+				shader_resource_format = format;
+				break;
+		}
+	}
+
+	bool IsReadDepth(const FrameGraphTextureDesc& desc)
+	{
+		return (desc.bind_flags & D3D11_BIND_DEPTH_STENCIL) && (desc.bind_flags & D3D11_BIND_SHADER_RESOURCE);
+	}
+}
 
 RenderTarget::RenderTarget(Renderer* renderer) : m_Renderer(renderer)
 {
@@ -7,75 +38,99 @@ RenderTarget::RenderTarget(Renderer* renderer) : m_Renderer(renderer)
 	m_DeviceContext = m_Renderer->GetDeviceContext();
 }
 
-void RenderTarget::Create(int width, int height)
+void RenderTarget::Create(const FrameGraphTextureDesc& desc)
 {
-	CreateRenderTexture(width, height);
-	CreateRenderTargetAndDepthStencilView(width, height);
+	m_Desc = desc;
+
+	// Release the views of the last texture
+	m_TextureRenderTargetView.Reset();
+	m_TextureDepthStencilView.Reset();
+	m_TextureShaderResource.Reset();
+
+	CreateRenderTexture();
+	CreateRenderTargetAndDepthStencilView();
 	CreateShaderResource();
 }
 
-void RenderTarget::Use()
+void RenderTarget::Clear(const float colour[4])
 {
 	// Clear the render target view to the chosen colour
-	m_DeviceContext->ClearRenderTargetView(m_TextureRenderTargetView.Get(), reinterpret_cast<const float*>(&DirectX::Colors::DarkGreen));
-	m_DeviceContext->ClearDepthStencilView(m_TextureDepthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	m_DeviceContext->ClearRenderTargetView(m_TextureRenderTargetView.Get(), colour);
+}
 
-	// Bind the render target view to the pipeline's output merger stage
-	m_DeviceContext->OMSetRenderTargets(1, m_TextureRenderTargetView.GetAddressOf(), m_TextureDepthStencilView.Get());
+void RenderTarget::ClearDepth()
+{
+	m_DeviceContext->ClearDepthStencilView(m_TextureDepthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 }
 
-void RenderTarget::CreateRenderTexture(int width, int height)
+void RenderTarget::CreateRenderTexture()
 {
+	DXGI_FORMAT texture_format = static_cast<DXGI_FORMAT>(m_Desc.format);
+	DXGI_FORMAT shader_resource_format = texture_format;
+	if (IsReadDepth(m_Desc))
+	{
+		GetDepthFormats(static_cast<DXGI_FORMAT>(m_Desc.format), texture_format, shader_resource_format);
+	}
+
 	D3D11_TEXTURE2D_DESC texture_desc = {};
-	texture_desc.Width = width;
-	texture_desc.Height = height;
+	texture_desc.Width = m_Desc.width;
+	texture_desc.Height = m_Desc.height;
 	texture_desc.MipLevels = 1;
 	texture_desc.ArraySize = 1;
-	texture_desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-	texture_desc.SampleDesc.Count = 1;
+	texture_desc.Format = texture_format;
+	texture_desc.SampleDesc.Count = m_Desc.sample_count;
 	texture_desc.SampleDesc.Quality = 0;
 	texture_desc.Usage = D3D11_USAGE_DEFAULT;
-	texture_desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	texture_desc.BindFlags = m_Desc.bind_flags;
 	texture_desc.CPUAccessFlags = 0;
 	texture_desc.MiscFlags = 0;
 
 	DX::Check(m_Device->CreateTexture2D(&texture_desc, 0, m_Texture.ReleaseAndGetAddressOf()));
 }
 
-void RenderTarget::CreateRenderTargetAndDepthStencilView(int width, int height)
+void RenderTarget::CreateRenderTargetAndDepthStencilView()
 {
+	bool is_multisampled = (m_Desc.sample_count > 1);
+
 	// Create the render target view.
-	D3D11_RENDER_TARGET_VIEW_DESC target_view_desc = {};
-	target_view_desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-	target_view_desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	target_view_desc.Texture2D.MipSlice = 0;
+	if (m_Desc.bind_flags & D3D11_BIND_RENDER_TARGET)
+	{
+		D3D11_RENDER_TARGET_VIEW_DESC target_view_desc = {};
+		target_view_desc.Format = static_cast<DXGI_FORMAT>(m_Desc.format);
+		target_view_desc.ViewDimension = is_multisampled ? D3D11_RTV_DIMENSION_TEXTURE2DMS : D3D11_RTV_DIMENSION_TEXTURE2D;
+		target_view_desc.Texture2D.MipSlice = 0;
 
-	DX::Check(m_Device->CreateRenderTargetView(m_Texture.Get(), &target_view_desc, m_TextureRenderTargetView.ReleaseAndGetAddressOf()));
+		DX::Check(m_Device->CreateRenderTargetView(m_Texture.Get(), &target_view_desc, m_TextureRenderTargetView.ReleaseAndGetAddressOf()));
+	}
 
 	// Depth stencil
-	D3D11_TEXTURE2D_DESC depth_texture_desc = {};
-	depth_texture_desc.Width = width;
-	depth_texture_desc.Height = height;
-	depth_texture_desc.MipLevels = 1;
-	depth_texture_desc.ArraySize = 1;
-	depth_texture_desc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-	depth_texture_desc.SampleDesc.Count = 1;
-	depth_texture_desc.SampleDesc.Quality = 0;
-	depth_texture_desc.Usage = D3D11_USAGE_DEFAULT;
-	depth_texture_desc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-
-	ComPtr<ID3D11Texture2D> texture = nullptr;
-	DX::Check(m_Device->CreateTexture2D(&depth_texture_desc, nullptr, texture.ReleaseAndGetAddressOf()));
-	DX::Check(m_Device->CreateDepthStencilView(texture.Get(), nullptr, m_TextureDepthStencilView.ReleaseAndGetAddressOf()));
+	if (m_Desc.bind_flags & D3D11_BIND_DEPTH_STENCIL)
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC depth_view_desc = {};
+		depth_view_desc.Format = static_cast<DXGI_FORMAT>(m_Desc.format);
+		depth_view_desc.ViewDimension = is_multisampled ? D3D11_DSV_DIMENSION_TEXTURE2DMS : D3D11_DSV_DIMENSION_TEXTURE2D;
+
+		DX::Check(m_Device->CreateDepthStencilView(m_Texture.Get(), &depth_view_desc, m_TextureDepthStencilView.ReleaseAndGetAddressOf()));
+	}
 }
 
 void RenderTarget::CreateShaderResource()
 {
+	if (!(m_Desc.bind_flags & D3D11_BIND_SHADER_RESOURCE))
+		return;
+
+	DXGI_FORMAT texture_format = static_cast<DXGI_FORMAT>(m_Desc.format);
+	DXGI_FORMAT shader_resource_format = texture_format;
+	if (IsReadDepth(m_Desc))
+	{
+		GetDepthFormats(static_cast<DXGI_FORMAT>(m_Desc.format), texture_format, shader_resource_format);
+	}
+
 	D3D11_SHADER_RESOURCE_VIEW_DESC view_desc = {};
-	view_desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-	view_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	view_desc.Format = shader_resource_format;
+	view_desc.ViewDimension = (m_Desc.sample_count > 1) ? D3D11_SRV_DIMENSION_TEXTURE2DMS : D3D11_SRV_DIMENSION_TEXTURE2D;
 	view_desc.Texture2D.MostDetailedMip = 0;
 	view_desc.Texture2D.MipLevels = 1;
 
 	DX::Check(m_Device->CreateShaderResourceView(m_Texture.Get(), &view_desc, m_TextureShaderResource.ReleaseAndGetAddressOf()));
-}
\ No newline at end of file
+}
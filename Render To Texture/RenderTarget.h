@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Renderer.h"
+#include "../External/FrameGraph.h"
 
+// A texture the scene can be rendered to, created with the views its bind flags allow
 class RenderTarget
 {
 	Renderer* m_Renderer = nullptr;
@@ -12,23 +14,32 @@ public:
 	RenderTarget(Renderer* renderer);
 	virtual ~RenderTarget() = default;
 
-	void Create(int width, int height);
-	void Use();
+	void Create(const FrameGraphTextureDesc& desc);
 
+	// Clear the colour or depth
+	void Clear(const float colour[4]);
+	void ClearDepth();
+
+	ID3D11RenderTargetView* GetRenderTargetView() const { return m_TextureRenderTargetView.Get(); }
+	ID3D11DepthStencilView* GetDepthStencilView() const { return m_TextureDepthStencilView.Get(); }
 	ID3D11ShaderResourceView* GetTexture() const { return m_TextureShaderResource.Get(); }
 
+	// Description the texture was created with
+	const FrameGraphTextureDesc& GetDesc() const { return m_Desc; }
+
 private:
+	FrameGraphTextureDesc m_Desc;
 
 	// Render texture
 	ComPtr<ID3D11Texture2D> m_Texture = nullptr;
-	void CreateRenderTexture(int width, int height);
+	void CreateRenderTexture();
 
 	// Render target and depth stencil
 	ComPtr<ID3D11RenderTargetView> m_TextureRenderTargetView = nullptr;
 	ComPtr<ID3D11DepthStencilView> m_TextureDepthStencilView = nullptr;
-	void CreateRenderTargetAndDepthStencilView(int width, int height);
+	void CreateRenderTargetAndDepthStencilView();
 
 	// Shader resource view
 	ComPtr<ID3D11ShaderResourceView> m_TextureShaderResource = nullptr;
 	void CreateShaderResource();
-};
\ No newline at end of file
+};
@@ -0,0 +1,159 @@
+#include "RenderTargetPool.h"
+#include "Renderer.h"
+#include "RenderTarget.h"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+	// Bytes per texel of the formats the samples create
+	uint32_t GetFormatSize(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+			case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			case DXGI_FORMAT_R32G32B32A32_UINT:
+				return 16;
+
+			case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			case DXGI_FORMAT_R16G16B16A16_UNORM:
+			case DXGI_FORMAT_R32G32_FLOAT:
+				return 8;
+
+			case DXGI_FORMAT_R8G8B8A8_UNORM:
+			case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+			case DXGI_FORMAT_B8G8R8A8_UNORM:
+			case DXGI_FORMAT_R10G10B10A2_UNORM:
+			case DXGI_FORMAT_R11G11B10_FLOAT:
+			case DXGI_FORMAT_R32_FLOAT:
+			case DXGI_FORMAT_D32_FLOAT:
+			case DXGI_FORMAT_D24_UNORM_S8_UINT:
+				return 4;
+
+			case DXGI_FORMAT_R16_FLOAT:
+			case DXGI_FORMAT_R16_UNORM:
+			case DXGI_FORMAT_D16_UNORM:
+				return 2;
+
+			case DXGI_FORMAT_R8_UNORM:
+				return 1;
+
+			default:
+				return 4;
+		}
+	}
+}
+
+RenderTargetPool::RenderTargetPool(Renderer* renderer) : m_Renderer(renderer)
+{
+}
+
+RenderTargetPool::~RenderTargetPool() = default;
+
+uint64_t RenderTargetPool::GetTextureSize(const FrameGraphTextureDesc& desc)
+{
+	return static_cast<uint64_t>(desc.width) * desc.height * desc.sample_count * GetFormatSize(static_cast<DXGI_FORMAT>(desc.format));
+}
+
+RenderTarget* RenderTargetPool::Acquire(const FrameGraphTextureDesc& desc)
+{
+	m_Stats.acquire_count++;
+
+	// Reuse the most recently released match, it is the least likely to be evicted soon anyway
+	Entry* match = nullptr;
+	for (Entry& entry : m_Entries)
+	{
+		if (!entry.in_use && entry.target->GetDesc() == desc)
+		{
+			if (match == nullptr || entry.released_frame > match->released_frame)
+				match = &entry;
+		}
+	}
+
+	if (match != nullptr)
+	{
+		m_Stats.hit_count++;
+		m_Stats.free_count--;
+		m_Stats.bytes_free -= match->bytes;
+
+		match->in_use = true;
+		return match->target.get();
+	}
+
+	// Nothing free matches, create a new target
+	Entry entry;
+	entry.target = std::make_unique<RenderTarget>(m_Renderer);
+	entry.target->Create(desc);
+	entry.bytes = GetTextureSize(desc);
+	entry.released_frame = m_Frame;
+	entry.in_use = true;
+
+	m_Stats.created_count++;
+	m_Stats.target_count++;
+	m_Stats.bytes_held += entry.bytes;
+
+	m_Entries.push_back(std::move(entry));
+	return m_Entries.back().target.get();
+}
+
+void RenderTargetPool::Release(RenderTarget* target)
+{
+	for (Entry& entry : m_Entries)
+	{
+		if (entry.target.get() == target && entry.in_use)
+		{
+			entry.in_use = false;
+			entry.released_frame = m_Frame;
+
+			m_Stats.free_count++;
+			m_Stats.bytes_free += entry.bytes;
+			return;
+		}
+	}
+}
+
+template<typename Predicate>
+void RenderTargetPool::Evict(Predicate predicate)
+{
+	auto it = std::remove_if(m_Entries.begin(), m_Entries.end(), [&](const Entry& entry)
+	{
+		if (entry.in_use || !predicate(entry))
+			return false;
+
+		m_Stats.evicted_count++;
+		m_Stats.target_count--;
+		m_Stats.free_count--;
+		m_Stats.bytes_held -= entry.bytes;
+		m_Stats.bytes_free -= entry.bytes;
+		return true;
+	});
+
+	m_Entries.erase(it, m_Entries.end());
+}
+
+void RenderTargetPool::EndFrame()
+{
+	m_Frame++;
+
+	// Nothing to evict, skip walking the pool
+	if (m_Stats.free_count == 0)
+		return;
+
+	const uint64_t frame = m_Frame;
+	this->Evict([frame](const Entry& entry) { return frame - entry.released_frame > MAX_UNUSED_FRAMES; });
+}
+
+void RenderTargetPool::Trim()
+{
+	this->Evict([](const Entry&) { return true; });
+}
+
+void RenderTargetPool::Print() const
+{
+	double hit_rate = (m_Stats.acquire_count > 0) ? 100.0 * static_cast<double>(m_Stats.hit_count) / static_cast<double>(m_Stats.acquire_count) : 0.0;
+
+	std::cout << "Render target pool: " << m_Stats.target_count << " targets (" << m_Stats.free_count << " free), "
+		<< (m_Stats.bytes_held / 1024) << " KB held (" << (m_Stats.bytes_free / 1024) << " KB free)\n";
+	std::cout << "  " << m_Stats.acquire_count << " acquires, " << m_Stats.hit_count << " hits (" << hit_rate << "%), "
+		<< m_Stats.created_count << " created, " << m_Stats.evicted_count << " evicted\n";
+}
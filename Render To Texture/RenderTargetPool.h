@@ -0,0 +1,76 @@
+#pragma once
+
+#include "../External/FrameGraph.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Renderer;
+class RenderTarget;
+
+// Counters of the pool, the byte counts are estimates from the formats and sizes
+struct RenderTargetPoolStats
+{
+	uint64_t acquire_count = 0;
+	uint64_t hit_count = 0;
+	uint64_t created_count = 0;
+	uint64_t evicted_count = 0;
+
+	uint32_t target_count = 0;
+	uint32_t free_count = 0;
+	uint64_t bytes_held = 0;
+	uint64_t bytes_free = 0;
+};
+
+// Hands out render targets keyed by their description (size, format, bind flags and samples)
+//
+// Released targets stay in the pool and are given to the next request with the same description,
+// targets nobody has asked for in MAX_UNUSED_FRAMES frames are destroyed
+class RenderTargetPool
+{
+	Renderer* m_Renderer = nullptr;
+
+public:
+	RenderTargetPool(Renderer* renderer);
+	virtual ~RenderTargetPool();
+
+	// Frames a released target is kept for before it is destroyed
+	static constexpr uint32_t MAX_UNUSED_FRAMES = 120;
+
+	// Take a target matching the description, creating one if none are free
+	RenderTarget* Acquire(const FrameGraphTextureDesc& desc);
+
+	// Give a target back to the pool
+	void Release(RenderTarget* target);
+
+	// Count the frame and destroy targets unused for too long
+	void EndFrame();
+
+	// Destroy every released target
+	void Trim();
+
+	// Counters
+	inline const RenderTargetPoolStats& GetStats() const { return m_Stats; }
+	void Print() const;
+
+	// Estimated memory of a texture with this description
+	static uint64_t GetTextureSize(const FrameGraphTextureDesc& desc);
+
+private:
+	struct Entry
+	{
+		std::unique_ptr<RenderTarget> target;
+		uint64_t bytes;
+		uint64_t released_frame;
+		bool in_use;
+	};
+
+	std::vector<Entry> m_Entries;
+	uint64_t m_Frame = 0;
+
+	RenderTargetPoolStats m_Stats;
+
+	// Destroy the released targets the predicate picks
+	template<typename Predicate>
+	void Evict(Predicate predicate);
+};
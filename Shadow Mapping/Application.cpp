@@ -11,6 +11,15 @@
 #include "Floor.h"
 #include "Vertex.h"
 #include "ShadowMap.h"
+#include "RenderDevice.h"
+#include "RecordingRenderDevice.h"
+#include "ConstantBufferRing.h"
+#include "StateCacheRenderDevice.h"
+#include "RenderContext.h"
+#include "FrameGraphTextures.h"
+#include "UploadQueue.h"
+#include "GeometryArena.h"
+#include "../External/ThreadPool.h"
 
 #include <DirectXMath.h>
 #include <DirectXCollision.h>
@@ -20,6 +29,59 @@ using namespace DirectX;
 #include <iostream>
 #include <array>
 #include <string>
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <cmath>
+
+namespace
+{
+	// Render queue passes, a pass per shadow cascade then the main pass
+	const uint32_t SHADOW_PASS = 0;
+	const uint32_t MAIN_PASS = MAX_SHADOW_CASCADES;
+	const uint32_t PASS_COUNT = MAX_SHADOW_CASCADES + 1;
+
+	// Render queue shader ids
+	const uint32_t DEFAULT_SHADER = 0;
+	const uint32_t INSTANCED_SHADER = 1;
+
+	// Render queue material ids, one per mesh as the samples have no materials
+	const uint32_t FLOOR_MATERIAL = 0;
+	const uint32_t MODEL_MATERIAL = 1;
+
+	// Render queue payloads, the instanced grid is followed by the pass and the per draw grid cubes follow on from the last
+	const uint32_t DRAW_FLOOR = 0;
+	const uint32_t DRAW_GIANT_MODEL = 1;
+	const uint32_t DRAW_ORBITING_MODEL = 2;
+	const uint32_t DRAW_INSTANCED_GRID = 3;
+	const uint32_t DRAW_GRID_CUBE = DRAW_INSTANCED_GRID + PASS_COUNT;
+
+	// World space bounds of the scene's meshes, matching the transforms they are drawn with
+	const XMFLOAT3 GRID_CUBE_EXTENTS = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	const XMFLOAT3 FLOOR_CENTER = XMFLOAT3(0.0f, -1.0f, 0.0f);
+	const XMFLOAT3 FLOOR_EXTENTS = XMFLOAT3(100.0f, 0.1f, 100.0f);
+	const XMFLOAT3 GIANT_MODEL_CENTER = XMFLOAT3(0.0f, 5.0f, -50.0f);
+	const XMFLOAT3 GIANT_MODEL_EXTENTS = XMFLOAT3(10.0f, 10.0f, 10.0f);
+	const XMFLOAT3 ORBITING_MODEL_EXTENTS = XMFLOAT3(3.0f, 3.0f, 3.0f);
+
+	// Path of the orbiting model around the middle of the grid
+	const float ORBIT_RADIUS = 20.0f;
+	const float ORBIT_HEIGHT = 6.0f;
+	const float ORBIT_SPEED = 0.5f;
+
+	// Upload backend that only counts, for timing the upload queue without a GPU
+	class CountingUploadBackend : public UploadBackend
+	{
+	public:
+		void BeginBatch(uint32_t buffer_bytes) override { frame_bytes = 0; }
+		void Upload(const UploadCommand& command) override { frame_bytes += command.size; }
+		void EndBatch() override {}
+
+		uint64_t frame_bytes = 0;
+	};
+}
 
 Application::Application()
 {
@@ -37,233 +99,1618 @@ Application::Application()
 	// Create shadow map
 	m_ShadowMap = std::make_unique<ShadowMap>(m_Renderer.get());
 
-	// Used for visualiation
-	this->CreateLineBuffer();
+	// Used for visualiation
+	this->CreateLineBuffer();
+
+	// Textures created by the frame graph
+	m_FrameGraphTextures = std::make_unique<FrameGraphTextures>(m_Renderer.get());
+
+	// Holds the transforms of the visible cubes of each pass
+	for (auto& instance_buffer : m_InstanceBuffers)
+	{
+		instance_buffer = std::make_unique<InstanceBuffer>(m_Renderer.get());
+	}
+
+	// Refilled for every tile of the shadow atlas
+	m_AtlasInstanceBuffer = std::make_unique<InstanceBuffer>(m_Renderer.get());
+
+	// Create shader
+	m_DefaultShader = std::make_unique<DefaultShader>(m_Renderer.get());
+	m_DefaultShader->Load();
+
+	// Create shader
+	m_LineShader = std::make_unique<LineShader>(m_Renderer.get());
+	m_LineShader->Load();
+
+	// Create camera
+	m_FreeCamera = std::make_unique<FreeCamera>(window_width, window_height);
+	m_VisualCamera = std::make_unique<VisualCamera>(window_width, window_height);
+	m_ShadowCamera = std::make_unique<ShadowCamera>(window_width, window_height);
+
+	// Cascades cover the free camera's frustum, each gets a full slice of the shadow map
+	m_ShadowCascades.SetResolution(static_cast<uint32_t>(SHADOW_MAP_SIZE));
+
+	m_Renderer->GetRenderDevice()->SetPixelSampler(0, m_ShadowMap->GetShadowSamplerState());
+
+	// Lights shadowed through the atlas
+	this->CreateLocalLights();
+
+	// The largest meshes hide the grid cubes behind them
+	m_OcclusionCuller.AddOccluderBox(GIANT_MODEL_CENTER, GIANT_MODEL_EXTENTS);
+	m_OcclusionCuller.AddOccluderBox(FLOOR_CENTER, FLOOR_EXTENTS);
+
+	// Print some info
+	std::cout << "1) Free camera\n2) Visual camera\n3) Shadow camera\nC) Capture frame commands\nI) Toggle instancing\nR) Toggle constant buffer ring\nF) Toggle state filtering\n+/-) Grid size\nB) Instancing benchmark\nK) Render queue sort benchmark\nM) Toggle multithreaded recording\nT) Recording thread count\nP) Recording thread scaling benchmark\nG) Print frame graph\nU) Upload batching benchmark\nV) Toggle frustum culling\nL) Culling benchmark\nN) Shadow cascade count\nH) Toggle shadow caching\nJ) Shadow caching benchmark\nO) Toggle local lights\nX) Toggle octree culling\nY) Octree benchmark\nZ) Toggle occlusion culling\nRight mouse) Pick grid cube" << '\n';
+}
+
+int Application::Execute()
+{
+	m_Timer.Start();
+
+	// Model
+	m_Floor = std::make_unique<Floor>(m_Renderer.get());
+	m_Floor->Create();
+
+	m_Model = std::make_unique<Model>(m_Renderer.get());
+	m_Model->Create();
+
+	// Main application loop
+	while (m_Running)
+	{
+		m_Timer.Tick();
+		this->CalculateFrameStats();
+
+		MSG msg = {};
+		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+		{
+			if (msg.message == WM_QUIT)
+			{
+				m_Running = false;
+			}
+
+			TranslateMessage(&msg);
+			DispatchMessageW(&msg);
+		}
+		else
+		{
+			// Update camera
+			if (m_CameraToggle == CameraToggle::Visual)
+			{
+				m_VisualCamera->Move(m_Timer.DeltaTime());
+			}
+			else if (m_CameraToggle == CameraToggle::Free)
+			{
+				m_FreeCamera->Move(m_Timer.DeltaTime());
+			}
+
+			// Calculate light view and projection
+			m_ShadowCamera->LookAt(m_FreeCamera.get(), m_FreeCamera->GetPosition(), XMLoadFloat4(&m_LightDirection));
+
+			// Start the frame's constant buffer allocations
+			m_Renderer->BeginFrame();
+
+			// Rebuild the grid transforms and bounds if they have changed
+			this->UpdateGridInstances();
+
+			// Move the dynamic caster
+			this->UpdateOrbitingModel();
+
+			// Fit the shadow cascades and cull every pass
+			this->CullScene();
+
+			// Hand out the shadow atlas' tiles to the lights near the free camera
+			if (m_UseLocalLights)
+			{
+				m_LocalLights.Update(m_FreeCamera->GetView(), m_FreeCamera->GetProjection());
+			}
+
+			// Update light buffer
+			this->UpdateLightConstantBuffer();
+
+			// Record the commands of this frame if a capture was requested
+			bool capture_frame = m_CaptureFrame;
+			if (capture_frame)
+			{
+				m_Renderer->BeginCapture();
+			}
+
+			if (m_UseParallelRecording)
+			{
+				// Both passes are recorded on worker threads and executed here in order, command lists start with nothing bound so there is nothing to unbind
+				this->RecordPassesParallel(m_RecordingThreadCount, capture_frame, true);
+			}
+			else
+			{
+				// Render the shadow map then the scene applying it
+				this->BuildFrameGraph();
+				m_FrameGraph.Execute(*m_FrameGraphTextures);
+			}
+
+			if (capture_frame)
+			{
+				this->PrintFrameCapture(m_Renderer->EndCapture());
+				if (m_UseParallelRecording)
+				{
+					this->PrintParallelCapture();
+				}
+
+				m_CaptureFrame = false;
+			}
+
+			// Display the rendered scene
+			m_Renderer->Present();
+		}
+	}
+
+	return 0;
+}
+
+LRESULT Application::HandleMessage(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+	switch (msg)
+	{
+		case WM_DESTROY:
+			PostQuitMessage(0);
+			return 0;
+
+		case WM_SIZE:
+			this->OnResized(hwnd, msg, wParam, lParam);
+			return 0;
+
+		case WM_MOUSEMOVE:
+			this->OnMouseMove(hwnd, msg, wParam, lParam);
+			return 0;
+
+		case WM_RBUTTONDOWN:
+			this->PickGridCube(static_cast<int>(GET_X_LPARAM(lParam)), static_cast<int>(GET_Y_LPARAM(lParam)));
+			return 0;
+
+		case WM_KEYDOWN:
+		{
+			// Toggle between cameras
+			switch (wParam)
+			{
+				case '1':
+					if (m_CameraToggle != CameraToggle::Free)
+					{
+						std::cout << "Free camera\n";
+						m_CameraToggle = CameraToggle::Free;
+					}
+					break;
+				case '2':
+					if (m_CameraToggle != CameraToggle::Visual)
+					{
+						std::cout << "Visual camera\n";
+						m_CameraToggle = CameraToggle::Visual;
+
+						m_VisualCamera->SetPosition(m_FreeCamera->GetPosition());
+					}
+					break;
+				case '3':
+					if (m_CameraToggle != CameraToggle::Shadow)
+					{
+						std::cout << "Shadow camera\n";
+						m_CameraToggle = CameraToggle::Shadow;
+					}
+					break;
+				case 'C':
+					m_CaptureFrame = true;
+					break;
+				case 'I':
+					m_UseInstancing = !m_UseInstancing;
+					m_GridInstancesDirty = true;
+					std::cout << (m_UseInstancing ? "Instancing on\n" : "Instancing off\n");
+					break;
+				case 'R':
+					if (m_Renderer->SupportsConstantBufferRing())
+					{
+						m_UseConstantBufferRing = !m_UseConstantBufferRing;
+						m_Renderer->SetConstantBufferRingEnabled(m_UseConstantBufferRing);
+						std::cout << (m_UseConstantBufferRing ? "Constant buffer ring on\n" : "Constant buffer ring off\n");
+					}
+					else
+					{
+						std::cout << "Constant buffer offsets are not supported, using a buffer per constant block\n";
+					}
+					break;
+				case 'F':
+					m_Renderer->SetStateCacheEnabled(!m_Renderer->IsStateCacheEnabled());
+					std::cout << (m_Renderer->IsStateCacheEnabled() ? "State filtering on\n" : "State filtering off\n");
+					break;
+				case VK_ADD:
+				case VK_OEM_PLUS:
+					this->ResizeGrid(m_GridSize * 2);
+					break;
+				case VK_SUBTRACT:
+				case VK_OEM_MINUS:
+					this->ResizeGrid(m_GridSize / 2);
+					break;
+				case 'B':
+					this->RunInstancingBenchmark();
+					break;
+				case 'K':
+					this->RunRenderQueueBenchmark();
+					break;
+				case 'M':
+					m_UseParallelRecording = !m_UseParallelRecording;
+					std::cout << (m_UseParallelRecording ? "Multithreaded recording on (" : "Multithreaded recording off (") << m_RecordingThreadCount << " threads)\n";
+					break;
+				case 'T':
+					m_RecordingThreadCount = (m_RecordingThreadCount >= 8) ? 1 : m_RecordingThreadCount * 2;
+					std::cout << "Recording threads: " << m_RecordingThreadCount << '\n';
+					break;
+				case 'P':
+					this->RunRecordingBenchmark();
+					break;
+				case 'G':
+					m_FrameGraph.Print();
+					break;
+				case 'U':
+					m_Renderer->GetUploadQueue()->Print();
+					this->RunUploadBenchmark();
+					break;
+				case 'V':
+					m_UseCulling = !m_UseCulling;
+					m_ShadowCache.Invalidate();
+					std::cout << (m_UseCulling ? "Frustum culling on\n" : "Frustum culling off\n");
+					break;
+				case 'L':
+					this->RunCullingBenchmark();
+					this->RunCollisionBenchmark();
+					break;
+				case 'N':
+					m_ShadowCascades.SetCascadeCount(m_ShadowCascades.GetCascadeCount() % MAX_SHADOW_CASCADES + 1);
+					std::cout << "Shadow cascades: " << m_ShadowCascades.GetCascadeCount() << '\n';
+					break;
+				case 'H':
+					m_UseShadowCache = !m_UseShadowCache;
+					std::cout << (m_UseShadowCache ? "Shadow caching on\n" : "Shadow caching off\n");
+					break;
+				case 'J':
+					this->RunShadowCacheBenchmark();
+					break;
+				case 'O':
+					m_UseLocalLights = !m_UseLocalLights;
+					m_LocalLights.Invalidate();
+					std::cout << (m_UseLocalLights ? "Local lights on\n" : "Local lights off\n");
+					break;
+				case 'X':
+					m_UseOctree = !m_UseOctree;
+					std::cout << (m_UseOctree ? "Octree culling on\n" : "Octree culling off\n");
+					break;
+				case 'Y':
+					this->RunOctreeBenchmark();
+					break;
+				case 'Z':
+					m_UseOcclusionCulling = !m_UseOcclusionCulling;
+					std::cout << (m_UseOcclusionCulling ? "Occlusion culling on\n" : "Occlusion culling off\n");
+					break;
+			}
+
+			return 0;
+		}
+	}
+
+	return DefWindowProc(hwnd, msg, wParam, lParam);
+}
+
+void Application::BuildFrameGraph()
+{
+	m_FrameGraph.Reset();
+
+	// Every texture is owned by the renderer and the shadow map
+	FrameGraphHandle shadow_map = m_FrameGraph.ImportTexture("Shadow map");
+	FrameGraphHandle shadow_atlas = m_FrameGraph.ImportTexture("Shadow atlas");
+	FrameGraphHandle back_buffer = m_FrameGraph.ImportTexture("Back buffer");
+
+	// Must render the scene to generate the shadow map
+	uint32_t shadows_pass = m_FrameGraph.AddPass("Shadows", [this]() { this->RenderShadowsPass(); });
+	m_FrameGraph.Write(shadows_pass, shadow_map, FrameGraphAccess::DepthStencil);
+
+	// Then the local lights' tiles
+	uint32_t atlas_pass = m_FrameGraph.AddPass("Shadow atlas", [this]() { this->RenderShadowAtlasPass(); });
+	m_FrameGraph.Write(atlas_pass, shadow_atlas, FrameGraphAccess::DepthStencil);
+
+	// Render the scene again this time applying the shadow map
+	uint32_t main_pass = m_FrameGraph.AddPass("Main", [this]() { this->RenderMainPass(); });
+	m_FrameGraph.Read(main_pass, shadow_map, 0);
+	m_FrameGraph.Read(main_pass, shadow_atlas, 1);
+	m_FrameGraph.Write(main_pass, back_buffer, FrameGraphAccess::RenderTarget);
+
+	// Only compiles on the first frame, the passes are the same every frame after
+	m_FrameGraph.Compile();
+}
+
+void Application::RenderShadowsPass()
+{
+	// Bring the cached static depth up to date
+	this->RenderShadowCache();
+
+	// Render the scene into each cascade's slice, only the dynamic casters when the static ones are cached
+	for (uint32_t cascade = 0; cascade < m_ShadowCascades.GetCascadeCount(); ++cascade)
+	{
+		this->BeginShadowsPass(cascade, true);
+		this->RenderScene(this->GetPassView(SHADOW_PASS + cascade), SHADOW_PASS + cascade, this->GetShadowLayers());
+	}
+}
+
+void Application::RenderShadowCache()
+{
+	if (!m_UseShadowCache)
+		return;
+
+	m_ShadowCache.BeginFrame();
+
+	// Only cascades that moved, or whose static casters changed, are rendered again
+	for (uint32_t cascade = 0; cascade < m_ShadowCascades.GetCascadeCount(); ++cascade)
+	{
+		if (!m_ShadowCache.UpdateCascade(cascade, m_ShadowCascades.GetView(cascade), m_ShadowCascades.GetProjection(cascade)))
+			continue;
+
+		m_ShadowMap->BindCache(cascade);
+		this->UseCascadeCamera(cascade);
+		this->RenderScene(this->GetPassView(SHADOW_PASS + cascade), SHADOW_PASS + cascade, SceneLayers::Static);
+	}
+}
+
+void Application::RenderShadowAtlasPass()
+{
+	if (!m_UseLocalLights)
+		return;
+
+	// Lights without tiles this frame are left unshadowed, and tiles whose depth is still right are left as they are
+	const std::vector<LocalShadowView>& shadow_views = m_LocalLights.GetShadowViews();
+	for (size_t i = 0; i < shadow_views.size(); ++i)
+	{
+		const LocalShadowView& shadow_view = shadow_views[i];
+		if (!shadow_view.redraw)
+			continue;
+
+		// Depth only from the light's view, into its cleared tile
+		m_ShadowMap->BindAtlasTile(shadow_view.tile, true);
+		m_DefaultShader->Use(false);
+
+		XMMATRIX view = XMLoadFloat4x4(&shadow_view.view);
+		XMMATRIX projection = XMLoadFloat4x4(&shadow_view.projection);
+		XMFLOAT3 position;
+		XMStoreFloat3(&position, XMMatrixInverse(nullptr, view).r[3]);
+		m_DefaultShader->UpdateCameraBuffer(view, projection, position);
+
+		// Meshes outside the light's frustum cast nothing into the tile
+		if (shadow_view.frustum.IntersectsBox(FLOOR_CENTER, FLOOR_EXTENTS))
+		{
+			this->DrawSceneItem(DRAW_FLOOR);
+		}
+
+		if (shadow_view.frustum.IntersectsBox(GIANT_MODEL_CENTER, GIANT_MODEL_EXTENTS))
+		{
+			this->DrawSceneItem(DRAW_GIANT_MODEL);
+		}
+
+		if (shadow_view.frustum.IntersectsBox(m_OrbitingModelPosition, ORBITING_MODEL_EXTENTS))
+		{
+			this->DrawSceneItem(DRAW_ORBITING_MODEL);
+		}
+
+		// The lights are small so culling a tile on this thread is cheaper than starting workers
+		if (m_UseOctree)
+		{
+			m_SceneOctree.QueryFrustum(shadow_view.frustum, m_AtlasVisibleGrid);
+		}
+		else
+		{
+			m_GridCuller.CullSerial(shadow_view.frustum, CullingShape::Box, m_AtlasVisibleGrid);
+		}
+		if (m_UseInstancing)
+		{
+			m_VisibleInstances.resize(m_AtlasVisibleGrid.size());
+			for (size_t j = 0; j < m_AtlasVisibleGrid.size(); ++j)
+			{
+				m_VisibleInstances[j] = m_GridInstances[m_AtlasVisibleGrid[j]];
+			}
+
+			m_AtlasInstanceBuffer->Update(m_VisibleInstances);
+			if (m_AtlasInstanceBuffer->GetInstanceCount() != 0)
+			{
+				this->DrawInstancedGrid(m_AtlasInstanceBuffer.get());
+			}
+		}
+		else
+		{
+			for (uint32_t index : m_AtlasVisibleGrid)
+			{
+				this->DrawSceneItem(DRAW_GRID_CUBE + index);
+			}
+		}
+	}
+}
+
+void Application::CreateLocalLights()
+{
+	const XMFLOAT3 colours[] =
+	{
+		XMFLOAT3(1.0f, 0.6f, 0.3f),
+		XMFLOAT3(0.3f, 0.6f, 1.0f),
+		XMFLOAT3(0.4f, 1.0f, 0.5f),
+		XMFLOAT3(1.0f, 0.4f, 0.8f),
+	};
+
+	// Spot lights pointing down and point lights between them, spread over the default grid
+	m_LocalLights.Clear();
+	for (int x = 0; x < 6; ++x)
+	{
+		for (int z = 0; z < 4; ++z)
+		{
+			LocalLight light;
+			light.type = ((x + z) % 2 == 0) ? ShadowLightType::Spot : ShadowLightType::Point;
+			light.position = XMFLOAT3(-40.0f + x * 16.0f, 8.0f, -36.0f + z * 24.0f);
+			light.direction = XMFLOAT3(0.3f, -1.0f, 0.2f);
+			light.colour = colours[(x + z) % 4];
+			light.range = 18.0f;
+			light.spot_angle = 0.6f;
+			m_LocalLights.Add(light);
+		}
+	}
+}
+
+SceneLayers Application::GetShadowLayers() const
+{
+	return m_UseShadowCache ? SceneLayers::Dynamic : SceneLayers::All;
+}
+
+void Application::RenderMainPass()
+{
+	this->BeginMainPass(true);
+
+	// Render the scene
+	this->RenderScene(this->GetCameraView(), MAIN_PASS);
+
+	// Visualize orbitial camera frustum
+	this->RenderVisualizations();
+}
+
+void Application::BeginShadowsPass(uint32_t cascade, bool clear)
+{
+	// Start from the cached static casters instead of an empty slice
+	if (clear && m_UseShadowCache)
+	{
+		m_ShadowMap->RestoreCache(cascade);
+		clear = false;
+	}
+
+	// Bind the cascade's slice of the shadow map
+	m_ShadowMap->Bind(cascade, clear);
+	this->UseCascadeCamera(cascade);
+}
+
+void Application::UseCascadeCamera(uint32_t cascade)
+{
+	// Bind the shader to the pipeline
+	m_DefaultShader->Use(false);
+
+	// Set camera constant buffer from the cascade
+	XMMATRIX view = m_ShadowCascades.GetView(cascade);
+	XMMATRIX projection = m_ShadowCascades.GetProjection(cascade);
+	XMFLOAT3 position = m_ShadowCascades.GetCascade(cascade).center;
+	m_DefaultShader->UpdateCameraBuffer(view, projection, position);
+}
+
+void Application::BeginMainPass(bool clear)
+{
+	// Set viewport back to scene
+	int width, height;
+	m_Window->GetSize(&width, &height);
+	m_Renderer->SetViewport(width, height);
+
+	// Bind default raster
+	m_Renderer->SetRasterState();
+
+	// Clear the buffers
+	if (clear)
+	{
+		m_Renderer->Clear();
+	}
+	else
+	{
+		m_Renderer->BindRenderTarget();
+	}
+
+	// Bind the shader to the pipeline
+	m_DefaultShader->Use(true);
+
+	// Set camera constant buffer
+	this->UpdateCameraConstantBuffer();
+
+	// Bind shadow map to the pipeline
+	RenderDevice* device = m_Renderer->GetRenderDevice();
+	device->SetPixelShaderResource(0, m_ShadowMap->GetShadowMapTexture());
+	device->SetPixelShaderResource(1, m_ShadowMap->GetShadowAtlasTexture());
+	device->SetPixelSampler(0, m_ShadowMap->GetShadowSamplerState());
+}
+
+XMMATRIX Application::GetPassView(uint32_t pass) const
+{
+	return (pass == MAIN_PASS) ? this->GetCameraView() : m_ShadowCascades.GetView(pass - SHADOW_PASS);
+}
+
+XMMATRIX Application::GetPassProjection(uint32_t pass) const
+{
+	return (pass == MAIN_PASS) ? this->GetCameraProjection() : m_ShadowCascades.GetProjection(pass - SHADOW_PASS);
+}
+
+void Application::RenderScene(const XMMATRIX& view, uint32_t pass, SceneLayers layers)
+{
+	// Submit every draw then sort them so state changes are grouped and near objects are drawn first
+	this->QueueScene(view, pass, layers);
+	m_RenderQueues[pass].Sort();
+
+	for (const RenderQueueItem& item : m_RenderQueues[pass])
+	{
+		this->DrawSceneItem(item.payload);
+	}
+}
+
+void Application::RenderVisualizations()
+{
+	if (m_CameraToggle == CameraToggle::Visual)
+	{
+		m_LineShader->Use();
+		m_LineShader->UpdateModelBuffer(XMMatrixIdentity());
+		this->VisualizeCameraFrustum();
+		this->VisualizeShadowCamera();
+		this->VisualizeLightDirection();
+	}
+}
+
+void Application::BuildGridInstances()
+{
+	m_GridInstances.clear();
+	m_GridInstances.reserve(static_cast<size_t>(m_GridSize) * m_GridSize);
+
+	// The default 13x13 grid spans -50 to 46, bigger grids grow evenly around it
+	const float spacing = 8.0f;
+	const float start = -50.0f - spacing * static_cast<float>(m_GridSize - 13) * 0.5f;
+
+	m_GridCuller.Clear();
+	m_GridCuller.Reserve(static_cast<uint32_t>(m_GridSize) * m_GridSize);
+	m_SceneOctree.Clear();
+
+	for (int x = 0; x < m_GridSize; ++x)
+	{
+		for (int w = 0; w < m_GridSize; ++w)
+		{
+			XMFLOAT3 position(start + x * spacing, 0.0f, start + w * spacing);
+			XMMATRIX model_transform = XMMatrixTranslation(position.x, position.y, position.z);
+
+			InstanceData instance;
+			XMStoreFloat4x4(&instance.model, model_transform);
+			XMStoreFloat4x4(&instance.model_inverse, XMMatrixInverse(nullptr, model_transform));
+			m_GridInstances.push_back(instance);
+
+			// Same index as the instance
+			uint32_t index = m_GridCuller.AddBox(position, GRID_CUBE_EXTENTS);
+			m_SceneOctree.Insert(index, position, GRID_CUBE_EXTENTS);
+		}
+	}
+}
+
+void Application::UpdateGridInstances()
+{
+	if (!m_GridInstancesDirty)
+		return;
+
+	// The visible transforms are uploaded per pass once the grid has been culled
+	this->BuildGridInstances();
+
+	// The grid is static, so the cached shadows no longer match it
+	m_ShadowCache.Invalidate();
+	m_LocalLights.Invalidate();
+
+	m_GridInstancesDirty = false;
+}
+
+void Application::UpdateOrbitingModel()
+{
+	// Circles the middle of the grid, spinning as it goes
+	float angle = m_Timer.TotalTime() * ORBIT_SPEED;
+	XMFLOAT3 previous_position = m_OrbitingModelPosition;
+	m_OrbitingModelPosition = XMFLOAT3(std::cos(angle) * ORBIT_RADIUS, ORBIT_HEIGHT, std::sin(angle) * ORBIT_RADIUS);
+
+	// Light tiles it has left or moved into have to be rendered again
+	if (m_UseLocalLights)
+	{
+		m_LocalLights.InvalidateBox(previous_position, ORBITING_MODEL_EXTENTS);
+		m_LocalLights.InvalidateBox(m_OrbitingModelPosition, ORBITING_MODEL_EXTENTS);
+	}
+
+	XMMATRIX transform = XMMatrixScaling(2.0f, 2.0f, 2.0f) * XMMatrixRotationY(angle * 3.0f);
+	transform *= XMMatrixTranslation(m_OrbitingModelPosition.x, m_OrbitingModelPosition.y, m_OrbitingModelPosition.z);
+	XMStoreFloat4x4(&m_OrbitingModelTransform, transform);
+}
+
+void Application::CullScene()
+{
+	uint32_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+	// One cascade per thread, each culls its own casters
+	m_ShadowCascades.Update(m_FreeCamera->GetView(), m_FreeCamera->GetProjection(), XMLoadFloat4(&m_LightDirection), m_GridCuller, thread_count);
+
+	if (!m_UseCulling)
+	{
+		// Every cube in every pass
+		uint32_t count = m_GridCuller.GetCount();
+		for (std::vector<uint32_t>& visible : m_VisibleGrid)
+		{
+			visible.resize(count);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				visible[i] = i;
+			}
+		}
+
+		return;
+	}
+
+	for (uint32_t cascade = 0; cascade < m_ShadowCascades.GetCascadeCount(); ++cascade)
+	{
+		m_VisibleGrid[SHADOW_PASS + cascade] = m_ShadowCascades.GetCascade(cascade).casters;
+	}
+
+	// Then the main pass' camera
+	XMMATRIX view_projection = this->GetCameraView() * this->GetCameraProjection();
+	CullingFrustum frustum = CullingFrustum::FromViewProjection(view_projection);
+	if (m_UseOctree)
+	{
+		m_SceneOctree.QueryFrustum(frustum, m_VisibleGrid[MAIN_PASS]);
+	}
+	else
+	{
+		m_GridCuller.Cull(frustum, CullingShape::Box, thread_count, m_VisibleGrid[MAIN_PASS]);
+	}
+
+	// And what is left behind the occluders
+	if (m_UseOcclusionCulling)
+	{
+		this->CullOccludedGrid(view_projection, thread_count);
+	}
+}
+
+void Application::CullOccludedGrid(const XMMATRIX& view_projection, uint32_t thread_count)
+{
+	m_OcclusionCuller.Render(view_projection, thread_count);
+
+	// Keep the cubes not entirely behind the occluders, in the same order
+	std::vector<uint32_t>& visible = m_VisibleGrid[MAIN_PASS];
+	size_t visible_count = 0;
+	for (uint32_t index : visible)
+	{
+		const InstanceData& instance = m_GridInstances[index];
+		if (m_OcclusionCuller.TestBox(XMFLOAT3(instance.model._41, instance.model._42, instance.model._43), GRID_CUBE_EXTENTS))
+		{
+			visible[visible_count++] = index;
+		}
+	}
+
+	visible.resize(visible_count);
+}
+
+void Application::QueueScene(const XMMATRIX& view, uint32_t pass, SceneLayers layers)
+{
+	RenderQueue& queue = m_RenderQueues[pass];
+	queue.Clear();
+
+	// Sort keys cover the pass' own near to far planes, a cascade's light view depths can be negative and change every frame
+	XMMATRIX inverse_projection = XMMatrixInverse(nullptr, this->GetPassProjection(pass));
+	float near_depth = XMVectorGetZ(XMVector3TransformCoord(XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), inverse_projection));
+	float far_depth = XMVectorGetZ(XMVector3TransformCoord(XMVectorSet(0.0f, 0.0f, 1.0f, 1.0f), inverse_projection));
+	queue.SetDepthRange(near_depth, far_depth);
+
+	// Keys are ordered on the view space depth of the object's origin
+	auto view_depth = [&view](float x, float y, float z)
+	{
+		return XMVectorGetZ(XMVector3TransformCoord(XMVectorSet(x, y, z, 1.0f), view));
+	};
+
+	// The cascades skip the floor and giant model when they are outside their caster volume
+	auto is_drawn = [this, pass](const XMFLOAT3& center, const XMFLOAT3& extents)
+	{
+		return (pass == MAIN_PASS || !m_UseCulling) ? true : m_ShadowCascades.GetCascade(pass - SHADOW_PASS).caster_volume.IntersectsBox(center, extents);
+	};
+
+	// Orbiting model, the only dynamic caster
+	if (layers != SceneLayers::Static && is_drawn(m_OrbitingModelPosition, ORBITING_MODEL_EXTENTS))
+	{
+		const XMFLOAT3& position = m_OrbitingModelPosition;
+		queue.Submit(queue.MakeOpaqueKey(pass, DEFAULT_SHADER, MODEL_MATERIAL, 0, view_depth(position.x, position.y, position.z)), DRAW_ORBITING_MODEL);
+	}
+
+	// Everything else is static
+	if (layers == SceneLayers::Dynamic)
+		return;
+
+	// Floor
+	if (is_drawn(FLOOR_CENTER, FLOOR_EXTENTS))
+	{
+		queue.Submit(queue.MakeOpaqueKey(pass, DEFAULT_SHADER, FLOOR_MATERIAL, 0, view_depth(0.0f, -1.0f, 0.0f)), DRAW_FLOOR);
+	}
+
+	// Giant model
+	if (is_drawn(GIANT_MODEL_CENTER, GIANT_MODEL_EXTENTS))
+	{
+		queue.Submit(queue.MakeOpaqueKey(pass, DEFAULT_SHADER, MODEL_MATERIAL, 0, view_depth(0.0f, 5.0f, -50.0f)), DRAW_GIANT_MODEL);
+	}
+
+	// Only the cubes left by this frame's culling are drawn
+	const std::vector<uint32_t>& visible = m_VisibleGrid[pass];
+
+	// Grid of small models
+	if (m_UseInstancing)
+	{
+		// Gather the visible transforms into the pass' instance buffer
+		m_VisibleInstances.resize(visible.size());
+		for (size_t i = 0; i < visible.size(); ++i)
+		{
+			m_VisibleInstances[i] = m_GridInstances[visible[i]];
+		}
+
+		InstanceBuffer* instance_buffer = m_InstanceBuffers[pass].get();
+		instance_buffer->Update(m_VisibleInstances);
+		if (instance_buffer->GetInstanceCount() == 0)
+			return;
+
+		// The whole grid is one draw, sorted by its middle visible cube
+		const InstanceData& middle = m_VisibleInstances[m_VisibleInstances.size() / 2];
+		float depth = view_depth(middle.model._41, middle.model._42, middle.model._43);
+		queue.Submit(queue.MakeOpaqueKey(pass, INSTANCED_SHADER, MODEL_MATERIAL, 0, depth), DRAW_INSTANCED_GRID + pass);
+	}
+	else
+	{
+		for (uint32_t index : visible)
+		{
+			const InstanceData& instance = m_GridInstances[index];
+			float depth = view_depth(instance.model._41, instance.model._42, instance.model._43);
+			queue.Submit(queue.MakeOpaqueKey(pass, DEFAULT_SHADER, MODEL_MATERIAL, 0, depth), DRAW_GRID_CUBE + index);
+		}
+	}
+}
+
+void Application::DrawSceneItem(uint32_t draw)
+{
+	if (draw == DRAW_FLOOR)
+	{
+		// Render the floor
+		XMMATRIX floor_transform = XMMatrixIdentity();
+		floor_transform *= XMMatrixTranslation(0.0f, -1.0f, 0.0f);
+		this->UpdateModelConstantBuffer(floor_transform);
+		m_Floor->Render();
+	}
+	else if (draw == DRAW_GIANT_MODEL)
+	{
+		// Render the model as giant
+		XMMATRIX model_transform = XMMatrixIdentity();
+		model_transform *= XMMatrixScaling(10.0f, 10.0f, 10.0f);
+		model_transform *= XMMatrixTranslation(0.0f, 5.0f, -50.0f);
+		this->UpdateModelConstantBuffer(model_transform);
+		m_Model->Render();
+	}
+	else if (draw == DRAW_ORBITING_MODEL)
+	{
+		// Render the model moved along its orbit this frame
+		this->UpdateModelConstantBuffer(XMLoadFloat4x4(&m_OrbitingModelTransform));
+		m_Model->Render();
+	}
+	else if (draw < DRAW_GRID_CUBE)
+	{
+		this->DrawInstancedGrid(m_InstanceBuffers[draw - DRAW_INSTANCED_GRID].get());
+	}
+	else
+	{
+		// One constant buffer update and draw per cube
+		const InstanceData& instance = m_GridInstances[draw - DRAW_GRID_CUBE];
+		this->UpdateModelConstantBuffer(XMLoadFloat4x4(&instance.model));
+		m_Model->Render();
+	}
+}
+
+void Application::DrawInstancedGrid(InstanceBuffer* instance_buffer)
+{
+	// One draw for the visible grid, the transforms come from instance slot 1
+	m_DefaultShader->UseInstancedVertexShader(true);
+	instance_buffer->Bind(1);
+	m_Model->RenderInstanced(instance_buffer->GetInstanceCount());
+	m_DefaultShader->UseInstancedVertexShader(false);
+}
+
+void Application::ResizeGrid(int grid_size)
+{
+	const int min_grid_size = 13;
+	const int max_grid_size = 416;
+	if (grid_size < min_grid_size || grid_size > max_grid_size)
+		return;
+
+	m_GridSize = grid_size;
+	m_GridInstancesDirty = true;
+
+	std::cout << "Grid " << m_GridSize << "x" << m_GridSize << " (" << (m_GridSize * m_GridSize) << " cubes)\n";
+}
+
+void Application::RunInstancingBenchmark()
+{
+	const int grid_sizes[] = { 13, 26, 52, 104, 208, 416 };
+	const int iterations = 10;
+
+	int previous_grid_size = m_GridSize;
+	bool previous_use_instancing = m_UseInstancing;
+
+	// Only the CPU side is measured, commands are recorded but not sent to the GPU
+	std::cout << "Instancing benchmark - CPU time to build, sort and submit the scene for one pass (" << iterations << " runs each)\n";
+
+	for (int grid_size : grid_sizes)
+	{
+		m_GridSize = grid_size;
+		std::cout << "  " << (grid_size * grid_size) << " cubes\n";
+
+		for (int instanced = 0; instanced <= 1; ++instanced)
+		{
+			m_UseInstancing = (instanced == 1);
+
+			double total_ms = 0.0;
+			RenderDeviceStats stats;
+			for (int i = 0; i < iterations; ++i)
+			{
+				m_Renderer->BeginCapture(false);
+				m_Renderer->BeginFrame();
+
+				auto start_time = std::chrono::high_resolution_clock::now();
+				m_GridInstancesDirty = true;
+				this->UpdateGridInstances();
+				this->CullScene();
+				this->RenderScene(this->GetPassView(SHADOW_PASS), SHADOW_PASS);
+				auto end_time = std::chrono::high_resolution_clock::now();
+
+				total_ms += std::chrono::duration<double, std::milli>(end_time - start_time).count();
+				stats = m_Renderer->EndCapture().GetStats();
+			}
+
+			std::cout << "    " << (m_UseInstancing ? "Instanced: " : "Per draw:  ") << (total_ms / iterations) << " ms, "
+				<< stats.draw_calls << " draws, " << stats.total_calls << " calls, " << stats.upload_bytes << " bytes uploaded\n";
+		}
+	}
+
+	// Restore the scene
+	m_GridSize = previous_grid_size;
+	m_UseInstancing = previous_use_instancing;
+	m_GridInstancesDirty = true;
+}
+
+void Application::RunRenderQueueBenchmark()
+{
+	const uint32_t submission_counts[] = { 10000, 100000, 250000, 1000000 };
+	const int iterations = 10;
+
+	std::cout << "Render queue benchmark - CPU time to submit and sort random keys (" << iterations << " runs each)\n";
+
+	// Random depths and state, like a large unsorted scene
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<float> depth_distribution(0.0f, 1000.0f);
+	std::uniform_int_distribution<uint32_t> state_distribution(0, 63);
+
+	for (uint32_t count : submission_counts)
+	{
+		std::vector<uint64_t> keys(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			keys[i] = m_RenderQueues[MAIN_PASS].MakeOpaqueKey(MAIN_PASS, state_distribution(generator) % 4, state_distribution(generator),
+				state_distribution(generator), depth_distribution(generator));
+		}
+
+		// Allocate up front so only the first frame at a new size grows the queue
+		RenderQueue queue;
+		queue.Reserve(count);
+
+		double radix_ms = 0.0;
+		double std_sort_ms = 0.0;
+		std::vector<RenderQueueItem> items(count);
+		for (int i = 0; i < iterations; ++i)
+		{
+			auto start_time = std::chrono::high_resolution_clock::now();
+			queue.Clear();
+			for (uint32_t j = 0; j < count; ++j)
+			{
+				queue.Submit(keys[j], j);
+			}
+			queue.Sort();
+			auto end_time = std::chrono::high_resolution_clock::now();
+			radix_ms += std::chrono::duration<double, std::milli>(end_time - start_time).count();
+
+			start_time = std::chrono::high_resolution_clock::now();
+			for (uint32_t j = 0; j < count; ++j)
+			{
+				items[j] = { keys[j], j };
+			}
+			std::sort(items.begin(), items.end(), [](const RenderQueueItem& a, const RenderQueueItem& b) { return a.key < b.key; });
+			end_time = std::chrono::high_resolution_clock::now();
+			std_sort_ms += std::chrono::duration<double, std::milli>(end_time - start_time).count();
+		}
+
+		// Both orders must agree on the keys
+		bool matches = std::equal(queue.begin(), queue.end(), items.begin(), [](const RenderQueueItem& a, const RenderQueueItem& b) { return a.key == b.key; });
+
+		std::cout << "  " << count << " draws: radix " << (radix_ms / iterations) << " ms, std::sort " << (std_sort_ms / iterations) << " ms"
+			<< (matches ? "\n" : " (orders differ)\n");
+	}
+}
+
+void Application::RunUploadBenchmark()
+{
+	const uint64_t budgets[] = { 1024 * 1024, 4 * 1024 * 1024, 16 * 1024 * 1024, UploadQueue::UNLIMITED_BUDGET };
+	const uint32_t scene_bytes = 64 * 1024 * 1024;
+
+	std::cout << "Upload benchmark - streaming " << (scene_bytes / (1024 * 1024)) << " MB of 4 KB to 1 MB buffers\n";
+
+	// Buffer sizes of a scene load, mostly small with a few large meshes
+	std::mt19937 generator(42);
+	std::uniform_int_distribution<uint32_t> size_distribution(12, 20);
+	std::vector<uint32_t> sizes;
+	for (uint32_t total = 0; total < scene_bytes;)
+	{
+		uint32_t size = 1u << size_distribution(generator);
+		sizes.push_back(size);
+		total += size;
+	}
+
+	std::vector<uint8_t> data(1 << 20);
+
+	for (uint64_t budget : budgets)
+	{
+		UploadQueue queue;
+		CountingUploadBackend backend;
+
+		auto start_time = std::chrono::high_resolution_clock::now();
+		for (uint32_t size : sizes)
+		{
+			queue.QueueBuffer(nullptr, 0, data.data(), size);
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		double queue_ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+
+		// One flush per frame until everything has gone
+		uint32_t frames = 0;
+		uint64_t largest_frame = 0;
+		double flush_ms = 0.0;
+		while (!queue.IsEmpty())
+		{
+			start_time = std::chrono::high_resolution_clock::now();
+			queue.Flush(backend, budget);
+			end_time = std::chrono::high_resolution_clock::now();
+			flush_ms += std::chrono::duration<double, std::milli>(end_time - start_time).count();
+
+			largest_frame = std::max(largest_frame, backend.frame_bytes);
+			frames++;
+		}
+
+		std::cout << "  " << (budget == UploadQueue::UNLIMITED_BUDGET ? std::string("Unlimited") : std::to_string(budget / 1024) + " KB") << " budget: "
+			<< sizes.size() << " uploads over " << frames << " frames, largest frame " << (largest_frame / 1024) << " KB, queue " << queue_ms
+			<< " ms, flush " << (flush_ms / frames) << " ms a frame, " << queue.GetStats().page_count << " staging pages\n";
+	}
+}
+
+void Application::RunCullingBenchmark()
+{
+	const uint32_t object_counts[] = { 10000, 100000, 1000000 };
+	const int iterations = 10;
+	uint32_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+	std::cout << "Culling benchmark - CPU time to cull random boxes against the free camera (" << iterations << " runs each, "
+		<< FrustumCuller::GetInstructionSet() << " with " << FrustumCuller::GetLaneCount() << " lanes, " << thread_count << " threads)\n";
+
+	// The free camera's frustum in world space, for both the culler and DirectXCollision
+	XMMATRIX view = m_FreeCamera->GetView();
+	XMMATRIX projection = m_FreeCamera->GetProjection();
+	CullingFrustum frustum = CullingFrustum::FromViewProjection(view * projection);
+
+	BoundingFrustum bounding_frustum;
+	BoundingFrustum::CreateFromMatrix(bounding_frustum, projection);
+	bounding_frustum.Transform(bounding_frustum, XMMatrixInverse(nullptr, view));
+
+	// Boxes scattered around the camera, so a fraction of them are visible
+	XMFLOAT3 camera_position = m_FreeCamera->GetPosition();
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<float> position_distribution(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> extent_distribution(0.5f, 4.0f);
+
+	for (uint32_t count : object_counts)
+	{
+		FrustumCuller culler;
+		culler.Reserve(count);
+
+		std::vector<BoundingBox> boxes(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			XMFLOAT3 center(camera_position.x + position_distribution(generator), camera_position.y + position_distribution(generator) * 0.1f,
+				camera_position.z + position_distribution(generator));
+			XMFLOAT3 extents(extent_distribution(generator), extent_distribution(generator), extent_distribution(generator));
+
+			culler.AddBox(center, extents);
+			boxes[i] = BoundingBox(center, extents);
+		}
+
+		std::vector<uint32_t> visible;
+		visible.reserve(count);
+
+		// One box at a time through DirectXCollision as the baseline
+		double collision_ms = 0.0;
+		for (int i = 0; i < iterations; ++i)
+		{
+			auto start_time = std::chrono::high_resolution_clock::now();
+			visible.clear();
+			for (uint32_t j = 0; j < count; ++j)
+			{
+				if (bounding_frustum.Intersects(boxes[j]))
+				{
+					visible.push_back(j);
+				}
+			}
+			auto end_time = std::chrono::high_resolution_clock::now();
+			collision_ms += std::chrono::duration<double, std::milli>(end_time - start_time).count();
+		}
+
+		std::cout << "  " << count << " objects\n";
+		std::cout << "    DirectXCollision:    " << (collision_ms / iterations) << " ms, " << visible.size() << " visible\n";
+
+		// Structure of arrays boxes and spheres, on one thread then on every thread
+		for (int sphere = 0; sphere <= 1; ++sphere)
+		{
+			CullingShape shape = (sphere == 1) ? CullingShape::Sphere : CullingShape::Box;
+
+			for (uint32_t threads : { 1u, thread_count })
+			{
+				double cull_ms = 0.0;
+				for (int i = 0; i < iterations; ++i)
+				{
+					auto start_time = std::chrono::high_resolution_clock::now();
+					culler.Cull(frustum, shape, threads, visible);
+					auto end_time = std::chrono::high_resolution_clock::now();
+					cull_ms += std::chrono::duration<double, std::milli>(end_time - start_time).count();
+				}
+
+				const CullingStats& stats = culler.GetStats();
+				std::cout << "    " << (sphere == 1 ? "Spheres" : "Boxes") << ", " << stats.thread_count << (stats.thread_count == 1 ? " thread:  " : " threads: ")
+					<< (cull_ms / iterations) << " ms, " << stats.visible_count << " visible, " << stats.chunk_count << " chunks\n";
+			}
+		}
+	}
+}
+
+void Application::RunCollisionBenchmark()
+{
+	const uint32_t object_counts[] = { 1000, 10000, 100000 };
+	const int iterations = 10;
+	uint32_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+	std::cout << "Collision benchmark - CPU time to classify random boxes against each volume (" << iterations << " runs each, "
+		<< CollisionBatch::GetInstructionSet() << " with " << CollisionBatch::GetLaneCount() << " lanes, " << thread_count << " threads)\n";
+
+	// The free camera's frustum in world space and volumes of a similar size in front of it
+	XMMATRIX view = m_FreeCamera->GetView();
+	XMMATRIX projection = m_FreeCamera->GetProjection();
+
+	BoundingFrustum frustum;
+	BoundingFrustum::CreateFromMatrix(frustum, projection);
+	frustum.Transform(frustum, XMMatrixInverse(nullptr, view));
+
+	XMFLOAT3 camera_position = m_FreeCamera->GetPosition();
+	BoundingSphere sphere(camera_position, 250.0f);
+	BoundingBox box(camera_position, XMFLOAT3(250.0f, 50.0f, 150.0f));
+
+	BoundingOrientedBox oriented_box;
+	oriented_box.Center = camera_position;
+	oriented_box.Extents = XMFLOAT3(250.0f, 50.0f, 150.0f);
+	XMStoreFloat4(&oriented_box.Orientation, XMQuaternionRotationRollPitchYaw(0.3f, 0.7f, 0.1f));
+
+	// Boxes scattered around the camera, so some are inside each volume, some cross it and the rest miss it
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<float> position_distribution(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> extent_distribution(0.5f, 4.0f);
+
+	for (uint32_t count : object_counts)
+	{
+		CollisionBatch batch;
+		batch.Reserve(count);
+
+		std::vector<BoundingBox> boxes(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			XMFLOAT3 center(camera_position.x + position_distribution(generator), camera_position.y + position_distribution(generator) * 0.1f,
+				camera_position.z + position_distribution(generator));
+			XMFLOAT3 extents(extent_distribution(generator), extent_distribution(generator), extent_distribution(generator));
+
+			batch.AddBox(center, extents);
+			boxes[i] = BoundingBox(center, extents);
+		}
+
+		std::cout << "  " << count << " objects\n";
+
+		std::vector<ContainmentType> results(count);
+		std::vector<uint32_t> intersects;
+		std::vector<uint32_t> contains;
+
+		// Each volume one box at a time through DirectXCollision, then batched on one thread and on every thread
+		auto measure = [&](const char* name, const auto& volume)
+		{
+			double collision_ms = 0.0;
+			for (int i = 0; i < iterations; ++i)
+			{
+				auto start_time = std::chrono::high_resolution_clock::now();
+				for (uint32_t j = 0; j < count; ++j)
+				{
+					results[j] = volume.Contains(boxes[j]);
+				}
+				auto end_time = std::chrono::high_resolution_clock::now();
+				collision_ms += std::chrono::duration<double, std::milli>(end_time - start_time).count();
+			}
+
+			std::cout << "    " << name << "\n";
+			std::cout << "      DirectXCollision:    " << (collision_ms / iterations) << " ms\n";
 
-	// Create shader
-	m_DefaultShader = std::make_unique<DefaultShader>(m_Renderer.get());
-	m_DefaultShader->Load();
+			for (uint32_t threads : { 1u, thread_count })
+			{
+				double batch_ms = 0.0;
+				for (int i = 0; i < iterations; ++i)
+				{
+					auto start_time = std::chrono::high_resolution_clock::now();
+					batch.Classify(volume, threads, intersects, contains);
+					auto end_time = std::chrono::high_resolution_clock::now();
+					batch_ms += std::chrono::duration<double, std::milli>(end_time - start_time).count();
+				}
+
+				// Boxes where the masks and DirectXCollision disagree, which can happen for boxes just touching the volume
+				uint32_t mismatches = 0;
+				for (uint32_t j = 0; j < count; ++j)
+				{
+					if (CollisionBatch::GetContainment(intersects, contains, j) != results[j])
+					{
+						mismatches++;
+					}
+				}
 
-	// Create shader
-	m_LineShader = std::make_unique<LineShader>(m_Renderer.get());
-	m_LineShader->Load();
+				const CollisionBatchStats& stats = batch.GetStats();
+				std::cout << "      Batch, " << stats.thread_count << (stats.thread_count == 1 ? " thread:  " : " threads: ") << (batch_ms / iterations)
+					<< " ms, " << stats.intersecting_count << " intersecting, " << stats.contained_count << " contained, " << mismatches << " mismatches\n";
+			}
+		};
 
-	// Create camera
-	m_FreeCamera = std::make_unique<FreeCamera>(window_width, window_height);
-	m_VisualCamera = std::make_unique<VisualCamera>(window_width, window_height);
-	m_ShadowCamera = std::make_unique<ShadowCamera>(window_width, window_height);
+		measure("Frustum", frustum);
+		measure("Sphere", sphere);
+		measure("Box", box);
+		measure("Oriented box", oriented_box);
+	}
+}
 
-	ID3D11SamplerState* shadow_sampler = m_ShadowMap->GetShadowSamplerState();
-	m_Renderer->GetDeviceContext()->PSSetSamplers(0, 1, &shadow_sampler);
+void Application::PickGridCube(int mouse_x, int mouse_y)
+{
+	int width, height;
+	m_Window->GetSize(&width, &height);
 
-	// Print some info
-	std::cout << "1) Free camera\n2) Visual camera\n3) Shadow camera" << '\n';
+	// Ray from the cursor on the near plane to the far plane
+	XMMATRIX view = this->GetCameraView();
+	XMMATRIX projection = this->GetCameraProjection();
+	XMVECTOR near_point = XMVector3Unproject(XMVectorSet(static_cast<float>(mouse_x), static_cast<float>(mouse_y), 0.0f, 0.0f), 0.0f, 0.0f,
+		static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f, projection, view, XMMatrixIdentity());
+	XMVECTOR far_point = XMVector3Unproject(XMVectorSet(static_cast<float>(mouse_x), static_cast<float>(mouse_y), 1.0f, 0.0f), 0.0f, 0.0f,
+		static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f, projection, view, XMMatrixIdentity());
+
+	XMFLOAT3 origin, direction;
+	XMStoreFloat3(&origin, near_point);
+	XMStoreFloat3(&direction, XMVectorSubtract(far_point, near_point));
+
+	// Distances are fractions of the way to the far plane
+	uint32_t cube = 0;
+	float distance = 0.0f;
+	if (m_SceneOctree.Raycast(origin, direction, 1.0f, cube, distance))
+	{
+		std::cout << "Picked grid cube " << cube << ", " << distance * XMVectorGetX(XMVector3Length(XMLoadFloat3(&direction))) << " units away\n";
+	}
+	else
+	{
+		std::cout << "No grid cube under the cursor\n";
+	}
 }
 
-int Application::Execute()
+void Application::RunOctreeBenchmark()
 {
-	m_Timer.Start();
+	const uint32_t object_counts[] = { 10000, 100000, 1000000 };
+	const int iterations = 10;
+	const uint32_t ray_count = 64;
 
-	// Model
-	m_Floor = std::make_unique<Floor>(m_Renderer.get());
-	m_Floor->Create();
+	std::cout << "Octree benchmark - CPU time of each query against scanning every object (" << iterations << " runs each, " << FrustumCuller::GetInstructionSet()
+		<< " on one thread)\n";
 
-	m_Model = std::make_unique<Model>(m_Renderer.get());
-	m_Model->Create();
+	// Average time of a function over the iterations
+	auto time_ms = [iterations](auto&& function)
+	{
+		auto start_time = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; ++i)
+		{
+			function(i);
+		}
+		auto end_time = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(end_time - start_time).count() / iterations;
+	};
+
+	// The same scene as the culling benchmark, boxes scattered around the free camera
+	CullingFrustum frustum = CullingFrustum::FromViewProjection(m_FreeCamera->GetView() * m_FreeCamera->GetProjection());
+	XMFLOAT3 camera_position = m_FreeCamera->GetPosition();
+	std::mt19937 generator(42);
+	std::uniform_real_distribution<float> position_distribution(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> extent_distribution(0.5f, 4.0f);
+
+	// Rays leaving the camera in every direction, 200 units long
+	std::uniform_real_distribution<float> direction_distribution(-1.0f, 1.0f);
+	std::vector<XMFLOAT3> ray_directions(ray_count);
+	for (XMFLOAT3& direction : ray_directions)
+	{
+		direction = XMFLOAT3(direction_distribution(generator), direction_distribution(generator) * 0.1f, direction_distribution(generator));
+		XMStoreFloat3(&direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+	}
 
-	// Light direction
-	XMFLOAT4 light_direction = DirectX::XMFLOAT4(0.7f, -0.6f, 0.4f, 1.0f);
+	const float ray_length = 200.0f;
+	const float sphere_radius = 50.0f;
+	const XMFLOAT3 box_extents = XMFLOAT3(50.0f, 50.0f, 50.0f);
 
-	// Main application loop
-	while (m_Running)
+	for (uint32_t count : object_counts)
 	{
-		m_Timer.Tick();
-		this->CalculateFrameStats();
+		FrustumCuller culler;
+		culler.Reserve(count);
 
-		MSG msg = {};
-		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+		std::vector<XMFLOAT3> centers(count);
+		std::vector<XMFLOAT3> extents(count);
+		for (uint32_t i = 0; i < count; ++i)
 		{
-			if (msg.message == WM_QUIT)
+			centers[i] = XMFLOAT3(camera_position.x + position_distribution(generator), camera_position.y + position_distribution(generator) * 0.1f,
+				camera_position.z + position_distribution(generator));
+			extents[i] = XMFLOAT3(extent_distribution(generator), extent_distribution(generator), extent_distribution(generator));
+			culler.AddBox(centers[i], extents[i]);
+		}
+
+		LooseOctree octree(camera_position, 512.0f, 10);
+		std::vector<uint32_t> results;
+		results.reserve(count);
+
+		std::cout << "  " << count << " objects\n";
+
+		// Inserting every object, then moving a tenth of them a little way back and forth
+		double build_ms = time_ms([&](int)
+		{
+			octree.Clear();
+			for (uint32_t i = 0; i < count; ++i)
 			{
-				m_Running = false;
+				octree.Insert(i, centers[i], extents[i]);
 			}
+		});
 
-			TranslateMessage(&msg);
-			DispatchMessageW(&msg);
-		}
-		else
+		double move_ms = time_ms([&](int iteration)
 		{
-			// Update camera
-			if (m_CameraToggle == CameraToggle::Visual)
+			float offset = (iteration % 2 == 0) ? 2.0f : -2.0f;
+			for (uint32_t i = 0; i < count; i += 10)
 			{
-				m_VisualCamera->Move(m_Timer.DeltaTime());
+				centers[i].x += offset;
+				octree.Move(i, centers[i], extents[i]);
 			}
-			else if (m_CameraToggle == CameraToggle::Free)
+		});
+
+		std::cout << "    Build: " << build_ms << " ms, move " << count / 10 << ": " << move_ms << " ms, " << octree.GetNodeCount() << " nodes\n";
+
+		// Frustum against the SIMD scan of the culler
+		size_t scan_count = 0;
+		double scan_ms = time_ms([&](int) { culler.CullSerial(frustum, CullingShape::Box, results); scan_count = results.size(); });
+		double octree_ms = time_ms([&](int) { octree.QueryFrustum(frustum, results); });
+		std::cout << "    Frustum: scan " << scan_ms << " ms, octree " << octree_ms << " ms, " << results.size() << " of " << scan_count << " found\n";
+
+		// Sphere and box around the camera against testing every object
+		scan_ms = time_ms([&](int)
+		{
+			results.clear();
+			for (uint32_t i = 0; i < count; ++i)
 			{
-				m_FreeCamera->Move(m_Timer.DeltaTime());
+				float x = std::max(std::fabs(centers[i].x - camera_position.x) - extents[i].x, 0.0f);
+				float y = std::max(std::fabs(centers[i].y - camera_position.y) - extents[i].y, 0.0f);
+				float z = std::max(std::fabs(centers[i].z - camera_position.z) - extents[i].z, 0.0f);
+				if (x * x + y * y + z * z <= sphere_radius * sphere_radius)
+				{
+					results.push_back(i);
+				}
 			}
+		});
 
-			// Calculate light view and projection
-			m_ShadowCamera->LookAt(m_FreeCamera.get(), m_FreeCamera->GetPosition(), XMLoadFloat4(&light_direction));
+		scan_count = results.size();
+		octree_ms = time_ms([&](int) { octree.QuerySphere(camera_position, sphere_radius, results); });
+		std::cout << "    Sphere: scan " << scan_ms << " ms, octree " << octree_ms << " ms, " << results.size() << " of " << scan_count << " found\n";
 
-			// Update light buffer
-			m_DefaultShader->UpdateDirectionalLightBuffer(light_direction, m_ShadowCamera->GetView(), m_ShadowCamera->GetProjection());
+		scan_ms = time_ms([&](int)
+		{
+			results.clear();
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				if (std::fabs(centers[i].x - camera_position.x) <= extents[i].x + box_extents.x && std::fabs(centers[i].y - camera_position.y) <= extents[i].y + box_extents.y &&
+					std::fabs(centers[i].z - camera_position.z) <= extents[i].z + box_extents.z)
+				{
+					results.push_back(i);
+				}
+			}
+		});
 
-			// Must render the scene to generate the shadow map
-			this->RenderShadowsPass();
+		scan_count = results.size();
+		octree_ms = time_ms([&](int) { octree.QueryBox(camera_position, box_extents, results); });
+		std::cout << "    Box: scan " << scan_ms << " ms, octree " << octree_ms << " ms, " << results.size() << " of " << scan_count << " found\n";
 
-			// Render the scene again this time applying the shadow map
-			this->RenderMainPass();
+		// Nearest hit of every ray, the scan runs the slab test on every object
+		uint32_t scan_hits = 0;
+		scan_ms = time_ms([&](int)
+		{
+			scan_hits = 0;
+			for (const XMFLOAT3& direction : ray_directions)
+			{
+				float nearest = ray_length;
+				bool hit = false;
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					BoundingBox box(centers[i], extents[i]);
+					float distance = 0.0f;
+					if (box.Intersects(XMLoadFloat3(&camera_position), XMLoadFloat3(&direction), distance) && distance <= nearest)
+					{
+						nearest = distance;
+						hit = true;
+					}
+				}
 
-			// Display the rendered scene
-			m_Renderer->Present();
-		}
-	}
+				scan_hits += hit ? 1 : 0;
+			}
+		});
 
-	return 0;
+		uint32_t octree_hits = 0;
+		octree_ms = time_ms([&](int)
+		{
+			octree_hits = 0;
+			for (const XMFLOAT3& direction : ray_directions)
+			{
+				uint32_t hit = 0;
+				float distance = 0.0f;
+				octree_hits += octree.Raycast(camera_position, direction, ray_length, hit, distance) ? 1 : 0;
+			}
+		});
+
+		std::cout << "    " << ray_count << " rays: scan " << scan_ms << " ms, octree " << octree_ms << " ms, " << octree_hits << " of " << scan_hits << " hit\n";
+	}
 }
 
-LRESULT Application::HandleMessage(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+void Application::RunShadowCacheBenchmark()
 {
-	switch (msg)
-	{
-		case WM_DESTROY:
-			PostQuitMessage(0);
-			return 0;
+	const int grid_sizes[] = { 13, 52, 208 };
+	const int iterations = 10;
 
-		case WM_SIZE:
-			this->OnResized(hwnd, msg, wParam, lParam);
-			return 0;
+	int previous_grid_size = m_GridSize;
+	bool previous_use_shadow_cache = m_UseShadowCache;
 
-		case WM_MOUSEMOVE:
-			this->OnMouseMove(hwnd, msg, wParam, lParam);
-			return 0;
+	// Only the CPU side is measured, commands are recorded but not sent to the GPU
+	std::cout << "Shadow cache benchmark - CPU time to record the shadows pass of " << m_ShadowCascades.GetCascadeCount() << " cascades ("
+		<< iterations << " runs each, " << (m_UseInstancing ? "instanced" : "per draw") << ")\n";
 
-		case WM_KEYDOWN:
+	for (int grid_size : grid_sizes)
+	{
+		m_GridSize = grid_size;
+		m_GridInstancesDirty = true;
+		this->UpdateGridInstances();
+		this->CullScene();
+
+		std::cout << "  " << (grid_size * grid_size) << " cubes\n";
+
+		// Every caster every frame, then the cache rebuilt every frame as when the cascades keep moving, then the cache reused
+		for (int mode = 0; mode < 3; ++mode)
 		{
-			// Toggle between cameras
-			switch (wParam)
+			m_UseShadowCache = (mode != 0);
+
+			double total_ms = 0.0;
+			RenderDeviceStats stats;
+			for (int i = 0; i < iterations; ++i)
 			{
-				case '1':
-					if (m_CameraToggle != CameraToggle::Free)
-					{
-						std::cout << "Free camera\n";
-						m_CameraToggle = CameraToggle::Free;
-					}
-					break;
-				case '2':
-					if (m_CameraToggle != CameraToggle::Visual)
-					{
-						std::cout << "Visual camera\n";
-						m_CameraToggle = CameraToggle::Visual;
+				if (mode == 1)
+				{
+					m_ShadowCache.Invalidate();
+				}
 
-						m_VisualCamera->SetPosition(m_FreeCamera->GetPosition());
-					}
-					break;
-				case '3':
-					if (m_CameraToggle != CameraToggle::Shadow)
-					{
-						std::cout << "Shadow camera\n";
-						m_CameraToggle = CameraToggle::Shadow;
-					}
-					break;
+				m_Renderer->BeginCapture(false);
+				m_Renderer->BeginFrame();
+
+				auto start_time = std::chrono::high_resolution_clock::now();
+				this->RenderShadowsPass();
+				auto end_time = std::chrono::high_resolution_clock::now();
+
+				total_ms += std::chrono::duration<double, std::milli>(end_time - start_time).count();
+				stats = m_Renderer->EndCapture().GetStats();
 			}
 
-			return 0;
+			const char* mode_names[] = { "Full redraw:   ", "Cache rebuild: ", "Cache reuse:   " };
+			std::cout << "    " << mode_names[mode] << (total_ms / iterations) << " ms, " << stats.draw_calls << " draws, " << stats.primitive_count << " primitives, "
+				<< stats.calls[static_cast<size_t>(RenderCommand::CopyTexture)] << " copies\n";
 		}
 	}
 
-	return DefWindowProc(hwnd, msg, wParam, lParam);
+	// Restore the scene, nothing reached the GPU so the cached depth is rebuilt along with the grid
+	m_GridSize = previous_grid_size;
+	m_UseShadowCache = previous_use_shadow_cache;
+	m_GridInstancesDirty = true;
 }
 
-void Application::RenderShadowsPass()
+uint32_t Application::RecordPassesParallel(uint32_t thread_count, bool record, bool forward_to_gpu)
 {
-	// Unbind shadow map from the pipeline so we can render the depth
-	ID3D11ShaderResourceView* nullSRV = nullptr;
-	m_Renderer->GetDeviceContext()->PSSetShaderResources(0, 1, &nullSRV);
+	// The cascades in use then the main pass
+	uint32_t passes[PASS_COUNT];
+	uint32_t pass_count = 0;
+	for (uint32_t cascade = 0; cascade < m_ShadowCascades.GetCascadeCount(); ++cascade)
+	{
+		passes[pass_count++] = SHADOW_PASS + cascade;
+	}
 
-	// Bind the shadow map render target
-	m_ShadowMap->Bind();
+	passes[pass_count++] = MAIN_PASS;
 
-	// Bind the shader to the pipeline
-	m_DefaultShader->Use(false);
+	// Cached static depth and the shadow atlas are rendered on this thread first, the command lists are executed after them
+	this->RenderShadowCache();
+	this->RenderShadowAtlasPass();
 
-	// Set camera constant buffer from the shadow camera
-	XMMATRIX view = m_ShadowCamera->GetView();
-	XMMATRIX projection = m_ShadowCamera->GetProjection();
-	XMFLOAT3 position = m_ShadowCamera->GetPosition();
-	m_DefaultShader->UpdateCameraBuffer(view, projection, position);
+	// Queue and sort every pass up front, the workers only read the queues
+	for (uint32_t i = 0; i < pass_count; ++i)
+	{
+		this->QueueScene(this->GetPassView(passes[i]), passes[i], (passes[i] == MAIN_PASS) ? SceneLayers::All : this->GetShadowLayers());
+		m_RenderQueues[passes[i]].Sort();
+	}
 
-	// Render the scene
-	this->RenderScene();
-}
+	// Split each pass into one chunk per thread, each chunk gets its own context so the command lists can be executed in order
+	const uint32_t max_chunk_count = Renderer::MAX_RENDER_CONTEXTS / pass_count;
+	uint32_t chunk_count = std::max(1u, std::min(thread_count, max_chunk_count));
 
-void Application::RenderMainPass()
-{
-	// Set viewport back to scene
-	int width, height;
-	m_Window->GetSize(&width, &height);
-	m_Renderer->SetViewport(width, height);
+	m_RecordingJobs.clear();
+	for (uint32_t i = 0; i < pass_count; ++i)
+	{
+		uint32_t pass = passes[i];
+		uint32_t item_count = m_RenderQueues[pass].GetCount();
+		for (uint32_t chunk = 0; chunk < chunk_count; ++chunk)
+		{
+			RecordingJob job = {};
+			job.context = m_Renderer->GetRenderContext(static_cast<uint32_t>(m_RecordingJobs.size()) + 1);
+			job.pass = pass;
+			job.first_item = item_count * chunk / chunk_count;
+			job.last_item = item_count * (chunk + 1) / chunk_count;
+			job.first_chunk = (chunk == 0);
+			job.last_chunk = (chunk == chunk_count - 1);
+			m_RecordingJobs.push_back(job);
+		}
+	}
 
-	// Bind default raster
-	m_Renderer->SetRasterState();
+	// Workers take the next job until there are none left, the calling thread works as well
+	std::atomic<uint32_t> next_job(0);
+	auto worker = [this, &next_job, record, forward_to_gpu]()
+	{
+		for (uint32_t i = next_job++; i < m_RecordingJobs.size(); i = next_job++)
+		{
+			this->RecordJob(m_RecordingJobs[i], record, forward_to_gpu);
+		}
+	};
 
-	// Clear the buffers
-	m_Renderer->Clear();
+	uint32_t used_threads = ThreadPool::GetShared().Run(thread_count, worker);
 
-	// Bind the shader to the pipeline
-	m_DefaultShader->Use(true);
+	// Play the command lists back in draw order
+	for (const RecordingJob& job : m_RecordingJobs)
+	{
+		job.context->Execute();
+	}
 
-	// Set camera constant buffer
-	this->UpdateCameraConstantBuffer();
+	return used_threads;
+}
 
-	// Bind shadow map to the pipeline
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
-	ID3D11ShaderResourceView* shadowmap_texture = m_ShadowMap->GetShadowMapTexture();
-	context->PSSetShaderResources(0, 1, &shadowmap_texture);
+void Application::RecordJob(const RecordingJob& job, bool record, bool forward_to_gpu)
+{
+	m_Renderer->BindRenderContext(job.context);
+	job.context->Begin(record, forward_to_gpu);
+
+	// Nothing is bound at the start of a command list, so every chunk sets up the whole pass
+	if (job.pass != MAIN_PASS)
+	{
+		this->BeginShadowsPass(job.pass - SHADOW_PASS, job.first_chunk);
+	}
+	else
+	{
+		this->BeginMainPass(job.first_chunk);
+	}
 
-	ID3D11SamplerState* shadow_sampler = m_ShadowMap->GetShadowSamplerState();
-	context->PSSetSamplers(0, 1, &shadow_sampler);
+	this->UpdateLightConstantBuffer();
 
-	// Render the scene
-	this->RenderScene();
+	// Draw this chunk of the sorted queue
+	const RenderQueueItem* items = m_RenderQueues[job.pass].begin();
+	for (uint32_t i = job.first_item; i < job.last_item; ++i)
+	{
+		this->DrawSceneItem(items[i].payload);
+	}
+
+	// The line shader's buffers are shared, so only one chunk may draw them
+	if (job.pass == MAIN_PASS && job.last_chunk)
+	{
+		this->RenderVisualizations();
+	}
+
+	job.context->Finish();
+	m_Renderer->BindRenderContext(nullptr);
 }
 
-void Application::RenderScene()
+void Application::RunRecordingBenchmark()
 {
-	// Render the floor
-	XMMATRIX floor_transform = XMMatrixIdentity();
-	floor_transform *= XMMatrixTranslation(0.0f, -1.0f, 0.0f);
-	this->UpdateModelConstantBuffer(floor_transform);
-	m_Floor->Render();
+	const uint32_t thread_counts[] = { 1, 2, 4, 8 };
+	const int iterations = 10;
+
+	int previous_grid_size = m_GridSize;
+	bool previous_use_instancing = m_UseInstancing;
+
+	// A large per draw grid, so there is enough work to split
+	m_GridSize = 208;
+	m_UseInstancing = false;
+	m_GridInstancesDirty = true;
+	this->UpdateGridInstances();
+	this->CullScene();
+
+	// Only the CPU side is measured, commands are recorded but not sent to the GPU
+	std::cout << "Recording benchmark - CPU time to record both passes of " << (m_GridSize * m_GridSize) << " cubes (" << iterations << " runs each, "
+		<< std::thread::hardware_concurrency() << " hardware threads)\n";
+
+	// Single threaded on the immediate context as the baseline
+	double serial_ms = 0.0;
+	for (int i = 0; i < iterations; ++i)
+	{
+		m_Renderer->BeginCapture(false);
+		m_Renderer->BeginFrame();
+
+		auto start_time = std::chrono::high_resolution_clock::now();
+		this->RenderShadowsPass();
+		this->RenderMainPass();
+		auto end_time = std::chrono::high_resolution_clock::now();
 
-	// Render the model as giant
-	XMMATRIX model_transform = XMMatrixIdentity();
-	model_transform *= XMMatrixScaling(10.0f, 10.0f, 10.0f);
-	model_transform *= XMMatrixTranslation(0.0f, 5.0f, -50.0f);
-	this->UpdateModelConstantBuffer(model_transform);
-	m_Model->Render();
+		serial_ms += std::chrono::duration<double, std::milli>(end_time - start_time).count();
+		m_Renderer->EndCapture();
+	}
+
+	serial_ms /= iterations;
+	std::cout << "  Immediate: " << serial_ms << " ms\n";
 
-	// Render small models
-	for (int x = -50; x <= 50; x += 8)
+	for (uint32_t thread_count : thread_counts)
 	{
-		for (int w = -50; w <= 50; w += 8)
+		double total_ms = 0.0;
+		uint32_t used_threads = 0;
+		for (int i = 0; i < iterations; ++i)
 		{
-			model_transform = XMMatrixIdentity();
-			model_transform *= XMMatrixTranslation(x, 0.0f, w);
-			this->UpdateModelConstantBuffer(model_transform);
-			m_Model->Render();
+			m_Renderer->BeginFrame();
+
+			auto start_time = std::chrono::high_resolution_clock::now();
+			used_threads = this->RecordPassesParallel(thread_count, true, false);
+			auto end_time = std::chrono::high_resolution_clock::now();
+
+			total_ms += std::chrono::duration<double, std::milli>(end_time - start_time).count();
 		}
-	}
 
-	// Visualize orbitial camera frustum
-	if (m_CameraToggle == CameraToggle::Visual)
-	{
-		m_LineShader->Use();
-		this->VisualizeCameraFrustum();
-		this->VisualizeShadowCamera();
-		this->VisualizeLightDirection();
+		// Every chunk's draws added together, this should match for every thread count
+		uint64_t draw_calls = 0;
+		for (const RecordingJob& job : m_RecordingJobs)
+		{
+			draw_calls += job.context->GetRecorder().GetStats().draw_calls;
+		}
+
+		total_ms /= iterations;
+		std::cout << "  " << thread_count << (thread_count == 1 ? " thread:  " : " threads: ") << total_ms << " ms (" << (serial_ms / total_ms) << "x), "
+			<< m_RecordingJobs.size() << " command lists, " << draw_calls << " draws, " << used_threads << " used\n";
 	}
+
+	// Restore the scene
+	m_GridSize = previous_grid_size;
+	m_UseInstancing = previous_use_instancing;
+	m_GridInstancesDirty = true;
 }
 
 void Application::OnResized(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -326,7 +1773,9 @@ void Application::CalculateFrameStats()
 	// Update window title every second with FPS
 	if (time > 1.0f)
 	{
-		std::string frame_title = "(FPS: " + std::to_string(m_FrameCount) + ")";
+		uint32_t caster_count = m_ShadowCascades.GetCasterCount() * m_ShadowCascades.GetCascadeCount();
+		std::string frame_title = "(FPS: " + std::to_string(m_FrameCount) + ", " + std::to_string(time * 1000.0f / m_FrameCount) + " ms, shadow casters culled: " +
+			std::to_string(caster_count - m_ShadowCascades.GetKeptCasterCount()) + " of " + std::to_string(caster_count) + ", shadow cache " + (m_UseShadowCache ? "on" : "off") + ")";
 		m_Window->SetTitle(m_ApplicationTitle + " " + frame_title);
 
 		time = 0.0f;
@@ -337,7 +1786,40 @@ void Application::CalculateFrameStats()
 void Application::UpdateModelConstantBuffer(const DirectX::XMMATRIX& world)
 {
 	m_DefaultShader->UpdateModelBuffer(world);
-	m_LineShader->UpdateModelBuffer(XMMatrixIdentity());
+}
+
+XMMATRIX Application::GetCameraView() const
+{
+	if (m_CameraToggle == CameraToggle::Visual)
+	{
+		return m_VisualCamera->GetView();
+	}
+	else if (m_CameraToggle == CameraToggle::Shadow)
+	{
+		return m_ShadowCamera->GetView();
+	}
+
+	return m_FreeCamera->GetView();
+}
+
+XMMATRIX Application::GetCameraProjection() const
+{
+	if (m_CameraToggle == CameraToggle::Visual)
+	{
+		return m_VisualCamera->GetProjection();
+	}
+	else if (m_CameraToggle == CameraToggle::Shadow)
+	{
+		return m_ShadowCamera->GetProjection();
+	}
+
+	return m_FreeCamera->GetProjection();
+}
+
+void Application::UpdateLightConstantBuffer()
+{
+	m_DefaultShader->UpdateDirectionalLightBuffer(m_LightDirection, m_ShadowCascades);
+	m_DefaultShader->UpdateLocalLightBuffer(m_LocalLights, m_UseLocalLights);
 }
 
 void Application::UpdateCameraConstantBuffer()
@@ -411,12 +1893,8 @@ void Application::VisualizeCameraFrustum()
 	}
 
 	// Map lines to the buffer
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
-
-	D3D11_MAPPED_SUBRESOURCE resource = {};
-	DX::Check(context->Map(m_LineBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &resource));
-	std::memcpy(resource.pData, line_vertices.data(), line_vertices.size() * sizeof(Vertex));
-	context->Unmap(m_LineBuffer.Get(), 0);
+	RenderDevice* device = m_Renderer->GetRenderDevice();
+	device->UpdateDynamicBuffer(m_LineBuffer.Get(), line_vertices.data(), static_cast<uint32_t>(line_vertices.size() * sizeof(LineVertex)));
 
 	// Render
 	this->RenderDebugLines();
@@ -484,12 +1962,8 @@ void Application::VisualizeShadowCamera()
 	}
 
 	// Map lines to the buffer
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
-
-	D3D11_MAPPED_SUBRESOURCE resource = {};
-	DX::Check(context->Map(m_LineBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &resource));
-	std::memcpy(resource.pData, line_vertices.data(), line_vertices.size() * sizeof(Vertex));
-	context->Unmap(m_LineBuffer.Get(), 0);
+	RenderDevice* device = m_Renderer->GetRenderDevice();
+	device->UpdateDynamicBuffer(m_LineBuffer.Get(), line_vertices.data(), static_cast<uint32_t>(line_vertices.size() * sizeof(LineVertex)));
 
 	// Render
 	this->RenderDebugLines();
@@ -514,21 +1988,14 @@ void Application::VisualizeLightDirection()
 	line_vertices[1].colour = VertexColour(1.0f, 1.0f, 0.0f);
 
 	// Map lines to the buffer
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
-
-	D3D11_MAPPED_SUBRESOURCE resource = {};
-	DX::Check(context->Map(m_LineBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &resource));
-	std::memcpy(resource.pData, line_vertices.data(), line_vertices.size() * sizeof(Vertex));
-	context->Unmap(m_LineBuffer.Get(), 0);
+	RenderDevice* device = m_Renderer->GetRenderDevice();
+	device->UpdateDynamicBuffer(m_LineBuffer.Get(), line_vertices.data(), static_cast<uint32_t>(line_vertices.size() * sizeof(LineVertex)));
 
 	// Render
-	UINT stride = sizeof(LineVertex);
-	UINT offset = 0;
+	device->SetVertexBuffer(0, m_LineBuffer.Get(), sizeof(LineVertex), 0);
+	device->SetPrimitiveTopology(PrimitiveTopology::LineList);
 
-	context->IASetVertexBuffers(0, 1, m_LineBuffer.GetAddressOf(), &stride, &offset);
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
-
-	context->Draw(2, 0);
+	device->Draw(2, 0);
 }
 
 void Application::CreateLineBuffer()
@@ -547,13 +2014,85 @@ void Application::CreateLineBuffer()
 
 void Application::RenderDebugLines()
 {
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
+	RenderDevice* device = m_Renderer->GetRenderDevice();
+
+	device->SetVertexBuffer(0, m_LineBuffer.Get(), sizeof(LineVertex), 0);
+	device->SetPrimitiveTopology(PrimitiveTopology::LineList);
+
+	device->Draw(24, 0);
+}
+
+void Application::PrintFrameCapture(const RecordingRenderDevice& recorder)
+{
+	const RenderDeviceStats& stats = recorder.GetStats();
+
+	std::cout << "Frame capture\n";
+	std::cout << "  Commands: " << stats.total_calls << " (" << stats.stream_bytes << " bytes)\n";
+	std::cout << "  Draws: " << stats.draw_calls << " (" << stats.instance_count << " instances, " << stats.primitive_count << " primitives)\n";
+	std::cout << "  Uploaded: " << stats.upload_bytes << " bytes\n";
+	std::cout << "  Objects: " << recorder.GetObjectCount() << '\n';
+
+	// Binds dropped by the state cache before they reached the recorder
+	if (m_Renderer->IsStateCacheEnabled())
+	{
+		const StateCacheStats& cache_stats = m_Renderer->GetStateCache()->GetStats();
+		std::cout << "  State cache: " << cache_stats.issued_calls << " binds issued, " << cache_stats.filtered_calls << " filtered\n";
+	}
+
+	// Constant buffer ring usage
+	ConstantBufferRing* ring = m_Renderer->GetConstantBufferRing();
+	if (ring != nullptr)
+	{
+		const ConstantRingStats& ring_stats = ring->GetStats();
+		std::cout << "  Constant ring: " << ring_stats.allocations << " allocations, " << ring_stats.used_bytes << " of " << ring_stats.capacity
+			<< " bytes, " << ring_stats.overflows << " overflows\n";
+	}
+
+	// Every mesh draws from the same vertex and index buffer
+	m_Renderer->GetGeometryArena()->Print();
 
-	UINT stride = sizeof(LineVertex);
-	UINT offset = 0;
+	// Cubes left after frustum culling
+	std::cout << "  Culling: " << (m_UseCulling ? "" : "off, ") << m_VisibleGrid[MAIN_PASS].size() << " main pass cubes of " << m_GridCuller.GetCount()
+		<< " (" << (m_UseOctree ? "octree, " : "") << FrustumCuller::GetInstructionSet() << ")\n";
+	m_SceneOctree.Print();
 
-	context->IASetVertexBuffers(0, 1, m_LineBuffer.GetAddressOf(), &stride, &offset);
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+	// Grid cubes hidden behind the occluders
+	if (m_UseCulling && m_UseOcclusionCulling)
+	{
+		m_OcclusionCuller.Print();
+	}
+	m_ShadowCascades.Print();
+
+	// Cascades whose static casters were drawn again this frame
+	if (m_UseShadowCache)
+	{
+		m_ShadowCache.Print();
+	}
+
+	// Tiles handed to the local lights and how many were rendered again
+	if (m_UseLocalLights)
+	{
+		m_LocalLights.GetAtlas().Print();
+		std::cout << "  Local shadows: " << m_LocalLights.GetRedrawCount() << " of " << m_LocalLights.GetShadowViews().size() << " views rendered\n";
+	}
 
-	context->Draw(24, 0);
+	// Calls per command
+	for (size_t i = 0; i < static_cast<size_t>(RenderCommand::Count); ++i)
+	{
+		if (stats.calls[i] == 0)
+			continue;
+
+		std::cout << "    " << RecordingRenderDevice::GetCommandName(static_cast<RenderCommand>(i)) << ": " << stats.calls[i] << '\n';
+	}
+}
+
+void Application::PrintParallelCapture()
+{
+	// Commands of each command list, in the order they were executed
+	for (const RecordingJob& job : m_RecordingJobs)
+	{
+		const RenderDeviceStats& stats = job.context->GetRecorder().GetStats();
+		std::cout << "  Context " << job.context->GetIndex() << " (" << (job.pass == MAIN_PASS ? "main pass" : "cascade " + std::to_string(job.pass - SHADOW_PASS)) << ", items " << job.first_item
+			<< " to " << job.last_item << "): " << stats.total_calls << " commands, " << stats.draw_calls << " draws, " << stats.upload_bytes << " bytes uploaded\n";
+	}
 }
@@ -8,11 +8,22 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <DirectXMath.h>
 using namespace DirectX;
 
 #include <d3d11_1.h>
+#include "InstanceBuffer.h"
+#include "RenderQueue.h"
+#include "../External/FrameGraph.h"
+#include "FrustumCuller.h"
+#include "ShadowCascades.h"
+#include "ShadowCache.h"
+#include "LocalLights.h"
+#include "LooseOctree.h"
+#include "OcclusionCuller.h"
+#include "CollisionBatch.h"
 
 // This include is requires for using DirectX smart pointers (ComPtr)
 #include <wrl\client.h>
@@ -32,6 +43,10 @@ class ShadowCamera;
 class Model;
 class Floor;
 
+class RecordingRenderDevice;
+class RenderContext;
+class FrameGraphTextures;
+
 enum class CameraToggle
 {
 	Visual,
@@ -39,6 +54,14 @@ enum class CameraToggle
 	Shadow
 };
 
+// Which of the scene's casters a pass draws, static casters can come from the shadow cache
+enum class SceneLayers
+{
+	All,
+	Static,
+	Dynamic
+};
+
 class Application
 {
 public:
@@ -58,10 +81,128 @@ private:
 	std::unique_ptr<Renderer> m_Renderer = nullptr;
 	std::unique_ptr<ShadowMap> m_ShadowMap = nullptr;
 
+	// Declares the passes and what they read and write, the graph orders them and unbinds the shadow map between them
+	FrameGraph m_FrameGraph;
+	std::unique_ptr<FrameGraphTextures> m_FrameGraphTextures = nullptr;
+	void BuildFrameGraph();
+
 	void RenderShadowsPass();
 	void RenderMainPass();
 
-	void RenderScene();
+	// Bind the pass' targets, shader and camera, the targets are only cleared by the first recording of the pass
+	// With shadow caching the cascade's slice starts from its cached static depth instead of being cleared
+	void BeginShadowsPass(uint32_t cascade, bool clear);
+	void BeginMainPass(bool clear);
+	void UseCascadeCamera(uint32_t cascade);
+
+	// Queue, sort and draw the scene as seen from the pass' view
+	void RenderScene(const XMMATRIX& view, uint32_t pass, SceneLayers layers = SceneLayers::All);
+
+	// Static casters are rendered into the shadow cache only when a cascade's cached depth is out of date, the shadows pass
+	// then copies it into the shadow map and draws the dynamic casters on top
+	bool m_UseShadowCache = true;
+	ShadowCache m_ShadowCache;
+	void RenderShadowCache();
+	SceneLayers GetShadowLayers() const;
+
+	// Time recording the shadows pass with and without the cache, without sending anything to the GPU
+	void RunShadowCacheBenchmark();
+
+	// Spot and point lights over the grid, the ones near the camera share the tiles of the shadow atlas
+	bool m_UseLocalLights = true;
+	LocalLights m_LocalLights;
+	std::unique_ptr<InstanceBuffer> m_AtlasInstanceBuffer = nullptr;
+	std::vector<uint32_t> m_AtlasVisibleGrid;
+	void CreateLocalLights();
+	void RenderShadowAtlasPass();
+
+	// Model orbiting the scene, the only caster that moves
+	XMFLOAT3 m_OrbitingModelPosition = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	XMFLOAT4X4 m_OrbitingModelTransform;
+	void UpdateOrbitingModel();
+
+	// Passes are the shadow cascades followed by the main pass
+	XMMATRIX GetPassView(uint32_t pass) const;
+	XMMATRIX GetPassProjection(uint32_t pass) const;
+
+	// Opaque draws of the scene per pass, ordered by shader, mesh and then front to back
+	RenderQueue m_RenderQueues[MAX_SHADOW_CASCADES + 1];
+	void QueueScene(const XMMATRIX& view, uint32_t pass, SceneLayers layers);
+	void DrawSceneItem(uint32_t draw);
+	void DrawInstancedGrid(InstanceBuffer* instance_buffer);
+
+	// Lines showing the cameras and light in the visual camera mode
+	void RenderVisualizations();
+
+	// Record both passes on deferred contexts, each pass is split into one chunk per thread
+	// The chunks are recorded in parallel then executed in draw order on the immediate context
+	struct RecordingJob
+	{
+		RenderContext* context;
+		uint32_t pass;
+		uint32_t first_item;
+		uint32_t last_item;
+		bool first_chunk;
+		bool last_chunk;
+	};
+
+	bool m_UseParallelRecording = false;
+	uint32_t m_RecordingThreadCount = 4;
+	std::vector<RecordingJob> m_RecordingJobs;
+	uint32_t RecordPassesParallel(uint32_t thread_count, bool record, bool forward_to_gpu);
+	void RecordJob(const RecordingJob& job, bool record, bool forward_to_gpu);
+
+	// Time recording both passes with growing thread counts, without sending anything to the GPU
+	void RunRecordingBenchmark();
+
+	// Time building and sorting large queues against std::sort
+	void RunRenderQueueBenchmark();
+
+	// Stream a large scene through the upload queue with different budgets, without sending anything to the GPU
+	void RunUploadBenchmark();
+
+	// Grid of small cubes, drawn with a single instanced draw per pass unless instancing is toggled off
+	// Each pass has its own instance buffer holding only the cubes inside its frustum
+	int m_GridSize = 13;
+	bool m_UseInstancing = true;
+	bool m_GridInstancesDirty = true;
+	std::vector<InstanceData> m_GridInstances;
+	std::vector<InstanceData> m_VisibleInstances;
+	std::unique_ptr<InstanceBuffer> m_InstanceBuffers[MAX_SHADOW_CASCADES + 1];
+	void BuildGridInstances();
+	void UpdateGridInstances();
+	void ResizeGrid(int grid_size);
+
+	// Bounds of the grid cubes and the indices of the cubes each pass draws, culled once per frame before the passes
+	bool m_UseCulling = true;
+	FrustumCuller m_GridCuller;
+	std::vector<uint32_t> m_VisibleGrid[MAX_SHADOW_CASCADES + 1];
+	void CullScene();
+
+	// Cascades split from the free camera's frustum, each renders the casters inside its volume extruded towards the light
+	ShadowCascades m_ShadowCascades;
+
+	// Time culling growing numbers of random boxes, against DirectXCollision and across threads
+	void RunCullingBenchmark();
+
+	// Time frustum, sphere, box and oriented box containment of random boxes, one Contains call each against batched masks
+	void RunCollisionBenchmark();
+
+	// Grid cubes in a loose octree, which culls the main pass and the atlas tiles instead of scanning every cube and picks the cube under the mouse
+	bool m_UseOctree = true;
+	LooseOctree m_SceneOctree = LooseOctree(XMFLOAT3(0.0f, 0.0f, 0.0f), 2048.0f, 10);
+	void PickGridCube(int mouse_x, int mouse_y);
+
+	// Time building, moving and querying the octree against scanning every object
+	void RunOctreeBenchmark();
+
+	// The giant model and the floor are rasterized on the CPU, and the main pass' grid cubes hidden behind them are dropped before queuing
+	bool m_UseOcclusionCulling = true;
+	OcclusionCuller m_OcclusionCuller;
+	void CullOccludedGrid(const XMMATRIX& view_projection, uint32_t thread_count);
+
+	// Compare per draw and instanced submission of growing grids
+	void RunInstancingBenchmark();
 
 	// Models
 	std::unique_ptr<Model> m_Model = nullptr;
@@ -98,6 +239,14 @@ private:
 	// Update camera constant buffer shader
 	void UpdateCameraConstantBuffer();
 
+	// Update the light constant buffer from the shadow camera
+	XMFLOAT4 m_LightDirection = XMFLOAT4(0.7f, -0.6f, 0.4f, 1.0f);
+	void UpdateLightConstantBuffer();
+
+	// View and projection of the camera the main pass is rendered from
+	XMMATRIX GetCameraView() const;
+	XMMATRIX GetCameraProjection() const;
+
 	// Visualize bounding frustum
 	void VisualizeCameraFrustum();
 	void VisualizeShadowCamera();
@@ -107,4 +256,12 @@ private:
 	ComPtr<ID3D11Buffer> m_LineBuffer;
 	void CreateLineBuffer();
 	void RenderDebugLines();
+
+	// Per draw constants are suballocated from one dynamic buffer when supported
+	bool m_UseConstantBufferRing = true;
+
+	// Record the commands of the next frame and print what was submitted
+	bool m_CaptureFrame = false;
+	void PrintFrameCapture(const RecordingRenderDevice& recorder);
+	void PrintParallelCapture();
 };
\ No newline at end of file
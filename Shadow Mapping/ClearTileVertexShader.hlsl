@@ -0,0 +1,7 @@
+// Entry point for clearing a tile of the shadow atlas - one triangle covering the viewport at the far depth, without any vertex buffer
+float4 main(uint vertex_id : SV_VertexID) : SV_POSITION
+{
+    // (-1, 1), (3, 1) and (-1, -3) in clip space, clockwise so it isn't culled
+    float2 corner = float2((vertex_id << 1) & 2, vertex_id & 2);
+    return float4(corner.x * 2.0f - 1.0f, 1.0f - corner.y * 2.0f, 1.0f, 1.0f);
+}
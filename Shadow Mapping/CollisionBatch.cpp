@@ -0,0 +1,416 @@
+#include "CollisionBatch.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "../External/ThreadPool.h"
+#include "../External/SimdLanes.h"
+
+namespace
+{
+	using namespace Simd;
+
+	// Boxes of a set of lanes
+	struct BoxLanes
+	{
+		Lanes center[3];
+		Lanes extents[3];
+	};
+
+	// Each query turns its volume into splatted constants once, then gives a bit per lane for touching and for holding the boxes
+
+	// Six planes facing outwards, a box is outside a plane when its center is further in front of it than the box's radius
+	// along the normal and inside when it is that far behind, as in BoundingFrustum::Contains
+	struct FrustumQuery
+	{
+		Lanes normal[6][3];
+		Lanes absolute_normal[6][3];
+		Lanes distance[6];
+
+		FrustumQuery(const BoundingFrustum& frustum)
+		{
+			XMVECTOR planes[6];
+			frustum.GetPlanes(&planes[0], &planes[1], &planes[2], &planes[3], &planes[4], &planes[5]);
+
+			for (int p = 0; p < 6; ++p)
+			{
+				XMFLOAT4 plane;
+				XMStoreFloat4(&plane, planes[p]);
+
+				const float values[3] = { plane.x, plane.y, plane.z };
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					normal[p][axis] = Splat(values[axis]);
+					absolute_normal[p][axis] = Splat(std::fabs(values[axis]));
+				}
+
+				distance[p] = Splat(plane.w);
+			}
+		}
+
+		inline void Test(const BoxLanes& box, uint32_t& intersects, uint32_t& contains) const
+		{
+			intersects = ALL_LANES;
+			contains = ALL_LANES;
+			for (int p = 0; p < 6 && intersects != 0; ++p)
+			{
+				Lanes d = MultiplyAdd(normal[p][0], box.center[0], distance[p]);
+				d = MultiplyAdd(normal[p][1], box.center[1], d);
+				d = MultiplyAdd(normal[p][2], box.center[2], d);
+
+				Lanes radius = Multiply(absolute_normal[p][0], box.extents[0]);
+				radius = MultiplyAdd(absolute_normal[p][1], box.extents[1], radius);
+				radius = MultiplyAdd(absolute_normal[p][2], box.extents[2], radius);
+
+				intersects &= LessEqualMask(d, radius);
+				contains &= LessMask(Add(d, radius), Splat(0.0f));
+			}
+
+			contains &= intersects;
+		}
+	};
+
+	// A sphere touches a box when the box's nearest point is within its radius, and holds it when the furthest corner is
+	struct SphereQuery
+	{
+		Lanes center[3];
+		Lanes radius_squared;
+
+		SphereQuery(const BoundingSphere& sphere)
+		{
+			center[0] = Splat(sphere.Center.x);
+			center[1] = Splat(sphere.Center.y);
+			center[2] = Splat(sphere.Center.z);
+			radius_squared = Splat(sphere.Radius * sphere.Radius);
+		}
+
+		inline void Test(const BoxLanes& box, uint32_t& intersects, uint32_t& contains) const
+		{
+			Lanes nearest = Splat(0.0f);
+			Lanes furthest = Splat(0.0f);
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				Lanes offset = Abs(Subtract(center[axis], box.center[axis]));
+				Lanes near_offset = Max(Subtract(offset, box.extents[axis]), Splat(0.0f));
+				Lanes far_offset = Add(offset, box.extents[axis]);
+				nearest = MultiplyAdd(near_offset, near_offset, nearest);
+				furthest = MultiplyAdd(far_offset, far_offset, furthest);
+			}
+
+			intersects = LessEqualMask(nearest, radius_squared);
+			contains = intersects & LessEqualMask(furthest, radius_squared);
+		}
+	};
+
+	// Boxes are compared by their minimum and maximum corners, as in BoundingBox::Contains
+	struct BoxQuery
+	{
+		Lanes min[3];
+		Lanes max[3];
+
+		BoxQuery(const BoundingBox& box)
+		{
+			const float center[3] = { box.Center.x, box.Center.y, box.Center.z };
+			const float extents[3] = { box.Extents.x, box.Extents.y, box.Extents.z };
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				min[axis] = Splat(center[axis] - extents[axis]);
+				max[axis] = Splat(center[axis] + extents[axis]);
+			}
+		}
+
+		inline void Test(const BoxLanes& box, uint32_t& intersects, uint32_t& contains) const
+		{
+			intersects = ALL_LANES;
+			contains = ALL_LANES;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				Lanes box_min = Subtract(box.center[axis], box.extents[axis]);
+				Lanes box_max = Add(box.center[axis], box.extents[axis]);
+				intersects &= LessEqualMask(box_min, max[axis]) & LessEqualMask(min[axis], box_max);
+				contains &= LessEqualMask(min[axis], box_min) & LessEqualMask(box_max, max[axis]);
+			}
+
+			contains &= intersects;
+		}
+	};
+
+	// Separating axis test against the fifteen axes of two boxes, the world axes of the batch's boxes, the oriented box's axes
+	// and their cross products. The oriented box holds a box when the box's bounds along each of its axes fit inside it
+	struct OrientedBoxQuery
+	{
+		// Oriented box axis j along world axis i, its absolute value with a little added so parallel edges don't give a zero
+		// cross product, and the absolute value without
+		Lanes rotation[3][3];
+		Lanes absolute_rotation[3][3];
+		Lanes exact_absolute_rotation[3][3];
+
+		Lanes center[3];
+		Lanes extents[3];
+
+		// Radius of the oriented box along each world axis and each cross product axis
+		Lanes world_radius[3];
+		Lanes cross_radius[3][3];
+
+		OrientedBoxQuery(const BoundingOrientedBox& box)
+		{
+			XMMATRIX orientation = XMMatrixRotationQuaternion(XMLoadFloat4(&box.Orientation));
+			XMFLOAT3 axes[3];
+			for (int j = 0; j < 3; ++j)
+			{
+				XMStoreFloat3(&axes[j], orientation.r[j]);
+			}
+
+			const float box_extents[3] = { box.Extents.x, box.Extents.y, box.Extents.z };
+			const float box_center[3] = { box.Center.x, box.Center.y, box.Center.z };
+
+			float absolute[3][3];
+			for (int j = 0; j < 3; ++j)
+			{
+				const float axis[3] = { axes[j].x, axes[j].y, axes[j].z };
+				for (int i = 0; i < 3; ++i)
+				{
+					absolute[i][j] = std::fabs(axis[i]) + 1e-6f;
+					rotation[i][j] = Splat(axis[i]);
+					absolute_rotation[i][j] = Splat(absolute[i][j]);
+					exact_absolute_rotation[i][j] = Splat(std::fabs(axis[i]));
+				}
+			}
+
+			for (int i = 0; i < 3; ++i)
+			{
+				center[i] = Splat(box_center[i]);
+				extents[i] = Splat(box_extents[i]);
+				world_radius[i] = Splat(box_extents[0] * absolute[i][0] + box_extents[1] * absolute[i][1] + box_extents[2] * absolute[i][2]);
+
+				for (int j = 0; j < 3; ++j)
+				{
+					int j1 = (j + 1) % 3;
+					int j2 = (j + 2) % 3;
+					cross_radius[i][j] = Splat(box_extents[j1] * absolute[i][j2] + box_extents[j2] * absolute[i][j1]);
+				}
+			}
+		}
+
+		inline void Test(const BoxLanes& box, uint32_t& intersects, uint32_t& contains) const
+		{
+			// From the batch's box to the oriented box in world space
+			Lanes offset[3];
+			for (int i = 0; i < 3; ++i)
+			{
+				offset[i] = Subtract(center[i], box.center[i]);
+			}
+
+			// World axes
+			intersects = ALL_LANES;
+			for (int i = 0; i < 3; ++i)
+			{
+				intersects &= LessEqualMask(Abs(offset[i]), Add(box.extents[i], world_radius[i]));
+			}
+
+			// Oriented box axes, the box fits when its center and radius along every one of them are inside the extents
+			contains = ALL_LANES;
+			for (int j = 0; j < 3; ++j)
+			{
+				Lanes distance = Abs(MultiplyAdd(offset[2], rotation[2][j], MultiplyAdd(offset[1], rotation[1][j], Multiply(offset[0], rotation[0][j]))));
+				Lanes radius = MultiplyAdd(box.extents[2], absolute_rotation[2][j], MultiplyAdd(box.extents[1], absolute_rotation[1][j], Multiply(box.extents[0], absolute_rotation[0][j])));
+				Lanes exact_radius = MultiplyAdd(box.extents[2], exact_absolute_rotation[2][j],
+					MultiplyAdd(box.extents[1], exact_absolute_rotation[1][j], Multiply(box.extents[0], exact_absolute_rotation[0][j])));
+
+				intersects &= LessEqualMask(distance, Add(radius, extents[j]));
+				contains &= LessEqualMask(Add(distance, exact_radius), extents[j]);
+			}
+
+			// Cross products of world axis i and oriented box axis j
+			for (int i = 0; i < 3 && intersects != 0; ++i)
+			{
+				int i1 = (i + 1) % 3;
+				int i2 = (i + 2) % 3;
+				for (int j = 0; j < 3; ++j)
+				{
+					Lanes distance = Abs(Subtract(Multiply(offset[i2], rotation[i1][j]), Multiply(offset[i1], rotation[i2][j])));
+					Lanes radius = MultiplyAdd(box.extents[i1], absolute_rotation[i2][j], MultiplyAdd(box.extents[i2], absolute_rotation[i1][j], cross_radius[i][j]));
+					intersects &= LessEqualMask(distance, radius);
+				}
+			}
+
+			contains &= intersects;
+		}
+	};
+}
+
+void CollisionBatch::Clear()
+{
+	m_CenterX.clear();
+	m_CenterY.clear();
+	m_CenterZ.clear();
+	m_ExtentX.clear();
+	m_ExtentY.clear();
+	m_ExtentZ.clear();
+	m_Count = 0;
+}
+
+void CollisionBatch::Reserve(uint32_t count)
+{
+	uint32_t padded_count = (count + WORD_BITS - 1) / WORD_BITS * WORD_BITS;
+	m_CenterX.reserve(padded_count);
+	m_CenterY.reserve(padded_count);
+	m_CenterZ.reserve(padded_count);
+	m_ExtentX.reserve(padded_count);
+	m_ExtentY.reserve(padded_count);
+	m_ExtentZ.reserve(padded_count);
+}
+
+uint32_t CollisionBatch::AddBox(const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+	uint32_t index = m_Count++;
+
+	// Grow a word at a time so whole words can always be loaded
+	if (index >= m_CenterX.size())
+	{
+		size_t padded_count = m_CenterX.size() + WORD_BITS;
+		m_CenterX.resize(padded_count, 0.0f);
+		m_CenterY.resize(padded_count, 0.0f);
+		m_CenterZ.resize(padded_count, 0.0f);
+		m_ExtentX.resize(padded_count, 0.0f);
+		m_ExtentY.resize(padded_count, 0.0f);
+		m_ExtentZ.resize(padded_count, 0.0f);
+	}
+
+	this->SetBox(index, center, extents);
+	return index;
+}
+
+void CollisionBatch::SetBox(uint32_t index, const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+	m_CenterX[index] = center.x;
+	m_CenterY[index] = center.y;
+	m_CenterZ[index] = center.z;
+	m_ExtentX[index] = extents.x;
+	m_ExtentY[index] = extents.y;
+	m_ExtentZ[index] = extents.z;
+}
+
+void CollisionBatch::Classify(const BoundingFrustum& frustum, uint32_t thread_count, std::vector<uint32_t>& intersects, std::vector<uint32_t>& contains)
+{
+	this->Run(FrustumQuery(frustum), thread_count, intersects, contains);
+}
+
+void CollisionBatch::Classify(const BoundingSphere& sphere, uint32_t thread_count, std::vector<uint32_t>& intersects, std::vector<uint32_t>& contains)
+{
+	this->Run(SphereQuery(sphere), thread_count, intersects, contains);
+}
+
+void CollisionBatch::Classify(const BoundingBox& box, uint32_t thread_count, std::vector<uint32_t>& intersects, std::vector<uint32_t>& contains)
+{
+	this->Run(BoxQuery(box), thread_count, intersects, contains);
+}
+
+void CollisionBatch::Classify(const BoundingOrientedBox& box, uint32_t thread_count, std::vector<uint32_t>& intersects, std::vector<uint32_t>& contains)
+{
+	this->Run(OrientedBoxQuery(box), thread_count, intersects, contains);
+}
+
+template<typename Query>
+void CollisionBatch::Run(const Query& query, uint32_t thread_count, std::vector<uint32_t>& intersects, std::vector<uint32_t>& contains)
+{
+	uint32_t word_count = (m_Count + WORD_BITS - 1) / WORD_BITS;
+	uint32_t chunk_words = CHUNK_SIZE / WORD_BITS;
+	uint32_t chunk_count = (word_count + chunk_words - 1) / chunk_words;
+
+	intersects.resize(word_count);
+	contains.resize(word_count);
+
+	// Workers from the shared pool take the next chunk until there are none left, the calling thread works as well
+	std::atomic<uint32_t> next_chunk(0);
+	auto worker = [&]()
+	{
+		for (uint32_t chunk = next_chunk++; chunk < chunk_count; chunk = next_chunk++)
+		{
+			uint32_t begin = chunk * chunk_words;
+			uint32_t end = std::min(begin + chunk_words, word_count);
+
+			for (uint32_t word = begin; word < end; ++word)
+			{
+				uint32_t intersect_bits = 0;
+				uint32_t contain_bits = 0;
+
+				for (uint32_t lane = 0; lane < WORD_BITS; lane += LANE_COUNT)
+				{
+					uint32_t i = word * WORD_BITS + lane;
+
+					BoxLanes box;
+					box.center[0] = Load(&m_CenterX[i]);
+					box.center[1] = Load(&m_CenterY[i]);
+					box.center[2] = Load(&m_CenterZ[i]);
+					box.extents[0] = Load(&m_ExtentX[i]);
+					box.extents[1] = Load(&m_ExtentY[i]);
+					box.extents[2] = Load(&m_ExtentZ[i]);
+
+					uint32_t lane_intersects = 0;
+					uint32_t lane_contains = 0;
+					query.Test(box, lane_intersects, lane_contains);
+
+					intersect_bits |= lane_intersects << lane;
+					contain_bits |= lane_contains << lane;
+				}
+
+				intersects[word] = intersect_bits;
+				contains[word] = contain_bits;
+			}
+		}
+	};
+
+	uint32_t used_threads = ThreadPool::GetShared().Run(std::min(thread_count, chunk_count), worker);
+
+	// The padding past the last box isn't part of the answer
+	uint32_t used_bits = m_Count % WORD_BITS;
+	if (used_bits != 0)
+	{
+		uint32_t valid = (1u << used_bits) - 1;
+		intersects[word_count - 1] &= valid;
+		contains[word_count - 1] &= valid;
+	}
+
+	m_Stats.object_count = m_Count;
+	m_Stats.intersecting_count = CountBits(intersects);
+	m_Stats.contained_count = CountBits(contains);
+	m_Stats.chunk_count = chunk_count;
+	m_Stats.thread_count = used_threads;
+}
+
+ContainmentType CollisionBatch::GetContainment(const std::vector<uint32_t>& intersects, const std::vector<uint32_t>& contains, uint32_t index)
+{
+	uint32_t word = index / WORD_BITS;
+	uint32_t bit = 1u << (index % WORD_BITS);
+
+	if (contains[word] & bit)
+		return CONTAINS;
+
+	return (intersects[word] & bit) ? INTERSECTS : DISJOINT;
+}
+
+uint32_t CollisionBatch::CountBits(const std::vector<uint32_t>& mask)
+{
+	uint32_t count = 0;
+	for (uint32_t word : mask)
+	{
+		// Clear the lowest set bit until there are none
+		for (; word != 0; word &= word - 1)
+		{
+			count++;
+		}
+	}
+
+	return count;
+}
+
+uint32_t CollisionBatch::GetLaneCount()
+{
+	return LANE_COUNT;
+}
+
+const char* CollisionBatch::GetInstructionSet()
+{
+	return INSTRUCTION_SET;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+using namespace DirectX;
+
+// Counters of the last query
+struct CollisionBatchStats
+{
+	uint32_t object_count = 0;
+	uint32_t intersecting_count = 0;
+	uint32_t contained_count = 0;
+	uint32_t chunk_count = 0;
+	uint32_t thread_count = 0;
+};
+
+// Containment of many axis aligned boxes in one frustum, sphere, box or oriented box per call
+//
+// The boxes are stored as structure of arrays padded to whole 32 bit words, and a query fills two masks with a bit per box:
+// one set where the volume touches the box and one where it holds all of it, the same answers as the volume's DirectXCollision
+// Contains giving INTERSECTS or CONTAINS. Boxes are tested four at a time across SSE lanes, and the words are split into chunks
+// shared out between the shared thread pool's workers, each chunk writing only its own words. Like BoundingFrustum::Contains
+// a frustum only tests its planes, so a box just outside one of its corners can still be reported as touching it
+class CollisionBatch
+{
+public:
+	// Boxes per chunk, small batches stay on the calling thread
+	static constexpr uint32_t CHUNK_SIZE = 16 * 1024;
+
+	// Boxes per word of a mask
+	static constexpr uint32_t WORD_BITS = 32;
+
+	CollisionBatch() = default;
+	virtual ~CollisionBatch() = default;
+
+	// Remove every box
+	void Clear();
+
+	// Make room for this many boxes up front
+	void Reserve(uint32_t count);
+
+	// Add a box, returns its index
+	uint32_t AddBox(const XMFLOAT3& center, const XMFLOAT3& extents);
+
+	// Move a box
+	void SetBox(uint32_t index, const XMFLOAT3& center, const XMFLOAT3& extents);
+
+	inline uint32_t GetCount() const { return m_Count; }
+
+	// Set bit i of intersects when the volume touches box i and of contains when it holds all of it, using up to thread_count threads
+	void Classify(const BoundingFrustum& frustum, uint32_t thread_count, std::vector<uint32_t>& intersects, std::vector<uint32_t>& contains);
+	void Classify(const BoundingSphere& sphere, uint32_t thread_count, std::vector<uint32_t>& intersects, std::vector<uint32_t>& contains);
+	void Classify(const BoundingBox& box, uint32_t thread_count, std::vector<uint32_t>& intersects, std::vector<uint32_t>& contains);
+	void Classify(const BoundingOrientedBox& box, uint32_t thread_count, std::vector<uint32_t>& intersects, std::vector<uint32_t>& contains);
+
+	// A box's bits read back as DirectXCollision's containment
+	static ContainmentType GetContainment(const std::vector<uint32_t>& intersects, const std::vector<uint32_t>& contains, uint32_t index);
+
+	// Number of bits set in a mask
+	static uint32_t CountBits(const std::vector<uint32_t>& mask);
+
+	// Counters of the last query
+	inline const CollisionBatchStats& GetStats() const { return m_Stats; }
+
+	// Lanes tested per instruction and the instruction set, fixed at compile time
+	static uint32_t GetLaneCount();
+	static const char* GetInstructionSet();
+
+private:
+	// Bounds, padded with empty boxes to a whole word
+	std::vector<float> m_CenterX;
+	std::vector<float> m_CenterY;
+	std::vector<float> m_CenterZ;
+	std::vector<float> m_ExtentX;
+	std::vector<float> m_ExtentY;
+	std::vector<float> m_ExtentZ;
+	uint32_t m_Count = 0;
+
+	CollisionBatchStats m_Stats;
+
+	// Run a query's lane test over every word across the threads, then clear the padding's bits and count
+	template<typename Query>
+	void Run(const Query& query, uint32_t thread_count, std::vector<uint32_t>& intersects, std::vector<uint32_t>& contains);
+};
@@ -0,0 +1,54 @@
+#include "ConstantBufferRing.h"
+#include "Renderer.h"
+#include "RenderDevice.h"
+
+ConstantBufferRing::ConstantBufferRing(Renderer* renderer, uint32_t capacity, uint32_t max_capacity) : m_Renderer(renderer), m_Allocator(capacity, max_capacity)
+{
+	this->CreateBuffer();
+}
+
+void ConstantBufferRing::BeginFrame()
+{
+	// The last frame overflowed, recreate the buffer at the new size
+	if (m_Allocator.BeginFrame())
+	{
+		this->CreateBuffer();
+	}
+}
+
+bool ConstantBufferRing::Upload(const void* data, uint32_t size, ConstantAllocation& allocation)
+{
+	if (!m_Allocator.Allocate(size, allocation))
+		return false;
+
+	// First write of the frame discards so the GPU can keep reading last frame's constants
+	DynamicWrite write = (allocation.discard ? DynamicWrite::Discard : DynamicWrite::NoOverwrite);
+	m_Renderer->GetRenderDevice()->UpdateDynamicBufferRange(m_Buffer.Get(), allocation.offset, data, size, write);
+
+	return true;
+}
+
+void ConstantBufferRing::Bind(uint32_t slot, const ConstantAllocation& allocation)
+{
+	// Offsets and counts are in 16 byte constants
+	uint32_t first_constant = allocation.offset / 16;
+	uint32_t constant_count = allocation.size / 16;
+
+	RenderDevice* device = m_Renderer->GetRenderDevice();
+	device->SetVertexConstantBufferRange(slot, m_Buffer.Get(), first_constant, constant_count);
+	device->SetPixelConstantBufferRange(slot, m_Buffer.Get(), first_constant, constant_count);
+}
+
+void ConstantBufferRing::CreateBuffer()
+{
+	ID3D11Device* device = m_Renderer->GetDevice();
+
+	// Create ring buffer
+	D3D11_BUFFER_DESC bd = {};
+	bd.Usage = D3D11_USAGE_DYNAMIC;
+	bd.ByteWidth = m_Allocator.GetCapacity();
+	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	DX::Check(device->CreateBuffer(&bd, nullptr, m_Buffer.ReleaseAndGetAddressOf()));
+}
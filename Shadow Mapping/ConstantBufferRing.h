@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ConstantRingAllocator.h"
+#include <d3d11.h>
+
+// This include is requires for using DirectX smart pointers (ComPtr)
+#include <wrl\client.h>
+using Microsoft::WRL::ComPtr;
+
+class Renderer;
+
+// One large dynamic constant buffer shared by every per draw update
+// Constants are written with NO_OVERWRITE and bound with an offset, which needs Direct3D 11.1
+class ConstantBufferRing
+{
+	Renderer* m_Renderer = nullptr;
+
+public:
+	ConstantBufferRing(Renderer* renderer, uint32_t capacity, uint32_t max_capacity);
+	virtual ~ConstantBufferRing() = default;
+
+	// Start a new frame, must be called before any upload of the frame
+	void BeginFrame();
+
+	// Copy the constants into the ring, returns false if the frame has run out of room
+	bool Upload(const void* data, uint32_t size, ConstantAllocation& allocation);
+
+	// Bind the allocation to the vertex and pixel shader
+	void Bind(uint32_t slot, const ConstantAllocation& allocation);
+
+	// Check the allocation can still be bound
+	inline bool IsCurrent(const ConstantAllocation& allocation) const { return m_Allocator.IsCurrent(allocation); }
+
+	// Counters of the current frame
+	inline const ConstantRingStats& GetStats() const { return m_Allocator.GetStats(); }
+
+private:
+	ConstantRingAllocator m_Allocator;
+
+	ComPtr<ID3D11Buffer> m_Buffer = nullptr;
+	void CreateBuffer();
+};
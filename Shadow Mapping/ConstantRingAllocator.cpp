@@ -0,0 +1,75 @@
+#include "ConstantRingAllocator.h"
+#include <algorithm>
+
+ConstantRingAllocator::ConstantRingAllocator(uint32_t capacity, uint32_t max_capacity)
+{
+	m_MaxCapacity = Align(std::max(max_capacity, ALIGNMENT));
+	m_Capacity = std::min(Align(std::max(capacity, ALIGNMENT)), m_MaxCapacity);
+	m_Stats.capacity = m_Capacity;
+}
+
+uint32_t ConstantRingAllocator::Align(uint32_t size)
+{
+	return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+bool ConstantRingAllocator::BeginFrame()
+{
+	// Grow if the last frame asked for more than the ring holds
+	bool grown = false;
+	if (m_Stats.requested_bytes > m_Capacity && m_Capacity < m_MaxCapacity)
+	{
+		uint64_t capacity = m_Capacity;
+		while (capacity < m_Stats.requested_bytes && capacity < m_MaxCapacity)
+		{
+			capacity *= 2;
+		}
+
+		m_Capacity = static_cast<uint32_t>(std::min<uint64_t>(capacity, m_MaxCapacity));
+		grown = true;
+	}
+
+	// Reset for the new frame
+	uint32_t grow_count = m_Stats.grow_count + (grown ? 1 : 0);
+	m_Stats = ConstantRingStats();
+	m_Stats.capacity = m_Capacity;
+	m_Stats.grow_count = grow_count;
+
+	m_Head = 0;
+	m_Frame++;
+
+	return grown;
+}
+
+bool ConstantRingAllocator::Allocate(uint32_t size, ConstantAllocation& allocation)
+{
+	// Nothing can be allocated before the first frame has started
+	if (m_Frame == 0 || size == 0)
+		return false;
+
+	uint32_t aligned_size = Align(size);
+	m_Stats.requested_bytes += aligned_size;
+
+	// Out of room for this frame, the caller falls back to its own buffer
+	if (aligned_size > m_Capacity - m_Head)
+	{
+		m_Stats.overflows++;
+		return false;
+	}
+
+	allocation.offset = m_Head;
+	allocation.size = aligned_size;
+	allocation.frame = m_Frame;
+	allocation.discard = (m_Head == 0);
+
+	m_Head += aligned_size;
+	m_Stats.allocations++;
+	m_Stats.used_bytes = m_Head;
+
+	return true;
+}
+
+bool ConstantRingAllocator::IsCurrent(const ConstantAllocation& allocation) const
+{
+	return allocation.size != 0 && allocation.frame == m_Frame;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+
+// Where a block of constants was placed in the ring
+struct ConstantAllocation
+{
+	// Byte offset and aligned size inside the ring buffer
+	uint32_t offset = 0;
+	uint32_t size = 0;
+
+	// Frame the allocation belongs to, it is only valid until the next frame starts
+	uint64_t frame = 0;
+
+	// First allocation of the frame, the buffer must be mapped with WRITE_DISCARD instead of NO_OVERWRITE
+	bool discard = false;
+};
+
+// Counters of the current frame
+struct ConstantRingStats
+{
+	uint32_t allocations = 0;
+	uint32_t overflows = 0;
+	uint32_t used_bytes = 0;
+	uint32_t requested_bytes = 0;
+	uint32_t capacity = 0;
+	uint32_t grow_count = 0;
+};
+
+// Bookkeeping for a per frame linear allocator over one large dynamic constant buffer
+// Every frame starts at offset 0 with a discard, so the driver renames the buffer and frames still in flight keep their data.
+// Allocations that don't fit fail rather than wrap, as wrapping would need a discard that invalidates the ranges already bound.
+// The next frame grows the capacity to fit what was asked for, up to the maximum
+class ConstantRingAllocator
+{
+public:
+	// Constant buffer offsets must be a multiple of 16 constants (256 bytes)
+	static constexpr uint32_t ALIGNMENT = 256;
+
+	ConstantRingAllocator(uint32_t capacity, uint32_t max_capacity);
+	virtual ~ConstantRingAllocator() = default;
+
+	// Start a new frame, returns true if the capacity has grown and the buffer must be recreated
+	bool BeginFrame();
+
+	// Reserve an aligned block for the current frame, returns false if it doesn't fit
+	bool Allocate(uint32_t size, ConstantAllocation& allocation);
+
+	// Check the allocation was made during the current frame
+	bool IsCurrent(const ConstantAllocation& allocation) const;
+
+	// Size of the ring in bytes
+	inline uint32_t GetCapacity() const { return m_Capacity; }
+
+	// Frame counter, starts at 0 before the first BeginFrame
+	inline uint64_t GetFrame() const { return m_Frame; }
+
+	// Counters of the current frame
+	inline const ConstantRingStats& GetStats() const { return m_Stats; }
+
+	// Round a size up to the alignment
+	static uint32_t Align(uint32_t size);
+
+private:
+	uint32_t m_Capacity = 0;
+	uint32_t m_MaxCapacity = 0;
+	uint32_t m_Head = 0;
+	uint64_t m_Frame = 0;
+	ConstantRingStats m_Stats;
+};
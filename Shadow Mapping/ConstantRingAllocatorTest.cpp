@@ -0,0 +1,120 @@
+// Standalone check of the constant ring's bookkeeping, it has no Direct3D dependency so it builds without the Windows SDK
+// It isn't part of the project as it has its own main, build and run it on its own:
+//   g++ -std=c++17 ConstantRingAllocatorTest.cpp ConstantRingAllocator.cpp && ./a.out
+//   cl /EHsc /std:c++17 ConstantRingAllocatorTest.cpp ConstantRingAllocator.cpp && ConstantRingAllocatorTest.exe
+#include "ConstantRingAllocator.h"
+#include <cstdio>
+
+namespace
+{
+	int g_Failures = 0;
+
+	// Report a failed check without stopping, so one run lists every failure
+	void Check(bool condition, const char* description)
+	{
+		if (!condition)
+		{
+			std::printf("FAILED: %s\n", description);
+			g_Failures++;
+		}
+	}
+
+	void TestAlignment()
+	{
+		Check(ConstantRingAllocator::Align(1) == 256, "1 byte rounds up to 256");
+		Check(ConstantRingAllocator::Align(256) == 256, "256 bytes stays 256");
+		Check(ConstantRingAllocator::Align(257) == 512, "257 bytes rounds up to 512");
+
+		// The capacities are aligned as well
+		ConstantRingAllocator ring(5000, 1u << 31);
+		Check(ring.GetCapacity() == 5120, "capacity rounds up to the alignment");
+
+		ConstantRingAllocator clamped(8192, 1024);
+		Check(clamped.GetCapacity() == 1024, "capacity is clamped to the maximum");
+	}
+
+	void TestAllocate()
+	{
+		ConstantRingAllocator ring(1024, 4096);
+		ConstantAllocation allocation;
+
+		// Nothing can be allocated before the first frame
+		Check(!ring.Allocate(16, allocation), "allocation before the first frame fails");
+		Check(!ring.BeginFrame(), "first frame doesn't grow");
+
+		// Only the first allocation of the frame discards, every block starts on the alignment
+		Check(ring.Allocate(128, allocation), "first allocation fits");
+		Check(allocation.offset == 0 && allocation.size == 256 && allocation.discard, "first allocation is at 0 and discards");
+
+		Check(ring.Allocate(1, allocation), "second allocation fits");
+		Check(allocation.offset == 256 && allocation.size == 256 && !allocation.discard, "second allocation follows without a discard");
+
+		Check(ring.Allocate(300, allocation), "third allocation fits");
+		Check(allocation.offset == 512 && allocation.size == 512, "third allocation is aligned to two blocks");
+
+		Check(!ring.Allocate(0, allocation), "empty allocation fails");
+		Check(ring.IsCurrent(allocation), "allocation is current during its frame");
+
+		const ConstantRingStats& stats = ring.GetStats();
+		Check(stats.allocations == 3 && stats.used_bytes == 1024, "stats count the allocations and used bytes");
+
+		// The next frame starts from the beginning with a discard
+		ring.BeginFrame();
+		Check(!ring.IsCurrent(allocation), "allocation expires with its frame");
+		Check(ring.Allocate(16, allocation) && allocation.offset == 0 && allocation.discard, "new frame starts at 0 with a discard");
+	}
+
+	void TestOverflowAndGrowth()
+	{
+		ConstantRingAllocator ring(1024, 4096);
+		ConstantAllocation allocation;
+
+		// A full ring fails the allocation rather than wrapping
+		ring.BeginFrame();
+		for (int i = 0; i < 4; ++i)
+		{
+			ring.Allocate(256, allocation);
+		}
+
+		Check(!ring.Allocate(1, allocation), "allocation past the capacity fails");
+		Check(ring.GetStats().overflows == 1, "overflow is counted");
+		Check(ring.GetStats().requested_bytes == 1280, "overflowing request still counts towards the next size");
+
+		// The next frame doubles to fit what was asked for
+		Check(ring.BeginFrame(), "frame after an overflow grows");
+		Check(ring.GetCapacity() == 2048, "capacity doubles to fit the request");
+		Check(ring.GetStats().overflows == 0 && ring.GetStats().grow_count == 1, "stats reset but keep the grow count");
+
+		// Growth stops at the maximum
+		for (int i = 0; i < 28; ++i)
+		{
+			ring.Allocate(256, allocation);
+		}
+
+		Check(ring.BeginFrame() && ring.GetCapacity() == 4096, "capacity grows up to the maximum");
+
+		for (int i = 0; i < 40; ++i)
+		{
+			ring.Allocate(256, allocation);
+		}
+
+		Check(!ring.BeginFrame() && ring.GetCapacity() == 4096, "capacity doesn't grow past the maximum");
+		Check(ring.GetStats().grow_count == 2, "grow count covers both growths");
+	}
+}
+
+int main()
+{
+	TestAlignment();
+	TestAllocate();
+	TestOverflowAndGrowth();
+
+	if (g_Failures != 0)
+	{
+		std::printf("%d check(s) failed\n", g_Failures);
+		return 1;
+	}
+
+	std::printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,159 @@
+#include "D3D11RenderDevice.h"
+#include "Renderer.h"
+
+#include <cassert>
+#include <cstring>
+
+D3D11RenderDevice::D3D11RenderDevice(ID3D11DeviceContext* context) : m_DeviceContext(context)
+{
+	// Only available with the Direct3D 11.1 runtime
+	m_DeviceContext->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(m_DeviceContext1.GetAddressOf()));
+}
+
+void D3D11RenderDevice::SetInputLayout(ID3D11InputLayout* input_layout)
+{
+	m_DeviceContext->IASetInputLayout(input_layout);
+}
+
+void D3D11RenderDevice::SetVertexBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t stride, uint32_t offset)
+{
+	UINT strides[1] = { stride };
+	UINT offsets[1] = { offset };
+	m_DeviceContext->IASetVertexBuffers(slot, 1, &buffer, strides, offsets);
+}
+
+void D3D11RenderDevice::SetIndexBuffer(ID3D11Buffer* buffer, IndexFormat format, uint32_t offset)
+{
+	m_DeviceContext->IASetIndexBuffer(buffer, static_cast<DXGI_FORMAT>(format), offset);
+}
+
+void D3D11RenderDevice::SetPrimitiveTopology(PrimitiveTopology topology)
+{
+	m_DeviceContext->IASetPrimitiveTopology(static_cast<D3D11_PRIMITIVE_TOPOLOGY>(topology));
+}
+
+void D3D11RenderDevice::SetVertexShader(ID3D11VertexShader* shader)
+{
+	m_DeviceContext->VSSetShader(shader, nullptr, 0);
+}
+
+void D3D11RenderDevice::SetPixelShader(ID3D11PixelShader* shader)
+{
+	m_DeviceContext->PSSetShader(shader, nullptr, 0);
+}
+
+void D3D11RenderDevice::SetVertexConstantBuffer(uint32_t slot, ID3D11Buffer* buffer)
+{
+	m_DeviceContext->VSSetConstantBuffers(slot, 1, &buffer);
+}
+
+void D3D11RenderDevice::SetPixelConstantBuffer(uint32_t slot, ID3D11Buffer* buffer)
+{
+	m_DeviceContext->PSSetConstantBuffers(slot, 1, &buffer);
+}
+
+void D3D11RenderDevice::SetVertexConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t first_constant, uint32_t constant_count)
+{
+	m_DeviceContext1->VSSetConstantBuffers1(slot, 1, &buffer, &first_constant, &constant_count);
+}
+
+void D3D11RenderDevice::SetPixelConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t first_constant, uint32_t constant_count)
+{
+	m_DeviceContext1->PSSetConstantBuffers1(slot, 1, &buffer, &first_constant, &constant_count);
+}
+
+void D3D11RenderDevice::SetPixelShaderResource(uint32_t slot, ID3D11ShaderResourceView* view)
+{
+	m_DeviceContext->PSSetShaderResources(slot, 1, &view);
+}
+
+void D3D11RenderDevice::SetPixelSampler(uint32_t slot, ID3D11SamplerState* sampler)
+{
+	m_DeviceContext->PSSetSamplers(slot, 1, &sampler);
+}
+
+void D3D11RenderDevice::SetRasterizerState(ID3D11RasterizerState* state)
+{
+	m_DeviceContext->RSSetState(state);
+}
+
+void D3D11RenderDevice::SetDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencil_ref)
+{
+	m_DeviceContext->OMSetDepthStencilState(state, stencil_ref);
+}
+
+void D3D11RenderDevice::SetViewport(const RenderViewport& viewport)
+{
+	D3D11_VIEWPORT d3d11_viewport = {};
+	d3d11_viewport.TopLeftX = viewport.x;
+	d3d11_viewport.TopLeftY = viewport.y;
+	d3d11_viewport.Width = viewport.width;
+	d3d11_viewport.Height = viewport.height;
+	d3d11_viewport.MinDepth = viewport.min_depth;
+	d3d11_viewport.MaxDepth = viewport.max_depth;
+
+	m_DeviceContext->RSSetViewports(1, &d3d11_viewport);
+}
+
+void D3D11RenderDevice::SetRenderTarget(ID3D11RenderTargetView* render_target, ID3D11DepthStencilView* depth_stencil)
+{
+	m_DeviceContext->OMSetRenderTargets(1, &render_target, depth_stencil);
+}
+
+void D3D11RenderDevice::ClearRenderTarget(ID3D11RenderTargetView* render_target, const float colour[4])
+{
+	m_DeviceContext->ClearRenderTargetView(render_target, colour);
+}
+
+void D3D11RenderDevice::ClearDepthStencil(ID3D11DepthStencilView* depth_stencil, uint32_t clear_flags, float depth, uint8_t stencil)
+{
+	m_DeviceContext->ClearDepthStencilView(depth_stencil, clear_flags, depth, stencil);
+}
+
+void D3D11RenderDevice::UpdateBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size)
+{
+	// Without a box the whole buffer is written, constant buffers can't take a range before Direct3D 11.1
+	D3D11_BUFFER_DESC desc = {};
+	buffer->GetDesc(&desc);
+	assert(size == desc.ByteWidth);
+
+	m_DeviceContext->UpdateSubresource(buffer, 0, nullptr, data, 0, 0);
+}
+
+void D3D11RenderDevice::UpdateDynamicBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size)
+{
+	D3D11_MAPPED_SUBRESOURCE resource = {};
+	DX::Check(m_DeviceContext->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &resource));
+	std::memcpy(resource.pData, data, size);
+	m_DeviceContext->Unmap(buffer, 0);
+}
+
+void D3D11RenderDevice::UpdateDynamicBufferRange(ID3D11Buffer* buffer, uint32_t offset, const void* data, uint32_t size, DynamicWrite write)
+{
+	D3D11_MAP map_type = (write == DynamicWrite::Discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE);
+
+	D3D11_MAPPED_SUBRESOURCE resource = {};
+	DX::Check(m_DeviceContext->Map(buffer, 0, map_type, 0, &resource));
+	std::memcpy(reinterpret_cast<uint8_t*>(resource.pData) + offset, data, size);
+	m_DeviceContext->Unmap(buffer, 0);
+}
+
+void D3D11RenderDevice::CopyTexture(ID3D11Resource* destination, uint32_t destination_subresource, ID3D11Resource* source, uint32_t source_subresource)
+{
+	m_DeviceContext->CopySubresourceRegion(destination, destination_subresource, 0, 0, 0, source, source_subresource, nullptr);
+}
+
+void D3D11RenderDevice::Draw(uint32_t vertex_count, uint32_t start_vertex)
+{
+	m_DeviceContext->Draw(vertex_count, start_vertex);
+}
+
+void D3D11RenderDevice::DrawIndexed(uint32_t index_count, uint32_t start_index, int32_t base_vertex)
+{
+	m_DeviceContext->DrawIndexed(index_count, start_index, base_vertex);
+}
+
+void D3D11RenderDevice::DrawIndexedInstanced(uint32_t index_count, uint32_t instance_count, uint32_t start_index, int32_t base_vertex, uint32_t start_instance)
+{
+	m_DeviceContext->DrawIndexedInstanced(index_count, instance_count, start_index, base_vertex, start_instance);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "RenderDevice.h"
+#include <d3d11_1.h>
+
+// This include is requires for using DirectX smart pointers (ComPtr)
+#include <wrl\client.h>
+using Microsoft::WRL::ComPtr;
+
+// Issues the commands on a Direct3D 11 device context
+class D3D11RenderDevice : public RenderDevice
+{
+	ID3D11DeviceContext* m_DeviceContext = nullptr;
+
+	// Needed for binding constant buffer ranges, null on Direct3D 11.0 runtimes
+	ComPtr<ID3D11DeviceContext1> m_DeviceContext1 = nullptr;
+
+public:
+	D3D11RenderDevice(ID3D11DeviceContext* context);
+	virtual ~D3D11RenderDevice() = default;
+
+	// Input assembler
+	void SetInputLayout(ID3D11InputLayout* input_layout) override;
+	void SetVertexBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t stride, uint32_t offset) override;
+	void SetIndexBuffer(ID3D11Buffer* buffer, IndexFormat format, uint32_t offset) override;
+	void SetPrimitiveTopology(PrimitiveTopology topology) override;
+
+	// Shaders and their resources
+	void SetVertexShader(ID3D11VertexShader* shader) override;
+	void SetPixelShader(ID3D11PixelShader* shader) override;
+	void SetVertexConstantBuffer(uint32_t slot, ID3D11Buffer* buffer) override;
+	void SetPixelConstantBuffer(uint32_t slot, ID3D11Buffer* buffer) override;
+	void SetVertexConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t first_constant, uint32_t constant_count) override;
+	void SetPixelConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t first_constant, uint32_t constant_count) override;
+	void SetPixelShaderResource(uint32_t slot, ID3D11ShaderResourceView* view) override;
+	void SetPixelSampler(uint32_t slot, ID3D11SamplerState* sampler) override;
+
+	// Rasterizer and output merger
+	void SetRasterizerState(ID3D11RasterizerState* state) override;
+	void SetDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencil_ref) override;
+	void SetViewport(const RenderViewport& viewport) override;
+	void SetRenderTarget(ID3D11RenderTargetView* render_target, ID3D11DepthStencilView* depth_stencil) override;
+	void ClearRenderTarget(ID3D11RenderTargetView* render_target, const float colour[4]) override;
+	void ClearDepthStencil(ID3D11DepthStencilView* depth_stencil, uint32_t clear_flags, float depth, uint8_t stencil) override;
+
+	// Buffers
+	void UpdateBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size) override;
+	void UpdateDynamicBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size) override;
+	void UpdateDynamicBufferRange(ID3D11Buffer* buffer, uint32_t offset, const void* data, uint32_t size, DynamicWrite write) override;
+
+	// Textures
+	void CopyTexture(ID3D11Resource* destination, uint32_t destination_subresource, ID3D11Resource* source, uint32_t source_subresource) override;
+
+	// Draws
+	void Draw(uint32_t vertex_count, uint32_t start_vertex) override;
+	void DrawIndexed(uint32_t index_count, uint32_t start_index, int32_t base_vertex) override;
+	void DrawIndexedInstanced(uint32_t index_count, uint32_t instance_count, uint32_t start_index, int32_t base_vertex, uint32_t start_instance) override;
+
+	// Get the context the commands are issued on
+	inline ID3D11DeviceContext* GetDeviceContext() const { return m_DeviceContext; }
+};
@@ -0,0 +1,84 @@
+#include "D3D11UploadBackend.h"
+#include "Renderer.h"
+#include <cstring>
+
+D3D11UploadBackend::D3D11UploadBackend(ID3D11Device* device, ID3D11DeviceContext* context) : m_Device(device), m_DeviceContext(context)
+{
+}
+
+void D3D11UploadBackend::BeginBatch(uint32_t buffer_bytes)
+{
+	m_BufferCopies.clear();
+	m_Staging = nullptr;
+	m_Mapped = nullptr;
+
+	// Only textures in this batch
+	if (buffer_bytes == 0)
+		return;
+
+	StagingBuffer& staging = m_StagingBuffers[m_NextStagingBuffer];
+	m_NextStagingBuffer = (m_NextStagingBuffer + 1) % STAGING_BUFFER_COUNT;
+
+	// Grow the staging buffer to fit the batch
+	if (staging.capacity < buffer_bytes)
+	{
+		D3D11_BUFFER_DESC buffer_desc = {};
+		buffer_desc.Usage = D3D11_USAGE_STAGING;
+		buffer_desc.ByteWidth = buffer_bytes;
+		buffer_desc.BindFlags = 0;
+		buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+		DX::Check(m_Device->CreateBuffer(&buffer_desc, nullptr, staging.buffer.ReleaseAndGetAddressOf()));
+		staging.capacity = buffer_bytes;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE resource = {};
+	DX::Check(m_DeviceContext->Map(staging.buffer.Get(), 0, D3D11_MAP_WRITE, 0, &resource));
+
+	m_Staging = staging.buffer.Get();
+	m_Mapped = static_cast<uint8_t*>(resource.pData);
+}
+
+void D3D11UploadBackend::Upload(const UploadCommand& command)
+{
+	if (command.type == UploadType::Texture)
+	{
+		ID3D11Resource* texture = static_cast<ID3D11Texture2D*>(command.destination);
+		m_DeviceContext->UpdateSubresource(texture, command.subresource, nullptr, command.data, command.row_pitch, command.depth_pitch);
+		return;
+	}
+
+	if (m_Mapped == nullptr)
+		return;
+
+	// Write into the staging buffer now, the copy waits until the staging buffer is unmapped
+	std::memcpy(m_Mapped + command.batch_offset, command.data, command.size);
+	m_BufferCopies.push_back(command);
+}
+
+void D3D11UploadBackend::EndBatch()
+{
+	if (m_Staging == nullptr)
+		return;
+
+	m_DeviceContext->Unmap(m_Staging, 0);
+
+	// Copy every buffer's range out of the staging buffer
+	for (const UploadCommand& command : m_BufferCopies)
+	{
+		D3D11_BOX box = {};
+		box.left = command.batch_offset;
+		box.right = command.batch_offset + command.size;
+		box.top = 0;
+		box.bottom = 1;
+		box.front = 0;
+		box.back = 1;
+
+		ID3D11Resource* buffer = static_cast<ID3D11Buffer*>(command.destination);
+		m_DeviceContext->CopySubresourceRegion(buffer, 0, command.destination_offset, 0, 0, m_Staging, 0, &box);
+	}
+
+	m_BufferCopies.clear();
+	m_Staging = nullptr;
+	m_Mapped = nullptr;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "UploadQueue.h"
+#include <d3d11.h>
+#include <vector>
+
+// This include is requires for using DirectX smart pointers (ComPtr)
+#include <wrl\client.h>
+using Microsoft::WRL::ComPtr;
+
+// Copies batches of uploads with a Direct3D 11 device context
+// Buffer uploads are written into one staging buffer per batch and copied on the GPU when the batch ends,
+// texture uploads go through UpdateSubresource as buffers can't be copied into textures in Direct3D 11
+class D3D11UploadBackend : public UploadBackend
+{
+	ID3D11Device* m_Device = nullptr;
+	ID3D11DeviceContext* m_DeviceContext = nullptr;
+
+public:
+	D3D11UploadBackend(ID3D11Device* device, ID3D11DeviceContext* context);
+	virtual ~D3D11UploadBackend() = default;
+
+	// Staging buffers used in turn, so a batch doesn't wait for the GPU to finish copying out of the last one
+	static const uint32_t STAGING_BUFFER_COUNT = 3;
+
+	// Upload backend
+	void BeginBatch(uint32_t buffer_bytes) override;
+	void Upload(const UploadCommand& command) override;
+	void EndBatch() override;
+
+private:
+	struct StagingBuffer
+	{
+		ComPtr<ID3D11Buffer> buffer = nullptr;
+		uint32_t capacity = 0;
+	};
+
+	StagingBuffer m_StagingBuffers[STAGING_BUFFER_COUNT];
+	uint32_t m_NextStagingBuffer = 0;
+
+	// Staging buffer of the current batch and where it is mapped
+	ID3D11Buffer* m_Staging = nullptr;
+	uint8_t* m_Mapped = nullptr;
+
+	// Buffer copies issued when the batch ends
+	std::vector<UploadCommand> m_BufferCopies;
+};
@@ -1,12 +1,16 @@
 #include "DefaultShader.h"
 #include "Renderer.h"
+#include "RenderDevice.h"
+#include "ConstantBufferRing.h"
 
 #include <Windows.h>
 #include "CompiledPixelShader.hlsl.h"
 #include "CompiledVertexShader.hlsl.h"
+#include "CompiledInstancedVertexShader.hlsl.h"
 
 #include <Windows.h>
 #include <DirectXMath.h>
+#include <cmath>
 
 namespace
 {
@@ -26,8 +30,29 @@ namespace
 	struct DirectionalLightBuffer
 	{
 		XMFLOAT4 direction;
-		XMMATRIX light_view;
-		XMMATRIX light_projection;
+		XMMATRIX cascade_view;
+		XMMATRIX cascade_view_projection[MAX_SHADOW_CASCADES];
+		XMFLOAT4 cascade_splits;
+		uint32_t cascade_count;
+		uint32_t padding[3];
+	};
+
+	struct LocalLightData
+	{
+		XMFLOAT4 position_range;
+		XMFLOAT4 direction_spot_cos;
+		XMFLOAT4 colour;
+		int32_t info[4];
+	};
+
+	struct LocalLightBuffer
+	{
+		LocalLightData lights[MAX_LOCAL_LIGHTS];
+		XMMATRIX shadow_view_projection[MAX_LOCAL_SHADOW_VIEWS];
+		XMFLOAT4 shadow_tiles[MAX_LOCAL_SHADOW_VIEWS];
+		uint32_t light_count;
+		float atlas_texel_size;
+		uint32_t padding[2];
 	};
 }
 
@@ -38,47 +63,93 @@ DefaultShader::DefaultShader(Renderer* renderer) : m_Renderer(renderer)
 void DefaultShader::Load()
 {
 	this->LoadVertexShader();
+	this->LoadInstancedVertexShader();
 	this->LoadPixelShader();
 
 	this->CreateModelConstantBuffer();
 	this->CreateCameraConstantBuffer();
 	this->CreateDirectionalLightBuffer();
+	this->CreateLocalLightBuffer();
 }
 
 void DefaultShader::Use(bool bind_pixel_shader)
 {
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
+	RenderDevice* device = m_Renderer->GetRenderDevice();
 
 	// Bind the input layout to the pipeline's Input Assembler stage
-	context->IASetInputLayout(m_VertexLayout.Get());
+	device->SetInputLayout(m_VertexLayout.Get());
 
 	// Bind the vertex shader to the pipeline's Vertex Shader stage
-	context->VSSetShader(m_VertexShader.Get(), nullptr, 0);
+	device->SetVertexShader(m_VertexShader.Get());
 
 	// Bind the pixel shader to the pipeline's Pixel Shader stage
 	if (bind_pixel_shader)
 	{
-		context->PSSetShader(m_PixelShader.Get(), nullptr, 0);
+		device->SetPixelShader(m_PixelShader.Get());
 	}
 	else
 	{
-		context->PSSetShader(nullptr, nullptr, 0);
+		device->SetPixelShader(nullptr);
 	}
 
 	// Bind the world constant buffer to the vertex and pixel shader
+	ConstantSlots& slots = this->GetConstantSlots();
 	const int constant_buffer_slot = 0;
-	context->VSSetConstantBuffers(constant_buffer_slot, 1, m_ModelConstantBuffer.GetAddressOf());
-	context->PSSetConstantBuffers(constant_buffer_slot, 1, m_ModelConstantBuffer.GetAddressOf());
+	this->BindConstants(constant_buffer_slot, m_ModelConstantBuffer.Get(), slots.model);
 
 	// Bind the camera constant buffer to the vertex and pixel shader
 	const int camera_buffer_slot = 1;
-	context->VSSetConstantBuffers(camera_buffer_slot, 1, m_CameraConstantBuffer.GetAddressOf());
-	context->PSSetConstantBuffers(camera_buffer_slot, 1, m_CameraConstantBuffer.GetAddressOf());
+	this->BindConstants(camera_buffer_slot, m_CameraConstantBuffer.Get(), slots.camera);
 
 	// Bind the world constant buffer to the vertex and pixel shader
 	const int light_buffer_slot = 2;
-	context->VSSetConstantBuffers(light_buffer_slot, 1, m_DirectionalLightBuffer.GetAddressOf());
-	context->PSSetConstantBuffers(light_buffer_slot, 1, m_DirectionalLightBuffer.GetAddressOf());
+	this->BindConstants(light_buffer_slot, m_DirectionalLightBuffer.Get(), slots.light);
+
+	// Bind the local light constant buffer to the vertex and pixel shader
+	const int local_light_buffer_slot = 3;
+	this->BindConstants(local_light_buffer_slot, m_LocalLightBuffer.Get(), slots.local_lights);
+}
+
+DefaultShader::ConstantSlots& DefaultShader::GetConstantSlots()
+{
+	return m_ConstantSlots[m_Renderer->GetRenderContextIndex()];
+}
+
+void DefaultShader::UploadConstants(uint32_t slot, ID3D11Buffer* buffer, const void* data, uint32_t size, ConstantAllocation& allocation)
+{
+	// Suballocate from the ring and bind at the new offset
+	ConstantBufferRing* ring = m_Renderer->GetConstantBufferRing();
+	if (ring != nullptr && ring->Upload(data, size, allocation))
+	{
+		ring->Bind(slot, allocation);
+		return;
+	}
+
+	// Fall back to the slot's own buffer, which only needs binding again if the slot was pointing at the ring
+	RenderDevice* device = m_Renderer->GetRenderDevice();
+	device->UpdateBuffer(buffer, data, size);
+
+	if (allocation.size != 0)
+	{
+		device->SetVertexConstantBuffer(slot, buffer);
+		device->SetPixelConstantBuffer(slot, buffer);
+		allocation = ConstantAllocation();
+	}
+}
+
+void DefaultShader::BindConstants(uint32_t slot, ID3D11Buffer* buffer, const ConstantAllocation& allocation)
+{
+	// Ring allocations are only valid for the frame they were made in
+	ConstantBufferRing* ring = m_Renderer->GetConstantBufferRing();
+	if (ring != nullptr && ring->IsCurrent(allocation))
+	{
+		ring->Bind(slot, allocation);
+		return;
+	}
+
+	RenderDevice* device = m_Renderer->GetRenderDevice();
+	device->SetVertexConstantBuffer(slot, buffer);
+	device->SetPixelConstantBuffer(slot, buffer);
 }
 
 void DefaultShader::LoadVertexShader()
@@ -100,6 +171,50 @@ void DefaultShader::LoadVertexShader()
 	DX::Check(device->CreateInputLayout(layout, number_elements, g_VertexShader, sizeof(g_VertexShader), m_VertexLayout.ReleaseAndGetAddressOf()));
 }
 
+void DefaultShader::UseInstancedVertexShader(bool instanced)
+{
+	RenderDevice* device = m_Renderer->GetRenderDevice();
+
+	// Constant buffers and the pixel shader are shared, only the vertex input changes
+	if (instanced)
+	{
+		device->SetInputLayout(m_InstancedVertexLayout.Get());
+		device->SetVertexShader(m_InstancedVertexShader.Get());
+	}
+	else
+	{
+		device->SetInputLayout(m_VertexLayout.Get());
+		device->SetVertexShader(m_VertexShader.Get());
+	}
+}
+
+void DefaultShader::LoadInstancedVertexShader()
+{
+	ID3D11Device* device = m_Renderer->GetDevice();
+
+	// Create the vertex shader
+	DX::Check(device->CreateVertexShader(g_InstancedVertexShader, sizeof(g_InstancedVertexShader), nullptr, m_InstancedVertexShader.ReleaseAndGetAddressOf()));
+
+	// Describe the memory layout, slot 0 is the mesh and slot 1 steps once per instance
+	D3D11_INPUT_ELEMENT_DESC layout[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "MODEL", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "MODEL", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "MODEL", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "MODEL", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "MODELINVERSE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "MODELINVERSE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 80, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "MODELINVERSE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 96, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "MODELINVERSE", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 112, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	};
+
+	UINT number_elements = ARRAYSIZE(layout);
+	DX::Check(device->CreateInputLayout(layout, number_elements, g_InstancedVertexShader, sizeof(g_InstancedVertexShader), m_InstancedVertexLayout.ReleaseAndGetAddressOf()));
+}
+
 void DefaultShader::LoadPixelShader()
 {
 	ID3D11Device* device = m_Renderer->GetDevice();
@@ -138,8 +253,7 @@ void DefaultShader::UpdateModelBuffer(const XMMATRIX& transform)
 	buffer.model = XMMatrixTranspose(transform);
 	buffer.model_inverse = XMMatrixTranspose(XMMatrixInverse(nullptr, transform));
 
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
-	context->UpdateSubresource(m_ModelConstantBuffer.Get(), 0, nullptr, &buffer, 0, 0);
+	this->UploadConstants(0, m_ModelConstantBuffer.Get(), &buffer, sizeof(buffer), this->GetConstantSlots().model);
 }
 
 void DefaultShader::UpdateCameraBuffer(const XMMATRIX& view, const XMMATRIX& projection, const XMFLOAT3& position)
@@ -149,8 +263,7 @@ void DefaultShader::UpdateCameraBuffer(const XMMATRIX& view, const XMMATRIX& pro
 	buffer.view = XMMatrixTranspose(view);
 	buffer.position = XMFLOAT4(position.x, position.y, position.z, 1.0f);
 
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
-	context->UpdateSubresource(m_CameraConstantBuffer.Get(), 0, nullptr, &buffer, 0, 0);
+	this->UploadConstants(1, m_CameraConstantBuffer.Get(), &buffer, sizeof(buffer), this->GetConstantSlots().camera);
 }
 
 void DefaultShader::CreateDirectionalLightBuffer()
@@ -166,13 +279,67 @@ void DefaultShader::CreateDirectionalLightBuffer()
 	DX::Check(device->CreateBuffer(&bd, nullptr, m_DirectionalLightBuffer.ReleaseAndGetAddressOf()));
 }
 
-void DefaultShader::UpdateDirectionalLightBuffer(const DirectX::XMFLOAT4& direction, const XMMATRIX& light_view, const XMMATRIX& light_projection)
+void DefaultShader::UpdateDirectionalLightBuffer(const DirectX::XMFLOAT4& direction, const ShadowCascades& cascades)
 {
 	DirectionalLightBuffer buffer = {};
 	buffer.direction = direction;
-	buffer.light_view = XMMatrixTranspose(light_view);
-	buffer.light_projection = XMMatrixTranspose(light_projection);
+	buffer.cascade_view = XMMatrixTranspose(cascades.GetCameraView());
+	buffer.cascade_count = cascades.GetCascadeCount();
+
+	// Unused cascades are left zeroed, the shader never reaches them
+	float splits[MAX_SHADOW_CASCADES] = {};
+	for (uint32_t i = 0; i < buffer.cascade_count; ++i)
+	{
+		buffer.cascade_view_projection[i] = XMMatrixTranspose(cascades.GetView(i) * cascades.GetProjection(i));
+		splits[i] = cascades.GetCascade(i).split_far;
+	}
+
+	buffer.cascade_splits = XMFLOAT4(splits[0], splits[1], splits[2], splits[3]);
 
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
-	context->UpdateSubresource(m_DirectionalLightBuffer.Get(), 0, nullptr, &buffer, 0, 0);
-}
\ No newline at end of file
+	this->UploadConstants(2, m_DirectionalLightBuffer.Get(), &buffer, sizeof(buffer), this->GetConstantSlots().light);
+}
+
+void DefaultShader::CreateLocalLightBuffer()
+{
+	ID3D11Device* device = m_Renderer->GetDevice();
+
+	// Create local light constant buffer
+	D3D11_BUFFER_DESC bd = {};
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.ByteWidth = sizeof(LocalLightBuffer);
+	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	DX::Check(device->CreateBuffer(&bd, nullptr, m_LocalLightBuffer.ReleaseAndGetAddressOf()));
+}
+
+void DefaultShader::UpdateLocalLightBuffer(const LocalLights& lights, bool enabled)
+{
+	LocalLightBuffer buffer = {};
+	buffer.light_count = enabled ? static_cast<uint32_t>(lights.GetLights().size()) : 0;
+	buffer.atlas_texel_size = 1.0f / static_cast<float>(lights.GetAtlas().GetAtlasSize());
+
+	for (uint32_t i = 0; i < buffer.light_count; ++i)
+	{
+		const LocalLight& light = lights.GetLights()[i];
+		LocalLightData& data = buffer.lights[i];
+		data.position_range = XMFLOAT4(light.position.x, light.position.y, light.position.z, light.range);
+
+		XMFLOAT3 direction;
+		XMStoreFloat3(&direction, XMVector3Normalize(XMLoadFloat3(&light.direction)));
+		data.direction_spot_cos = XMFLOAT4(direction.x, direction.y, direction.z, std::cos(light.spot_angle));
+
+		data.colour = XMFLOAT4(light.colour.x, light.colour.y, light.colour.z, 1.0f);
+		data.info[0] = lights.GetFirstShadowView(i);
+		data.info[1] = (light.type == ShadowLightType::Point) ? 1 : 0;
+	}
+
+	// Every view's matrix and where its tile is in the atlas
+	const std::vector<LocalShadowView>& views = lights.GetShadowViews();
+	for (size_t i = 0; i < views.size(); ++i)
+	{
+		buffer.shadow_view_projection[i] = XMMatrixTranspose(XMLoadFloat4x4(&views[i].view) * XMLoadFloat4x4(&views[i].projection));
+		buffer.shadow_tiles[i] = lights.GetAtlas().GetTileScaleOffset(views[i].tile);
+	}
+
+	this->UploadConstants(3, m_LocalLightBuffer.Get(), &buffer, sizeof(buffer), this->GetConstantSlots().local_lights);
+}
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <d3d11.h>
+#include "Renderer.h"
+#include "ConstantRingAllocator.h"
+#include "ShadowCascades.h"
+#include "LocalLights.h"
 #include <DirectXMath.h>
 using namespace DirectX;
 
@@ -8,8 +12,6 @@ using namespace DirectX;
 #include <wrl\client.h>
 using Microsoft::WRL::ComPtr;
 
-class Renderer;
-
 class DefaultShader
 {
 	Renderer* m_Renderer = nullptr;
@@ -24,14 +26,20 @@ public:
 	// Bind shader to the pipeline
 	void Use(bool bind_pixel_shader);
 
+	// Switch between the per draw vertex shader and the one reading model transforms from instance slot 1
+	void UseInstancedVertexShader(bool instanced);
+
 	// Update the model view projection constant buffer
 	void UpdateModelBuffer(const XMMATRIX& transform);
 
 	// Update camera buffer
 	void UpdateCameraBuffer(const XMMATRIX& view, const XMMATRIX& projection, const XMFLOAT3& position);
 
-	// Update the light buffer
-	void UpdateDirectionalLightBuffer(const XMFLOAT4& direction, const XMMATRIX& light_view, const XMMATRIX& light_projection);
+	// Update the light buffer with the cascades' matrices and splits
+	void UpdateDirectionalLightBuffer(const XMFLOAT4& direction, const ShadowCascades& cascades);
+
+	// Update the local light buffer with the lights and their shadow views, no lights are drawn when disabled
+	void UpdateLocalLightBuffer(const LocalLights& lights, bool enabled);
 
 private:
 	// Create vertex shader
@@ -39,6 +47,11 @@ private:
 	ComPtr<ID3D11VertexShader> m_VertexShader = nullptr;
 	ComPtr<ID3D11InputLayout> m_VertexLayout = nullptr;
 
+	// Create instanced vertex shader
+	void LoadInstancedVertexShader();
+	ComPtr<ID3D11VertexShader> m_InstancedVertexShader = nullptr;
+	ComPtr<ID3D11InputLayout> m_InstancedVertexLayout = nullptr;
+
 	// Create pixel shader
 	void LoadPixelShader();
 	ComPtr<ID3D11PixelShader> m_PixelShader = nullptr;
@@ -54,4 +67,27 @@ private:
 	// Create the DirectionalLightBuffer
 	ComPtr<ID3D11Buffer> m_DirectionalLightBuffer = nullptr;
 	void CreateDirectionalLightBuffer();
+
+	// Create the LocalLightBuffer
+	ComPtr<ID3D11Buffer> m_LocalLightBuffer = nullptr;
+	void CreateLocalLightBuffer();
+
+	// Where the constants of each slot were last written, the size is 0 if they are in the buffers above
+	// Kept per render context as each is recorded on its own thread with its own ring
+	struct ConstantSlots
+	{
+		ConstantAllocation model;
+		ConstantAllocation camera;
+		ConstantAllocation light;
+		ConstantAllocation local_lights;
+	};
+
+	ConstantSlots m_ConstantSlots[Renderer::MAX_RENDER_CONTEXTS + 1];
+	ConstantSlots& GetConstantSlots();
+
+	// Write constants to the renderer's ring and bind them, or to the slot's own buffer if the ring is unavailable or full
+	void UploadConstants(uint32_t slot, ID3D11Buffer* buffer, const void* data, uint32_t size, ConstantAllocation& allocation);
+
+	// Bind the slot from wherever the constants were last written
+	void BindConstants(uint32_t slot, ID3D11Buffer* buffer, const ConstantAllocation& allocation);
 };
\ No newline at end of file
@@ -9,22 +9,31 @@ Floor::Floor(Renderer* renderer) : m_Renderer(renderer)
 {
 }
 
-void Floor::Create()
+Floor::~Floor()
 {
-	CreateVertexBuffer();
-	CreateIndexBuffer();
+	m_Renderer->GetGeometryArena()->RemoveMesh(m_Mesh);
 }
 
-void Floor::CreateVertexBuffer()
+void Floor::Create()
 {
-	ID3D11Device* device = m_Renderer->GetDevice();
+	std::vector<Vertex> vertices;
+	CreateVertices(vertices);
+
+	std::vector<UINT> indices;
+	CreateIndices(indices);
+
+	// Copy the mesh into the shared vertex and index buffers
+	m_Mesh = m_Renderer->GetGeometryArena()->AddMesh(vertices.data(), static_cast<uint32_t>(vertices.size()), indices.data(), static_cast<uint32_t>(indices.size()));
+}
 
+void Floor::CreateVertices(std::vector<Vertex>& vertices)
+{
 	const float width = 100.0f;
 	const float height = 0.1f;
 	const float depth = 100.0f;
 
 	// Vertex data
-	std::vector<Vertex> vertices =
+	vertices =
 	{
 		{ VertexPosition(-width, -height, -depth), VertexNormal(+0.0f, +0.0f, -1.0f), VertexUV(0.0f, 1.0f) },
 		{ VertexPosition(-width, +height, -depth), VertexNormal(+0.0f, +0.0f, -1.0f), VertexUV(0.0f, 0.0f) },
@@ -56,25 +65,12 @@ void Floor::CreateVertexBuffer()
 		{ VertexPosition(+width, +height, +depth), VertexNormal(+1.0f, +0.0f, +0.0f), VertexUV(1.0f, 0.0f) },
 		{ VertexPosition(+width, -height, +depth), VertexNormal(+1.0f, +0.0f, +0.0f), VertexUV(1.0f, 1.0f) }
 	};
-
-	// Create vertex buffer
-	D3D11_BUFFER_DESC vertexbuffer_desc = {};
-	vertexbuffer_desc.Usage = D3D11_USAGE_DEFAULT;
-	vertexbuffer_desc.ByteWidth = static_cast<UINT>(sizeof(Vertex) * vertices.size());
-	vertexbuffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-
-	D3D11_SUBRESOURCE_DATA vertex_subdata = {};
-	vertex_subdata.pSysMem = vertices.data();
-
-	DX::Check(device->CreateBuffer(&vertexbuffer_desc, &vertex_subdata, m_VertexBuffer.ReleaseAndGetAddressOf()));
 }
 
-void Floor::CreateIndexBuffer()
+void Floor::CreateIndices(std::vector<UINT>& indices)
 {
-	ID3D11Device* device = m_Renderer->GetDevice();
-
 	// Set Indices
-	std::vector<UINT> indices =
+	indices =
 	{
 		0, 1, 2,
 		0, 2, 3,
@@ -89,38 +85,19 @@ void Floor::CreateIndexBuffer()
 		20, 21, 22,
 		20, 22, 23,
 	};
-
-	m_IndexCount = static_cast<UINT>(indices.size());
-
-	// Create index buffer
-	D3D11_BUFFER_DESC index_buffer_desc = {};
-	index_buffer_desc.Usage = D3D11_USAGE_DEFAULT;
-	index_buffer_desc.ByteWidth = static_cast<UINT>(sizeof(UINT) * indices.size());
-	index_buffer_desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-
-	D3D11_SUBRESOURCE_DATA index_subdata = {};
-	index_subdata.pSysMem = indices.data();
-
-	DX::Check(device->CreateBuffer(&index_buffer_desc, &index_subdata, m_IndexBuffer.ReleaseAndGetAddressOf()));
 }
 
 void Floor::Render()
 {
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
-
-	// We need to define the stride and offset
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
+	GeometryArena* arena = m_Renderer->GetGeometryArena();
 
-	// Bind the vertex buffer to the pipeline's Input Assembler stage
-	context->IASetVertexBuffers(0, 1, m_VertexBuffer.GetAddressOf(), &stride, &offset);
+	// Still streaming in
+	if (!arena->IsUploaded(m_Mesh))
+		return;
 
-	// Bind the index buffer to the pipeline's Input Assembler stage
-	context->IASetIndexBuffer(m_IndexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-
-	// Bind the geometry topology to the pipeline's Input Assembler stage
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	// Bind the shared vertex and index buffers, the state cache drops this when the last draw bound them too
+	arena->Bind();
 
 	// Render geometry
-	context->DrawIndexed(m_IndexCount, 0, 0);
-}
\ No newline at end of file
+	arena->Draw(m_Mesh);
+}
@@ -1,12 +1,15 @@
 #pragma once
 
+#include "GeometryArena.h"
 #include <d3d11.h>
+#include <vector>
 
 // This include is requires for using DirectX smart pointers (ComPtr)
 #include <wrl\client.h>
 using Microsoft::WRL::ComPtr;
 
 class Renderer;
+struct Vertex;
 
 class Floor
 {
@@ -14,7 +17,7 @@ class Floor
 
 public:
 	Floor(Renderer* renderer);
-	virtual ~Floor() = default;
+	virtual ~Floor();
 
 	// Create the model
 	void Create();
@@ -23,14 +26,12 @@ public:
 	void Render();
 
 private:
-	// Number of indices to draw
-	UINT m_IndexCount = 0;
+	// Mesh in the renderer's geometry arena
+	GeometryMesh m_Mesh = INVALID_GEOMETRY_MESH;
 
-	// Vertex buffer
-	void CreateVertexBuffer();
-	ComPtr<ID3D11Buffer> m_VertexBuffer = nullptr;
+	// Vertex data
+	void CreateVertices(std::vector<Vertex>& vertices);
 
-	// Index buffer
-	void CreateIndexBuffer();
-	ComPtr<ID3D11Buffer> m_IndexBuffer = nullptr;
+	// Index data
+	void CreateIndices(std::vector<UINT>& indices);
 };
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "FrameGraphTextures.h"
+#include "Renderer.h"
+#include "RenderDevice.h"
+
+namespace
+{
+	// Depth textures that are also read by shaders are created typeless, with a typed format for each view
+	void GetDepthFormats(DXGI_FORMAT format, DXGI_FORMAT& texture_format, DXGI_FORMAT& shader_resource_format)
+	{
+		switch (format)
+		{
+			case DXGI_FORMAT_D24_UNORM_S8_UINT:
+				texture_format = DXGI_FORMAT_R24G8_TYPELESS;
+				shader_resource_format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+				break;
+			case DXGI_FORMAT_D32_FLOAT:
+				texture_format = DXGI_FORMAT_R32_TYPELESS;
+				shader_resource_format = DXGI_FORMAT_R32_FLOAT;
+				break;
+			case DXGI_FORMAT_D16_UNORM:
+				texture_format = DXGI_FORMAT_R16_TYPELESS;
+				shader_resource_format = DXGI_FORMAT_R16_UNORM;
+				break;
+			default:
+				texture_format = format;
+				shader_resource_format = format;
+				break;
+		}
+	}
+}
+
+FrameGraphTextures::FrameGraphTextures(Renderer* renderer) : m_Renderer(renderer)
+{
+}
+
+void FrameGraphTextures::CreateTexture(uint32_t physical_index, const FrameGraphTextureDesc& desc)
+{
+	ID3D11Device* device = m_Renderer->GetDevice();
+
+	if (physical_index >= m_Textures.size())
+	{
+		m_Textures.resize(physical_index + 1);
+	}
+
+	Texture& texture = m_Textures[physical_index];
+	texture = Texture();
+
+	DXGI_FORMAT format = static_cast<DXGI_FORMAT>(desc.format);
+	bool is_depth = (desc.bind_flags & D3D11_BIND_DEPTH_STENCIL) != 0;
+	bool is_shader_resource = (desc.bind_flags & D3D11_BIND_SHADER_RESOURCE) != 0;
+	bool is_multisampled = (desc.sample_count > 1);
+
+	DXGI_FORMAT texture_format = format;
+	DXGI_FORMAT shader_resource_format = format;
+	if (is_depth && is_shader_resource)
+	{
+		GetDepthFormats(format, texture_format, shader_resource_format);
+	}
+
+	// Create the texture
+	D3D11_TEXTURE2D_DESC texture_desc = {};
+	texture_desc.Width = desc.width;
+	texture_desc.Height = desc.height;
+	texture_desc.MipLevels = 1;
+	texture_desc.ArraySize = 1;
+	texture_desc.Format = texture_format;
+	texture_desc.SampleDesc.Count = desc.sample_count;
+	texture_desc.SampleDesc.Quality = 0;
+	texture_desc.Usage = D3D11_USAGE_DEFAULT;
+	texture_desc.BindFlags = desc.bind_flags;
+
+	DX::Check(device->CreateTexture2D(&texture_desc, nullptr, texture.texture.ReleaseAndGetAddressOf()));
+
+	// Create the views the bind flags allow
+	if (desc.bind_flags & D3D11_BIND_RENDER_TARGET)
+	{
+		DX::Check(device->CreateRenderTargetView(texture.texture.Get(), nullptr, texture.render_target_view.ReleaseAndGetAddressOf()));
+	}
+
+	if (is_depth)
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC depth_view_desc = {};
+		depth_view_desc.Format = format;
+		depth_view_desc.ViewDimension = is_multisampled ? D3D11_DSV_DIMENSION_TEXTURE2DMS : D3D11_DSV_DIMENSION_TEXTURE2D;
+
+		DX::Check(device->CreateDepthStencilView(texture.texture.Get(), &depth_view_desc, texture.depth_stencil_view.ReleaseAndGetAddressOf()));
+	}
+
+	if (is_shader_resource)
+	{
+		D3D11_SHADER_RESOURCE_VIEW_DESC shader_view_desc = {};
+		shader_view_desc.Format = shader_resource_format;
+		shader_view_desc.ViewDimension = is_multisampled ? D3D11_SRV_DIMENSION_TEXTURE2DMS : D3D11_SRV_DIMENSION_TEXTURE2D;
+		shader_view_desc.Texture2D.MipLevels = 1;
+
+		DX::Check(device->CreateShaderResourceView(texture.texture.Get(), &shader_view_desc, texture.shader_resource_view.ReleaseAndGetAddressOf()));
+	}
+}
+
+void FrameGraphTextures::UnbindShaderResource(uint32_t slot)
+{
+	m_Renderer->GetRenderDevice()->SetPixelShaderResource(slot, nullptr);
+}
+
+void FrameGraphTextures::UnbindRenderTargets()
+{
+	m_Renderer->GetRenderDevice()->SetRenderTarget(nullptr, nullptr);
+}
+
+ID3D11RenderTargetView* FrameGraphTextures::GetRenderTargetView(uint32_t physical_index) const
+{
+	return (physical_index < m_Textures.size()) ? m_Textures[physical_index].render_target_view.Get() : nullptr;
+}
+
+ID3D11DepthStencilView* FrameGraphTextures::GetDepthStencilView(uint32_t physical_index) const
+{
+	return (physical_index < m_Textures.size()) ? m_Textures[physical_index].depth_stencil_view.Get() : nullptr;
+}
+
+ID3D11ShaderResourceView* FrameGraphTextures::GetShaderResourceView(uint32_t physical_index) const
+{
+	return (physical_index < m_Textures.size()) ? m_Textures[physical_index].shader_resource_view.Get() : nullptr;
+}
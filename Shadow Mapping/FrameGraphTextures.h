@@ -0,0 +1,42 @@
+#pragma once
+
+#include "../External/FrameGraph.h"
+#include <d3d11.h>
+#include <vector>
+
+// This include is requires for using DirectX smart pointers (ComPtr)
+#include <wrl\client.h>
+using Microsoft::WRL::ComPtr;
+
+class Renderer;
+
+// Creates the frame graph's physical textures and issues its unbinds through the renderer's device
+class FrameGraphTextures : public FrameGraphBackend
+{
+	Renderer* m_Renderer = nullptr;
+
+public:
+	FrameGraphTextures(Renderer* renderer);
+	virtual ~FrameGraphTextures() = default;
+
+	// Frame graph backend
+	void CreateTexture(uint32_t physical_index, const FrameGraphTextureDesc& desc) override;
+	void UnbindShaderResource(uint32_t slot) override;
+	void UnbindRenderTargets() override;
+
+	// Views of a physical texture, null if its bind flags don't allow them
+	ID3D11RenderTargetView* GetRenderTargetView(uint32_t physical_index) const;
+	ID3D11DepthStencilView* GetDepthStencilView(uint32_t physical_index) const;
+	ID3D11ShaderResourceView* GetShaderResourceView(uint32_t physical_index) const;
+
+private:
+	struct Texture
+	{
+		ComPtr<ID3D11Texture2D> texture;
+		ComPtr<ID3D11RenderTargetView> render_target_view;
+		ComPtr<ID3D11DepthStencilView> depth_stencil_view;
+		ComPtr<ID3D11ShaderResourceView> shader_resource_view;
+	};
+
+	std::vector<Texture> m_Textures;
+};
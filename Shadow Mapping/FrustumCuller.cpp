@@ -0,0 +1,301 @@
+#include "FrustumCuller.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#include "../External/ThreadPool.h"
+#include "../External/SimdLanes.h"
+
+namespace
+{
+	using namespace Simd;
+
+	// Write the indices of the lanes set in the mask, without branching on each lane
+	inline uint32_t WriteVisible(uint32_t mask, uint32_t first_index, uint32_t* output)
+	{
+		uint32_t written = 0;
+		for (uint32_t lane = 0; lane < LANE_COUNT; ++lane)
+		{
+			output[written] = first_index + lane;
+			written += (mask >> lane) & 1;
+		}
+
+		return written;
+	}
+}
+
+CullingFrustum CullingFrustum::FromViewProjection(const XMMATRIX& view_projection)
+{
+	// Row vectors are multiplied on the left, so the clip space planes are combinations of the matrix columns
+	XMMATRIX columns = XMMatrixTranspose(view_projection);
+
+	XMVECTOR planes[6] =
+	{
+		XMVectorAdd(columns.r[3], columns.r[0]),		// Left
+		XMVectorSubtract(columns.r[3], columns.r[0]),	// Right
+		XMVectorAdd(columns.r[3], columns.r[1]),		// Bottom
+		XMVectorSubtract(columns.r[3], columns.r[1]),	// Top
+		columns.r[2],									// Near, depth is 0 to 1
+		XMVectorSubtract(columns.r[3], columns.r[2]),	// Far
+	};
+
+	// Normalised so the box and sphere tests measure distances in world units
+	CullingFrustum frustum;
+	for (int i = 0; i < 6; ++i)
+	{
+		XMStoreFloat4(&frustum.planes[i], XMPlaneNormalize(planes[i]));
+	}
+
+	return frustum;
+}
+
+bool CullingFrustum::IntersectsBox(const XMFLOAT3& center, const XMFLOAT3& extents) const
+{
+	for (const XMFLOAT4& plane : planes)
+	{
+		float d = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w +
+			std::fabs(plane.x) * extents.x + std::fabs(plane.y) * extents.y + std::fabs(plane.z) * extents.z;
+
+		if (d < 0.0f)
+			return false;
+	}
+
+	return true;
+}
+
+void FrustumCuller::Clear()
+{
+	m_CenterX.clear();
+	m_CenterY.clear();
+	m_CenterZ.clear();
+	m_ExtentX.clear();
+	m_ExtentY.clear();
+	m_ExtentZ.clear();
+	m_Radius.clear();
+}
+
+void FrustumCuller::Reserve(uint32_t count)
+{
+	m_CenterX.reserve(count);
+	m_CenterY.reserve(count);
+	m_CenterZ.reserve(count);
+	m_ExtentX.reserve(count);
+	m_ExtentY.reserve(count);
+	m_ExtentZ.reserve(count);
+	m_Radius.reserve(count);
+}
+
+uint32_t FrustumCuller::AddBox(const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+	uint32_t index = this->GetCount();
+
+	m_CenterX.push_back(0.0f);
+	m_CenterY.push_back(0.0f);
+	m_CenterZ.push_back(0.0f);
+	m_ExtentX.push_back(0.0f);
+	m_ExtentY.push_back(0.0f);
+	m_ExtentZ.push_back(0.0f);
+	m_Radius.push_back(0.0f);
+
+	this->SetBox(index, center, extents);
+	return index;
+}
+
+void FrustumCuller::SetBox(uint32_t index, const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+	m_CenterX[index] = center.x;
+	m_CenterY[index] = center.y;
+	m_CenterZ[index] = center.z;
+	m_ExtentX[index] = extents.x;
+	m_ExtentY[index] = extents.y;
+	m_ExtentZ[index] = extents.z;
+	m_Radius[index] = std::sqrt(extents.x * extents.x + extents.y * extents.y + extents.z * extents.z);
+}
+
+uint32_t FrustumCuller::GetLaneCount()
+{
+	return LANE_COUNT;
+}
+
+const char* FrustumCuller::GetInstructionSet()
+{
+	return INSTRUCTION_SET;
+}
+
+void FrustumCuller::Cull(const CullingFrustum& frustum, CullingShape shape, uint32_t thread_count, std::vector<uint32_t>& visible)
+{
+	uint32_t count = this->GetCount();
+	uint32_t chunk_count = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+	// Each chunk can write up to its own size
+	visible.resize(count);
+	m_ChunkCounts.assign(chunk_count, 0);
+
+	// Workers from the shared pool take the next chunk until there are none left, the calling thread works as well
+	std::atomic<uint32_t> next_chunk(0);
+	auto worker = [&]()
+	{
+		for (uint32_t chunk = next_chunk++; chunk < chunk_count; chunk = next_chunk++)
+		{
+			uint32_t begin = chunk * CHUNK_SIZE;
+			uint32_t end = std::min(begin + CHUNK_SIZE, count);
+			m_ChunkCounts[chunk] = this->CullRange(frustum, shape, begin, end, visible.data() + begin);
+		}
+	};
+
+	uint32_t used_threads = ThreadPool::GetShared().Run(std::min(thread_count, chunk_count), worker);
+
+	// Pack the chunks' visible indices together
+	uint32_t visible_count = 0;
+	for (uint32_t chunk = 0; chunk < chunk_count; ++chunk)
+	{
+		uint32_t begin = chunk * CHUNK_SIZE;
+		if (visible_count != begin)
+		{
+			std::memmove(visible.data() + visible_count, visible.data() + begin, m_ChunkCounts[chunk] * sizeof(uint32_t));
+		}
+
+		visible_count += m_ChunkCounts[chunk];
+	}
+
+	visible.resize(visible_count);
+
+	m_Stats.object_count = count;
+	m_Stats.visible_count = visible_count;
+	m_Stats.chunk_count = chunk_count;
+	m_Stats.thread_count = used_threads;
+}
+
+void FrustumCuller::CullSerial(const CullingFrustum& frustum, CullingShape shape, std::vector<uint32_t>& visible) const
+{
+	uint32_t count = this->GetCount();
+	visible.resize(count);
+	visible.resize(this->CullRange(frustum, shape, 0, count, visible.data()));
+}
+
+uint32_t FrustumCuller::CullRange(const CullingFrustum& frustum, CullingShape shape, uint32_t begin, uint32_t end, uint32_t* output) const
+{
+	return (shape == CullingShape::Box) ? this->CullBoxes(frustum, begin, end, output) : this->CullSpheres(frustum, begin, end, output);
+}
+
+uint32_t FrustumCuller::CullBoxes(const CullingFrustum& frustum, uint32_t begin, uint32_t end, uint32_t* output) const
+{
+	// A box is outside a plane when even its corner furthest along the normal is behind it,
+	// that corner is the center plus the extents projected onto the absolute normal
+	uint32_t written = 0;
+	uint32_t i = begin;
+
+#if defined(SIMD_LANES_SSE)
+	Lanes normal_x[6], normal_y[6], normal_z[6], distance[6];
+	Lanes absolute_x[6], absolute_y[6], absolute_z[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		const XMFLOAT4& plane = frustum.planes[p];
+		normal_x[p] = Splat(plane.x);
+		normal_y[p] = Splat(plane.y);
+		normal_z[p] = Splat(plane.z);
+		distance[p] = Splat(plane.w);
+		absolute_x[p] = Splat(std::fabs(plane.x));
+		absolute_y[p] = Splat(std::fabs(plane.y));
+		absolute_z[p] = Splat(std::fabs(plane.z));
+	}
+
+	for (; i + LANE_COUNT <= end; i += LANE_COUNT)
+	{
+		Lanes center_x = Load(&m_CenterX[i]);
+		Lanes center_y = Load(&m_CenterY[i]);
+		Lanes center_z = Load(&m_CenterZ[i]);
+		Lanes extent_x = Load(&m_ExtentX[i]);
+		Lanes extent_y = Load(&m_ExtentY[i]);
+		Lanes extent_z = Load(&m_ExtentZ[i]);
+
+		uint32_t mask = ALL_LANES;
+		for (int p = 0; p < 6 && mask != 0; ++p)
+		{
+			Lanes d = MultiplyAdd(normal_x[p], center_x, distance[p]);
+			d = MultiplyAdd(normal_y[p], center_y, d);
+			d = MultiplyAdd(normal_z[p], center_z, d);
+			d = MultiplyAdd(absolute_x[p], extent_x, d);
+			d = MultiplyAdd(absolute_y[p], extent_y, d);
+			d = MultiplyAdd(absolute_z[p], extent_z, d);
+			mask &= NotNegativeMask(d);
+		}
+
+		written += WriteVisible(mask, i, output + written);
+	}
+#endif
+
+	// What is left over
+	for (; i < end; ++i)
+	{
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; ++p)
+		{
+			const XMFLOAT4& plane = frustum.planes[p];
+			float d = plane.x * m_CenterX[i] + plane.y * m_CenterY[i] + plane.z * m_CenterZ[i] + plane.w +
+				std::fabs(plane.x) * m_ExtentX[i] + std::fabs(plane.y) * m_ExtentY[i] + std::fabs(plane.z) * m_ExtentZ[i];
+			inside = (d >= 0.0f);
+		}
+
+		output[written] = i;
+		written += inside ? 1 : 0;
+	}
+
+	return written;
+}
+
+uint32_t FrustumCuller::CullSpheres(const CullingFrustum& frustum, uint32_t begin, uint32_t end, uint32_t* output) const
+{
+	// A sphere is outside a plane when its center is further behind it than the radius
+	uint32_t written = 0;
+	uint32_t i = begin;
+
+#if defined(SIMD_LANES_SSE)
+	Lanes normal_x[6], normal_y[6], normal_z[6], distance[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		const XMFLOAT4& plane = frustum.planes[p];
+		normal_x[p] = Splat(plane.x);
+		normal_y[p] = Splat(plane.y);
+		normal_z[p] = Splat(plane.z);
+		distance[p] = Splat(plane.w);
+	}
+
+	for (; i + LANE_COUNT <= end; i += LANE_COUNT)
+	{
+		Lanes center_x = Load(&m_CenterX[i]);
+		Lanes center_y = Load(&m_CenterY[i]);
+		Lanes center_z = Load(&m_CenterZ[i]);
+		Lanes radius = Load(&m_Radius[i]);
+
+		uint32_t mask = ALL_LANES;
+		for (int p = 0; p < 6 && mask != 0; ++p)
+		{
+			Lanes d = MultiplyAdd(normal_x[p], center_x, Add(distance[p], radius));
+			d = MultiplyAdd(normal_y[p], center_y, d);
+			d = MultiplyAdd(normal_z[p], center_z, d);
+			mask &= NotNegativeMask(d);
+		}
+
+		written += WriteVisible(mask, i, output + written);
+	}
+#endif
+
+	// What is left over
+	for (; i < end; ++i)
+	{
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; ++p)
+		{
+			const XMFLOAT4& plane = frustum.planes[p];
+			float d = plane.x * m_CenterX[i] + plane.y * m_CenterY[i] + plane.z * m_CenterZ[i] + plane.w + m_Radius[i];
+			inside = (d >= 0.0f);
+		}
+
+		output[written] = i;
+		written += inside ? 1 : 0;
+	}
+
+	return written;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+// Frustum as six planes facing inwards, a point is inside when dot(normal, point) + d >= 0 for every plane
+struct CullingFrustum
+{
+	XMFLOAT4 planes[6];
+
+	// Planes of a view projection matrix, in the space the matrix transforms from
+	static CullingFrustum FromViewProjection(const XMMATRIX& view_projection);
+
+	// Test a single axis aligned box, for objects kept outside a culler
+	bool IntersectsBox(const XMFLOAT3& center, const XMFLOAT3& extents) const;
+};
+
+// What the bounds are tested as
+enum class CullingShape : uint8_t
+{
+	Box,
+	Sphere,
+};
+
+// Counters of the last cull
+struct CullingStats
+{
+	uint32_t object_count = 0;
+	uint32_t visible_count = 0;
+	uint32_t chunk_count = 0;
+	uint32_t thread_count = 0;
+};
+
+// Frustum culling over bounds stored as structure of arrays, so one instruction tests a box or sphere per lane
+// against a plane. Compiled for 4 lanes with SSE2, or one lane without it, through External/SimdLanes.h.
+// Large counts are split into chunks culled on the shared thread pool, each chunk writes its visible indices to its own
+// range of the output and the ranges are packed together at the end, so the output is in index order
+class FrustumCuller
+{
+public:
+	// Objects per chunk, small scenes stay on the calling thread
+	static constexpr uint32_t CHUNK_SIZE = 16 * 1024;
+
+	FrustumCuller() = default;
+	virtual ~FrustumCuller() = default;
+
+	// Remove every object
+	void Clear();
+
+	// Make room for this many objects up front
+	void Reserve(uint32_t count);
+
+	// Add an axis aligned box, its bounding sphere is stored as well, returns the object's index
+	uint32_t AddBox(const XMFLOAT3& center, const XMFLOAT3& extents);
+
+	// Move an object
+	void SetBox(uint32_t index, const XMFLOAT3& center, const XMFLOAT3& extents);
+
+	inline uint32_t GetCount() const { return static_cast<uint32_t>(m_CenterX.size()); }
+
+	// Write the indices of the objects inside or touching the frustum, using up to thread_count threads of the shared pool
+	void Cull(const CullingFrustum& frustum, CullingShape shape, uint32_t thread_count, std::vector<uint32_t>& visible);
+
+	// Cull on the calling thread without touching the culler's counters, so several frustums can be culled at once
+	void CullSerial(const CullingFrustum& frustum, CullingShape shape, std::vector<uint32_t>& visible) const;
+
+	// Counters of the last cull
+	inline const CullingStats& GetStats() const { return m_Stats; }
+
+	// Lanes tested per instruction and the instruction set, fixed at compile time
+	static uint32_t GetLaneCount();
+	static const char* GetInstructionSet();
+
+private:
+	// Bounds
+	std::vector<float> m_CenterX;
+	std::vector<float> m_CenterY;
+	std::vector<float> m_CenterZ;
+	std::vector<float> m_ExtentX;
+	std::vector<float> m_ExtentY;
+	std::vector<float> m_ExtentZ;
+	std::vector<float> m_Radius;
+
+	// Visible count of each chunk of the last cull
+	std::vector<uint32_t> m_ChunkCounts;
+
+	CullingStats m_Stats;
+
+	// Cull the objects from begin to end, returns the number written to output
+	uint32_t CullRange(const CullingFrustum& frustum, CullingShape shape, uint32_t begin, uint32_t end, uint32_t* output) const;
+	uint32_t CullBoxes(const CullingFrustum& frustum, uint32_t begin, uint32_t end, uint32_t* output) const;
+	uint32_t CullSpheres(const CullingFrustum& frustum, uint32_t begin, uint32_t end, uint32_t* output) const;
+};
@@ -0,0 +1,100 @@
+#include "GeometryAllocator.h"
+#include <algorithm>
+
+GeometryAllocator::GeometryAllocator(uint32_t capacity)
+{
+	this->Reset(capacity);
+}
+
+void GeometryAllocator::Reset(uint32_t capacity)
+{
+	m_Capacity = capacity;
+	m_Used = 0;
+
+	m_FreeRanges.clear();
+	if (capacity > 0)
+	{
+		m_FreeRanges.push_back({ 0, capacity });
+	}
+}
+
+uint32_t GeometryAllocator::Allocate(uint32_t count)
+{
+	if (count == 0)
+		return INVALID_OFFSET;
+
+	for (auto it = m_FreeRanges.begin(); it != m_FreeRanges.end(); ++it)
+	{
+		if (it->count < count)
+			continue;
+
+		// Take the front of the range
+		uint32_t offset = it->offset;
+		it->offset += count;
+		it->count -= count;
+
+		if (it->count == 0)
+		{
+			m_FreeRanges.erase(it);
+		}
+
+		m_Used += count;
+		return offset;
+	}
+
+	return INVALID_OFFSET;
+}
+
+void GeometryAllocator::Free(uint32_t offset, uint32_t count)
+{
+	if (count == 0 || offset == INVALID_OFFSET)
+		return;
+
+	m_Used -= count;
+
+	// First free range after the one being freed
+	auto next = std::lower_bound(m_FreeRanges.begin(), m_FreeRanges.end(), offset, [](const Range& range, uint32_t value) { return range.offset < value; });
+
+	// Merge with the range before
+	bool merged = false;
+	if (next != m_FreeRanges.begin())
+	{
+		auto previous = next - 1;
+		if (previous->offset + previous->count == offset)
+		{
+			previous->count += count;
+			merged = true;
+
+			// Now touches the range after as well
+			if (next != m_FreeRanges.end() && previous->offset + previous->count == next->offset)
+			{
+				previous->count += next->count;
+				m_FreeRanges.erase(next);
+			}
+		}
+	}
+
+	if (merged)
+		return;
+
+	// Merge with the range after
+	if (next != m_FreeRanges.end() && offset + count == next->offset)
+	{
+		next->offset = offset;
+		next->count += count;
+		return;
+	}
+
+	m_FreeRanges.insert(next, { offset, count });
+}
+
+uint32_t GeometryAllocator::GetLargestFree() const
+{
+	uint32_t largest = 0;
+	for (const Range& range : m_FreeRanges)
+	{
+		largest = std::max(largest, range.count);
+	}
+
+	return largest;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// First fit range allocator over the elements of a buffer, freed ranges are merged with their neighbours
+class GeometryAllocator
+{
+public:
+	static constexpr uint32_t INVALID_OFFSET = 0xFFFFFFFF;
+
+	GeometryAllocator(uint32_t capacity = 0);
+	virtual ~GeometryAllocator() = default;
+
+	// Forget every allocation and start again with this many elements free
+	void Reset(uint32_t capacity);
+
+	// Reserve a range, returns INVALID_OFFSET if no free range is large enough
+	uint32_t Allocate(uint32_t count);
+
+	// Give a range back
+	void Free(uint32_t offset, uint32_t count);
+
+	// Sizes in elements
+	inline uint32_t GetCapacity() const { return m_Capacity; }
+	inline uint32_t GetUsed() const { return m_Used; }
+	inline uint32_t GetFree() const { return m_Capacity - m_Used; }
+	uint32_t GetLargestFree() const;
+
+	// Number of separate free ranges, more than one means the free space is fragmented
+	inline uint32_t GetFreeRangeCount() const { return static_cast<uint32_t>(m_FreeRanges.size()); }
+
+private:
+	struct Range
+	{
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	// Sorted by offset
+	std::vector<Range> m_FreeRanges;
+	uint32_t m_Capacity = 0;
+	uint32_t m_Used = 0;
+};
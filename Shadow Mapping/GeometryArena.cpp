@@ -0,0 +1,215 @@
+#include "GeometryArena.h"
+#include "Renderer.h"
+#include "RenderDevice.h"
+#include "StateCacheRenderDevice.h"
+#include "UploadQueue.h"
+#include "Vertex.h"
+#include <algorithm>
+#include <iostream>
+
+GeometryArena::GeometryArena(Renderer* renderer, uint32_t vertex_capacity, uint32_t index_capacity) : m_Renderer(renderer)
+{
+	m_VertexAllocator.Reset(vertex_capacity);
+	m_IndexAllocator.Reset(index_capacity);
+	this->CreateBuffers(vertex_capacity, index_capacity, m_VertexBuffer, m_IndexBuffer);
+}
+
+void GeometryArena::CreateBuffers(uint32_t vertex_capacity, uint32_t index_capacity, ComPtr<ID3D11Buffer>& vertex_buffer, ComPtr<ID3D11Buffer>& index_buffer)
+{
+	ID3D11Device* device = m_Renderer->GetDevice();
+
+	// Create vertex buffer
+	D3D11_BUFFER_DESC vertexbuffer_desc = {};
+	vertexbuffer_desc.Usage = D3D11_USAGE_DEFAULT;
+	vertexbuffer_desc.ByteWidth = static_cast<UINT>(sizeof(Vertex) * vertex_capacity);
+	vertexbuffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+	DX::Check(device->CreateBuffer(&vertexbuffer_desc, nullptr, vertex_buffer.ReleaseAndGetAddressOf()));
+
+	// Create index buffer
+	D3D11_BUFFER_DESC index_buffer_desc = {};
+	index_buffer_desc.Usage = D3D11_USAGE_DEFAULT;
+	index_buffer_desc.ByteWidth = static_cast<UINT>(sizeof(UINT) * index_capacity);
+	index_buffer_desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+	DX::Check(device->CreateBuffer(&index_buffer_desc, nullptr, index_buffer.ReleaseAndGetAddressOf()));
+}
+
+GeometryMesh GeometryArena::AddMesh(const Vertex* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count)
+{
+	uint32_t base_vertex = m_VertexAllocator.Allocate(vertex_count);
+	uint32_t start_index = m_IndexAllocator.Allocate(index_count);
+
+	// Out of room, or only out of contiguous room, move everything into buffers that fit the mesh as well
+	if (base_vertex == GeometryAllocator::INVALID_OFFSET || start_index == GeometryAllocator::INVALID_OFFSET)
+	{
+		m_VertexAllocator.Free(base_vertex, vertex_count);
+		m_IndexAllocator.Free(start_index, index_count);
+
+		uint32_t vertex_capacity = m_VertexAllocator.GetCapacity();
+		while (vertex_capacity < m_VertexAllocator.GetUsed() + vertex_count)
+			vertex_capacity = std::max(vertex_capacity * 2, 1024u);
+
+		uint32_t index_capacity = m_IndexAllocator.GetCapacity();
+		while (index_capacity < m_IndexAllocator.GetUsed() + index_count)
+			index_capacity = std::max(index_capacity * 2, 1024u);
+
+		if (vertex_capacity != m_VertexAllocator.GetCapacity() || index_capacity != m_IndexAllocator.GetCapacity())
+			m_GrowCount++;
+
+		this->Compact(vertex_capacity, index_capacity);
+
+		base_vertex = m_VertexAllocator.Allocate(vertex_count);
+		start_index = m_IndexAllocator.Allocate(index_count);
+	}
+
+	GeometryMesh mesh = static_cast<GeometryMesh>(m_Meshes.size());
+	if (!m_FreeMeshes.empty())
+	{
+		mesh = m_FreeMeshes.back();
+		m_FreeMeshes.pop_back();
+	}
+	else
+	{
+		m_Meshes.push_back({});
+	}
+
+	MeshEntry& entry = m_Meshes[mesh];
+	entry.base_vertex = base_vertex;
+	entry.vertex_count = vertex_count;
+	entry.start_index = start_index;
+	entry.index_count = index_count;
+	entry.live = true;
+
+	// Queue the data, it is copied into the shared buffers in a batch at the start of a frame
+	UploadQueue* upload_queue = m_Renderer->GetUploadQueue();
+	upload_queue->QueueBuffer(m_VertexBuffer.Get(), static_cast<uint32_t>(base_vertex * sizeof(Vertex)), vertices, static_cast<uint32_t>(vertex_count * sizeof(Vertex)));
+	entry.upload_ticket = upload_queue->QueueBuffer(m_IndexBuffer.Get(), static_cast<uint32_t>(start_index * sizeof(UINT)), indices, static_cast<uint32_t>(index_count * sizeof(UINT)));
+
+	return mesh;
+}
+
+void GeometryArena::RemoveMesh(GeometryMesh mesh)
+{
+	if (mesh >= m_Meshes.size() || !m_Meshes[mesh].live)
+		return;
+
+	MeshEntry& entry = m_Meshes[mesh];
+	m_VertexAllocator.Free(entry.base_vertex, entry.vertex_count);
+	m_IndexAllocator.Free(entry.start_index, entry.index_count);
+
+	entry.live = false;
+	m_FreeMeshes.push_back(mesh);
+}
+
+bool GeometryArena::IsUploaded(GeometryMesh mesh) const
+{
+	return mesh < m_Meshes.size() && m_Meshes[mesh].live && m_Renderer->GetUploadQueue()->IsComplete(m_Meshes[mesh].upload_ticket);
+}
+
+void GeometryArena::Bind()
+{
+	RenderDevice* device = m_Renderer->GetRenderDevice();
+
+	// Bind the vertex buffer to the pipeline's Input Assembler stage
+	device->SetVertexBuffer(0, m_VertexBuffer.Get(), sizeof(Vertex), 0);
+
+	// Bind the index buffer to the pipeline's Input Assembler stage
+	device->SetIndexBuffer(m_IndexBuffer.Get(), IndexFormat::UInt32, 0);
+
+	// Bind the geometry topology to the pipeline's Input Assembler stage
+	device->SetPrimitiveTopology(PrimitiveTopology::TriangleList);
+}
+
+void GeometryArena::Draw(GeometryMesh mesh)
+{
+	const MeshEntry& entry = m_Meshes[mesh];
+	m_Renderer->GetRenderDevice()->DrawIndexed(entry.index_count, entry.start_index, static_cast<int32_t>(entry.base_vertex));
+}
+
+void GeometryArena::DrawInstanced(GeometryMesh mesh, uint32_t instance_count)
+{
+	const MeshEntry& entry = m_Meshes[mesh];
+	m_Renderer->GetRenderDevice()->DrawIndexedInstanced(entry.index_count, instance_count, entry.start_index, static_cast<int32_t>(entry.base_vertex), 0);
+}
+
+void GeometryArena::CompactIfFragmented()
+{
+	if (m_VertexAllocator.GetFreeRangeCount() > MAX_FREE_RANGES || m_IndexAllocator.GetFreeRangeCount() > MAX_FREE_RANGES)
+	{
+		this->Compact(m_VertexAllocator.GetCapacity(), m_IndexAllocator.GetCapacity());
+	}
+}
+
+void GeometryArena::Compact(uint32_t vertex_capacity, uint32_t index_capacity)
+{
+	// Queued uploads point at the old buffers, they have to land before the old buffers are copied
+	m_Renderer->FlushUploads();
+
+	ComPtr<ID3D11Buffer> vertex_buffer = nullptr;
+	ComPtr<ID3D11Buffer> index_buffer = nullptr;
+	this->CreateBuffers(vertex_capacity, index_capacity, vertex_buffer, index_buffer);
+
+	m_VertexAllocator.Reset(vertex_capacity);
+	m_IndexAllocator.Reset(index_capacity);
+
+	// Copy the live meshes in the order they were placed, so they are packed at the front of the new buffers
+	std::vector<GeometryMesh> order;
+	for (GeometryMesh mesh = 0; mesh < m_Meshes.size(); ++mesh)
+	{
+		if (m_Meshes[mesh].live)
+			order.push_back(mesh);
+	}
+
+	std::sort(order.begin(), order.end(), [this](GeometryMesh a, GeometryMesh b) { return m_Meshes[a].base_vertex < m_Meshes[b].base_vertex; });
+
+	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
+	for (GeometryMesh mesh : order)
+	{
+		MeshEntry& entry = m_Meshes[mesh];
+		uint32_t base_vertex = m_VertexAllocator.Allocate(entry.vertex_count);
+		uint32_t start_index = m_IndexAllocator.Allocate(entry.index_count);
+
+		D3D11_BOX vertex_box = { 0, 0, 0, 0, 1, 1 };
+		vertex_box.left = static_cast<UINT>(entry.base_vertex * sizeof(Vertex));
+		vertex_box.right = static_cast<UINT>((entry.base_vertex + entry.vertex_count) * sizeof(Vertex));
+		context->CopySubresourceRegion(vertex_buffer.Get(), 0, static_cast<UINT>(base_vertex * sizeof(Vertex)), 0, 0, m_VertexBuffer.Get(), 0, &vertex_box);
+
+		D3D11_BOX index_box = { 0, 0, 0, 0, 1, 1 };
+		index_box.left = static_cast<UINT>(entry.start_index * sizeof(UINT));
+		index_box.right = static_cast<UINT>((entry.start_index + entry.index_count) * sizeof(UINT));
+		context->CopySubresourceRegion(index_buffer.Get(), 0, static_cast<UINT>(start_index * sizeof(UINT)), 0, 0, m_IndexBuffer.Get(), 0, &index_box);
+
+		entry.base_vertex = base_vertex;
+		entry.start_index = start_index;
+	}
+
+	m_VertexBuffer = vertex_buffer;
+	m_IndexBuffer = index_buffer;
+	m_CompactionCount++;
+
+	// The old buffers may still be bound
+	m_Renderer->GetStateCache()->Invalidate();
+}
+
+GeometryArenaStats GeometryArena::GetStats() const
+{
+	GeometryArenaStats stats;
+	stats.mesh_count = static_cast<uint32_t>(m_Meshes.size() - m_FreeMeshes.size());
+	stats.vertex_used = m_VertexAllocator.GetUsed();
+	stats.vertex_capacity = m_VertexAllocator.GetCapacity();
+	stats.index_used = m_IndexAllocator.GetUsed();
+	stats.index_capacity = m_IndexAllocator.GetCapacity();
+	stats.free_range_count = m_VertexAllocator.GetFreeRangeCount() + m_IndexAllocator.GetFreeRangeCount();
+	stats.compaction_count = m_CompactionCount;
+	stats.grow_count = m_GrowCount;
+	return stats;
+}
+
+void GeometryArena::Print() const
+{
+	GeometryArenaStats stats = this->GetStats();
+	std::cout << "  Geometry arena: " << stats.mesh_count << " meshes, " << stats.vertex_used << " of " << stats.vertex_capacity << " vertices, "
+		<< stats.index_used << " of " << stats.index_capacity << " indices, " << stats.free_range_count << " free ranges, "
+		<< stats.compaction_count << " compactions, " << stats.grow_count << " grows\n";
+}
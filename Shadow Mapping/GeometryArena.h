@@ -0,0 +1,93 @@
+#pragma once
+
+#include "GeometryAllocator.h"
+#include <d3d11.h>
+#include <vector>
+
+// This include is requires for using DirectX smart pointers (ComPtr)
+#include <wrl\client.h>
+using Microsoft::WRL::ComPtr;
+
+class Renderer;
+struct Vertex;
+
+// Handle of a mesh in the arena
+typedef uint32_t GeometryMesh;
+const GeometryMesh INVALID_GEOMETRY_MESH = 0xFFFFFFFF;
+
+// Counters of the arena, sizes are in vertices and indices
+struct GeometryArenaStats
+{
+	uint32_t mesh_count = 0;
+	uint32_t vertex_used = 0;
+	uint32_t vertex_capacity = 0;
+	uint32_t index_used = 0;
+	uint32_t index_capacity = 0;
+	uint32_t free_range_count = 0;
+	uint32_t compaction_count = 0;
+	uint32_t grow_count = 0;
+};
+
+// Every static mesh shares one vertex buffer and one index buffer, so drawing any of them needs the same input assembler state.
+// Meshes are drawn with their base vertex and start index, and index from 0 within their own vertices.
+// Removing meshes leaves holes, which are closed by copying the live meshes into new buffers once the free space is fragmented
+class GeometryArena
+{
+	Renderer* m_Renderer = nullptr;
+
+public:
+	GeometryArena(Renderer* renderer, uint32_t vertex_capacity, uint32_t index_capacity);
+	virtual ~GeometryArena() = default;
+
+	// Free ranges allowed before the arena is compacted
+	static const uint32_t MAX_FREE_RANGES = 8;
+
+	// Copy a mesh into the arena, the data is uploaded through the renderer's upload queue
+	GeometryMesh AddMesh(const Vertex* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count);
+
+	// Give the mesh's ranges back, the handle can be reused by the next mesh
+	void RemoveMesh(GeometryMesh mesh);
+
+	// Check the mesh's data has reached the GPU
+	bool IsUploaded(GeometryMesh mesh) const;
+
+	// Bind the shared buffers, only the first bind of a frame reaches Direct3D when the state cache is on
+	void Bind();
+
+	// Draw a mesh, the arena must be bound
+	void Draw(GeometryMesh mesh);
+	void DrawInstanced(GeometryMesh mesh, uint32_t instance_count);
+
+	// Compact if removed meshes have left too many holes, must be called on the main thread outside of recording
+	void CompactIfFragmented();
+
+	// Move every mesh to the front of new buffers of this size
+	void Compact(uint32_t vertex_capacity, uint32_t index_capacity);
+
+	// Counters
+	GeometryArenaStats GetStats() const;
+	void Print() const;
+
+private:
+	struct MeshEntry
+	{
+		uint32_t base_vertex;
+		uint32_t vertex_count;
+		uint32_t start_index;
+		uint32_t index_count;
+		uint64_t upload_ticket;
+		bool live;
+	};
+
+	std::vector<MeshEntry> m_Meshes;
+	std::vector<GeometryMesh> m_FreeMeshes;
+
+	GeometryAllocator m_VertexAllocator;
+	GeometryAllocator m_IndexAllocator;
+	uint32_t m_CompactionCount = 0;
+	uint32_t m_GrowCount = 0;
+
+	ComPtr<ID3D11Buffer> m_VertexBuffer = nullptr;
+	ComPtr<ID3D11Buffer> m_IndexBuffer = nullptr;
+	void CreateBuffers(uint32_t vertex_capacity, uint32_t index_capacity, ComPtr<ID3D11Buffer>& vertex_buffer, ComPtr<ID3D11Buffer>& index_buffer);
+};
@@ -0,0 +1,50 @@
+#include "InstanceBuffer.h"
+#include "Renderer.h"
+#include "RenderDevice.h"
+
+InstanceBuffer::InstanceBuffer(Renderer* renderer) : m_Renderer(renderer)
+{
+}
+
+void InstanceBuffer::Update(const std::vector<InstanceData>& instances)
+{
+	m_InstanceCount = static_cast<uint32_t>(instances.size());
+	if (m_InstanceCount == 0)
+		return;
+
+	// Grow to the next power of two so a slowly growing scene doesn't recreate the buffer every frame
+	if (m_InstanceCount > m_Capacity)
+	{
+		uint32_t capacity = 64;
+		while (capacity < m_InstanceCount)
+		{
+			capacity *= 2;
+		}
+
+		this->CreateBuffer(capacity);
+	}
+
+	// Discard the previous contents, the driver hands back a fresh region if the GPU is still reading the old one
+	RenderDevice* device = m_Renderer->GetRenderDevice();
+	device->UpdateDynamicBuffer(m_Buffer.Get(), instances.data(), static_cast<uint32_t>(instances.size() * sizeof(InstanceData)));
+}
+
+void InstanceBuffer::Bind(uint32_t slot)
+{
+	m_Renderer->GetRenderDevice()->SetVertexBuffer(slot, m_Buffer.Get(), sizeof(InstanceData), 0);
+}
+
+void InstanceBuffer::CreateBuffer(uint32_t capacity)
+{
+	ID3D11Device* device = m_Renderer->GetDevice();
+
+	// Create instance buffer
+	D3D11_BUFFER_DESC buffer_desc = {};
+	buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
+	buffer_desc.ByteWidth = static_cast<UINT>(sizeof(InstanceData) * capacity);
+	buffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	DX::Check(device->CreateBuffer(&buffer_desc, nullptr, m_Buffer.ReleaseAndGetAddressOf()));
+	m_Capacity = capacity;
+}
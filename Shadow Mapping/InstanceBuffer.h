@@ -0,0 +1,47 @@
+#pragma once
+
+#include <d3d11.h>
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+// This include is requires for using DirectX smart pointers (ComPtr)
+#include <wrl\client.h>
+using Microsoft::WRL::ComPtr;
+
+class Renderer;
+
+// Per instance vertex data, the matrices are stored untransposed and read as rows by the input layout
+struct InstanceData
+{
+	XMFLOAT4X4 model;
+	XMFLOAT4X4 model_inverse;
+};
+
+// Dynamic vertex buffer holding the transforms of every instance of a draw
+class InstanceBuffer
+{
+	Renderer* m_Renderer = nullptr;
+
+public:
+	InstanceBuffer(Renderer* renderer);
+	virtual ~InstanceBuffer() = default;
+
+	// Upload the instances, the buffer grows if it is too small
+	void Update(const std::vector<InstanceData>& instances);
+
+	// Bind the buffer to the given input assembler slot
+	void Bind(uint32_t slot);
+
+	// Number of instances from the last update
+	inline uint32_t GetInstanceCount() const { return m_InstanceCount; }
+
+private:
+	ComPtr<ID3D11Buffer> m_Buffer = nullptr;
+	uint32_t m_Capacity = 0;
+	uint32_t m_InstanceCount = 0;
+
+	// Create the buffer with room for at least this many instances
+	void CreateBuffer(uint32_t capacity);
+};
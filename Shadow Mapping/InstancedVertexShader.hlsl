@@ -0,0 +1,32 @@
+#include "ShaderData.hlsli"
+
+// Entry point for the instanced vertex shader - the model transform comes from the instance buffer instead of the constant buffer
+PixelInput main(InstancedVertexInput input)
+{
+    PixelInput pixel_input;
+
+    // Rebuild the instance transforms
+    matrix model_transform = matrix(input.model0, input.model1, input.model2, input.model3);
+    matrix model_transform_inverse = matrix(input.model_inverse0, input.model_inverse1, input.model_inverse2, input.model_inverse3);
+
+	// Transform to homogeneous clip space
+    pixel_input.positionClipSpace = mul(float4(input.position, 1.0f), model_transform);
+    pixel_input.positionClipSpace = mul(pixel_input.positionClipSpace, cCameraView);
+    pixel_input.positionClipSpace = mul(pixel_input.positionClipSpace, cCameraProjection);
+
+    // Transform to world space.
+    pixel_input.position = input.position;
+
+    // Transform the normals by the inverse world space
+    pixel_input.normal = mul(input.normal, (float3x3) model_transform_inverse).xyz;
+
+    // Pass UV
+    pixel_input.uv = input.uv;
+
+    // World position and depth in the cascade view - used to pick a cascade and sample the shadow map
+    float4 world_position = mul(float4(input.position, 1.0f), model_transform);
+    pixel_input.worldPosition = world_position.xyz;
+    pixel_input.cascadeDepth = mul(world_position, cCascadeView).z;
+
+    return pixel_input;
+}
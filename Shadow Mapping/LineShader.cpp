@@ -1,5 +1,6 @@
 #include "LineShader.h"
 #include "Renderer.h"
+#include "RenderDevice.h"
 
 #include <Windows.h>
 
@@ -39,26 +40,26 @@ void LineShader::Load()
 
 void LineShader::Use()
 {
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
+	RenderDevice* device = m_Renderer->GetRenderDevice();
 
 	// Bind the input layout to the pipeline's Input Assembler stage
-	context->IASetInputLayout(m_VertexLayout.Get());
+	device->SetInputLayout(m_VertexLayout.Get());
 
 	// Bind the vertex shader to the pipeline's Vertex Shader stage
-	context->VSSetShader(m_VertexShader.Get(), nullptr, 0);
+	device->SetVertexShader(m_VertexShader.Get());
 
 	// Bind the pixel shader to the pipeline's Pixel Shader stage
-	context->PSSetShader(m_PixelShader.Get(), nullptr, 0);
+	device->SetPixelShader(m_PixelShader.Get());
 
 	// Bind the world constant buffer to the vertex and pixel shader
 	const int constant_buffer_slot = 0;
-	context->VSSetConstantBuffers(constant_buffer_slot, 1, m_ModelConstantBuffer.GetAddressOf());
-	context->PSSetConstantBuffers(constant_buffer_slot, 1, m_ModelConstantBuffer.GetAddressOf());
+	device->SetVertexConstantBuffer(constant_buffer_slot, m_ModelConstantBuffer.Get());
+	device->SetPixelConstantBuffer(constant_buffer_slot, m_ModelConstantBuffer.Get());
 
 	// Bind the camera constant buffer to the vertex and pixel shader
 	const int camera_buffer_slot = 1;
-	context->VSSetConstantBuffers(camera_buffer_slot, 1, m_CameraConstantBuffer.GetAddressOf());
-	context->PSSetConstantBuffers(camera_buffer_slot, 1, m_CameraConstantBuffer.GetAddressOf());
+	device->SetVertexConstantBuffer(camera_buffer_slot, m_CameraConstantBuffer.Get());
+	device->SetPixelConstantBuffer(camera_buffer_slot, m_CameraConstantBuffer.Get());
 }
 
 void LineShader::LoadVertexShader()
@@ -116,8 +117,7 @@ void LineShader::UpdateModelBuffer(const XMMATRIX& transform)
 	ModelBuffer buffer = {};
 	buffer.model = XMMatrixTranspose(transform);
 
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
-	context->UpdateSubresource(m_ModelConstantBuffer.Get(), 0, nullptr, &buffer, 0, 0);
+	m_Renderer->GetRenderDevice()->UpdateBuffer(m_ModelConstantBuffer.Get(), &buffer, sizeof(buffer));
 }
 
 void LineShader::UpdateCameraBuffer(const XMMATRIX& view, const XMMATRIX& projection, const XMFLOAT3& position)
@@ -127,6 +127,5 @@ void LineShader::UpdateCameraBuffer(const XMMATRIX& view, const XMMATRIX& projec
 	buffer.view = XMMatrixTranspose(view);
 	buffer.position = XMFLOAT4(position.x, position.y, position.z, 1.0f);
 
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
-	context->UpdateSubresource(m_CameraConstantBuffer.Get(), 0, nullptr, &buffer, 0, 0);
+	m_Renderer->GetRenderDevice()->UpdateBuffer(m_CameraConstantBuffer.Get(), &buffer, sizeof(buffer));
 }
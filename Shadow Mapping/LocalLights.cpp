@@ -0,0 +1,142 @@
+#include "LocalLights.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Shadow depth starts a little in front of the light, a closer near plane wastes the depth precision
+	const float SHADOW_NEAR_PLANE = 0.5f;
+
+	// Cube face directions and up vectors, in the order the pixel shader picks them
+	const XMFLOAT3 CUBE_FACE_DIRECTIONS[MAX_SHADOW_LIGHT_FACES] =
+	{
+		XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f),
+		XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 0.0f, -1.0f),
+	};
+
+	const XMFLOAT3 CUBE_FACE_UPS[MAX_SHADOW_LIGHT_FACES] =
+	{
+		XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, -1.0f),
+		XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f),
+	};
+}
+
+void LocalLights::Add(const LocalLight& light)
+{
+	if (m_Lights.size() >= MAX_LOCAL_LIGHTS)
+		return;
+
+	m_LightTree.Insert(static_cast<uint32_t>(m_Lights.size()), light.position, XMFLOAT3(light.range, light.range, light.range));
+	m_Lights.push_back(light);
+	m_FirstShadowViews.push_back(-1);
+}
+
+void LocalLights::Clear()
+{
+	m_Lights.clear();
+	m_FirstShadowViews.clear();
+	m_LightTree.Clear();
+}
+
+void LocalLights::Invalidate()
+{
+	m_RedrawAll = true;
+}
+
+void LocalLights::InvalidateBox(const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+	m_ChangedBoxes.push_back({ center, extents });
+}
+
+void LocalLights::Update(const XMMATRIX& camera_view, const XMMATRIX& camera_projection)
+{
+	// Only lights reaching into the camera's frustum can cast visible shadows
+	CullingFrustum camera_frustum = CullingFrustum::FromViewProjection(camera_view * camera_projection);
+
+	// Lights are requested in index order, so the atlas sees the same order every frame
+	m_LightTree.QueryFrustum(camera_frustum, m_VisibleLights);
+	std::sort(m_VisibleLights.begin(), m_VisibleLights.end());
+
+	m_Requests.clear();
+	for (uint32_t i : m_VisibleLights)
+	{
+		const LocalLight& light = m_Lights[i];
+
+		ShadowAtlasRequest request;
+		request.light_id = i;
+		request.type = light.type;
+		request.importance = ShadowAtlas::CalculateImportance(light.position, light.range, camera_view, camera_projection);
+		if (request.importance > 0.0f)
+		{
+			m_Requests.push_back(request);
+		}
+	}
+
+	m_Atlas.Update(m_Requests);
+
+	// A view per tile, lights that would go past the most views the shaders take are left unshadowed
+	m_ShadowViews.clear();
+	m_RedrawCount = 0;
+	for (uint32_t i = 0; i < m_Lights.size(); ++i)
+	{
+		// A light left without views last frame wasn't rendered into its tile
+		bool had_views = m_FirstShadowViews[i] >= 0;
+		m_FirstShadowViews[i] = -1;
+
+		const ShadowAtlasAllocation* allocation = m_Atlas.GetAllocation(i);
+		if (allocation == nullptr || m_ShadowViews.size() + allocation->face_count > MAX_LOCAL_SHADOW_VIEWS)
+			continue;
+
+		bool redraw_light = m_RedrawAll || allocation->moved || !had_views;
+
+		m_FirstShadowViews[i] = static_cast<int32_t>(m_ShadowViews.size());
+		for (uint32_t face = 0; face < allocation->face_count; ++face)
+		{
+			this->AddShadowView(m_Lights[i], face, allocation->faces[face]);
+
+			// Faces of a kept tile only need rendering again if something changed in front of them
+			LocalShadowView& shadow_view = m_ShadowViews.back();
+			shadow_view.redraw = redraw_light;
+			for (size_t j = 0; j < m_ChangedBoxes.size() && !shadow_view.redraw; ++j)
+			{
+				shadow_view.redraw = shadow_view.frustum.IntersectsBox(m_ChangedBoxes[j].center, m_ChangedBoxes[j].extents);
+			}
+
+			if (shadow_view.redraw)
+			{
+				m_RedrawCount++;
+			}
+		}
+	}
+
+	m_RedrawAll = false;
+	m_ChangedBoxes.clear();
+}
+
+void LocalLights::AddShadowView(const LocalLight& light, uint32_t face, const ShadowAtlasTile& tile)
+{
+	XMVECTOR position = XMLoadFloat3(&light.position);
+
+	XMMATRIX view;
+	XMMATRIX projection;
+	if (light.type == ShadowLightType::Point)
+	{
+		// Each face covers exactly a quarter turn so the faces meet at the edges
+		view = XMMatrixLookToLH(position, XMLoadFloat3(&CUBE_FACE_DIRECTIONS[face]), XMLoadFloat3(&CUBE_FACE_UPS[face]));
+		projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, SHADOW_NEAR_PLANE, light.range);
+	}
+	else
+	{
+		XMVECTOR direction = XMVector3Normalize(XMLoadFloat3(&light.direction));
+		XMVECTOR up = (std::fabs(XMVectorGetY(direction)) > 0.99f) ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+		view = XMMatrixLookToLH(position, direction, up);
+		projection = XMMatrixPerspectiveFovLH(light.spot_angle * 2.0f, 1.0f, SHADOW_NEAR_PLANE, light.range);
+	}
+
+	LocalShadowView shadow_view;
+	XMStoreFloat4x4(&shadow_view.view, view);
+	XMStoreFloat4x4(&shadow_view.projection, projection);
+	shadow_view.tile = tile;
+	shadow_view.frustum = CullingFrustum::FromViewProjection(view * projection);
+	m_ShadowViews.push_back(shadow_view);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+#include "FrustumCuller.h"
+#include "LooseOctree.h"
+#include "ShadowAtlas.h"
+
+// Most local lights and shadow views the shaders take, a point light uses a view per cube face
+const uint32_t MAX_LOCAL_LIGHTS = 32;
+const uint32_t MAX_LOCAL_SHADOW_VIEWS = 96;
+
+// A point or spot light, spot lights shine along their direction inside a cone of twice the spot angle
+struct LocalLight
+{
+	ShadowLightType type = ShadowLightType::Point;
+	XMFLOAT3 position = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	XMFLOAT3 direction = XMFLOAT3(0.0f, -1.0f, 0.0f);
+	XMFLOAT3 colour = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	float range = 10.0f;
+	float spot_angle = XM_PIDIV4;
+};
+
+// One depth render of a local light into its atlas tile
+struct LocalShadowView
+{
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 projection;
+	ShadowAtlasTile tile;
+	CullingFrustum frustum;
+
+	// The tile's depth from earlier frames is out of date and has to be cleared and rendered again
+	bool redraw = true;
+};
+
+// The scene's local lights and the shadow views of the ones given atlas tiles
+// Each frame the lights touching the camera's frustum ask the atlas for tiles sized by how much of the screen they cover.
+// A tile keeps its depth between frames and is only rendered again when it moved, its light had no views last frame, or
+// something that changed since the last frame is inside its view
+class LocalLights
+{
+public:
+	LocalLights() = default;
+	virtual ~LocalLights() = default;
+
+	// Lights past MAX_LOCAL_LIGHTS are ignored
+	void Add(const LocalLight& light);
+	void Clear();
+
+	// Every tile is rendered again by the next update, for when the static casters change
+	void Invalidate();
+
+	// Tiles whose view touches the box are rendered again by the next update, for casters that moved from or to it
+	void InvalidateBox(const XMFLOAT3& center, const XMFLOAT3& extents);
+
+	// Assign atlas tiles from the camera's view then build the view and projection of every tile
+	void Update(const XMMATRIX& camera_view, const XMMATRIX& camera_projection);
+
+	inline const std::vector<LocalLight>& GetLights() const { return m_Lights; }
+	inline const std::vector<LocalShadowView>& GetShadowViews() const { return m_ShadowViews; }
+
+	// Index of a light's first shadow view, the faces of a point light follow in +X, -X, +Y, -Y, +Z, -Z order, -1 if it has no shadows
+	inline int32_t GetFirstShadowView(uint32_t light) const { return m_FirstShadowViews[light]; }
+
+	inline const ShadowAtlas& GetAtlas() const { return m_Atlas; }
+
+	// Shadow views that have to be rendered this frame
+	inline uint32_t GetRedrawCount() const { return m_RedrawCount; }
+
+private:
+	std::vector<LocalLight> m_Lights;
+	std::vector<int32_t> m_FirstShadowViews;
+
+	// Light ranges as boxes, so only the lights near the camera are looked at
+	LooseOctree m_LightTree = LooseOctree(XMFLOAT3(0.0f, 0.0f, 0.0f), 512.0f, 6);
+	std::vector<uint32_t> m_VisibleLights;
+
+	ShadowAtlas m_Atlas;
+	std::vector<ShadowAtlasRequest> m_Requests;
+	std::vector<LocalShadowView> m_ShadowViews;
+
+	// What changed since the last update
+	struct ChangedBox
+	{
+		XMFLOAT3 center;
+		XMFLOAT3 extents;
+	};
+
+	bool m_RedrawAll = true;
+	std::vector<ChangedBox> m_ChangedBoxes;
+	uint32_t m_RedrawCount = 0;
+
+	// View and projection of a light's face
+	void AddShadowView(const LocalLight& light, uint32_t face, const ShadowAtlasTile& tile);
+};
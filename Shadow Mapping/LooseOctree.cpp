@@ -0,0 +1,708 @@
+#include "LooseOctree.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "../External/SimdLanes.h"
+
+namespace
+{
+	using namespace Simd;
+
+	// Direction of each child's center from its parent's, in octant order
+	const float OCTANT_X[8] = { -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f };
+	const float OCTANT_Y[8] = { -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f };
+	const float OCTANT_Z[8] = { -1.0f, -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+
+	// Deepest the traversal stack gets, each level pops one node and pushes up to eight
+	const uint32_t STACK_SIZE = MAX_OCTREE_DEPTH * 8 + 8;
+
+	// Bounds of one object
+	struct Bounds
+	{
+		float center_x, center_y, center_z;
+		float extent_x, extent_y, extent_z;
+	};
+
+	// A query tests the eight children of a node, a child's loose half size is its parent's half size,
+	// the lanes set in inside are children entirely inside the volume
+	struct FrustumTest
+	{
+		const CullingFrustum& frustum;
+
+		uint32_t TestChildren(const XMFLOAT3& center, float child_half_size, uint32_t& inside) const
+		{
+			float loose_half_size = child_half_size * 2.0f;
+
+			uint32_t overlap = 0;
+			inside = 0;
+			for (uint32_t first = 0; first < 8; first += LANE_COUNT)
+			{
+				Lanes octant_x = Load(&OCTANT_X[first]);
+				Lanes octant_y = Load(&OCTANT_Y[first]);
+				Lanes octant_z = Load(&OCTANT_Z[first]);
+
+				uint32_t lanes_overlap = ALL_LANES;
+				uint32_t lanes_inside = ALL_LANES;
+				for (int p = 0; p < 6 && lanes_overlap != 0; ++p)
+				{
+					// Distance of each child's center from the plane, then its box projected onto the normal
+					const XMFLOAT4& plane = frustum.planes[p];
+					float parent_distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+					float radius = (std::fabs(plane.x) + std::fabs(plane.y) + std::fabs(plane.z)) * loose_half_size;
+
+					Lanes d = MultiplyAdd(octant_x, Splat(plane.x * child_half_size), Splat(parent_distance));
+					d = MultiplyAdd(octant_y, Splat(plane.y * child_half_size), d);
+					d = MultiplyAdd(octant_z, Splat(plane.z * child_half_size), d);
+
+					lanes_overlap &= NotNegativeMask(Add(d, Splat(radius)));
+					lanes_inside &= NotNegativeMask(Subtract(d, Splat(radius)));
+				}
+
+				overlap |= lanes_overlap << first;
+				inside |= (lanes_overlap & lanes_inside) << first;
+			}
+
+			return overlap;
+		}
+
+		bool TestObject(const Bounds& bounds) const
+		{
+			return frustum.IntersectsBox(XMFLOAT3(bounds.center_x, bounds.center_y, bounds.center_z), XMFLOAT3(bounds.extent_x, bounds.extent_y, bounds.extent_z));
+		}
+	};
+
+	struct SphereTest
+	{
+		XMFLOAT3 center;
+		float radius;
+
+		uint32_t TestChildren(const XMFLOAT3& parent_center, float child_half_size, uint32_t& inside) const
+		{
+			Lanes loose_half_size = Splat(child_half_size * 2.0f);
+			Lanes radius_squared = Splat(radius * radius);
+			Lanes zero = Splat(0.0f);
+
+			uint32_t overlap = 0;
+			inside = 0;
+			for (uint32_t first = 0; first < 8; first += LANE_COUNT)
+			{
+				// Distance along each axis from the sphere's center to the children's centers
+				Lanes dx = Abs(MultiplyAdd(Load(&OCTANT_X[first]), Splat(child_half_size), Splat(parent_center.x - center.x)));
+				Lanes dy = Abs(MultiplyAdd(Load(&OCTANT_Y[first]), Splat(child_half_size), Splat(parent_center.y - center.y)));
+				Lanes dz = Abs(MultiplyAdd(Load(&OCTANT_Z[first]), Splat(child_half_size), Splat(parent_center.z - center.z)));
+
+				// Closest point of the box is within the radius
+				Lanes nearest_x = Max(Subtract(dx, loose_half_size), zero);
+				Lanes nearest_y = Max(Subtract(dy, loose_half_size), zero);
+				Lanes nearest_z = Max(Subtract(dz, loose_half_size), zero);
+				Lanes nearest = MultiplyAdd(nearest_x, nearest_x, MultiplyAdd(nearest_y, nearest_y, Multiply(nearest_z, nearest_z)));
+
+				// Furthest corner of the box is within the radius
+				Lanes furthest_x = Add(dx, loose_half_size);
+				Lanes furthest_y = Add(dy, loose_half_size);
+				Lanes furthest_z = Add(dz, loose_half_size);
+				Lanes furthest = MultiplyAdd(furthest_x, furthest_x, MultiplyAdd(furthest_y, furthest_y, Multiply(furthest_z, furthest_z)));
+
+				overlap |= LessEqualMask(nearest, radius_squared) << first;
+				inside |= LessEqualMask(furthest, radius_squared) << first;
+			}
+
+			return overlap;
+		}
+
+		bool TestObject(const Bounds& bounds) const
+		{
+			float x = std::max(std::fabs(bounds.center_x - center.x) - bounds.extent_x, 0.0f);
+			float y = std::max(std::fabs(bounds.center_y - center.y) - bounds.extent_y, 0.0f);
+			float z = std::max(std::fabs(bounds.center_z - center.z) - bounds.extent_z, 0.0f);
+			return x * x + y * y + z * z <= radius * radius;
+		}
+	};
+
+	struct BoxTest
+	{
+		XMFLOAT3 center;
+		XMFLOAT3 extents;
+
+		uint32_t TestChildren(const XMFLOAT3& parent_center, float child_half_size, uint32_t& inside) const
+		{
+			float loose_half_size = child_half_size * 2.0f;
+
+			uint32_t overlap = 0;
+			inside = 0;
+			for (uint32_t first = 0; first < 8; first += LANE_COUNT)
+			{
+				Lanes dx = Abs(MultiplyAdd(Load(&OCTANT_X[first]), Splat(child_half_size), Splat(parent_center.x - center.x)));
+				Lanes dy = Abs(MultiplyAdd(Load(&OCTANT_Y[first]), Splat(child_half_size), Splat(parent_center.y - center.y)));
+				Lanes dz = Abs(MultiplyAdd(Load(&OCTANT_Z[first]), Splat(child_half_size), Splat(parent_center.z - center.z)));
+
+				// Overlapping on every axis, then entirely inside on every axis
+				uint32_t lanes_overlap = LessEqualMask(dx, Splat(loose_half_size + extents.x)) & LessEqualMask(dy, Splat(loose_half_size + extents.y)) &
+					LessEqualMask(dz, Splat(loose_half_size + extents.z));
+				uint32_t lanes_inside = LessEqualMask(dx, Splat(extents.x - loose_half_size)) & LessEqualMask(dy, Splat(extents.y - loose_half_size)) &
+					LessEqualMask(dz, Splat(extents.z - loose_half_size));
+
+				overlap |= lanes_overlap << first;
+				inside |= lanes_inside << first;
+			}
+
+			return overlap;
+		}
+
+		bool TestObject(const Bounds& bounds) const
+		{
+			return std::fabs(bounds.center_x - center.x) <= bounds.extent_x + extents.x && std::fabs(bounds.center_y - center.y) <= bounds.extent_y + extents.y &&
+				std::fabs(bounds.center_z - center.z) <= bounds.extent_z + extents.z;
+		}
+	};
+
+	// Ray with its direction inverted for the slab tests, zero components are nudged so nothing divides by zero
+	struct Ray
+	{
+		XMFLOAT3 origin;
+		XMFLOAT3 inverse_direction;
+		float max_distance;
+
+		Ray(const XMFLOAT3& ray_origin, const XMFLOAT3& direction, float ray_max_distance) : origin(ray_origin), max_distance(ray_max_distance)
+		{
+			auto invert = [](float value)
+			{
+				const float epsilon = 1e-12f;
+				return 1.0f / ((std::fabs(value) < epsilon) ? (value < 0.0f ? -epsilon : epsilon) : value);
+			};
+
+			inverse_direction = XMFLOAT3(invert(direction.x), invert(direction.y), invert(direction.z));
+		}
+
+		// Distance the ray enters each child, returns the children it enters before the max distance
+		uint32_t TestChildren(const XMFLOAT3& parent_center, float child_half_size, float entry[8]) const
+		{
+			Lanes loose_half_size = Splat(child_half_size * 2.0f);
+
+			uint32_t hit = 0;
+			for (uint32_t first = 0; first < 8; first += LANE_COUNT)
+			{
+				Lanes near_distance = Splat(0.0f);
+				Lanes far_distance = Splat(max_distance);
+
+				// Entering and leaving each pair of planes
+				const float* octants[3] = { &OCTANT_X[first], &OCTANT_Y[first], &OCTANT_Z[first] };
+				const float parent[3] = { parent_center.x - origin.x, parent_center.y - origin.y, parent_center.z - origin.z };
+				const float inverse[3] = { inverse_direction.x, inverse_direction.y, inverse_direction.z };
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					Lanes offset = MultiplyAdd(Load(octants[axis]), Splat(child_half_size), Splat(parent[axis]));
+					Lanes low = Multiply(Subtract(offset, loose_half_size), Splat(inverse[axis]));
+					Lanes high = Multiply(Add(offset, loose_half_size), Splat(inverse[axis]));
+					near_distance = Max(near_distance, Min(low, high));
+					far_distance = Min(far_distance, Max(low, high));
+				}
+
+				Store(&entry[first], near_distance);
+				hit |= LessEqualMask(near_distance, far_distance) << first;
+			}
+
+			return hit;
+		}
+
+		// Distance the ray enters an object, negative if it misses
+		float TestObject(const Bounds& bounds) const
+		{
+			float near_distance = 0.0f;
+			float far_distance = max_distance;
+
+			const float center[3] = { bounds.center_x - origin.x, bounds.center_y - origin.y, bounds.center_z - origin.z };
+			const float extent[3] = { bounds.extent_x, bounds.extent_y, bounds.extent_z };
+			const float inverse[3] = { inverse_direction.x, inverse_direction.y, inverse_direction.z };
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float low = (center[axis] - extent[axis]) * inverse[axis];
+				float high = (center[axis] + extent[axis]) * inverse[axis];
+				near_distance = std::max(near_distance, std::min(low, high));
+				far_distance = std::min(far_distance, std::max(low, high));
+			}
+
+			return (near_distance <= far_distance) ? near_distance : -1.0f;
+		}
+	};
+}
+
+LooseOctree::LooseOctree(const XMFLOAT3& center, float half_size, uint32_t max_depth)
+	: m_RootCenter(center), m_RootHalfSize(half_size), m_MaxDepth(std::min(max_depth, MAX_OCTREE_DEPTH))
+{
+	this->Clear();
+}
+
+void LooseOctree::Clear()
+{
+	m_Nodes.resize(1);
+	m_FreeBlocks.clear();
+
+	Node& root = m_Nodes[0];
+	root.center = m_RootCenter;
+	root.half_size = m_RootHalfSize;
+	root.depth = 0;
+	root.parent = INVALID_INDEX;
+	root.first_child = INVALID_INDEX;
+	root.subtree_count = 0;
+	root.objects.clear();
+
+	m_Objects.clear();
+	m_Count = 0;
+
+	m_CenterX.clear();
+	m_CenterY.clear();
+	m_CenterZ.clear();
+	m_ExtentX.clear();
+	m_ExtentY.clear();
+	m_ExtentZ.clear();
+}
+
+void LooseOctree::Insert(uint32_t id, const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+	if (id < m_Objects.size() && m_Objects[id].node != INVALID_INDEX)
+	{
+		this->Move(id, center, extents);
+		return;
+	}
+
+	// Ids are indices, so the arrays grow to the largest one
+	if (id >= m_Objects.size())
+	{
+		size_t size = static_cast<size_t>(id) + 1;
+		m_Objects.resize(size);
+		m_CenterX.resize(size);
+		m_CenterY.resize(size);
+		m_CenterZ.resize(size);
+		m_ExtentX.resize(size);
+		m_ExtentY.resize(size);
+		m_ExtentZ.resize(size);
+	}
+
+	m_CenterX[id] = center.x;
+	m_CenterY[id] = center.y;
+	m_CenterZ[id] = center.z;
+	m_ExtentX[id] = extents.x;
+	m_ExtentY[id] = extents.y;
+	m_ExtentZ[id] = extents.z;
+
+	this->Link(id);
+	++m_Count;
+}
+
+void LooseOctree::Move(uint32_t id, const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+	if (id >= m_Objects.size() || m_Objects[id].node == INVALID_INDEX)
+	{
+		this->Insert(id, center, extents);
+		return;
+	}
+
+	m_CenterX[id] = center.x;
+	m_CenterY[id] = center.y;
+	m_CenterZ[id] = center.z;
+	m_ExtentX[id] = extents.x;
+	m_ExtentY[id] = extents.y;
+	m_ExtentZ[id] = extents.z;
+
+	// Small moves stay inside the same cell and only update the bounds, as long as the object still fits and no child would take it
+	const Node& node = m_Nodes[m_Objects[id].node];
+	uint32_t target_depth = this->GetTargetDepth(center, extents);
+	bool inside_cell = std::fabs(center.x - node.center.x) <= node.half_size && std::fabs(center.y - node.center.y) <= node.half_size &&
+		std::fabs(center.z - node.center.z) <= node.half_size;
+
+	if (node.depth <= target_depth && (inside_cell || node.depth == 0) && (node.depth == target_depth || node.first_child == INVALID_INDEX))
+		return;
+
+	this->Unlink(id);
+	this->Link(id);
+}
+
+void LooseOctree::Remove(uint32_t id)
+{
+	if (id >= m_Objects.size() || m_Objects[id].node == INVALID_INDEX)
+		return;
+
+	this->Unlink(id);
+	--m_Count;
+}
+
+uint32_t LooseOctree::GetTargetDepth(const XMFLOAT3& center, const XMFLOAT3& extents) const
+{
+	// Objects centered outside the root can't go down any cell
+	if (std::fabs(center.x - m_RootCenter.x) > m_RootHalfSize || std::fabs(center.y - m_RootCenter.y) > m_RootHalfSize ||
+		std::fabs(center.z - m_RootCenter.z) > m_RootHalfSize)
+	{
+		return 0;
+	}
+
+	// A node's loose bounds hold anything centered in its cell no bigger than the cell, so go down while the child's cell is big enough
+	float largest_extent = std::max(extents.x, std::max(extents.y, extents.z));
+	float half_size = m_RootHalfSize;
+	uint32_t depth = 0;
+	while (depth < m_MaxDepth && half_size * 0.5f >= largest_extent)
+	{
+		half_size *= 0.5f;
+		++depth;
+	}
+
+	return depth;
+}
+
+void LooseOctree::Link(uint32_t id)
+{
+	XMFLOAT3 center(m_CenterX[id], m_CenterY[id], m_CenterZ[id]);
+	XMFLOAT3 extents(m_ExtentX[id], m_ExtentY[id], m_ExtentZ[id]);
+	uint32_t target_depth = this->GetTargetDepth(center, extents);
+
+	// Follow the center down, a leaf only splits once it is full
+	uint32_t node = 0;
+	while (m_Nodes[node].depth < target_depth)
+	{
+		if (m_Nodes[node].first_child == INVALID_INDEX)
+		{
+			if (m_Nodes[node].objects.size() < OCTREE_NODE_CAPACITY)
+				break;
+
+			this->Split(node);
+		}
+
+		const Node& parent = m_Nodes[node];
+		uint32_t octant = (center.x >= parent.center.x ? 1 : 0) | (center.y >= parent.center.y ? 2 : 0) | (center.z >= parent.center.z ? 4 : 0);
+		node = parent.first_child + octant;
+	}
+
+	Node& leaf = m_Nodes[node];
+	m_Objects[id].node = node;
+	m_Objects[id].slot = static_cast<uint32_t>(leaf.objects.size());
+	leaf.objects.push_back(id);
+
+	for (uint32_t parent = node; parent != INVALID_INDEX; parent = m_Nodes[parent].parent)
+	{
+		++m_Nodes[parent].subtree_count;
+	}
+}
+
+void LooseOctree::Unlink(uint32_t id)
+{
+	Object& object = m_Objects[id];
+	Node& node = m_Nodes[object.node];
+
+	// Swap the last object into the removed one's slot
+	uint32_t last = node.objects.back();
+	node.objects[object.slot] = last;
+	m_Objects[last].slot = object.slot;
+	node.objects.pop_back();
+
+	for (uint32_t parent = object.node; parent != INVALID_INDEX; parent = m_Nodes[parent].parent)
+	{
+		--m_Nodes[parent].subtree_count;
+	}
+
+	// Free children left empty, stopping at the first node that still has objects below it
+	for (uint32_t parent = object.node; parent != INVALID_INDEX; parent = m_Nodes[parent].parent)
+	{
+		Node& current = m_Nodes[parent];
+		if (current.subtree_count != current.objects.size())
+			break;
+
+		if (current.first_child != INVALID_INDEX)
+		{
+			this->FreeChildren(parent);
+		}
+	}
+
+	object.node = INVALID_INDEX;
+}
+
+uint32_t LooseOctree::AllocateChildren(uint32_t parent)
+{
+	uint32_t block = 0;
+	if (!m_FreeBlocks.empty())
+	{
+		block = m_FreeBlocks.back();
+		m_FreeBlocks.pop_back();
+	}
+	else
+	{
+		block = static_cast<uint32_t>(m_Nodes.size());
+		m_Nodes.resize(m_Nodes.size() + 8);
+	}
+
+	// Children split the parent's cell in half along each axis
+	Node& parent_node = m_Nodes[parent];
+	float child_half_size = parent_node.half_size * 0.5f;
+	for (uint32_t octant = 0; octant < 8; ++octant)
+	{
+		Node& child = m_Nodes[block + octant];
+		child.center = XMFLOAT3(parent_node.center.x + OCTANT_X[octant] * child_half_size, parent_node.center.y + OCTANT_Y[octant] * child_half_size,
+			parent_node.center.z + OCTANT_Z[octant] * child_half_size);
+		child.half_size = child_half_size;
+		child.depth = parent_node.depth + 1;
+		child.parent = parent;
+		child.first_child = INVALID_INDEX;
+		child.subtree_count = 0;
+		child.objects.clear();
+	}
+
+	parent_node.first_child = block;
+	return block;
+}
+
+void LooseOctree::Split(uint32_t node)
+{
+	this->AllocateChildren(node);
+
+	// Objects small enough for the children move down a level, the rest stay
+	std::vector<uint32_t>& objects = m_Nodes[node].objects;
+	for (size_t i = objects.size(); i-- > 0;)
+	{
+		uint32_t id = objects[i];
+		XMFLOAT3 center(m_CenterX[id], m_CenterY[id], m_CenterZ[id]);
+		if (this->GetTargetDepth(center, XMFLOAT3(m_ExtentX[id], m_ExtentY[id], m_ExtentZ[id])) <= m_Nodes[node].depth)
+			continue;
+
+		// Swap the last object into its slot
+		objects[i] = objects.back();
+		m_Objects[objects[i]].slot = static_cast<uint32_t>(i);
+		objects.pop_back();
+
+		const Node& parent = m_Nodes[node];
+		uint32_t octant = (center.x >= parent.center.x ? 1 : 0) | (center.y >= parent.center.y ? 2 : 0) | (center.z >= parent.center.z ? 4 : 0);
+		Node& child = m_Nodes[parent.first_child + octant];
+
+		m_Objects[id].node = parent.first_child + octant;
+		m_Objects[id].slot = static_cast<uint32_t>(child.objects.size());
+		child.objects.push_back(id);
+		++child.subtree_count;
+	}
+}
+
+void LooseOctree::FreeChildren(uint32_t node)
+{
+	uint32_t block = m_Nodes[node].first_child;
+	for (uint32_t octant = 0; octant < 8; ++octant)
+	{
+		if (m_Nodes[block + octant].first_child != INVALID_INDEX)
+		{
+			this->FreeChildren(block + octant);
+		}
+	}
+
+	m_FreeBlocks.push_back(block);
+	m_Nodes[node].first_child = INVALID_INDEX;
+}
+
+void LooseOctree::WriteSubtree(uint32_t node, std::vector<uint32_t>& results) const
+{
+	const Node& current = m_Nodes[node];
+	results.insert(results.end(), current.objects.begin(), current.objects.end());
+
+	if (current.first_child == INVALID_INDEX || current.subtree_count == current.objects.size())
+		return;
+
+	for (uint32_t octant = 0; octant < 8; ++octant)
+	{
+		if (m_Nodes[current.first_child + octant].subtree_count != 0)
+		{
+			this->WriteSubtree(current.first_child + octant, results);
+		}
+	}
+}
+
+template<typename Test>
+void LooseOctree::Traverse(const Test& test, std::vector<uint32_t>& results) const
+{
+	results.clear();
+	if (m_Count == 0)
+		return;
+
+	uint32_t stack[STACK_SIZE];
+	uint32_t stack_size = 0;
+	stack[stack_size++] = 0;
+
+	while (stack_size > 0)
+	{
+		const Node& node = m_Nodes[stack[--stack_size]];
+
+		// The node's own objects one at a time
+		for (uint32_t id : node.objects)
+		{
+			Bounds bounds = { m_CenterX[id], m_CenterY[id], m_CenterZ[id], m_ExtentX[id], m_ExtentY[id], m_ExtentZ[id] };
+			if (test.TestObject(bounds))
+			{
+				results.push_back(id);
+			}
+		}
+
+		if (node.first_child == INVALID_INDEX || node.subtree_count == node.objects.size())
+			continue;
+
+		// Every child at once, children inside the volume need no more tests
+		uint32_t inside = 0;
+		uint32_t overlap = test.TestChildren(node.center, node.half_size * 0.5f, inside);
+		for (uint32_t octant = 0; octant < 8; ++octant)
+		{
+			uint32_t child = node.first_child + octant;
+			if ((overlap & (1u << octant)) == 0 || m_Nodes[child].subtree_count == 0)
+				continue;
+
+			if ((inside & (1u << octant)) != 0)
+			{
+				this->WriteSubtree(child, results);
+			}
+			else
+			{
+				stack[stack_size++] = child;
+			}
+		}
+	}
+}
+
+void LooseOctree::QueryFrustum(const CullingFrustum& frustum, std::vector<uint32_t>& results) const
+{
+	this->Traverse(FrustumTest{ frustum }, results);
+}
+
+void LooseOctree::QuerySphere(const XMFLOAT3& center, float radius, std::vector<uint32_t>& results) const
+{
+	this->Traverse(SphereTest{ center, radius }, results);
+}
+
+void LooseOctree::QueryBox(const XMFLOAT3& center, const XMFLOAT3& extents, std::vector<uint32_t>& results) const
+{
+	this->Traverse(BoxTest{ center, extents }, results);
+}
+
+void LooseOctree::QueryRay(const XMFLOAT3& origin, const XMFLOAT3& direction, float max_distance, std::vector<uint32_t>& results) const
+{
+	results.clear();
+	if (m_Count == 0)
+		return;
+
+	Ray ray(origin, direction, max_distance);
+
+	uint32_t stack[STACK_SIZE];
+	uint32_t stack_size = 0;
+	stack[stack_size++] = 0;
+
+	while (stack_size > 0)
+	{
+		const Node& node = m_Nodes[stack[--stack_size]];
+
+		for (uint32_t id : node.objects)
+		{
+			Bounds bounds = { m_CenterX[id], m_CenterY[id], m_CenterZ[id], m_ExtentX[id], m_ExtentY[id], m_ExtentZ[id] };
+			if (ray.TestObject(bounds) >= 0.0f)
+			{
+				results.push_back(id);
+			}
+		}
+
+		if (node.first_child == INVALID_INDEX || node.subtree_count == node.objects.size())
+			continue;
+
+		float entry[8];
+		uint32_t hit = ray.TestChildren(node.center, node.half_size * 0.5f, entry);
+		for (uint32_t octant = 0; octant < 8; ++octant)
+		{
+			uint32_t child = node.first_child + octant;
+			if ((hit & (1u << octant)) != 0 && m_Nodes[child].subtree_count != 0)
+			{
+				stack[stack_size++] = child;
+			}
+		}
+	}
+}
+
+bool LooseOctree::Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float max_distance, uint32_t& hit, float& distance) const
+{
+	if (m_Count == 0)
+		return false;
+
+	Ray ray(origin, direction, max_distance);
+	float nearest = max_distance;
+	bool found = false;
+
+	// Nodes with the distance the ray enters them, nearer children are popped first
+	uint32_t stack[STACK_SIZE];
+	float stack_entry[STACK_SIZE];
+	uint32_t stack_size = 0;
+	stack[stack_size] = 0;
+	stack_entry[stack_size++] = 0.0f;
+
+	while (stack_size > 0)
+	{
+		--stack_size;
+		if (stack_entry[stack_size] > nearest)
+			continue;
+
+		const Node& node = m_Nodes[stack[stack_size]];
+
+		for (uint32_t id : node.objects)
+		{
+			Bounds bounds = { m_CenterX[id], m_CenterY[id], m_CenterZ[id], m_ExtentX[id], m_ExtentY[id], m_ExtentZ[id] };
+			float object_distance = ray.TestObject(bounds);
+			if (object_distance >= 0.0f && object_distance <= nearest)
+			{
+				nearest = object_distance;
+				hit = id;
+				found = true;
+			}
+		}
+
+		if (node.first_child == INVALID_INDEX || node.subtree_count == node.objects.size())
+			continue;
+
+		float entry[8];
+		uint32_t hit_mask = ray.TestChildren(node.center, node.half_size * 0.5f, entry);
+
+		// Children the ray enters before the nearest hit so far, sorted furthest first so the nearest is on top of the stack
+		uint32_t children[8];
+		uint32_t child_count = 0;
+		for (uint32_t octant = 0; octant < 8; ++octant)
+		{
+			uint32_t child = node.first_child + octant;
+			if ((hit_mask & (1u << octant)) == 0 || entry[octant] > nearest || m_Nodes[child].subtree_count == 0)
+				continue;
+
+			uint32_t i = child_count++;
+			for (; i > 0 && entry[children[i - 1]] < entry[octant]; --i)
+			{
+				children[i] = children[i - 1];
+			}
+
+			children[i] = octant;
+		}
+
+		for (uint32_t i = 0; i < child_count; ++i)
+		{
+			stack[stack_size] = node.first_child + children[i];
+			stack_entry[stack_size++] = entry[children[i]];
+		}
+	}
+
+	if (found)
+	{
+		distance = nearest;
+	}
+
+	return found;
+}
+
+void LooseOctree::Print() const
+{
+	// Where the objects ended up
+	uint32_t deepest = 0;
+	for (const Object& object : m_Objects)
+	{
+		if (object.node != INVALID_INDEX)
+		{
+			deepest = std::max(deepest, m_Nodes[object.node].depth);
+		}
+	}
+
+	std::cout << "  Octree: " << m_Count << " objects in " << this->GetNodeCount() << " nodes, " << m_Nodes[0].objects.size() << " in the root, deepest level "
+		<< deepest << " of " << m_MaxDepth << '\n';
+}
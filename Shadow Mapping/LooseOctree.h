@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+#include "FrustumCuller.h"
+
+// Deepest level a loose octree can split to
+const uint32_t MAX_OCTREE_DEPTH = 12;
+
+// Objects a leaf holds before it is split
+const uint32_t OCTREE_NODE_CAPACITY = 8;
+
+// Spatial index of boxes for frustum, sphere, box and ray queries without scanning every object
+//
+// Each node's cell is a cube split into eight children, and its loose bounds are twice the cell's size. An object goes down
+// the cells holding its center while the children would still be as big as the object, so it always fits its node's loose
+// bounds, and leaves only split once they are full. Inserting, moving or removing only walks the path down from the root.
+// The eight children of a node are stored together and have the same size, so a query tests all of them at once across
+// SIMD lanes, and nodes entirely inside a query hand over every object below them without any more tests
+class LooseOctree
+{
+public:
+	// Cube covered by the root and how many times it can be split, objects centered outside it are kept in the root
+	LooseOctree(const XMFLOAT3& center, float half_size, uint32_t max_depth);
+	virtual ~LooseOctree() = default;
+
+	// Remove every object
+	void Clear();
+
+	// Add or move an object, ids are small indices chosen by the caller such as the object's index in its own arrays
+	void Insert(uint32_t id, const XMFLOAT3& center, const XMFLOAT3& extents);
+	void Move(uint32_t id, const XMFLOAT3& center, const XMFLOAT3& extents);
+	void Remove(uint32_t id);
+
+	inline uint32_t GetCount() const { return m_Count; }
+	inline uint32_t GetNodeCount() const { return static_cast<uint32_t>(m_Nodes.size() - m_FreeBlocks.size() * 8); }
+
+	// Write the ids of the objects inside or touching the volume, in no particular order
+	void QueryFrustum(const CullingFrustum& frustum, std::vector<uint32_t>& results) const;
+	void QuerySphere(const XMFLOAT3& center, float radius, std::vector<uint32_t>& results) const;
+	void QueryBox(const XMFLOAT3& center, const XMFLOAT3& extents, std::vector<uint32_t>& results) const;
+
+	// Every object the ray hits before max_distance, the direction doesn't need to be normalised and distances are in its lengths
+	void QueryRay(const XMFLOAT3& origin, const XMFLOAT3& direction, float max_distance, std::vector<uint32_t>& results) const;
+
+	// Nearest object the ray hits before max_distance, returns false if there is none
+	bool Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float max_distance, uint32_t& hit, float& distance) const;
+
+	// Print the object and node counts
+	void Print() const;
+
+private:
+	static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+	XMFLOAT3 m_RootCenter;
+	float m_RootHalfSize = 0.0f;
+	uint32_t m_MaxDepth = 0;
+
+	struct Node
+	{
+		// Cell, the loose bounds are twice the half size
+		XMFLOAT3 center;
+		float half_size = 0.0f;
+		uint32_t depth = 0;
+
+		uint32_t parent = INVALID_INDEX;
+
+		// First of the eight children in octant order, x is the lowest bit then y and z
+		uint32_t first_child = INVALID_INDEX;
+
+		// Objects in this node and every node below it, empty children are skipped and freed
+		uint32_t subtree_count = 0;
+		std::vector<uint32_t> objects;
+	};
+
+	// Node 0 is the root, children are allocated eight at a time and freed blocks are reused
+	std::vector<Node> m_Nodes;
+	std::vector<uint32_t> m_FreeBlocks;
+	uint32_t AllocateChildren(uint32_t parent);
+	void FreeChildren(uint32_t node);
+
+	// Give a full leaf its children and move down the objects small enough for them
+	void Split(uint32_t node);
+
+	// Where an object is, indexed by id
+	struct Object
+	{
+		uint32_t node = INVALID_INDEX;
+		uint32_t slot = 0;
+	};
+
+	std::vector<Object> m_Objects;
+	uint32_t m_Count = 0;
+
+	// Object bounds, indexed by id
+	std::vector<float> m_CenterX;
+	std::vector<float> m_CenterY;
+	std::vector<float> m_CenterZ;
+	std::vector<float> m_ExtentX;
+	std::vector<float> m_ExtentY;
+	std::vector<float> m_ExtentZ;
+
+	// Deepest level an object of these extents fits, 0 if its center is outside the root's cell
+	uint32_t GetTargetDepth(const XMFLOAT3& center, const XMFLOAT3& extents) const;
+
+	// Walk down towards the target level splitting full leaves on the way, then link or unlink the object
+	void Link(uint32_t id);
+	void Unlink(uint32_t id);
+
+	// Write every object of a node and the nodes below it
+	void WriteSubtree(uint32_t node, std::vector<uint32_t>& results) const;
+
+	// Walk the nodes a volume test overlaps, writing the objects it passes
+	template<typename Test>
+	void Traverse(const Test& test, std::vector<uint32_t>& results) const;
+};
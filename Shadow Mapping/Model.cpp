@@ -9,22 +9,31 @@ Model::Model(Renderer* renderer) : m_Renderer(renderer)
 {
 }
 
-void Model::Create()
+Model::~Model()
 {
-	CreateVertexBuffer();
-	CreateIndexBuffer();
+	m_Renderer->GetGeometryArena()->RemoveMesh(m_Mesh);
 }
 
-void Model::CreateVertexBuffer()
+void Model::Create()
 {
-	ID3D11Device* device = m_Renderer->GetDevice();
+	std::vector<Vertex> vertices;
+	CreateVertices(vertices);
+
+	std::vector<UINT> indices;
+	CreateIndices(indices);
+
+	// Copy the mesh into the shared vertex and index buffers
+	m_Mesh = m_Renderer->GetGeometryArena()->AddMesh(vertices.data(), static_cast<uint32_t>(vertices.size()), indices.data(), static_cast<uint32_t>(indices.size()));
+}
 
+void Model::CreateVertices(std::vector<Vertex>& vertices)
+{
 	const float width = 1.0f;
 	const float height = 1.0f;
 	const float depth = 1.0f;
 
 	// Vertex data
-	std::vector<Vertex> vertices =
+	vertices =
 	{
 		{ VertexPosition(-width, -height, -depth), VertexNormal(+0.0f, +0.0f, -1.0f), VertexUV(0.0f, 1.0f) },
 		{ VertexPosition(-width, +height, -depth), VertexNormal(+0.0f, +0.0f, -1.0f), VertexUV(0.0f, 0.0f) },
@@ -56,25 +65,12 @@ void Model::CreateVertexBuffer()
 		{ VertexPosition(+width, +height, +depth), VertexNormal(+1.0f, +0.0f, +0.0f), VertexUV(1.0f, 0.0f) },
 		{ VertexPosition(+width, -height, +depth), VertexNormal(+1.0f, +0.0f, +0.0f), VertexUV(1.0f, 1.0f) }
 	};
-
-	// Create vertex buffer
-	D3D11_BUFFER_DESC vertexbuffer_desc = {};
-	vertexbuffer_desc.Usage = D3D11_USAGE_DEFAULT;
-	vertexbuffer_desc.ByteWidth = static_cast<UINT>(sizeof(Vertex) * vertices.size());
-	vertexbuffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-
-	D3D11_SUBRESOURCE_DATA vertex_subdata = {};
-	vertex_subdata.pSysMem = vertices.data();
-
-	DX::Check(device->CreateBuffer(&vertexbuffer_desc, &vertex_subdata, m_VertexBuffer.ReleaseAndGetAddressOf()));
 }
 
-void Model::CreateIndexBuffer()
+void Model::CreateIndices(std::vector<UINT>& indices)
 {
-	ID3D11Device* device = m_Renderer->GetDevice();
-
 	// Set Indices
-	std::vector<UINT> indices =
+	indices =
 	{
 		0, 1, 2,
 		0, 2, 3,
@@ -89,38 +85,34 @@ void Model::CreateIndexBuffer()
 		20, 21, 22,
 		20, 22, 23,
 	};
+}
 
-	m_IndexCount = static_cast<UINT>(indices.size());
+void Model::Render()
+{
+	GeometryArena* arena = m_Renderer->GetGeometryArena();
 
-	// Create index buffer
-	D3D11_BUFFER_DESC index_buffer_desc = {};
-	index_buffer_desc.Usage = D3D11_USAGE_DEFAULT;
-	index_buffer_desc.ByteWidth = static_cast<UINT>(sizeof(UINT) * indices.size());
-	index_buffer_desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	// Still streaming in
+	if (!arena->IsUploaded(m_Mesh))
+		return;
 
-	D3D11_SUBRESOURCE_DATA index_subdata = {};
-	index_subdata.pSysMem = indices.data();
+	// Bind the shared vertex and index buffers, the state cache drops this when the last draw bound them too
+	arena->Bind();
 
-	DX::Check(device->CreateBuffer(&index_buffer_desc, &index_subdata, m_IndexBuffer.ReleaseAndGetAddressOf()));
+	// Render geometry
+	arena->Draw(m_Mesh);
 }
 
-void Model::Render()
+void Model::RenderInstanced(UINT instance_count)
 {
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
+	GeometryArena* arena = m_Renderer->GetGeometryArena();
 
-	// We need to define the stride and offset
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
+	// Still streaming in
+	if (!arena->IsUploaded(m_Mesh))
+		return;
 
-	// Bind the vertex buffer to the pipeline's Input Assembler stage
-	context->IASetVertexBuffers(0, 1, m_VertexBuffer.GetAddressOf(), &stride, &offset);
+	// Bind the shared vertex and index buffers, the state cache drops this when the last draw bound them too
+	arena->Bind();
 
-	// Bind the index buffer to the pipeline's Input Assembler stage
-	context->IASetIndexBuffer(m_IndexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-
-	// Bind the geometry topology to the pipeline's Input Assembler stage
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-	// Render geometry
-	context->DrawIndexed(m_IndexCount, 0, 0);
-}
\ No newline at end of file
+	// Render every instance
+	arena->DrawInstanced(m_Mesh, instance_count);
+}
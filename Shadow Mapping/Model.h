@@ -1,12 +1,15 @@
 #pragma once
 
+#include "GeometryArena.h"
 #include <d3d11.h>
+#include <vector>
 
 // This include is requires for using DirectX smart pointers (ComPtr)
 #include <wrl\client.h>
 using Microsoft::WRL::ComPtr;
 
 class Renderer;
+struct Vertex;
 
 class Model
 {
@@ -14,7 +17,7 @@ class Model
 
 public:
 	Model(Renderer* renderer);
-	virtual ~Model() = default;
+	virtual ~Model();
 
 	// Create the model
 	void Create();
@@ -22,15 +25,16 @@ public:
 	// Render the model
 	void Render();
 
+	// Render many copies of the model in one draw, the instance buffer must already be bound
+	void RenderInstanced(UINT instance_count);
+
 private:
-	// Number of indices to draw
-	UINT m_IndexCount = 0;
+	// Mesh in the renderer's geometry arena
+	GeometryMesh m_Mesh = INVALID_GEOMETRY_MESH;
 
-	// Vertex buffer
-	void CreateVertexBuffer();
-	ComPtr<ID3D11Buffer> m_VertexBuffer = nullptr;
+	// Vertex data
+	void CreateVertices(std::vector<Vertex>& vertices);
 
-	// Index buffer
-	void CreateIndexBuffer();
-	ComPtr<ID3D11Buffer> m_IndexBuffer = nullptr;
+	// Index data
+	void CreateIndices(std::vector<UINT>& indices);
 };
\ No newline at end of file
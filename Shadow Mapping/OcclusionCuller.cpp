@@ -0,0 +1,363 @@
+#include "OcclusionCuller.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+#include "../External/ThreadPool.h"
+#include "../External/SimdLanes.h"
+
+namespace
+{
+	using namespace Simd;
+
+	// Pixel centers of the lanes from the first pixel of a group
+	const float LANE_CENTERS[4] = { 0.5f, 1.5f, 2.5f, 3.5f };
+
+	// Corners of a box in the order the twelve triangles use them
+	const float BOX_CORNERS[8][3] =
+	{
+		{ -1.0f, -1.0f, -1.0f }, { -1.0f, +1.0f, -1.0f }, { +1.0f, +1.0f, -1.0f }, { +1.0f, -1.0f, -1.0f },
+		{ -1.0f, -1.0f, +1.0f }, { -1.0f, +1.0f, +1.0f }, { +1.0f, +1.0f, +1.0f }, { +1.0f, -1.0f, +1.0f },
+	};
+
+	const uint32_t BOX_INDICES[36] =
+	{
+		0, 1, 2, 0, 2, 3,	// -Z
+		4, 6, 5, 4, 7, 6,	// +Z
+		1, 5, 6, 1, 6, 2,	// +Y
+		0, 3, 7, 0, 7, 4,	// -Y
+		0, 4, 5, 0, 5, 1,	// -X
+		3, 2, 6, 3, 6, 7,	// +X
+	};
+}
+
+OcclusionCuller::OcclusionCuller() : m_ViewProjection(XMMatrixIdentity())
+{
+	m_Depth.assign(WIDTH * HEIGHT, 1.0f);
+	m_TileMaxDepth.assign(TILES_X * TILES_Y, 1.0f);
+}
+
+void OcclusionCuller::ClearOccluders()
+{
+	m_Occluders.clear();
+}
+
+void OcclusionCuller::AddOccluderMesh(const XMFLOAT3* positions, const uint32_t* indices, uint32_t index_count, const XMMATRIX& world)
+{
+	for (uint32_t i = 0; i + 2 < index_count; i += 3)
+	{
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			XMFLOAT3 position;
+			XMStoreFloat3(&position, XMVector3TransformCoord(XMLoadFloat3(&positions[indices[i + corner]]), world));
+			m_Occluders.push_back(position);
+		}
+	}
+}
+
+void OcclusionCuller::AddOccluderBox(const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+	XMFLOAT3 corners[8];
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		corners[i] = XMFLOAT3(center.x + BOX_CORNERS[i][0] * extents.x, center.y + BOX_CORNERS[i][1] * extents.y, center.z + BOX_CORNERS[i][2] * extents.z);
+	}
+
+	this->AddOccluderMesh(corners, BOX_INDICES, 36, XMMatrixIdentity());
+}
+
+void OcclusionCuller::Render(const XMMATRIX& view_projection, uint32_t thread_count)
+{
+	m_ViewProjection = view_projection;
+	m_Stats = OcclusionStats();
+
+	// Every occluder triangle into clip space, clipped and set up once for all the threads
+	m_Triangles.clear();
+	for (size_t i = 0; i + 2 < m_Occluders.size(); i += 3)
+	{
+		XMVECTOR clip[3];
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			clip[corner] = XMVector4Transform(XMVectorSetW(XMLoadFloat3(&m_Occluders[i + corner]), 1.0f), view_projection);
+		}
+
+		this->SetupTriangle(clip);
+	}
+
+	m_Stats.occluder_triangles = static_cast<uint32_t>(m_Occluders.size() / 3);
+	m_Stats.rasterized_triangles = static_cast<uint32_t>(m_Triangles.size());
+
+	// Workers from the shared pool take the next row of tiles until there are none left, the calling thread works as well.
+	// A few triangles are quicker to rasterize here than to wake the workers for
+	std::atomic<uint32_t> next_row(0);
+	auto worker = [this, &next_row]()
+	{
+		for (uint32_t row = next_row++; row < TILES_Y; row = next_row++)
+		{
+			this->RenderTileRow(row);
+		}
+	};
+
+	uint32_t used_threads = (m_Triangles.size() < MIN_PARALLEL_TRIANGLES) ? 1 : std::min(thread_count, TILES_Y);
+	m_Stats.thread_count = ThreadPool::GetShared().Run(used_threads, worker);
+}
+
+void OcclusionCuller::SetupTriangle(const XMVECTOR clip[3])
+{
+	XMFLOAT4 vertices[3];
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		XMStoreFloat4(&vertices[i], clip[i]);
+	}
+
+	// Depth is 0 on the near plane, keep the part of the triangle in front of it
+	XMFLOAT4 clipped[4];
+	uint32_t clipped_count = 0;
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		const XMFLOAT4& a = vertices[i];
+		const XMFLOAT4& b = vertices[(i + 1) % 3];
+
+		if (a.z >= 0.0f)
+		{
+			clipped[clipped_count++] = a;
+		}
+
+		if ((a.z >= 0.0f) != (b.z >= 0.0f))
+		{
+			float t = a.z / (a.z - b.z);
+			clipped[clipped_count++] = XMFLOAT4(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, 0.0f, a.w + (b.w - a.w) * t);
+		}
+	}
+
+	// What is left is a triangle or a quad
+	if (clipped_count >= 3)
+	{
+		XMFLOAT4 first[3] = { clipped[0], clipped[1], clipped[2] };
+		this->AddScreenTriangle(first);
+	}
+
+	if (clipped_count == 4)
+	{
+		XMFLOAT4 second[3] = { clipped[0], clipped[2], clipped[3] };
+		this->AddScreenTriangle(second);
+	}
+}
+
+void OcclusionCuller::AddScreenTriangle(const XMFLOAT4 clip[3])
+{
+	// Perspective divide then into pixels, y goes down the buffer
+	float x[3], y[3], z[3];
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		if (clip[i].w <= 0.0f)
+			return;
+
+		float inverse_w = 1.0f / clip[i].w;
+		x[i] = (clip[i].x * inverse_w * 0.5f + 0.5f) * static_cast<float>(WIDTH);
+		y[i] = (0.5f - clip[i].y * inverse_w * 0.5f) * static_cast<float>(HEIGHT);
+		z[i] = clip[i].z * inverse_w;
+	}
+
+	// Both windings are drawn, so the edges are turned to face inwards
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (std::fabs(area) < 1e-6f)
+		return;
+
+	if (area < 0.0f)
+	{
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+		std::swap(z[1], z[2]);
+		area = -area;
+	}
+
+	Triangle triangle;
+	triangle.min_x = std::max(0, static_cast<int>(std::floor(std::min(x[0], std::min(x[1], x[2])))));
+	triangle.max_x = std::min(static_cast<int>(WIDTH) - 1, static_cast<int>(std::floor(std::max(x[0], std::max(x[1], x[2])))));
+	triangle.min_y = std::max(0, static_cast<int>(std::floor(std::min(y[0], std::min(y[1], y[2])))));
+	triangle.max_y = std::min(static_cast<int>(HEIGHT) - 1, static_cast<int>(std::floor(std::max(y[0], std::max(y[1], y[2])))));
+	if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y)
+		return;
+
+	// Edge functions, positive on the inside of each edge
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		uint32_t next = (i + 1) % 3;
+		triangle.edge_a[i] = y[i] - y[next];
+		triangle.edge_b[i] = x[next] - x[i];
+		triangle.edge_c[i] = -(triangle.edge_a[i] * x[i] + triangle.edge_b[i] * y[i]);
+	}
+
+	// Depth is linear in screen space after the divide
+	triangle.depth_dx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+	triangle.depth_dy = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+	triangle.depth_origin = z[0] - triangle.depth_dx * x[0] - triangle.depth_dy * y[0];
+
+	m_Triangles.push_back(triangle);
+}
+
+void OcclusionCuller::RenderTileRow(uint32_t tile_row)
+{
+	const int first_y = static_cast<int>(tile_row * TILE_SIZE);
+	const int last_y = first_y + static_cast<int>(TILE_SIZE) - 1;
+
+	std::fill(m_Depth.begin() + first_y * WIDTH, m_Depth.begin() + (last_y + 1) * WIDTH, 1.0f);
+
+	for (const Triangle& triangle : m_Triangles)
+	{
+		int begin_y = std::max(first_y, triangle.min_y);
+		int end_y = std::min(last_y, triangle.max_y);
+
+		for (int y = begin_y; y <= end_y; ++y)
+		{
+			float* row = &m_Depth[y * WIDTH];
+			float center_y = static_cast<float>(y) + 0.5f;
+
+			// Each edge and the depth along the row
+			float row_edges[3];
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				row_edges[i] = triangle.edge_b[i] * center_y + triangle.edge_c[i];
+			}
+
+			float row_depth = triangle.depth_origin + triangle.depth_dy * center_y;
+
+			// Groups of pixels start on a multiple of the lane count, so every lane is inside the row
+			int x = triangle.min_x - triangle.min_x % static_cast<int>(LANE_COUNT);
+
+#if defined(SIMD_LANES_SSE)
+			Lanes edge_a0 = Splat(triangle.edge_a[0]);
+			Lanes edge_a1 = Splat(triangle.edge_a[1]);
+			Lanes edge_a2 = Splat(triangle.edge_a[2]);
+			Lanes depth_dx = Splat(triangle.depth_dx);
+			Lanes lane_centers = Load(LANE_CENTERS);
+			Lanes zero = Splat(0.0f);
+
+			for (; x <= triangle.max_x; x += LANE_COUNT)
+			{
+				Lanes center_x = Add(Splat(static_cast<float>(x)), lane_centers);
+
+				// Inside every edge
+				Lanes inside = GreaterThanZero(MultiplyAdd(edge_a0, center_x, Splat(row_edges[0])));
+				inside = And(inside, GreaterThanZero(MultiplyAdd(edge_a1, center_x, Splat(row_edges[1]))));
+				inside = And(inside, GreaterThanZero(MultiplyAdd(edge_a2, center_x, Splat(row_edges[2]))));
+				if (!Any(inside))
+					continue;
+
+				// Keep the nearest depth of the covered pixels
+				Lanes depth = Max(MultiplyAdd(depth_dx, center_x, Splat(row_depth)), zero);
+				Lanes previous = Load(row + x);
+				Store(row + x, Select(inside, Min(previous, depth), previous));
+			}
+#else
+			for (; x <= triangle.max_x; ++x)
+			{
+				float center_x = static_cast<float>(x) + 0.5f;
+				if (triangle.edge_a[0] * center_x + row_edges[0] <= 0.0f || triangle.edge_a[1] * center_x + row_edges[1] <= 0.0f ||
+					triangle.edge_a[2] * center_x + row_edges[2] <= 0.0f)
+				{
+					continue;
+				}
+
+				float depth = std::max(triangle.depth_dx * center_x + row_depth, 0.0f);
+				row[x] = std::min(row[x], depth);
+			}
+#endif
+		}
+	}
+
+	// Furthest depth of each tile in the row
+	for (uint32_t tile_x = 0; tile_x < TILES_X; ++tile_x)
+	{
+		float max_depth = 0.0f;
+		for (int y = first_y; y <= last_y; ++y)
+		{
+			const float* row = &m_Depth[y * WIDTH + tile_x * TILE_SIZE];
+			for (uint32_t x = 0; x < TILE_SIZE; ++x)
+			{
+				max_depth = std::max(max_depth, row[x]);
+			}
+		}
+
+		m_TileMaxDepth[tile_row * TILES_X + tile_x] = max_depth;
+	}
+}
+
+bool OcclusionCuller::TestBox(const XMFLOAT3& center, const XMFLOAT3& extents)
+{
+	++m_Stats.tested;
+
+	// Screen rectangle and nearest depth of the corners
+	float min_x = static_cast<float>(WIDTH);
+	float max_x = 0.0f;
+	float min_y = static_cast<float>(HEIGHT);
+	float max_y = 0.0f;
+	float min_depth = 1.0f;
+
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		XMVECTOR corner = XMVectorSet(center.x + BOX_CORNERS[i][0] * extents.x, center.y + BOX_CORNERS[i][1] * extents.y, center.z + BOX_CORNERS[i][2] * extents.z, 1.0f);
+
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector4Transform(corner, m_ViewProjection));
+
+		// Crossing the near plane, there is nothing in front of it to hide it
+		if (clip.z < 0.0f || clip.w <= 0.0f)
+			return true;
+
+		float inverse_w = 1.0f / clip.w;
+		float x = (clip.x * inverse_w * 0.5f + 0.5f) * static_cast<float>(WIDTH);
+		float y = (0.5f - clip.y * inverse_w * 0.5f) * static_cast<float>(HEIGHT);
+		min_x = std::min(min_x, x);
+		max_x = std::max(max_x, x);
+		min_y = std::min(min_y, y);
+		max_y = std::max(max_y, y);
+		min_depth = std::min(min_depth, clip.z * inverse_w);
+	}
+
+	// Outside the buffer is left to frustum culling
+	if (max_x < 0.0f || max_y < 0.0f || min_x >= static_cast<float>(WIDTH) || min_y >= static_cast<float>(HEIGHT))
+		return true;
+
+	int first_x = std::max(0, static_cast<int>(std::floor(min_x)));
+	int last_x = std::min(static_cast<int>(WIDTH) - 1, static_cast<int>(std::floor(max_x)));
+	int first_y = std::max(0, static_cast<int>(std::floor(min_y)));
+	int last_y = std::min(static_cast<int>(HEIGHT) - 1, static_cast<int>(std::floor(max_y)));
+
+	for (int tile_y = first_y / static_cast<int>(TILE_SIZE); tile_y <= last_y / static_cast<int>(TILE_SIZE); ++tile_y)
+	{
+		for (int tile_x = first_x / static_cast<int>(TILE_SIZE); tile_x <= last_x / static_cast<int>(TILE_SIZE); ++tile_x)
+		{
+			// Behind the furthest occluder in the tile
+			if (min_depth > m_TileMaxDepth[tile_y * TILES_X + tile_x])
+				continue;
+
+			// Otherwise the box' pixels in the tile
+			int begin_x = std::max(first_x, tile_x * static_cast<int>(TILE_SIZE));
+			int end_x = std::min(last_x, (tile_x + 1) * static_cast<int>(TILE_SIZE) - 1);
+			int begin_y = std::max(first_y, tile_y * static_cast<int>(TILE_SIZE));
+			int end_y = std::min(last_y, (tile_y + 1) * static_cast<int>(TILE_SIZE) - 1);
+
+			for (int y = begin_y; y <= end_y; ++y)
+			{
+				for (int x = begin_x; x <= end_x; ++x)
+				{
+					if (min_depth <= m_Depth[y * WIDTH + x])
+						return true;
+				}
+			}
+		}
+	}
+
+	++m_Stats.culled;
+	return false;
+}
+
+void OcclusionCuller::Print() const
+{
+	float culled_percentage = (m_Stats.tested == 0) ? 0.0f : 100.0f * static_cast<float>(m_Stats.culled) / static_cast<float>(m_Stats.tested);
+	std::cout << "  Occlusion: " << m_Stats.culled << " of " << m_Stats.tested << " draws culled (" << culled_percentage << "%), " << m_Stats.rasterized_triangles
+		<< " of " << m_Stats.occluder_triangles << " occluder triangles rasterized on " << m_Stats.thread_count << (m_Stats.thread_count == 1 ? " thread\n" : " threads\n");
+}
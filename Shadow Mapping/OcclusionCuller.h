@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+// Counters of the last frame
+struct OcclusionStats
+{
+	// Occluder triangles given and the ones left after clipping to the near plane and dropping those seen edge on
+	uint32_t occluder_triangles = 0;
+	uint32_t rasterized_triangles = 0;
+
+	// Boxes tested against the depth buffer and the ones found to be hidden
+	uint32_t tested = 0;
+	uint32_t culled = 0;
+
+	// Threads the occluders were rasterized on
+	uint32_t thread_count = 0;
+};
+
+// Software occlusion culling on the CPU
+//
+// A few large occluder meshes are rasterized into a small depth buffer, four pixels at a time across SSE lanes. The rows of
+// tiles are shared out between threads so no two threads write the same pixels, and each tile then keeps the furthest depth
+// of its pixels. A box is hidden when its nearest point is behind every tile it covers, the pixels of any tile it isn't behind
+// are checked before giving up. The buffer is much smaller than the screen, so a sliver of a box peeking past the edge of an
+// occluder can be missed
+class OcclusionCuller
+{
+public:
+	// Size of the depth buffer and its tiles
+	static constexpr uint32_t WIDTH = 320;
+	static constexpr uint32_t HEIGHT = 192;
+	static constexpr uint32_t TILE_SIZE = 8;
+
+	// Fewer triangles than this are rasterized on the calling thread alone
+	static constexpr uint32_t MIN_PARALLEL_TRIANGLES = 256;
+
+	OcclusionCuller();
+	virtual ~OcclusionCuller() = default;
+
+	// Remove every occluder
+	void ClearOccluders();
+
+	// Add the triangles of a mesh in world space
+	void AddOccluderMesh(const XMFLOAT3* positions, const uint32_t* indices, uint32_t index_count, const XMMATRIX& world);
+
+	// Add an axis aligned box as twelve triangles
+	void AddOccluderBox(const XMFLOAT3& center, const XMFLOAT3& extents);
+
+	// Rasterize the occluders as seen through the view projection, using up to thread_count threads of the shared pool, and reset the counters
+	void Render(const XMMATRIX& view_projection, uint32_t thread_count);
+
+	// Returns false if the box is entirely behind the occluders, boxes crossing the near plane are always visible
+	bool TestBox(const XMFLOAT3& center, const XMFLOAT3& extents);
+
+	// Depth of a pixel, 1 where no occluder was drawn
+	inline float GetDepth(uint32_t x, uint32_t y) const { return m_Depth[y * WIDTH + x]; }
+
+	// Counters of the last frame
+	inline const OcclusionStats& GetStats() const { return m_Stats; }
+
+	// Print the counters
+	void Print() const;
+
+private:
+	static constexpr uint32_t TILES_X = WIDTH / TILE_SIZE;
+	static constexpr uint32_t TILES_Y = HEIGHT / TILE_SIZE;
+
+	// World space occluder triangles, three vertices each
+	std::vector<XMFLOAT3> m_Occluders;
+
+	// Triangle ready to rasterize, edge functions are positive inside and depth is a plane in screen space
+	struct Triangle
+	{
+		float edge_a[3];
+		float edge_b[3];
+		float edge_c[3];
+		float depth_origin;
+		float depth_dx;
+		float depth_dy;
+		int min_x, max_x, min_y, max_y;
+	};
+
+	std::vector<Triangle> m_Triangles;
+
+	// Clip a triangle to the near plane and add what is left to the triangles
+	void SetupTriangle(const XMVECTOR clip[3]);
+	void AddScreenTriangle(const XMFLOAT4 clip[3]);
+
+	// Rasterize every triangle into a row of tiles then find its tiles' furthest depths
+	void RenderTileRow(uint32_t tile_row);
+
+	XMMATRIX m_ViewProjection;
+	std::vector<float> m_Depth;
+	std::vector<float> m_TileMaxDepth;
+
+	OcclusionStats m_Stats;
+};
@@ -33,8 +33,27 @@ float4 CalculateDirectionalLighting(float3 position, float3 normal, float shadow
     return ambient_light + ((diffuse_light + specular_light) * shadow_factor);
 }
 
-float CalculateShadowFactor(float4 light_view_projection)
+float CalculateShadowFactor(float3 world_position, float cascade_depth)
 {
+    // First cascade whose slice holds the pixel, nothing is shadowed past the last one
+    uint cascade = cCascadeCount;
+
+    [unroll]
+    for (int i = MAX_SHADOW_CASCADES - 1; i >= 0; --i)
+    {
+        if (i < (int)cCascadeCount && cascade_depth <= cCascadeSplits[i])
+        {
+            cascade = i;
+        }
+    }
+
+    if (cascade >= cCascadeCount)
+    {
+        return 1.0f;
+    }
+
+    float4 light_view_projection = mul(float4(world_position, 1.0f), cCascadeViewProjection[cascade]);
+
     // Complete projection to NDC
     float3 shadow_coords = light_view_projection.xyz / light_view_projection.w;
     
@@ -51,7 +70,90 @@ float CalculateShadowFactor(float4 light_view_projection)
 
     // SampleCmp performs the comparison (pixel_depth < map_depth) 
     // and returns 1.0 if NOT in shadow, 0.0 if in shadow (based on D3D11_COMPARISON_LESS)
-    return gShadowMap.SampleCmpLevelZero(gShadowSampler, tex_coords, shadow_coords.z);
+    return gShadowMap.SampleCmpLevelZero(gShadowSampler, float3(tex_coords, cascade), shadow_coords.z);
+}
+
+float CalculateLocalShadowFactor(float3 world_position, float3 to_light, LocalLight light)
+{
+    int view = light.info.x;
+    if (view < 0)
+    {
+        return 1.0f;
+    }
+
+    // Point lights use the cube face the pixel is in, the faces are +X, -X, +Y, -Y, +Z, -Z
+    if (light.info.y == 1)
+    {
+        float3 from_light = -to_light;
+        float3 axis = abs(from_light);
+        if (axis.x >= axis.y && axis.x >= axis.z)
+        {
+            view += (from_light.x > 0.0f) ? 0 : 1;
+        }
+        else if (axis.y >= axis.z)
+        {
+            view += (from_light.y > 0.0f) ? 2 : 3;
+        }
+        else
+        {
+            view += (from_light.z > 0.0f) ? 4 : 5;
+        }
+    }
+
+    float4 light_view_projection = mul(float4(world_position, 1.0f), cShadowViewProjection[view]);
+    float3 shadow_coords = light_view_projection.xyz / light_view_projection.w;
+    if (shadow_coords.z > 1.0f || shadow_coords.z < 0.0f)
+    {
+        return 1.0f;
+    }
+
+    // Into the tile, kept half a texel inside its edges so the filter never reads a neighbouring tile
+    float4 tile = cShadowTiles[view];
+    float2 tex_coords = float2(shadow_coords.x * 0.5f + 0.5f, -shadow_coords.y * 0.5f + 0.5f) * tile.xy + tile.zw;
+    float half_texel = cShadowAtlasTexelSize * 0.5f;
+    tex_coords = clamp(tex_coords, tile.zw + half_texel, tile.zw + tile.xy - half_texel);
+
+    return gShadowAtlas.SampleCmpLevelZero(gShadowSampler, tex_coords, shadow_coords.z);
+}
+
+float4 CalculateLocalLighting(float3 world_position, float3 normal)
+{
+    float4 light_colour = 0.0f;
+
+    for (uint i = 0; i < cLocalLightCount; ++i)
+    {
+        LocalLight light = cLocalLights[i];
+
+        float3 to_light = light.positionRange.xyz - world_position;
+        float distance = length(to_light);
+        if (distance >= light.positionRange.w)
+        {
+            continue;
+        }
+
+        to_light /= distance;
+
+        // Fades out smoothly at the light's range
+        float attenuation = saturate(1.0f - distance / light.positionRange.w);
+        attenuation *= attenuation;
+
+        // Spot lights fade across the outer part of their cone
+        if (light.info.y == 0)
+        {
+            float spot_cos = light.directionSpotCos.w;
+            attenuation *= smoothstep(spot_cos, lerp(spot_cos, 1.0f, 0.2f), dot(-to_light, light.directionSpotCos.xyz));
+        }
+
+        float diffuse_factor = saturate(dot(to_light, normal)) * attenuation;
+        if (diffuse_factor <= 0.0f)
+        {
+            continue;
+        }
+
+        light_colour += light.colour * diffuse_factor * CalculateLocalShadowFactor(world_position, to_light, light);
+    }
+
+    return light_colour;
 }
 
 // Entry point for the vertex shader - will be executed for each pixel
@@ -61,10 +163,13 @@ float4 main(PixelInput input) : SV_TARGET
     input.normal = normalize(input.normal);
     
     // Shadow
-    float shadow_factor = CalculateShadowFactor(input.lightViewProjection);
+    float shadow_factor = CalculateShadowFactor(input.worldPosition, input.cascadeDepth);
     
 	// Calculate directional light
     float4 light_colour = CalculateDirectionalLighting(input.position.xyz, input.normal, shadow_factor);
+
+    // Add the point and spot lights
+    light_colour += CalculateLocalLighting(input.worldPosition, input.normal);
     
     // Gammer correction
     light_colour = pow(light_colour, 1.0f / 2.2f);
@@ -0,0 +1,422 @@
+#include "RecordingRenderDevice.h"
+#include <cstring>
+
+RecordingRenderDevice::RecordingRenderDevice(RenderDevice* forward_device) : m_ForwardDevice(forward_device)
+{
+}
+
+void RecordingRenderDevice::Reset()
+{
+	m_Stream.clear();
+	m_Stats = RenderDeviceStats();
+}
+
+void RecordingRenderDevice::ResetObjects()
+{
+	Reset();
+	m_Objects.clear();
+}
+
+const char* RecordingRenderDevice::GetCommandName(RenderCommand command)
+{
+	switch (command)
+	{
+		case RenderCommand::SetInputLayout: return "SetInputLayout";
+		case RenderCommand::SetVertexBuffer: return "SetVertexBuffer";
+		case RenderCommand::SetIndexBuffer: return "SetIndexBuffer";
+		case RenderCommand::SetPrimitiveTopology: return "SetPrimitiveTopology";
+		case RenderCommand::SetVertexShader: return "SetVertexShader";
+		case RenderCommand::SetPixelShader: return "SetPixelShader";
+		case RenderCommand::SetVertexConstantBuffer: return "SetVertexConstantBuffer";
+		case RenderCommand::SetPixelConstantBuffer: return "SetPixelConstantBuffer";
+		case RenderCommand::SetVertexConstantBufferRange: return "SetVertexConstantBufferRange";
+		case RenderCommand::SetPixelConstantBufferRange: return "SetPixelConstantBufferRange";
+		case RenderCommand::SetPixelShaderResource: return "SetPixelShaderResource";
+		case RenderCommand::SetPixelSampler: return "SetPixelSampler";
+		case RenderCommand::SetRasterizerState: return "SetRasterizerState";
+		case RenderCommand::SetDepthStencilState: return "SetDepthStencilState";
+		case RenderCommand::SetViewport: return "SetViewport";
+		case RenderCommand::SetRenderTarget: return "SetRenderTarget";
+		case RenderCommand::ClearRenderTarget: return "ClearRenderTarget";
+		case RenderCommand::ClearDepthStencil: return "ClearDepthStencil";
+		case RenderCommand::UpdateBuffer: return "UpdateBuffer";
+		case RenderCommand::UpdateDynamicBuffer: return "UpdateDynamicBuffer";
+		case RenderCommand::UpdateDynamicBufferRange: return "UpdateDynamicBufferRange";
+		case RenderCommand::CopyTexture: return "CopyTexture";
+		case RenderCommand::Draw: return "Draw";
+		case RenderCommand::DrawIndexed: return "DrawIndexed";
+		case RenderCommand::DrawIndexedInstanced: return "DrawIndexedInstanced";
+		default: return "Unknown";
+	}
+}
+
+void RecordingRenderDevice::Begin(RenderCommand command)
+{
+	m_Stats.calls[static_cast<size_t>(command)]++;
+	m_Stats.total_calls++;
+
+	Write(static_cast<uint8_t>(command));
+}
+
+void RecordingRenderDevice::Write(const void* data, size_t size)
+{
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+	m_Stream.insert(m_Stream.end(), bytes, bytes + size);
+	m_Stats.stream_bytes += size;
+}
+
+void RecordingRenderDevice::Write(uint8_t value)
+{
+	m_Stream.push_back(value);
+	m_Stats.stream_bytes++;
+}
+
+void RecordingRenderDevice::Write(uint32_t value)
+{
+	// Always little endian so streams can be compared between platforms
+	uint8_t bytes[4] =
+	{
+		static_cast<uint8_t>(value),
+		static_cast<uint8_t>(value >> 8),
+		static_cast<uint8_t>(value >> 16),
+		static_cast<uint8_t>(value >> 24),
+	};
+
+	Write(bytes, sizeof(bytes));
+}
+
+void RecordingRenderDevice::Write(int32_t value)
+{
+	Write(static_cast<uint32_t>(value));
+}
+
+void RecordingRenderDevice::Write(float value)
+{
+	uint32_t bits = 0;
+	std::memcpy(&bits, &value, sizeof(bits));
+	Write(bits);
+}
+
+void RecordingRenderDevice::WriteObject(const void* object)
+{
+	if (object == nullptr)
+	{
+		Write(0u);
+		return;
+	}
+
+	// Ids are assigned in the order objects are first used
+	auto result = m_Objects.emplace(object, static_cast<uint32_t>(m_Objects.size() + 1));
+	Write(result.first->second);
+}
+
+uint32_t RecordingRenderDevice::GetPrimitiveCount(uint32_t vertex_count) const
+{
+	switch (m_Topology)
+	{
+		case PrimitiveTopology::LineList: return vertex_count / 2;
+		case PrimitiveTopology::TriangleList: return vertex_count / 3;
+		default: return 0;
+	}
+}
+
+void RecordingRenderDevice::SetInputLayout(ID3D11InputLayout* input_layout)
+{
+	Begin(RenderCommand::SetInputLayout);
+	WriteObject(input_layout);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->SetInputLayout(input_layout);
+}
+
+void RecordingRenderDevice::SetVertexBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t stride, uint32_t offset)
+{
+	Begin(RenderCommand::SetVertexBuffer);
+	Write(slot);
+	WriteObject(buffer);
+	Write(stride);
+	Write(offset);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->SetVertexBuffer(slot, buffer, stride, offset);
+}
+
+void RecordingRenderDevice::SetIndexBuffer(ID3D11Buffer* buffer, IndexFormat format, uint32_t offset)
+{
+	Begin(RenderCommand::SetIndexBuffer);
+	WriteObject(buffer);
+	Write(static_cast<uint32_t>(format));
+	Write(offset);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->SetIndexBuffer(buffer, format, offset);
+}
+
+void RecordingRenderDevice::SetPrimitiveTopology(PrimitiveTopology topology)
+{
+	Begin(RenderCommand::SetPrimitiveTopology);
+	Write(static_cast<uint32_t>(topology));
+	m_Topology = topology;
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->SetPrimitiveTopology(topology);
+}
+
+void RecordingRenderDevice::SetVertexShader(ID3D11VertexShader* shader)
+{
+	Begin(RenderCommand::SetVertexShader);
+	WriteObject(shader);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->SetVertexShader(shader);
+}
+
+void RecordingRenderDevice::SetPixelShader(ID3D11PixelShader* shader)
+{
+	Begin(RenderCommand::SetPixelShader);
+	WriteObject(shader);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->SetPixelShader(shader);
+}
+
+void RecordingRenderDevice::SetVertexConstantBuffer(uint32_t slot, ID3D11Buffer* buffer)
+{
+	Begin(RenderCommand::SetVertexConstantBuffer);
+	Write(slot);
+	WriteObject(buffer);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->SetVertexConstantBuffer(slot, buffer);
+}
+
+void RecordingRenderDevice::SetPixelConstantBuffer(uint32_t slot, ID3D11Buffer* buffer)
+{
+	Begin(RenderCommand::SetPixelConstantBuffer);
+	Write(slot);
+	WriteObject(buffer);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->SetPixelConstantBuffer(slot, buffer);
+}
+
+void RecordingRenderDevice::SetVertexConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t first_constant, uint32_t constant_count)
+{
+	Begin(RenderCommand::SetVertexConstantBufferRange);
+	Write(slot);
+	WriteObject(buffer);
+	Write(first_constant);
+	Write(constant_count);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->SetVertexConstantBufferRange(slot, buffer, first_constant, constant_count);
+}
+
+void RecordingRenderDevice::SetPixelConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t first_constant, uint32_t constant_count)
+{
+	Begin(RenderCommand::SetPixelConstantBufferRange);
+	Write(slot);
+	WriteObject(buffer);
+	Write(first_constant);
+	Write(constant_count);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->SetPixelConstantBufferRange(slot, buffer, first_constant, constant_count);
+}
+
+void RecordingRenderDevice::SetPixelShaderResource(uint32_t slot, ID3D11ShaderResourceView* view)
+{
+	Begin(RenderCommand::SetPixelShaderResource);
+	Write(slot);
+	WriteObject(view);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->SetPixelShaderResource(slot, view);
+}
+
+void RecordingRenderDevice::SetPixelSampler(uint32_t slot, ID3D11SamplerState* sampler)
+{
+	Begin(RenderCommand::SetPixelSampler);
+	Write(slot);
+	WriteObject(sampler);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->SetPixelSampler(slot, sampler);
+}
+
+void RecordingRenderDevice::SetRasterizerState(ID3D11RasterizerState* state)
+{
+	Begin(RenderCommand::SetRasterizerState);
+	WriteObject(state);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->SetRasterizerState(state);
+}
+
+void RecordingRenderDevice::SetDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencil_ref)
+{
+	Begin(RenderCommand::SetDepthStencilState);
+	WriteObject(state);
+	Write(stencil_ref);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->SetDepthStencilState(state, stencil_ref);
+}
+
+void RecordingRenderDevice::SetViewport(const RenderViewport& viewport)
+{
+	Begin(RenderCommand::SetViewport);
+	Write(viewport.x);
+	Write(viewport.y);
+	Write(viewport.width);
+	Write(viewport.height);
+	Write(viewport.min_depth);
+	Write(viewport.max_depth);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->SetViewport(viewport);
+}
+
+void RecordingRenderDevice::SetRenderTarget(ID3D11RenderTargetView* render_target, ID3D11DepthStencilView* depth_stencil)
+{
+	Begin(RenderCommand::SetRenderTarget);
+	WriteObject(render_target);
+	WriteObject(depth_stencil);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->SetRenderTarget(render_target, depth_stencil);
+}
+
+void RecordingRenderDevice::ClearRenderTarget(ID3D11RenderTargetView* render_target, const float colour[4])
+{
+	Begin(RenderCommand::ClearRenderTarget);
+	WriteObject(render_target);
+	for (int i = 0; i < 4; ++i)
+	{
+		Write(colour[i]);
+	}
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->ClearRenderTarget(render_target, colour);
+}
+
+void RecordingRenderDevice::ClearDepthStencil(ID3D11DepthStencilView* depth_stencil, uint32_t clear_flags, float depth, uint8_t stencil)
+{
+	Begin(RenderCommand::ClearDepthStencil);
+	WriteObject(depth_stencil);
+	Write(clear_flags);
+	Write(depth);
+	Write(stencil);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->ClearDepthStencil(depth_stencil, clear_flags, depth, stencil);
+}
+
+void RecordingRenderDevice::RecordUpload(RenderCommand command, ID3D11Buffer* buffer, const void* data, uint32_t size)
+{
+	Begin(command);
+	WriteObject(buffer);
+	Write(size);
+
+	// Payload only counts towards the stream size when it is stored
+	if (m_RecordPayloads)
+	{
+		Write(data, size);
+	}
+
+	m_Stats.upload_bytes += size;
+}
+
+void RecordingRenderDevice::UpdateBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size)
+{
+	RecordUpload(RenderCommand::UpdateBuffer, buffer, data, size);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->UpdateBuffer(buffer, data, size);
+}
+
+void RecordingRenderDevice::UpdateDynamicBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size)
+{
+	RecordUpload(RenderCommand::UpdateDynamicBuffer, buffer, data, size);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->UpdateDynamicBuffer(buffer, data, size);
+}
+
+void RecordingRenderDevice::UpdateDynamicBufferRange(ID3D11Buffer* buffer, uint32_t offset, const void* data, uint32_t size, DynamicWrite write)
+{
+	Begin(RenderCommand::UpdateDynamicBufferRange);
+	WriteObject(buffer);
+	Write(offset);
+	Write(static_cast<uint8_t>(write));
+	Write(size);
+
+	// Payload only counts towards the stream size when it is stored
+	if (m_RecordPayloads)
+	{
+		Write(data, size);
+	}
+
+	m_Stats.upload_bytes += size;
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->UpdateDynamicBufferRange(buffer, offset, data, size, write);
+}
+
+void RecordingRenderDevice::CopyTexture(ID3D11Resource* destination, uint32_t destination_subresource, ID3D11Resource* source, uint32_t source_subresource)
+{
+	Begin(RenderCommand::CopyTexture);
+	WriteObject(destination);
+	Write(destination_subresource);
+	WriteObject(source);
+	Write(source_subresource);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->CopyTexture(destination, destination_subresource, source, source_subresource);
+}
+
+void RecordingRenderDevice::Draw(uint32_t vertex_count, uint32_t start_vertex)
+{
+	Begin(RenderCommand::Draw);
+	Write(vertex_count);
+	Write(start_vertex);
+
+	m_Stats.draw_calls++;
+	m_Stats.instance_count++;
+	m_Stats.primitive_count += GetPrimitiveCount(vertex_count);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->Draw(vertex_count, start_vertex);
+}
+
+void RecordingRenderDevice::DrawIndexed(uint32_t index_count, uint32_t start_index, int32_t base_vertex)
+{
+	Begin(RenderCommand::DrawIndexed);
+	Write(index_count);
+	Write(start_index);
+	Write(base_vertex);
+
+	m_Stats.draw_calls++;
+	m_Stats.instance_count++;
+	m_Stats.primitive_count += GetPrimitiveCount(index_count);
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->DrawIndexed(index_count, start_index, base_vertex);
+}
+
+void RecordingRenderDevice::DrawIndexedInstanced(uint32_t index_count, uint32_t instance_count, uint32_t start_index, int32_t base_vertex, uint32_t start_instance)
+{
+	Begin(RenderCommand::DrawIndexedInstanced);
+	Write(index_count);
+	Write(instance_count);
+	Write(start_index);
+	Write(base_vertex);
+	Write(start_instance);
+
+	m_Stats.draw_calls++;
+	m_Stats.instance_count += instance_count;
+	m_Stats.primitive_count += static_cast<uint64_t>(GetPrimitiveCount(index_count)) * instance_count;
+
+	if (m_ForwardDevice != nullptr)
+		m_ForwardDevice->DrawIndexedInstanced(index_count, instance_count, start_index, base_vertex, start_instance);
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "RenderDevice.h"
+#include <vector>
+#include <unordered_map>
+
+// Opcode written at the start of every recorded command
+enum class RenderCommand : uint8_t
+{
+	SetInputLayout,
+	SetVertexBuffer,
+	SetIndexBuffer,
+	SetPrimitiveTopology,
+	SetVertexShader,
+	SetPixelShader,
+	SetVertexConstantBuffer,
+	SetPixelConstantBuffer,
+	SetVertexConstantBufferRange,
+	SetPixelConstantBufferRange,
+	SetPixelShaderResource,
+	SetPixelSampler,
+	SetRasterizerState,
+	SetDepthStencilState,
+	SetViewport,
+	SetRenderTarget,
+	ClearRenderTarget,
+	ClearDepthStencil,
+	UpdateBuffer,
+	UpdateDynamicBuffer,
+	UpdateDynamicBufferRange,
+	CopyTexture,
+	Draw,
+	DrawIndexed,
+	DrawIndexedInstanced,
+
+	Count,
+};
+
+// Counters gathered while recording
+struct RenderDeviceStats
+{
+	// Number of calls per command
+	uint64_t calls[static_cast<size_t>(RenderCommand::Count)] = {};
+
+	// Totals
+	uint64_t total_calls = 0;
+	uint64_t draw_calls = 0;
+	uint64_t instance_count = 0;
+	uint64_t primitive_count = 0;
+	uint64_t upload_bytes = 0;
+	uint64_t stream_bytes = 0;
+};
+
+// Records every command into a compact binary stream instead of (or as well as) issuing it on the GPU
+// Needs no Direct3D device so frame submission can be measured and compared without a window
+//
+// Each command is a one byte opcode followed by its arguments. Objects are replaced with a 32-bit id in the order they are
+// first seen (0 is null), which makes the stream identical between runs and machines for the same submission
+class RecordingRenderDevice : public RenderDevice
+{
+public:
+	// Commands are also forwarded to the target device if one is given
+	RecordingRenderDevice(RenderDevice* forward_device = nullptr);
+	virtual ~RecordingRenderDevice() = default;
+
+	// Change the device commands are forwarded to, null records only
+	inline void SetForwardDevice(RenderDevice* forward_device) { m_ForwardDevice = forward_device; }
+
+	// Clear the stream and counters for the next frame, object ids and allocated memory are kept
+	void Reset();
+
+	// Forget the object ids as well, needed if objects are released and their addresses may be reused
+	void ResetObjects();
+
+	// Store the contents of buffer updates in the stream, otherwise only the size is recorded
+	inline void SetRecordPayloads(bool record) { m_RecordPayloads = record; }
+
+	// Recorded data
+	inline const std::vector<uint8_t>& GetStream() const { return m_Stream; }
+	inline const RenderDeviceStats& GetStats() const { return m_Stats; }
+	inline uint32_t GetObjectCount() const { return static_cast<uint32_t>(m_Objects.size()); }
+
+	// Readable name of a command
+	static const char* GetCommandName(RenderCommand command);
+
+	// Input assembler
+	void SetInputLayout(ID3D11InputLayout* input_layout) override;
+	void SetVertexBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t stride, uint32_t offset) override;
+	void SetIndexBuffer(ID3D11Buffer* buffer, IndexFormat format, uint32_t offset) override;
+	void SetPrimitiveTopology(PrimitiveTopology topology) override;
+
+	// Shaders and their resources
+	void SetVertexShader(ID3D11VertexShader* shader) override;
+	void SetPixelShader(ID3D11PixelShader* shader) override;
+	void SetVertexConstantBuffer(uint32_t slot, ID3D11Buffer* buffer) override;
+	void SetPixelConstantBuffer(uint32_t slot, ID3D11Buffer* buffer) override;
+	void SetVertexConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t first_constant, uint32_t constant_count) override;
+	void SetPixelConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t first_constant, uint32_t constant_count) override;
+	void SetPixelShaderResource(uint32_t slot, ID3D11ShaderResourceView* view) override;
+	void SetPixelSampler(uint32_t slot, ID3D11SamplerState* sampler) override;
+
+	// Rasterizer and output merger
+	void SetRasterizerState(ID3D11RasterizerState* state) override;
+	void SetDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencil_ref) override;
+	void SetViewport(const RenderViewport& viewport) override;
+	void SetRenderTarget(ID3D11RenderTargetView* render_target, ID3D11DepthStencilView* depth_stencil) override;
+	void ClearRenderTarget(ID3D11RenderTargetView* render_target, const float colour[4]) override;
+	void ClearDepthStencil(ID3D11DepthStencilView* depth_stencil, uint32_t clear_flags, float depth, uint8_t stencil) override;
+
+	// Buffers
+	void UpdateBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size) override;
+	void UpdateDynamicBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size) override;
+	void UpdateDynamicBufferRange(ID3D11Buffer* buffer, uint32_t offset, const void* data, uint32_t size, DynamicWrite write) override;
+
+	// Textures
+	void CopyTexture(ID3D11Resource* destination, uint32_t destination_subresource, ID3D11Resource* source, uint32_t source_subresource) override;
+
+	// Draws
+	void Draw(uint32_t vertex_count, uint32_t start_vertex) override;
+	void DrawIndexed(uint32_t index_count, uint32_t start_index, int32_t base_vertex) override;
+	void DrawIndexedInstanced(uint32_t index_count, uint32_t instance_count, uint32_t start_index, int32_t base_vertex, uint32_t start_instance) override;
+
+private:
+	RenderDevice* m_ForwardDevice = nullptr;
+	bool m_RecordPayloads = false;
+
+	// Command stream
+	std::vector<uint8_t> m_Stream;
+	RenderDeviceStats m_Stats;
+
+	// Start a command
+	void Begin(RenderCommand command);
+
+	// Append raw bytes and values to the stream
+	void Write(const void* data, size_t size);
+	void Write(uint8_t value);
+	void Write(uint32_t value);
+	void Write(int32_t value);
+	void Write(float value);
+
+	// Stable id of an object
+	void WriteObject(const void* object);
+	std::unordered_map<const void*, uint32_t> m_Objects;
+
+	// Primitives per vertex of the bound topology, used to count primitives for the stats
+	PrimitiveTopology m_Topology = PrimitiveTopology::TriangleList;
+	uint32_t GetPrimitiveCount(uint32_t vertex_count) const;
+
+	// Buffer updates share the same encoding
+	void RecordUpload(RenderCommand command, ID3D11Buffer* buffer, const void* data, uint32_t size);
+};
@@ -0,0 +1,72 @@
+#include "RenderContext.h"
+#include "Renderer.h"
+#include "D3D11RenderDevice.h"
+#include "RecordingRenderDevice.h"
+#include "StateCacheRenderDevice.h"
+#include "ConstantBufferRing.h"
+
+RenderContext::RenderContext(Renderer* renderer, uint32_t index) : m_Renderer(renderer), m_Index(index)
+{
+	// Create the deferred context
+	DX::Check(m_Renderer->GetDevice()->CreateDeferredContext(0, m_DeferredContext.ReleaseAndGetAddressOf()));
+
+	// Render devices
+	m_D3D11RenderDevice = std::make_unique<D3D11RenderDevice>(m_DeferredContext.Get());
+	m_RecordingRenderDevice = std::make_unique<RecordingRenderDevice>(m_D3D11RenderDevice.get());
+	m_StateCache = std::make_unique<StateCacheRenderDevice>(m_D3D11RenderDevice.get());
+	m_RenderDevice = m_StateCache.get();
+
+	// Same sizes as the renderer's ring
+	if (m_Renderer->SupportsConstantBufferRing())
+	{
+		const uint32_t capacity = 1024 * ConstantRingAllocator::ALIGNMENT;
+		const uint32_t max_capacity = 64 * 1024 * 1024;
+		m_ConstantBufferRing = std::make_unique<ConstantBufferRing>(m_Renderer, capacity, max_capacity);
+	}
+}
+
+RenderContext::~RenderContext() = default;
+
+void RenderContext::Begin(bool record, bool forward_to_gpu)
+{
+	m_ForwardToGpu = forward_to_gpu;
+
+	m_RecordingRenderDevice->Reset();
+	m_RecordingRenderDevice->SetForwardDevice(forward_to_gpu ? m_D3D11RenderDevice.get() : nullptr);
+
+	// A deferred context starts every command list with nothing bound, so the cache starts again too
+	RenderDevice* target = (record || !forward_to_gpu) ? static_cast<RenderDevice*>(m_RecordingRenderDevice.get()) : m_D3D11RenderDevice.get();
+	m_StateCache->SetTarget(target);
+	m_StateCache->ResetStats();
+	m_RenderDevice = m_Renderer->IsStateCacheEnabled() ? m_StateCache.get() : target;
+
+	// The first upload of the command list discards
+	if (m_ConstantBufferRing != nullptr)
+	{
+		m_ConstantBufferRing->BeginFrame();
+	}
+}
+
+void RenderContext::Finish()
+{
+	if (!m_ForwardToGpu)
+	{
+		m_CommandList.Reset();
+		return;
+	}
+
+	// Don't carry the state over, the next recording sets everything it needs
+	DX::Check(m_DeferredContext->FinishCommandList(FALSE, m_CommandList.ReleaseAndGetAddressOf()));
+}
+
+void RenderContext::Execute()
+{
+	if (m_CommandList == nullptr)
+		return;
+
+	m_Renderer->GetDeviceContext()->ExecuteCommandList(m_CommandList.Get(), FALSE);
+	m_CommandList.Reset();
+
+	// Executing resets the immediate context's state, which the renderer's cache doesn't see
+	m_Renderer->GetStateCache()->Invalidate();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <d3d11_1.h>
+#include <memory>
+
+// This include is requires for using DirectX smart pointers (ComPtr)
+#include <wrl\client.h>
+using Microsoft::WRL::ComPtr;
+
+class Renderer;
+class RenderDevice;
+class D3D11RenderDevice;
+class RecordingRenderDevice;
+class StateCacheRenderDevice;
+class ConstantBufferRing;
+
+// A deferred context a worker thread records part of the frame on
+// The commands are closed into a command list by Finish and played back on the immediate context by Execute, in the order the frame is drawn
+class RenderContext
+{
+	Renderer* m_Renderer = nullptr;
+
+public:
+	RenderContext(Renderer* renderer, uint32_t index);
+	virtual ~RenderContext();
+
+	// Start recording, the commands are also recorded for inspection if record is set and only reach Direct3D if forward_to_gpu is set
+	void Begin(bool record, bool forward_to_gpu);
+
+	// Close the recorded commands into a command list
+	void Finish();
+
+	// Play the command list on the immediate context
+	void Execute();
+
+	// Device the worker records with, the state cache in front of the deferred context or the recorder
+	inline RenderDevice* GetRenderDevice() const { return m_RenderDevice; }
+
+	// This context's own ring for per draw constants, null if not supported
+	inline ConstantBufferRing* GetConstantBufferRing() const { return m_ConstantBufferRing.get(); }
+
+	// Commands of the last recording
+	inline const RecordingRenderDevice& GetRecorder() const { return *m_RecordingRenderDevice; }
+
+	// Index of the context, 0 is the immediate context so deferred contexts start at 1
+	inline uint32_t GetIndex() const { return m_Index; }
+
+private:
+	uint32_t m_Index = 0;
+	bool m_ForwardToGpu = true;
+
+	// Deferred context and the command list of the last recording
+	ComPtr<ID3D11DeviceContext> m_DeferredContext = nullptr;
+	ComPtr<ID3D11CommandList> m_CommandList = nullptr;
+
+	// Render devices, set up the same way as the renderer's
+	std::unique_ptr<D3D11RenderDevice> m_D3D11RenderDevice = nullptr;
+	std::unique_ptr<RecordingRenderDevice> m_RecordingRenderDevice = nullptr;
+	std::unique_ptr<StateCacheRenderDevice> m_StateCache = nullptr;
+	RenderDevice* m_RenderDevice = nullptr;
+
+	// Mapping a dynamic buffer on a deferred context must start with a discard, so sharing the renderer's ring is not possible
+	std::unique_ptr<ConstantBufferRing> m_ConstantBufferRing = nullptr;
+};
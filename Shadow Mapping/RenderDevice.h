@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Direct3D objects are only passed through the interface, so forward declarations keep it free of the Direct3D headers
+struct ID3D11Buffer;
+struct ID3D11InputLayout;
+struct ID3D11VertexShader;
+struct ID3D11PixelShader;
+struct ID3D11ShaderResourceView;
+struct ID3D11SamplerState;
+struct ID3D11RasterizerState;
+struct ID3D11DepthStencilState;
+struct ID3D11RenderTargetView;
+struct ID3D11DepthStencilView;
+struct ID3D11Resource;
+
+// Values match D3D11_PRIMITIVE_TOPOLOGY
+enum class PrimitiveTopology : uint32_t
+{
+	LineList = 2,
+	TriangleList = 4,
+};
+
+// Values match DXGI_FORMAT
+enum class IndexFormat : uint32_t
+{
+	UInt32 = 42,
+	UInt16 = 57,
+};
+
+// Values match D3D11_CLEAR_FLAG
+enum RenderClearFlags : uint32_t
+{
+	CLEAR_DEPTH = 0x1,
+	CLEAR_STENCIL = 0x2,
+};
+
+// How a range of a dynamic buffer is mapped
+enum class DynamicWrite
+{
+	// The previous contents are thrown away (D3D11_MAP_WRITE_DISCARD)
+	Discard,
+
+	// Promise not to touch anything the GPU may still be reading (D3D11_MAP_WRITE_NO_OVERWRITE)
+	NoOverwrite,
+};
+
+// Same layout as D3D11_VIEWPORT
+struct RenderViewport
+{
+	float x = 0.0f;
+	float y = 0.0f;
+	float width = 0.0f;
+	float height = 0.0f;
+	float min_depth = 0.0f;
+	float max_depth = 1.0f;
+};
+
+// Every per frame command the sample issues goes through this interface
+// Resources are still created on the ID3D11Device, only binding, updating and drawing is abstracted
+class RenderDevice
+{
+public:
+	RenderDevice() = default;
+	virtual ~RenderDevice() = default;
+
+	// Input assembler
+	virtual void SetInputLayout(ID3D11InputLayout* input_layout) = 0;
+	virtual void SetVertexBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t stride, uint32_t offset) = 0;
+	virtual void SetIndexBuffer(ID3D11Buffer* buffer, IndexFormat format, uint32_t offset) = 0;
+	virtual void SetPrimitiveTopology(PrimitiveTopology topology) = 0;
+
+	// Shaders and their resources
+	virtual void SetVertexShader(ID3D11VertexShader* shader) = 0;
+	virtual void SetPixelShader(ID3D11PixelShader* shader) = 0;
+	virtual void SetVertexConstantBuffer(uint32_t slot, ID3D11Buffer* buffer) = 0;
+	virtual void SetPixelConstantBuffer(uint32_t slot, ID3D11Buffer* buffer) = 0;
+
+	// Bind part of a constant buffer, offset and count are in 16 byte constants and must be multiples of 16 (Direct3D 11.1)
+	virtual void SetVertexConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t first_constant, uint32_t constant_count) = 0;
+	virtual void SetPixelConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t first_constant, uint32_t constant_count) = 0;
+	virtual void SetPixelShaderResource(uint32_t slot, ID3D11ShaderResourceView* view) = 0;
+	virtual void SetPixelSampler(uint32_t slot, ID3D11SamplerState* sampler) = 0;
+
+	// Rasterizer and output merger
+	virtual void SetRasterizerState(ID3D11RasterizerState* state) = 0;
+	virtual void SetDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencil_ref) = 0;
+	virtual void SetViewport(const RenderViewport& viewport) = 0;
+	virtual void SetRenderTarget(ID3D11RenderTargetView* render_target, ID3D11DepthStencilView* depth_stencil) = 0;
+	virtual void ClearRenderTarget(ID3D11RenderTargetView* render_target, const float colour[4]) = 0;
+	virtual void ClearDepthStencil(ID3D11DepthStencilView* depth_stencil, uint32_t clear_flags, float depth, uint8_t stencil) = 0;
+
+	// Replace the contents of a default usage buffer (UpdateSubresource), size must be the size of the whole buffer
+	virtual void UpdateBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size) = 0;
+
+	// Replace the contents of a dynamic buffer (Map with WRITE_DISCARD)
+	virtual void UpdateDynamicBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size) = 0;
+
+	// Write a range of a dynamic buffer
+	virtual void UpdateDynamicBufferRange(ID3D11Buffer* buffer, uint32_t offset, const void* data, uint32_t size, DynamicWrite write) = 0;
+
+	// Copy a whole subresource between textures of the same size and format (CopySubresourceRegion)
+	virtual void CopyTexture(ID3D11Resource* destination, uint32_t destination_subresource, ID3D11Resource* source, uint32_t source_subresource) = 0;
+
+	// Draws
+	virtual void Draw(uint32_t vertex_count, uint32_t start_vertex) = 0;
+	virtual void DrawIndexed(uint32_t index_count, uint32_t start_index, int32_t base_vertex) = 0;
+	virtual void DrawIndexedInstanced(uint32_t index_count, uint32_t instance_count, uint32_t start_index, int32_t base_vertex, uint32_t start_instance) = 0;
+};
@@ -0,0 +1,158 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// Bit positions of the key fields
+	const uint32_t PASS_SHIFT = 60;
+	const uint32_t TRANSLUCENT_SHIFT = 59;
+
+	const uint32_t OPAQUE_SHADER_SHIFT = 49;
+	const uint32_t OPAQUE_MATERIAL_SHIFT = 37;
+	const uint32_t OPAQUE_TEXTURE_SHIFT = 25;
+	const uint32_t OPAQUE_DEPTH_SHIFT = 0;
+
+	const uint32_t TRANSLUCENT_DEPTH_SHIFT = 34;
+	const uint32_t TRANSLUCENT_SHADER_SHIFT = 24;
+	const uint32_t TRANSLUCENT_MATERIAL_SHIFT = 12;
+	const uint32_t TRANSLUCENT_TEXTURE_SHIFT = 0;
+
+	// Radix sort in 8 passes of 8 bits
+	const uint32_t RADIX_BITS = 8;
+	const uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+	const uint32_t RADIX_PASSES = 64 / RADIX_BITS;
+}
+
+void RenderQueue::SetDepthRange(float near_depth, float far_depth)
+{
+	m_DepthNear = near_depth;
+	m_DepthScale = (far_depth > near_depth) ? static_cast<float>(MAX_DEPTH) / (far_depth - near_depth) : 0.0f;
+}
+
+uint32_t RenderQueue::QuantizeDepth(float depth) const
+{
+	float scaled = (depth - m_DepthNear) * m_DepthScale;
+
+	// Also catches NaN
+	if (!(scaled > 0.0f))
+		return 0;
+
+	if (scaled >= static_cast<float>(MAX_DEPTH))
+		return MAX_DEPTH;
+
+	return static_cast<uint32_t>(scaled);
+}
+
+uint64_t RenderQueue::MakeOpaqueKey(uint32_t pass, uint32_t shader, uint32_t material, uint32_t texture, float depth) const
+{
+	return (static_cast<uint64_t>(std::min(pass, MAX_PASS)) << PASS_SHIFT) |
+		(static_cast<uint64_t>(std::min(shader, MAX_SHADER)) << OPAQUE_SHADER_SHIFT) |
+		(static_cast<uint64_t>(std::min(material, MAX_MATERIAL)) << OPAQUE_MATERIAL_SHIFT) |
+		(static_cast<uint64_t>(std::min(texture, MAX_TEXTURE)) << OPAQUE_TEXTURE_SHIFT) |
+		(static_cast<uint64_t>(QuantizeDepth(depth)) << OPAQUE_DEPTH_SHIFT);
+}
+
+uint64_t RenderQueue::MakeTranslucentKey(uint32_t pass, uint32_t shader, uint32_t material, uint32_t texture, float depth) const
+{
+	// Farthest first, so the depth is inverted
+	uint32_t inverted_depth = MAX_DEPTH - QuantizeDepth(depth);
+
+	return (static_cast<uint64_t>(std::min(pass, MAX_PASS)) << PASS_SHIFT) |
+		(1ull << TRANSLUCENT_SHIFT) |
+		(static_cast<uint64_t>(inverted_depth) << TRANSLUCENT_DEPTH_SHIFT) |
+		(static_cast<uint64_t>(std::min(shader, MAX_SHADER)) << TRANSLUCENT_SHADER_SHIFT) |
+		(static_cast<uint64_t>(std::min(material, MAX_MATERIAL)) << TRANSLUCENT_MATERIAL_SHIFT) |
+		(static_cast<uint64_t>(std::min(texture, MAX_TEXTURE)) << TRANSLUCENT_TEXTURE_SHIFT);
+}
+
+void RenderQueue::Reserve(uint32_t capacity)
+{
+	if (capacity > m_Buffers[0].size())
+	{
+		this->Grow(capacity);
+	}
+}
+
+void RenderQueue::Grow(uint32_t capacity)
+{
+	// Keep what has been submitted so far
+	std::vector<RenderQueueItem> items(m_Items, m_Items + m_Count);
+
+	m_Buffers[0].resize(capacity);
+	m_Buffers[1].resize(capacity);
+	std::copy(items.begin(), items.end(), m_Buffers[0].begin());
+
+	m_Current = 0;
+	m_Items = m_Buffers[0].data();
+}
+
+void RenderQueue::Clear()
+{
+	m_Count = 0;
+	m_Current = 0;
+	m_Items = m_Buffers[0].data();
+}
+
+void RenderQueue::Submit(uint64_t key, uint32_t payload)
+{
+	// Only allocates while the scene is growing
+	if (m_Count == m_Buffers[0].size())
+	{
+		this->Grow(std::max<uint32_t>(1024, m_Count * 2));
+	}
+
+	m_Items[m_Count].key = key;
+	m_Items[m_Count].payload = payload;
+	m_Count++;
+}
+
+void RenderQueue::Sort()
+{
+	if (m_Count < 2)
+		return;
+
+	// Count every digit of every key in a single read of the items
+	uint32_t histograms[RADIX_PASSES][RADIX_SIZE];
+	std::memset(histograms, 0, sizeof(histograms));
+
+	for (uint32_t i = 0; i < m_Count; ++i)
+	{
+		uint64_t key = m_Items[i].key;
+		for (uint32_t pass = 0; pass < RADIX_PASSES; ++pass)
+		{
+			histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+		}
+	}
+
+	// Least significant digit first, each pass is a stable scatter into the other buffer
+	for (uint32_t pass = 0; pass < RADIX_PASSES; ++pass)
+	{
+		uint32_t shift = pass * RADIX_BITS;
+		uint32_t* histogram = histograms[pass];
+
+		// Every key has the same digit, nothing would move
+		if (histogram[(m_Items[0].key >> shift) & (RADIX_SIZE - 1)] == m_Count)
+			continue;
+
+		// Turn the counts into starting offsets
+		uint32_t offset = 0;
+		for (uint32_t digit = 0; digit < RADIX_SIZE; ++digit)
+		{
+			uint32_t count = histogram[digit];
+			histogram[digit] = offset;
+			offset += count;
+		}
+
+		RenderQueueItem* source = m_Items;
+		RenderQueueItem* destination = m_Buffers[1 - m_Current].data();
+		for (uint32_t i = 0; i < m_Count; ++i)
+		{
+			uint32_t digit = (source[i].key >> shift) & (RADIX_SIZE - 1);
+			destination[histogram[digit]++] = source[i];
+		}
+
+		m_Current = 1 - m_Current;
+		m_Items = destination;
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// A submitted draw, the payload is whatever the caller needs to find the draw again
+struct RenderQueueItem
+{
+	uint64_t key;
+	uint32_t payload;
+};
+
+// Collects draws with a 64-bit sort key and orders them with a radix sort
+//
+// Opaque keys:      pass (4) | 0 | shader (10) | material (12) | texture (12) | depth (25), front to back
+// Translucent keys: pass (4) | 1 | inverted depth (25) | shader (10) | material (12) | texture (12), back to front
+//
+// Opaque draws are grouped by state first so the fewest binds are needed, the depth only orders draws sharing all state,
+// which still gives early depth rejection within each group. Storage is kept between frames so a steady scene never allocates
+class RenderQueue
+{
+public:
+	RenderQueue() = default;
+	virtual ~RenderQueue() = default;
+
+	// Field limits
+	static constexpr uint32_t MAX_PASS = (1u << 4) - 1;
+	static constexpr uint32_t MAX_SHADER = (1u << 10) - 1;
+	static constexpr uint32_t MAX_MATERIAL = (1u << 12) - 1;
+	static constexpr uint32_t MAX_TEXTURE = (1u << 12) - 1;
+	static constexpr uint32_t MAX_DEPTH = (1u << 25) - 1;
+
+	// View space depth range mapped onto the depth bits, anything outside is clamped
+	void SetDepthRange(float near_depth, float far_depth);
+
+	// Build sort keys
+	uint64_t MakeOpaqueKey(uint32_t pass, uint32_t shader, uint32_t material, uint32_t texture, float depth) const;
+	uint64_t MakeTranslucentKey(uint32_t pass, uint32_t shader, uint32_t material, uint32_t texture, float depth) const;
+
+	// Make room for this many draws up front
+	void Reserve(uint32_t capacity);
+
+	// Start a new list of draws, keeps the allocated storage
+	void Clear();
+
+	// Add a draw
+	void Submit(uint64_t key, uint32_t payload);
+
+	// Order the draws by key, stable for equal keys
+	void Sort();
+
+	// Draws in submission order before Sort, in key order after
+	inline const RenderQueueItem* begin() const { return m_Items; }
+	inline const RenderQueueItem* end() const { return m_Items + m_Count; }
+	inline uint32_t GetCount() const { return m_Count; }
+
+private:
+	float m_DepthNear = 0.0f;
+	float m_DepthScale = 1.0f;
+	uint32_t QuantizeDepth(float depth) const;
+
+	// Two buffers, the sort moves the items between them and m_Items points at the one holding the result
+	std::vector<RenderQueueItem> m_Buffers[2];
+	RenderQueueItem* m_Items = nullptr;
+	uint32_t m_Count = 0;
+	uint32_t m_Current = 0;
+
+	// Grow both buffers
+	void Grow(uint32_t capacity);
+};
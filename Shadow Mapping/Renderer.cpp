@@ -1,13 +1,29 @@
 #include "Renderer.h"
 #include "Application.h"
 #include "Window.h"
+#include "D3D11RenderDevice.h"
+#include "RecordingRenderDevice.h"
+#include "StateCacheRenderDevice.h"
+#include "ConstantBufferRing.h"
+#include "RenderContext.h"
+#include "UploadQueue.h"
+#include "D3D11UploadBackend.h"
+#include "GeometryArena.h"
 
 #include <DirectXColors.h>
 
+namespace
+{
+	// Context the calling thread records on, null for the immediate context
+	thread_local RenderContext* t_RenderContext = nullptr;
+}
+
 Renderer::Renderer(Application* application) : m_Application(application)
 {
 }
 
+Renderer::~Renderer() = default;
+
 void Renderer::Create()
 {
 	int window_width, window_height;
@@ -19,6 +35,7 @@ void Renderer::Create()
 	CreateRenderTargetAndDepthStencilView(window_width, window_height);
 	SetViewport(window_width, window_height);
 	CreateRasterState();
+	CreateConstantBufferRing();
 }
 
 void Renderer::CreateDeviceAndContext()
@@ -55,6 +72,131 @@ void Renderer::CreateDeviceAndContext()
 		MessageBox(NULL, L"Unsupported", L"D3D_FEATURE_LEVEL_11_0 is not supported", MB_OK);
 		throw std::exception();
 	}
+
+	// Per frame commands go through the state cache, which forwards to Direct3D or to the recorder while capturing
+	m_D3D11RenderDevice = std::make_unique<D3D11RenderDevice>(m_DeviceContext.Get());
+	m_RecordingRenderDevice = std::make_unique<RecordingRenderDevice>(m_D3D11RenderDevice.get());
+	m_StateCache = std::make_unique<StateCacheRenderDevice>(m_D3D11RenderDevice.get());
+	UpdateRenderDevice();
+
+	// Uploads are copied on the immediate context at the start of each frame
+	m_UploadQueue = std::make_unique<UploadQueue>();
+	m_UploadBackend = std::make_unique<D3D11UploadBackend>(m_Device.Get(), m_DeviceContext.Get());
+
+	// Room for 64K vertices to start with, grows when a mesh doesn't fit
+	m_GeometryArena = std::make_unique<GeometryArena>(this, 64 * 1024, 192 * 1024);
+}
+
+void Renderer::UpdateRenderDevice()
+{
+	RenderDevice* target = m_Capturing ? static_cast<RenderDevice*>(m_RecordingRenderDevice.get()) : m_D3D11RenderDevice.get();
+
+	// The cache can't know what the new target has bound, so it starts again
+	m_StateCache->SetTarget(target);
+	m_RenderDevice = m_UseStateCache ? m_StateCache.get() : target;
+}
+
+RenderDevice* Renderer::GetRenderDevice() const
+{
+	return (t_RenderContext != nullptr) ? t_RenderContext->GetRenderDevice() : m_RenderDevice;
+}
+
+ConstantBufferRing* Renderer::GetConstantBufferRing() const
+{
+	if (!m_UseConstantBufferRing)
+		return nullptr;
+
+	return (t_RenderContext != nullptr) ? t_RenderContext->GetConstantBufferRing() : m_ConstantBufferRing.get();
+}
+
+RenderContext* Renderer::GetRenderContext(uint32_t index)
+{
+	if (index == 0 || index > MAX_RENDER_CONTEXTS)
+		return nullptr;
+
+	if (m_RenderContexts.size() < index)
+	{
+		m_RenderContexts.resize(index);
+	}
+
+	std::unique_ptr<RenderContext>& context = m_RenderContexts[index - 1];
+	if (context == nullptr)
+	{
+		context = std::make_unique<RenderContext>(this, index);
+	}
+
+	return context.get();
+}
+
+void Renderer::BindRenderContext(RenderContext* context)
+{
+	t_RenderContext = context;
+}
+
+uint32_t Renderer::GetRenderContextIndex() const
+{
+	return (t_RenderContext != nullptr) ? t_RenderContext->GetIndex() : 0;
+}
+
+void Renderer::SetStateCacheEnabled(bool enabled)
+{
+	m_UseStateCache = enabled;
+	UpdateRenderDevice();
+}
+
+void Renderer::CreateConstantBufferRing()
+{
+	// Binding with offsets and mapping constant buffers with NO_OVERWRITE both need Direct3D 11.1 support
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (FAILED(m_Device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+		return;
+
+	if (!options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer)
+		return;
+
+	// Starts with room for 1024 draws and grows when a frame runs out
+	const uint32_t capacity = 1024 * ConstantRingAllocator::ALIGNMENT;
+	const uint32_t max_capacity = 64 * 1024 * 1024;
+	m_ConstantBufferRing = std::make_unique<ConstantBufferRing>(this, capacity, max_capacity);
+}
+
+void Renderer::BeginFrame()
+{
+	// Close the holes left by removed meshes
+	m_GeometryArena->CompactIfFragmented();
+
+	// Copy this frame's share of the queued uploads before anything is drawn
+	m_UploadQueue->Flush(*m_UploadBackend, m_UploadBudget);
+
+	if (m_ConstantBufferRing != nullptr)
+	{
+		m_ConstantBufferRing->BeginFrame();
+	}
+
+	m_StateCache->ResetStats();
+}
+
+void Renderer::FlushUploads()
+{
+	m_UploadQueue->Flush(*m_UploadBackend, UploadQueue::UNLIMITED_BUDGET);
+}
+
+void Renderer::BeginCapture(bool forward_to_gpu)
+{
+	m_RecordingRenderDevice->Reset();
+	m_RecordingRenderDevice->SetForwardDevice(forward_to_gpu ? m_D3D11RenderDevice.get() : nullptr);
+
+	m_Capturing = true;
+	UpdateRenderDevice();
+	m_StateCache->ResetStats();
+}
+
+const RecordingRenderDevice& Renderer::EndCapture()
+{
+	m_Capturing = false;
+	UpdateRenderDevice();
+
+	return *m_RecordingRenderDevice;
 }
 
 void Renderer::CreateSwapChain(int width, int height)
@@ -141,37 +283,44 @@ void Renderer::CreateRenderTargetAndDepthStencilView(int width, int height)
 	DX::Check(m_Device->CreateDepthStencilView(depth_stencil.Get(), nullptr, m_DepthStencilView.GetAddressOf()));
 
 	// Binds both the render target and depth stencil to the pipeline's output merger stage
-	m_DeviceContext->OMSetRenderTargets(1, m_RenderTargetView.GetAddressOf(), m_DepthStencilView.Get());
+	m_RenderDevice->SetRenderTarget(m_RenderTargetView.Get(), m_DepthStencilView.Get());
 }
 
 void Renderer::SetViewport(int width, int height)
 {
 	// Describe the viewport
-	D3D11_VIEWPORT viewport = {};
-	viewport.Width = static_cast<float>(width);
-	viewport.Height = static_cast<float>(height);
-	viewport.MinDepth = 0.0f;
-	viewport.MaxDepth = 1.0f;
-	viewport.TopLeftX = 0;
-	viewport.TopLeftY = 0;
+	RenderViewport viewport = {};
+	viewport.width = static_cast<float>(width);
+	viewport.height = static_cast<float>(height);
+	viewport.min_depth = 0.0f;
+	viewport.max_depth = 1.0f;
+	viewport.x = 0;
+	viewport.y = 0;
 
 	// Bind viewport to the pipline's rasterization stage
-	m_DeviceContext->RSSetViewports(1, &viewport);
+	GetRenderDevice()->SetViewport(viewport);
 }
 
 void Renderer::SetRasterState()
 {
-	m_DeviceContext->RSSetState(m_RasterState.Get());
+	GetRenderDevice()->SetRasterizerState(m_RasterState.Get());
 }
 
 void Renderer::Clear()
 {
+	RenderDevice* device = GetRenderDevice();
+
 	// Clear the render target view to the chosen colour
-	m_DeviceContext->ClearRenderTargetView(m_RenderTargetView.Get(), reinterpret_cast<const float*>(&DirectX::Colors::SteelBlue));
-	m_DeviceContext->ClearDepthStencilView(m_DepthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	device->ClearRenderTarget(m_RenderTargetView.Get(), reinterpret_cast<const float*>(&DirectX::Colors::SteelBlue));
+	device->ClearDepthStencil(m_DepthStencilView.Get(), CLEAR_DEPTH | CLEAR_STENCIL, 1.0f, 0);
 
 	// Bind the render target view to the pipeline's output merger stage
-	m_DeviceContext->OMSetRenderTargets(1, m_RenderTargetView.GetAddressOf(), m_DepthStencilView.Get());
+	this->BindRenderTarget();
+}
+
+void Renderer::BindRenderTarget()
+{
+	GetRenderDevice()->SetRenderTarget(m_RenderTargetView.Get(), m_DepthStencilView.Get());
 }
 
 void Renderer::Present()
@@ -199,6 +348,9 @@ void Renderer::Resize(int width, int height)
 	if (width <= 0 || height <= 0)
 		return;
 
+	// The views are about to be recreated and may reuse the addresses of the old ones
+	m_StateCache->Invalidate();
+
 	// Releases the current render target and depth stencil view
 	m_DepthStencilView.ReleaseAndGetAddressOf();
 	m_RenderTargetView.ReleaseAndGetAddressOf();
@@ -2,12 +2,23 @@
 
 #include <d3d11_1.h>
 #include <exception>
+#include <memory>
+#include <vector>
 
 // This include is requires for using DirectX smart pointers (ComPtr)
 #include <wrl\client.h>
 using Microsoft::WRL::ComPtr;
 
 class Application;
+class RenderDevice;
+class D3D11RenderDevice;
+class RecordingRenderDevice;
+class StateCacheRenderDevice;
+class ConstantBufferRing;
+class RenderContext;
+class UploadQueue;
+class D3D11UploadBackend;
+class GeometryArena;
 
 namespace DX
 {
@@ -29,7 +40,7 @@ class Renderer
 
 public:
 	Renderer(Application* application);
-	virtual ~Renderer() = default;
+	virtual ~Renderer();
 
 	// Creates the rendering device and context
 	void Create();
@@ -37,6 +48,9 @@ public:
 	// Clear the buffers
 	void Clear();
 
+	// Bind the back buffer without clearing it
+	void BindRenderTarget();
+
 	// Display the rendered scene
 	void Present();
 
@@ -55,12 +69,80 @@ public:
 	// Get render context
 	inline ID3D11DeviceContext* GetDeviceContext() const { return m_DeviceContext.Get(); }
 
+	// Device every per frame command goes through, this is the state cache in front of Direct3D or the recorder
+	// On a thread with a render context bound this is the context's device instead
+	RenderDevice* GetRenderDevice() const;
+
+	// Drop binds that don't change the pipeline state
+	inline StateCacheRenderDevice* GetStateCache() const { return m_StateCache.get(); }
+	inline bool IsStateCacheEnabled() const { return m_UseStateCache; }
+	void SetStateCacheEnabled(bool enabled);
+
+	// Start a new frame of per frame allocations
+	void BeginFrame();
+
+	// Shared ring for per draw constants, null if constant buffer offsets are not supported or the ring is disabled
+	// On a thread with a render context bound this is the context's ring instead
+	ConstantBufferRing* GetConstantBufferRing() const;
+	inline bool SupportsConstantBufferRing() const { return m_ConstantBufferRing != nullptr; }
+	inline void SetConstantBufferRingEnabled(bool enabled) { m_UseConstantBufferRing = enabled; }
+
+	// Static data is queued here and copied to the GPU by BeginFrame, at most the upload budget a frame
+	inline UploadQueue* GetUploadQueue() const { return m_UploadQueue.get(); }
+	inline void SetUploadBudget(uint64_t bytes) { m_UploadBudget = bytes; }
+	inline uint64_t GetUploadBudget() const { return m_UploadBudget; }
+
+	// Copy every queued upload now, ignoring the budget
+	void FlushUploads();
+
+	// Shared vertex and index buffers of the static meshes
+	inline GeometryArena* GetGeometryArena() const { return m_GeometryArena.get(); }
+
+	// Record the commands between these calls, they are only issued on the GPU if forward_to_gpu is set
+	void BeginCapture(bool forward_to_gpu = true);
+	const RecordingRenderDevice& EndCapture();
+
+	// Deferred contexts for recording on worker threads, index 1 to MAX_RENDER_CONTEXTS, created on first use from the main thread
+	static const uint32_t MAX_RENDER_CONTEXTS = 16;
+	RenderContext* GetRenderContext(uint32_t index);
+
+	// Send the calling thread's commands to the context, null goes back to the immediate context
+	void BindRenderContext(RenderContext* context);
+
+	// Index of the context bound to the calling thread, 0 for the immediate context
+	uint32_t GetRenderContextIndex() const;
+
 private:
 	// Device and device context
 	ComPtr<ID3D11Device> m_Device = nullptr;
 	ComPtr<ID3D11DeviceContext> m_DeviceContext = nullptr;
 	void CreateDeviceAndContext();
 
+	// Render devices
+	std::unique_ptr<D3D11RenderDevice> m_D3D11RenderDevice = nullptr;
+	std::unique_ptr<RecordingRenderDevice> m_RecordingRenderDevice = nullptr;
+	std::unique_ptr<StateCacheRenderDevice> m_StateCache = nullptr;
+	RenderDevice* m_RenderDevice = nullptr;
+	bool m_UseStateCache = true;
+	bool m_Capturing = false;
+	void UpdateRenderDevice();
+
+	// Deferred contexts
+	std::vector<std::unique_ptr<RenderContext>> m_RenderContexts;
+
+	// Constant buffer ring, only created if the device can bind constant buffer ranges
+	std::unique_ptr<ConstantBufferRing> m_ConstantBufferRing = nullptr;
+	bool m_UseConstantBufferRing = true;
+	void CreateConstantBufferRing();
+
+	// Uploads of static data
+	std::unique_ptr<UploadQueue> m_UploadQueue = nullptr;
+	std::unique_ptr<D3D11UploadBackend> m_UploadBackend = nullptr;
+	uint64_t m_UploadBudget = 4 * 1024 * 1024;
+
+	// Static meshes
+	std::unique_ptr<GeometryArena> m_GeometryArena = nullptr;
+
 	// Swapchain
 	ComPtr<IDXGISwapChain> m_SwapChain = nullptr;
 	ComPtr<IDXGISwapChain1> m_SwapChain1 = nullptr;
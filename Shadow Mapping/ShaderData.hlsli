@@ -6,6 +6,22 @@ struct VertexInput
     float2 uv : TEXCOORD;
 };
 
+// Instanced vertex input, each row of the model matrices is a separate per instance element
+struct InstancedVertexInput
+{
+    float3 position : POSITION;
+    float3 normal : NORMAL;
+    float2 uv : TEXCOORD;
+    float4 model0 : MODEL0;
+    float4 model1 : MODEL1;
+    float4 model2 : MODEL2;
+    float4 model3 : MODEL3;
+    float4 model_inverse0 : MODELINVERSE0;
+    float4 model_inverse1 : MODELINVERSE1;
+    float4 model_inverse2 : MODELINVERSE2;
+    float4 model_inverse3 : MODELINVERSE3;
+};
+
 // Pixel input structure
 struct PixelInput
 {
@@ -13,7 +29,8 @@ struct PixelInput
     float3 position : POSITION;
     float3 normal : NORMAL;
     float2 uv : TEXCOORD;
-    float4 lightViewProjection : TEXCOORD1;
+    float3 worldPosition : TEXCOORD1;
+    float cascadeDepth : TEXCOORD2;
 };
 
 // World constant buffer
@@ -30,14 +47,45 @@ cbuffer CameraBuffer : register(b1)
     float4 cCameraPosition;
 }
 
-// Directional light constant buffer
+// Most cascades the shadow map array holds
+#define MAX_SHADOW_CASCADES 4
+
+// Directional light constant buffer, the cascades are picked by depth in the cascade view
 cbuffer DirectionalLightBuffer : register(b2)
 {
     float4 cLightDirection;
-    matrix cLightView;
-    matrix cLightProjection;
+    matrix cCascadeView;
+    matrix cCascadeViewProjection[MAX_SHADOW_CASCADES];
+    float4 cCascadeSplits;
+    uint cCascadeCount;
 }
 
-// Shadow map
-Texture2D gShadowMap : register(t0);
-SamplerComparisonState gShadowSampler : register(s0);
\ No newline at end of file
+// Most local lights and shadow views, a point light has a view per cube face
+#define MAX_LOCAL_LIGHTS 32
+#define MAX_LOCAL_SHADOW_VIEWS 96
+
+// Point or spot light, info.x is the first shadow view or -1 and info.y is 1 for point lights
+struct LocalLight
+{
+    float4 positionRange;
+    float4 directionSpotCos;
+    float4 colour;
+    int4 info;
+};
+
+// Local lights and the atlas tile of each shadow view, tiles are the scale in xy and the offset in zw
+cbuffer LocalLightBuffer : register(b3)
+{
+    LocalLight cLocalLights[MAX_LOCAL_LIGHTS];
+    matrix cShadowViewProjection[MAX_LOCAL_SHADOW_VIEWS];
+    float4 cShadowTiles[MAX_LOCAL_SHADOW_VIEWS];
+    uint cLocalLightCount;
+    float cShadowAtlasTexelSize;
+}
+
+// Shadow map, one slice per cascade
+Texture2DArray gShadowMap : register(t0);
+SamplerComparisonState gShadowSampler : register(s0);
+
+// Shadow atlas of the local lights
+Texture2D gShadowAtlas : register(t1);
\ No newline at end of file
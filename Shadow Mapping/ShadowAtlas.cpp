@@ -0,0 +1,436 @@
+#include "ShadowAtlas.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+	// Target level of a light that doesn't fit at all
+	const uint32_t NO_LEVEL = 0xFFFFFFFF;
+
+	// How far past the next tile size a light's importance has to move before its tile is resized, on top of the half way point
+	const float RESIZE_HYSTERESIS = 1.25f;
+
+	uint32_t Log2(uint32_t value)
+	{
+		uint32_t result = 0;
+		while (value > 1)
+		{
+			value >>= 1;
+			result++;
+		}
+
+		return result;
+	}
+
+	// Every other bit of a Morton index, the other axis is the same shifted down by one
+	uint32_t CompactBits(uint32_t value)
+	{
+		value &= 0x55555555;
+		value = (value | (value >> 1)) & 0x33333333;
+		value = (value | (value >> 2)) & 0x0F0F0F0F;
+		value = (value | (value >> 4)) & 0x00FF00FF;
+		value = (value | (value >> 8)) & 0x0000FFFF;
+		return value;
+	}
+}
+
+ShadowAtlas::ShadowAtlas(uint32_t atlas_size, uint32_t min_tile_size, uint32_t max_tile_size) : m_AtlasSize(atlas_size), m_MinTileSize(min_tile_size), m_MaxTileSize(max_tile_size)
+{
+	m_LevelCount = Log2(atlas_size / min_tile_size) + 1;
+	m_MinLevel = Log2(atlas_size / max_tile_size);
+
+	// Each level has four times the nodes of the one above
+	m_LevelStart.resize(m_LevelCount + 1);
+	uint32_t node_count = 0;
+	for (uint32_t level = 0; level < m_LevelCount; ++level)
+	{
+		m_LevelStart[level] = node_count;
+		node_count += 1u << (2 * level);
+	}
+
+	m_LevelStart[m_LevelCount] = node_count;
+
+	// Only the root is free to start with, everything below it appears as it is split
+	m_Nodes.resize(node_count, NodeState::Unused);
+	m_Nodes[0] = NodeState::Free;
+}
+
+float ShadowAtlas::CalculateImportance(const XMFLOAT3& center, float radius, const XMMATRIX& view, const XMMATRIX& projection)
+{
+	// Depth of the sphere's center in front of the camera, anything the camera is inside of fills the screen
+	XMVECTOR view_center = XMVector3TransformCoord(XMLoadFloat3(&center), view);
+	float depth = XMVectorGetZ(view_center);
+	if (depth + radius <= 0.0f)
+		return 0.0f;
+
+	float distance = XMVectorGetX(XMVector3Length(view_center));
+	if (distance <= radius)
+		return 1.0f;
+
+	// Projected radius as a fraction of half the screen's height, the projection's _22 is the cotangent of half the field of view
+	XMFLOAT4X4 projection_values;
+	XMStoreFloat4x4(&projection_values, projection);
+	return std::min(1.0f, radius * projection_values._22 / distance);
+}
+
+uint32_t ShadowAtlas::GetTileSize(uint32_t level) const
+{
+	return m_AtlasSize >> level;
+}
+
+uint32_t ShadowAtlas::GetNodeLevel(uint32_t node) const
+{
+	uint32_t level = 0;
+	while (node >= m_LevelStart[level + 1])
+	{
+		level++;
+	}
+
+	return level;
+}
+
+ShadowAtlasTile ShadowAtlas::GetNodeTile(uint32_t node) const
+{
+	uint32_t level = this->GetNodeLevel(node);
+	uint32_t index = node - m_LevelStart[level];
+
+	ShadowAtlasTile tile;
+	tile.size = this->GetTileSize(level);
+	tile.x = CompactBits(index) * tile.size;
+	tile.y = CompactBits(index >> 1) * tile.size;
+	return tile;
+}
+
+bool ShadowAtlas::AllocateNode(uint32_t level, uint32_t& node)
+{
+	// The smallest free node that is big enough, starting at the wanted size so splits are only made when nothing else fits
+	for (int32_t search_level = static_cast<int32_t>(level); search_level >= 0; --search_level)
+	{
+		uint32_t first = m_LevelStart[search_level];
+		uint32_t last = m_LevelStart[search_level + 1];
+		for (uint32_t i = first; i < last; ++i)
+		{
+			if (m_Nodes[i] != NodeState::Free)
+				continue;
+
+			// Split down to the wanted size, always keeping the first child
+			uint32_t current = i;
+			for (uint32_t current_level = static_cast<uint32_t>(search_level); current_level < level; ++current_level)
+			{
+				m_Nodes[current] = NodeState::Split;
+
+				uint32_t first_child = m_LevelStart[current_level + 1] + (current - m_LevelStart[current_level]) * 4;
+				for (uint32_t child = 0; child < 4; ++child)
+				{
+					m_Nodes[first_child + child] = NodeState::Free;
+				}
+
+				current = first_child;
+			}
+
+			m_Nodes[current] = NodeState::Used;
+			node = current;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ShadowAtlas::FreeNode(uint32_t node)
+{
+	m_Nodes[node] = NodeState::Free;
+
+	// Merge with the siblings while all four are free
+	uint32_t level = this->GetNodeLevel(node);
+	while (level > 0)
+	{
+		uint32_t index = node - m_LevelStart[level];
+		uint32_t first_sibling = m_LevelStart[level] + (index & ~3u);
+		for (uint32_t sibling = 0; sibling < 4; ++sibling)
+		{
+			if (m_Nodes[first_sibling + sibling] != NodeState::Free)
+				return;
+		}
+
+		for (uint32_t sibling = 0; sibling < 4; ++sibling)
+		{
+			m_Nodes[first_sibling + sibling] = NodeState::Unused;
+		}
+
+		level--;
+		node = m_LevelStart[level] + index / 4;
+		m_Nodes[node] = NodeState::Free;
+	}
+}
+
+bool ShadowAtlas::AllocateEntry(Entry& entry, uint32_t level)
+{
+	for (uint32_t face = 0; face < entry.allocation.face_count; ++face)
+	{
+		if (!this->AllocateNode(level, entry.nodes[face]))
+		{
+			// Give back the faces that did fit
+			for (uint32_t i = 0; i < face; ++i)
+			{
+				this->FreeNode(entry.nodes[i]);
+			}
+
+			return false;
+		}
+
+		entry.allocation.faces[face] = this->GetNodeTile(entry.nodes[face]);
+	}
+
+	entry.level = level;
+	entry.allocation.moved = true;
+	return true;
+}
+
+void ShadowAtlas::FreeEntry(Entry& entry)
+{
+	for (uint32_t face = 0; face < entry.allocation.face_count; ++face)
+	{
+		this->FreeNode(entry.nodes[face]);
+	}
+}
+
+uint32_t ShadowAtlas::GetTargetLevel(float importance, const Entry* current) const
+{
+	float wanted_size = importance * static_cast<float>(m_MaxTileSize);
+
+	// Keep the current tile until the wanted size is well past the half way point to the next size
+	if (current != nullptr)
+	{
+		float size = static_cast<float>(this->GetTileSize(current->level));
+		float lower = (current->level + 1 >= m_LevelCount) ? 0.0f : size / (std::sqrt(2.0f) * RESIZE_HYSTERESIS);
+		float upper = (current->level <= m_MinLevel) ? FLT_MAX : size * std::sqrt(2.0f) * RESIZE_HYSTERESIS;
+		if (wanted_size >= lower && wanted_size <= upper)
+			return current->level;
+	}
+
+	// Nearest power of two, clamped to the tile sizes handed out
+	float size_log = std::round(std::log2(std::max(wanted_size, 1.0f)));
+	uint32_t size = 1u << static_cast<uint32_t>(size_log);
+	size = std::max(m_MinTileSize, std::min(size, m_MaxTileSize));
+	return Log2(m_AtlasSize / size);
+}
+
+void ShadowAtlas::Update(const std::vector<ShadowAtlasRequest>& requests)
+{
+	uint64_t repack_count = m_Stats.repack_count;
+	m_Stats = ShadowAtlasStats();
+	m_Stats.repack_count = repack_count;
+
+	for (auto& pair : m_Entries)
+	{
+		pair.second.requested = false;
+		pair.second.allocation.moved = false;
+	}
+
+	// Sizes wanted by each light
+	m_Targets.clear();
+	for (const ShadowAtlasRequest& request : requests)
+	{
+		auto it = m_Entries.find(request.light_id);
+		Entry* current = nullptr;
+		if (it != m_Entries.end())
+		{
+			current = &it->second;
+			current->requested = true;
+		}
+
+		Target target = { request.light_id, request.type, request.importance, this->GetTargetLevel(request.importance, current), true };
+		m_Targets.push_back(target);
+	}
+
+	// Lights no longer asking for shadows give their tiles back
+	m_Removed.clear();
+	for (auto& pair : m_Entries)
+	{
+		if (!pair.second.requested)
+		{
+			this->FreeEntry(pair.second);
+			m_Removed.push_back(pair.first);
+			m_Stats.evicted_count++;
+		}
+	}
+
+	// Most important first, so the least important lights are the ones made smaller when the atlas is full
+	std::sort(m_Targets.begin(), m_Targets.end(), [](const Target& a, const Target& b)
+	{
+		return (a.importance != b.importance) ? a.importance > b.importance : a.light_id < b.light_id;
+	});
+
+	// Face area of a target at its level
+	auto get_area = [this](const Target& target)
+	{
+		uint64_t tile_size = this->GetTileSize(target.level);
+		return ((target.type == ShadowLightType::Point) ? MAX_SHADOW_LIGHT_FACES : 1) * tile_size * tile_size;
+	};
+
+	const uint64_t atlas_area = static_cast<uint64_t>(m_AtlasSize) * m_AtlasSize;
+	uint64_t area = 0;
+	for (const Target& target : m_Targets)
+	{
+		area += get_area(target);
+	}
+
+	// Halve the biggest tiles until everything fits, the least important of them first, then drop the least important lights
+	while (area > atlas_area)
+	{
+		Target* largest = nullptr;
+		for (auto it = m_Targets.rbegin(); it != m_Targets.rend(); ++it)
+		{
+			if (it->level != NO_LEVEL && it->level + 1 < m_LevelCount && (largest == nullptr || it->level < largest->level))
+			{
+				largest = &*it;
+			}
+		}
+
+		if (largest != nullptr)
+		{
+			area -= get_area(*largest) * 3 / 4;
+			largest->level++;
+			continue;
+		}
+
+		for (auto it = m_Targets.rbegin(); it != m_Targets.rend(); ++it)
+		{
+			if (it->level != NO_LEVEL)
+			{
+				area -= get_area(*it);
+				it->level = NO_LEVEL;
+				break;
+			}
+		}
+	}
+
+	// Lights staying at the same size keep their tiles, the rest give them back before anything is placed
+	for (Target& target : m_Targets)
+	{
+		auto it = m_Entries.find(target.light_id);
+		if (it == m_Entries.end())
+		{
+			if (target.level == NO_LEVEL)
+			{
+				target.allocate = false;
+				m_Stats.dropped_count++;
+			}
+
+			continue;
+		}
+
+		Entry& entry = it->second;
+		if (target.level == entry.level)
+		{
+			target.allocate = false;
+			m_Stats.kept_count++;
+			continue;
+		}
+
+		this->FreeEntry(entry);
+		if (target.level == NO_LEVEL)
+		{
+			target.allocate = false;
+			m_Removed.push_back(target.light_id);
+			m_Stats.dropped_count++;
+		}
+		else
+		{
+			m_Stats.resized_count++;
+		}
+	}
+
+	for (uint32_t light_id : m_Removed)
+	{
+		m_Entries.erase(light_id);
+	}
+
+	// Place the biggest tiles first, the small ones then fill the gaps
+	std::stable_sort(m_Targets.begin(), m_Targets.end(), [](const Target& a, const Target& b) { return a.level < b.level; });
+
+	bool repack = false;
+	for (const Target& target : m_Targets)
+	{
+		if (!target.allocate)
+			continue;
+
+		auto it = m_Entries.find(target.light_id);
+		if (it == m_Entries.end())
+		{
+			m_Stats.added_count++;
+			it = m_Entries.emplace(target.light_id, Entry()).first;
+		}
+
+		Entry& entry = it->second;
+		entry.allocation.type = target.type;
+		entry.allocation.face_count = (target.type == ShadowLightType::Point) ? MAX_SHADOW_LIGHT_FACES : 1;
+		entry.requested = true;
+
+		// Free space is too fragmented, the new entry is placed by the repack below
+		if (!repack && !this->AllocateEntry(entry, target.level))
+		{
+			entry.level = target.level;
+			repack = true;
+		}
+		else if (repack)
+		{
+			entry.level = target.level;
+		}
+	}
+
+	if (repack)
+	{
+		this->Repack();
+	}
+
+	// Counters of the atlas after the update
+	m_Stats.light_count = static_cast<uint32_t>(m_Entries.size());
+	for (const auto& pair : m_Entries)
+	{
+		uint64_t tile_size = this->GetTileSize(pair.second.level);
+		m_Stats.tile_count += pair.second.allocation.face_count;
+		m_Stats.used_texels += tile_size * tile_size * pair.second.allocation.face_count;
+	}
+}
+
+void ShadowAtlas::Repack()
+{
+	m_Stats.repack_count++;
+
+	std::fill(m_Nodes.begin(), m_Nodes.end(), NodeState::Unused);
+	m_Nodes[0] = NodeState::Free;
+
+	// Targets are already ordered largest first, every entry left holds one of them
+	for (const Target& target : m_Targets)
+	{
+		auto it = m_Entries.find(target.light_id);
+		if (it == m_Entries.end())
+			continue;
+
+		this->AllocateEntry(it->second, it->second.level);
+	}
+}
+
+const ShadowAtlasAllocation* ShadowAtlas::GetAllocation(uint32_t light_id) const
+{
+	auto it = m_Entries.find(light_id);
+	return (it != m_Entries.end()) ? &it->second.allocation : nullptr;
+}
+
+XMFLOAT4 ShadowAtlas::GetTileScaleOffset(const ShadowAtlasTile& tile) const
+{
+	float atlas_size = static_cast<float>(m_AtlasSize);
+	return XMFLOAT4(tile.size / atlas_size, tile.size / atlas_size, tile.x / atlas_size, tile.y / atlas_size);
+}
+
+void ShadowAtlas::Print() const
+{
+	uint64_t atlas_texels = static_cast<uint64_t>(m_AtlasSize) * m_AtlasSize;
+	std::cout << "  Shadow atlas: " << m_Stats.light_count << " lights in " << m_Stats.tile_count << " tiles, " << (100 * m_Stats.used_texels / atlas_texels) << "% of "
+		<< m_AtlasSize << "x" << m_AtlasSize << " used, " << m_Stats.kept_count << " kept, " << m_Stats.resized_count << " resized, " << m_Stats.added_count << " added, "
+		<< m_Stats.evicted_count << " evicted, " << m_Stats.dropped_count << " dropped, " << m_Stats.repack_count << " repacks\n";
+}
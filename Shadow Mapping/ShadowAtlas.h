@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+// Point lights need a tile per cube face, spot lights a single tile
+enum class ShadowLightType : uint8_t
+{
+	Spot,
+	Point,
+};
+
+// Size of the depth texture shared by the local lights' shadows
+const uint32_t SHADOW_ATLAS_SIZE = 4096;
+
+// Most tiles a light can hold, one per cube face
+const uint32_t MAX_SHADOW_LIGHT_FACES = 6;
+
+// A light asking for shadows this frame, more important lights get bigger tiles and keep them when the atlas is full
+struct ShadowAtlasRequest
+{
+	uint32_t light_id = 0;
+	ShadowLightType type = ShadowLightType::Spot;
+	float importance = 0.0f;
+};
+
+// Square region of the atlas in texels
+struct ShadowAtlasTile
+{
+	uint32_t x = 0;
+	uint32_t y = 0;
+	uint32_t size = 0;
+};
+
+// Tiles held by a light, every face of a point light has the same size
+struct ShadowAtlasAllocation
+{
+	ShadowLightType type = ShadowLightType::Spot;
+	uint32_t face_count = 0;
+	ShadowAtlasTile faces[MAX_SHADOW_LIGHT_FACES];
+
+	// Set when the tiles are new this frame, anything cached in the old tiles must be rendered again
+	bool moved = false;
+};
+
+// Counters of the last update
+struct ShadowAtlasStats
+{
+	uint32_t light_count = 0;
+	uint32_t kept_count = 0;
+	uint32_t resized_count = 0;
+	uint32_t added_count = 0;
+	uint32_t evicted_count = 0;
+
+	// Lights left without shadows as the atlas was full even at the smallest tile size
+	uint32_t dropped_count = 0;
+
+	// Updates that had to place every tile again because the free space was too fragmented
+	uint64_t repack_count = 0;
+
+	uint64_t used_texels = 0;
+	uint32_t tile_count = 0;
+};
+
+// Hands out square tiles of one fixed size depth texture to many spot and point lights
+//
+// The atlas is a quadtree, each node is free, split into four children or used by a tile, so tiles are power of two sizes
+// aligned to their size and freed tiles merge back with their siblings. A light's tile size follows its screen space importance
+// with some hysteresis, and lights keep their tiles between updates unless their size changes, so only new and resized
+// lights have to be rendered into new places. When everything requested can't fit, the biggest tiles are halved first so
+// every light keeps a tile, and only once every tile is at the smallest size are the least important lights dropped
+class ShadowAtlas
+{
+public:
+	// Size of the atlas and the smallest and largest tiles handed out, all powers of two
+	ShadowAtlas(uint32_t atlas_size = SHADOW_ATLAS_SIZE, uint32_t min_tile_size = 64, uint32_t max_tile_size = 1024);
+	virtual ~ShadowAtlas() = default;
+
+	// Screen space size of a light's bounding sphere, 1 once it covers the screen's height and 0 if it is behind the camera
+	static float CalculateImportance(const XMFLOAT3& center, float radius, const XMMATRIX& view, const XMMATRIX& projection);
+
+	// Assign tiles to this frame's lights, lights that are no longer requested give their tiles back
+	void Update(const std::vector<ShadowAtlasRequest>& requests);
+
+	// Tiles of a light, null if it has none
+	const ShadowAtlasAllocation* GetAllocation(uint32_t light_id) const;
+
+	// Scale and offset taking a tile's [0, 1] coordinates into the atlas' texture coordinates
+	XMFLOAT4 GetTileScaleOffset(const ShadowAtlasTile& tile) const;
+
+	inline uint32_t GetAtlasSize() const { return m_AtlasSize; }
+	inline const ShadowAtlasStats& GetStats() const { return m_Stats; }
+
+	// Print the counters and how full the atlas is
+	void Print() const;
+
+private:
+	uint32_t m_AtlasSize = 0;
+	uint32_t m_MinTileSize = 0;
+	uint32_t m_MaxTileSize = 0;
+
+	// Level 0 is the whole atlas, each level below halves the tile size down to the smallest tile
+	uint32_t m_LevelCount = 0;
+	uint32_t m_MinLevel = 0;
+	uint32_t GetTileSize(uint32_t level) const;
+
+	// Quadtree nodes stored level by level in Morton order, so the children of a node at index i are at 4i to 4i + 3 in the next level
+	enum class NodeState : uint8_t
+	{
+		Unused,
+		Free,
+		Split,
+		Used,
+	};
+
+	std::vector<NodeState> m_Nodes;
+	std::vector<uint32_t> m_LevelStart;
+
+	// Take the smallest free node that fits a tile of the level, splitting it down to the level, or free a used node
+	bool AllocateNode(uint32_t level, uint32_t& node);
+	void FreeNode(uint32_t node);
+	uint32_t GetNodeLevel(uint32_t node) const;
+	ShadowAtlasTile GetNodeTile(uint32_t node) const;
+
+	// Tiles held by each light and the nodes behind them
+	struct Entry
+	{
+		ShadowAtlasAllocation allocation;
+		uint32_t nodes[MAX_SHADOW_LIGHT_FACES];
+		uint32_t level = 0;
+		bool requested = false;
+	};
+
+	std::unordered_map<uint32_t, Entry> m_Entries;
+
+	// Allocate every face of a light at a level, nothing is kept if one of them fails
+	bool AllocateEntry(Entry& entry, uint32_t level);
+	void FreeEntry(Entry& entry);
+
+	// Give back every tile and place the targets again, largest first, which always fits once the budget has been applied
+	void Repack();
+
+	// Level a light wants, staying at its current level until its importance is well past the next size
+	uint32_t GetTargetLevel(float importance, const Entry* current) const;
+
+	// Scratch, kept to avoid allocating on every update
+	struct Target
+	{
+		uint32_t light_id;
+		ShadowLightType type;
+		float importance;
+		uint32_t level;
+		bool allocate;
+	};
+
+	std::vector<Target> m_Targets;
+	std::vector<uint32_t> m_Removed;
+
+	ShadowAtlasStats m_Stats;
+};
@@ -0,0 +1,48 @@
+#include "ShadowCache.h"
+#include <cstring>
+#include <iostream>
+
+void ShadowCache::Invalidate()
+{
+	m_StaticVersion++;
+	m_Stats.invalidations++;
+}
+
+void ShadowCache::BeginFrame()
+{
+	m_Stats.frame_rebuilds = 0;
+}
+
+bool ShadowCache::UpdateCascade(uint32_t cascade, const XMMATRIX& view, const XMMATRIX& projection)
+{
+	XMFLOAT4X4 new_view;
+	XMFLOAT4X4 new_projection;
+	XMStoreFloat4x4(&new_view, view);
+	XMStoreFloat4x4(&new_projection, projection);
+
+	// The cascades are snapped to whole texels, so matrices of a cascade that hasn't moved are bit for bit the same
+	CacheKey& key = m_Keys[cascade];
+	bool reuse = key.valid && key.static_version == m_StaticVersion && std::memcmp(&key.view, &new_view, sizeof(XMFLOAT4X4)) == 0 &&
+		std::memcmp(&key.projection, &new_projection, sizeof(XMFLOAT4X4)) == 0;
+
+	if (reuse)
+	{
+		m_Stats.reuses++;
+		return false;
+	}
+
+	key.view = new_view;
+	key.projection = new_projection;
+	key.static_version = m_StaticVersion;
+	key.valid = true;
+
+	m_Stats.rebuilds++;
+	m_Stats.frame_rebuilds++;
+	return true;
+}
+
+void ShadowCache::Print() const
+{
+	std::cout << "  Shadow cache: " << m_Stats.frame_rebuilds << " cascades rebuilt this frame, " << m_Stats.rebuilds << " rebuilds and " << m_Stats.reuses
+		<< " reuses in total, " << m_Stats.invalidations << " invalidations\n";
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+#include "ShadowCascades.h"
+
+// Counters of the cached cascades
+struct ShadowCacheStats
+{
+	// Cascades whose static casters were rendered again and cascades that reused the cached depth
+	uint64_t rebuilds = 0;
+	uint64_t reuses = 0;
+
+	// Times the static set or anything else every cascade depends on changed
+	uint64_t invalidations = 0;
+
+	// Cascades rebuilt by the last frame
+	uint32_t frame_rebuilds = 0;
+};
+
+// Decides when the static casters' depth of each cascade has to be rendered again
+//
+// A cascade's cached depth is only valid for the view and projection it was rendered with and the static set at the time.
+// The scene calls Invalidate whenever a static caster is added, removed or moved, and a changed light direction or cascade
+// fit shows up as a different view or projection. Everything else can reuse the cached depth and only draw the dynamic casters
+class ShadowCache
+{
+public:
+	ShadowCache() = default;
+	virtual ~ShadowCache() = default;
+
+	// Static casters have changed, every cascade is rebuilt
+	void Invalidate();
+
+	// Start of a frame's cascades, only resets the per frame counter
+	void BeginFrame();
+
+	// Returns true if the cascade's cached depth must be rendered again, the new view and projection are then stored so the next frame can reuse it
+	bool UpdateCascade(uint32_t cascade, const XMMATRIX& view, const XMMATRIX& projection);
+
+	// Counters
+	inline const ShadowCacheStats& GetStats() const { return m_Stats; }
+
+	// Print the counters
+	void Print() const;
+
+private:
+	// What a cascade's cached depth was rendered with
+	struct CacheKey
+	{
+		XMFLOAT4X4 view;
+		XMFLOAT4X4 projection;
+		uint64_t static_version = 0;
+		bool valid = false;
+	};
+
+	CacheKey m_Keys[MAX_SHADOW_CASCADES];
+
+	// Bumped by every invalidation, a key from an older version is stale
+	uint64_t m_StaticVersion = 0;
+
+	ShadowCacheStats m_Stats;
+};
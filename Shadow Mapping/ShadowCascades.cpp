@@ -0,0 +1,151 @@
+#include "ShadowCascades.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+#include "../External/ThreadPool.h"
+
+void ShadowCascades::SetCascadeCount(uint32_t count)
+{
+	m_CascadeCount = std::max(1u, std::min(count, MAX_SHADOW_CASCADES));
+}
+
+void ShadowCascades::Update(const XMMATRIX& camera_view, const XMMATRIX& camera_projection, const XMVECTOR& light_direction, const FrustumCuller& casters, uint32_t thread_count)
+{
+	XMStoreFloat4x4(&m_CameraView, camera_view);
+	m_CasterCount = casters.GetCount();
+
+	// Corners of the whole frustum, a slice's corners lie on the lines between them
+	XMMATRIX inverse_view_projection = XMMatrixInverse(nullptr, camera_view * camera_projection);
+	const float ndc_corners[4][2] = { { -1.0f, 1.0f }, { 1.0f, 1.0f }, { -1.0f, -1.0f }, { 1.0f, -1.0f } };
+	for (int i = 0; i < 4; ++i)
+	{
+		XMStoreFloat3(&m_NearCorners[i], XMVector3TransformCoord(XMVectorSet(ndc_corners[i][0], ndc_corners[i][1], 0.0f, 1.0f), inverse_view_projection));
+		XMStoreFloat3(&m_FarCorners[i], XMVector3TransformCoord(XMVectorSet(ndc_corners[i][0], ndc_corners[i][1], 1.0f, 1.0f), inverse_view_projection));
+	}
+
+	XMMATRIX inverse_projection = XMMatrixInverse(nullptr, camera_projection);
+	m_NearDepth = XMVectorGetZ(XMVector3TransformCoord(XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), inverse_projection));
+	m_FarDepth = XMVectorGetZ(XMVector3TransformCoord(XMVectorSet(0.0f, 0.0f, 1.0f, 1.0f), inverse_projection));
+
+	// Only rotates into light space, each cascade's projection is centered on its own slice
+	XMVECTOR direction = XMVector3Normalize(light_direction);
+	XMVECTOR up = (std::fabs(XMVectorGetY(direction)) > 0.99f) ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	XMStoreFloat4x4(&m_LightView, XMMatrixLookToLH(XMVectorZero(), direction, up));
+
+	// Practical split scheme, logarithmic splits keep the texel density even but leave the first cascade tiny, so they are blended with uniform splits
+	float near_depth = m_NearDepth;
+	float far_depth = std::min(m_FarDepth, m_ShadowDistance);
+	float previous_split = near_depth;
+	for (uint32_t i = 0; i < m_CascadeCount; ++i)
+	{
+		float ratio = static_cast<float>(i + 1) / static_cast<float>(m_CascadeCount);
+		float logarithmic = near_depth * std::pow(far_depth / near_depth, ratio);
+		float uniform = near_depth + (far_depth - near_depth) * ratio;
+
+		m_Cascades[i].split_near = previous_split;
+		m_Cascades[i].split_far = m_SplitLambda * logarithmic + (1.0f - m_SplitLambda) * uniform;
+		previous_split = m_Cascades[i].split_far;
+	}
+
+	// Workers from the shared pool take the next cascade until there are none left, the calling thread works as well. Fitting
+	// is a few matrices, so the cascades are only shared out when there are enough casters to cull to be worth waking workers
+	std::atomic<uint32_t> next_cascade(0);
+	auto worker = [&]()
+	{
+		for (uint32_t cascade = next_cascade++; cascade < m_CascadeCount; cascade = next_cascade++)
+		{
+			this->FitCascade(cascade, casters);
+		}
+	};
+
+	uint32_t used_threads = (m_CasterCount < MIN_PARALLEL_CASTERS) ? 1 : std::min(thread_count, m_CascadeCount);
+	ThreadPool::GetShared().Run(used_threads, worker);
+}
+
+void ShadowCascades::FitCascade(uint32_t cascade, const FrustumCuller& casters)
+{
+	ShadowCascade& result = m_Cascades[cascade];
+
+	// Corners of the slice, the frustum's edges are straight so they are found by view depth along them
+	float depth_range = m_FarDepth - m_NearDepth;
+	float near_t = (result.split_near - m_NearDepth) / depth_range;
+	float far_t = (result.split_far - m_NearDepth) / depth_range;
+
+	XMVECTOR corners[8];
+	for (int i = 0; i < 4; ++i)
+	{
+		XMVECTOR near_corner = XMLoadFloat3(&m_NearCorners[i]);
+		XMVECTOR far_corner = XMLoadFloat3(&m_FarCorners[i]);
+		corners[i] = XMVectorLerp(near_corner, far_corner, near_t);
+		corners[i + 4] = XMVectorLerp(near_corner, far_corner, far_t);
+	}
+
+	// Bounding sphere, its size only depends on the slice's shape so it stays the same as the camera turns
+	XMVECTOR center = XMVectorZero();
+	for (int i = 0; i < 8; ++i)
+	{
+		center = XMVectorAdd(center, corners[i]);
+	}
+
+	center = XMVectorScale(center, 1.0f / 8.0f);
+
+	float radius = 0.0f;
+	for (int i = 0; i < 8; ++i)
+	{
+		radius = std::max(radius, XMVectorGetX(XMVector3Length(XMVectorSubtract(corners[i], center))));
+	}
+
+	// Rounded up so float error can't change the size from frame to frame
+	radius = std::ceil(radius * 16.0f) / 16.0f;
+
+	XMStoreFloat3(&result.center, center);
+	result.radius = radius;
+
+	// Move the center in whole texels, so every texel covers the same world space as the frame before
+	// Depth is snapped as well so the projection only changes when the cascade moves, which lets cached shadow maps be reused
+	XMMATRIX light_view = XMLoadFloat4x4(&m_LightView);
+	XMFLOAT3 light_center;
+	XMStoreFloat3(&light_center, XMVector3TransformCoord(center, light_view));
+
+	float texel_size = (2.0f * radius) / static_cast<float>(m_Resolution);
+	light_center.x = std::floor(light_center.x / texel_size) * texel_size;
+	light_center.y = std::floor(light_center.y / texel_size) * texel_size;
+	light_center.z = std::floor(light_center.z / texel_size) * texel_size;
+
+	// Casters in front of the near plane are clamped onto it as the shadow pass doesn't clip depth, the far plane gets a texel more for the snapped depth
+	XMMATRIX projection = XMMatrixOrthographicOffCenterLH(light_center.x - radius, light_center.x + radius, light_center.y - radius, light_center.y + radius,
+		light_center.z - radius, light_center.z + radius + texel_size);
+
+	result.view = m_LightView;
+	XMStoreFloat4x4(&result.projection, projection);
+
+	// Open the near plane so the volume reaches back to the light, then keep only the casters inside it
+	result.caster_volume = CullingFrustum::FromViewProjection(light_view * projection);
+	result.caster_volume.planes[4] = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+	casters.CullSerial(result.caster_volume, CullingShape::Box, result.casters);
+}
+
+uint32_t ShadowCascades::GetKeptCasterCount() const
+{
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < m_CascadeCount; ++i)
+	{
+		kept += static_cast<uint32_t>(m_Cascades[i].casters.size());
+	}
+
+	return kept;
+}
+
+void ShadowCascades::Print() const
+{
+	std::cout << "  Shadow cascades: " << m_CascadeCount << ", " << GetKeptCasterCount() << " of " << (m_CasterCount * m_CascadeCount) << " casters drawn\n";
+
+	for (uint32_t i = 0; i < m_CascadeCount; ++i)
+	{
+		const ShadowCascade& cascade = m_Cascades[i];
+		std::cout << "    Cascade " << i << ": depth " << cascade.split_near << " to " << cascade.split_far << ", radius " << cascade.radius << ", texel "
+			<< (2.0f * cascade.radius / static_cast<float>(m_Resolution)) << ", " << cascade.casters.size() << " of " << m_CasterCount << " casters\n";
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+#include "FrustumCuller.h"
+
+// Most cascades the shadow map array holds
+const uint32_t MAX_SHADOW_CASCADES = 4;
+
+// One slice of the camera's frustum and the light projection covering it
+struct ShadowCascade
+{
+	// View space depth range of the slice
+	float split_near = 0.0f;
+	float split_far = 0.0f;
+
+	// Bounding sphere of the slice in world space, the projection is fitted to it so it doesn't change size as the camera turns
+	XMFLOAT3 center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	float radius = 0.0f;
+
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 projection;
+
+	// The projection's volume extruded towards the light and the indices of the casters inside it
+	CullingFrustum caster_volume;
+	std::vector<uint32_t> casters;
+};
+
+// Splits a camera's frustum into cascades for a directional light
+// - split depths blend logarithmic and uniform splits, the practical split scheme
+// - each cascade is fitted to the bounding sphere of its slice and snapped to whole shadow map texels, so the shadows don't shimmer
+// - casters are culled per cascade against its volume extruded towards the light
+// With enough casters the cascades are fitted and culled in parallel on the shared thread pool, one cascade per job
+class ShadowCascades
+{
+public:
+	// Fewer casters than this are culled for every cascade on the calling thread
+	static constexpr uint32_t MIN_PARALLEL_CASTERS = FrustumCuller::CHUNK_SIZE;
+
+	ShadowCascades() = default;
+	virtual ~ShadowCascades() = default;
+
+	// Number of cascades in use, 1 to MAX_SHADOW_CASCADES
+	void SetCascadeCount(uint32_t count);
+	inline uint32_t GetCascadeCount() const { return m_CascadeCount; }
+
+	// 0 splits uniformly, 1 logarithmically
+	inline void SetSplitLambda(float lambda) { m_SplitLambda = lambda; }
+
+	// Shadows end at this view depth, or the camera's far plane if it is closer
+	inline void SetShadowDistance(float distance) { m_ShadowDistance = distance; }
+
+	// Width and height of a cascade's shadow map in texels
+	inline void SetResolution(uint32_t resolution) { m_Resolution = resolution; }
+
+	// Fit the cascades to the camera's frustum and cull the casters' bounds against each of them
+	void Update(const XMMATRIX& camera_view, const XMMATRIX& camera_projection, const XMVECTOR& light_direction, const FrustumCuller& casters, uint32_t thread_count);
+
+	inline const ShadowCascade& GetCascade(uint32_t cascade) const { return m_Cascades[cascade]; }
+	inline XMMATRIX GetView(uint32_t cascade) const { return XMLoadFloat4x4(&m_Cascades[cascade].view); }
+	inline XMMATRIX GetProjection(uint32_t cascade) const { return XMLoadFloat4x4(&m_Cascades[cascade].projection); }
+
+	// View the split depths are measured in
+	inline XMMATRIX GetCameraView() const { return XMLoadFloat4x4(&m_CameraView); }
+
+	// Casters tested against each cascade and how many every cascade kept in total
+	inline uint32_t GetCasterCount() const { return m_CasterCount; }
+	uint32_t GetKeptCasterCount() const;
+
+	// Print the cascades' splits, sizes and casters
+	void Print() const;
+
+private:
+	uint32_t m_CascadeCount = MAX_SHADOW_CASCADES;
+	float m_SplitLambda = 0.75f;
+	float m_ShadowDistance = 100.0f;
+	uint32_t m_Resolution = 2048;
+
+	ShadowCascade m_Cascades[MAX_SHADOW_CASCADES];
+	XMFLOAT4X4 m_CameraView;
+	uint32_t m_CasterCount = 0;
+
+	// Corners of the camera's near and far planes in world space and their view depths, shared by every cascade
+	XMFLOAT3 m_NearCorners[4];
+	XMFLOAT3 m_FarCorners[4];
+	float m_NearDepth = 0.0f;
+	float m_FarDepth = 0.0f;
+
+	// Light rotation, the cascades only differ in their projections
+	XMFLOAT4X4 m_LightView;
+
+	// Fit one cascade and cull its casters
+	void FitCascade(uint32_t cascade, const FrustumCuller& casters);
+};
@@ -1,51 +1,157 @@
 #include "ShadowMap.h"
+#include "RenderDevice.h"
+
+#include "CompiledClearTileVertexShader.hlsl.h"
 
 ShadowMap::ShadowMap(Renderer* renderer) : m_Renderer(renderer)
 {
 	this->CreateShadowMapTexture();
+	this->CreateShadowAtlasTexture();
+	this->CreateClearTile();
 	this->CreateRasterModeBackCull();
 	this->CreateShadowSampler();
 }
 
-void ShadowMap::Bind()
+void ShadowMap::Bind(uint32_t cascade, bool clear)
+{
+	this->BindDepthStencil(m_DepthStencilViews[cascade].Get(), clear);
+}
+
+void ShadowMap::BindCache(uint32_t cascade)
+{
+	this->BindDepthStencil(m_CacheDepthStencilViews[cascade].Get(), true);
+}
+
+void ShadowMap::RestoreCache(uint32_t cascade)
+{
+	// One mip per slice, so the subresource is the slice
+	RenderDevice* device = m_Renderer->GetRenderDevice();
+	device->CopyTexture(m_Texture.Get(), cascade, m_CacheTexture.Get(), cascade);
+}
+
+void ShadowMap::BindAtlasTile(const ShadowAtlasTile& tile, bool clear)
+{
+	RenderDevice* device = m_Renderer->GetRenderDevice();
+
+	// Depth only, like the cascades
+	device->SetPixelShader(nullptr);
+	device->SetRenderTarget(nullptr, m_ShadowAtlasDepthStencilView.Get());
+
+	// The viewport keeps the light's view inside its tile
+	RenderViewport viewport = {};
+	viewport.width = static_cast<float>(tile.size);
+	viewport.height = static_cast<float>(tile.size);
+	viewport.min_depth = 0.0f;
+	viewport.max_depth = 1.0f;
+	viewport.x = static_cast<float>(tile.x);
+	viewport.y = static_cast<float>(tile.y);
+	device->SetViewport(viewport);
+
+	// Far depth over the whole viewport, without depth bias and ignoring what is already there
+	if (clear)
+	{
+		device->SetRasterizerState(nullptr);
+		device->SetDepthStencilState(m_ClearTileDepthState.Get(), 0);
+		device->SetInputLayout(nullptr);
+		device->SetPrimitiveTopology(PrimitiveTopology::TriangleList);
+		device->SetVertexShader(m_ClearTileVertexShader.Get());
+		device->Draw(3, 0);
+		device->SetDepthStencilState(nullptr, 0);
+	}
+
+	device->SetRasterizerState(m_RasterModelBackShadowAtlas.Get());
+}
+
+void ShadowMap::BindDepthStencil(ID3D11DepthStencilView* depth_stencil, bool clear)
 {
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
+	RenderDevice* device = m_Renderer->GetRenderDevice();
 
 	// Unbind the pixel shader as we don't use it for simple shadows
-	context->PSSetShader(nullptr, nullptr, 0);
+	device->SetPixelShader(nullptr);
 
 	// Clear the render target view to the chosen colour
-	context->ClearDepthStencilView(m_DepthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	if (clear)
+	{
+		device->ClearDepthStencil(depth_stencil, CLEAR_DEPTH | CLEAR_STENCIL, 1.0f, 0);
+	}
 
 	// Bind the render target view to the pipeline's output merger stage
-	ID3D11RenderTargetView* render_target_views[1] = { nullptr };
-	context->OMSetRenderTargets(1, render_target_views, m_DepthStencilView.Get());
+	device->SetRenderTarget(nullptr, depth_stencil);
 
 	// Describe the viewport
-	D3D11_VIEWPORT viewport = {};
-	viewport.Width = static_cast<float>(m_ShadowMapTextureSize);
-	viewport.Height = static_cast<float>(m_ShadowMapTextureSize);
-	viewport.MinDepth = 0.0f; 
-	viewport.MaxDepth = 1.0f;
-	viewport.TopLeftX = 0;
-	viewport.TopLeftY = 0;
+	RenderViewport viewport = {};
+	viewport.width = static_cast<float>(m_ShadowMapTextureSize);
+	viewport.height = static_cast<float>(m_ShadowMapTextureSize);
+	viewport.min_depth = 0.0f; 
+	viewport.max_depth = 1.0f;
+	viewport.x = 0;
+	viewport.y = 0;
 
 	// Bind viewport to the pipline's rasterization stage
-	context->RSSetViewports(1, &viewport);
+	device->SetViewport(viewport);
 
 	// Set raster state
-	context->RSSetState(m_RasterModelBackShadow.Get());
+	device->SetRasterizerState(m_RasterModelBackShadow.Get());
 }
 
 void ShadowMap::CreateShadowMapTexture()
 {
 	ID3D11Device* device = m_Renderer->GetDevice();
 
-	// Create shadow map texture
+	// Create shadow map texture and the static cache, the cache is only rendered to and copied from
+	this->CreateDepthArray(D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE, m_Texture, m_DepthStencilViews);
+	this->CreateDepthArray(D3D11_BIND_DEPTH_STENCIL, m_CacheTexture, m_CacheDepthStencilViews);
+
+	// Create shadow resource of the whole array
+	D3D11_SHADER_RESOURCE_VIEW_DESC shader_resource_view_desc = {};
+	shader_resource_view_desc.Format = DXGI_FORMAT_R32_FLOAT;
+	shader_resource_view_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	shader_resource_view_desc.Texture2DArray.MipLevels = 1;
+	shader_resource_view_desc.Texture2DArray.ArraySize = MAX_SHADOW_CASCADES;
+
+	DX::Check(device->CreateShaderResourceView(m_Texture.Get(), &shader_resource_view_desc, m_ShadowMapTexture.GetAddressOf()));
+}
+
+void ShadowMap::CreateDepthArray(UINT bind_flags, ComPtr<ID3D11Texture2D>& texture, ComPtr<ID3D11DepthStencilView> views[MAX_SHADOW_CASCADES])
+{
+	ID3D11Device* device = m_Renderer->GetDevice();
+
+	// Create depth texture, one slice per cascade
 	D3D11_TEXTURE2D_DESC texture_desc = {}; 
 	texture_desc.Width = static_cast<UINT>(m_ShadowMapTextureSize);
 	texture_desc.Height = static_cast<UINT>(m_ShadowMapTextureSize);
 	texture_desc.MipLevels = 1;
+	texture_desc.ArraySize = MAX_SHADOW_CASCADES;
+	texture_desc.SampleDesc.Count = 1;
+	texture_desc.SampleDesc.Quality = 0;
+	texture_desc.Format = DXGI_FORMAT_R32_TYPELESS;
+	texture_desc.Usage = D3D11_USAGE_DEFAULT;
+	texture_desc.BindFlags = bind_flags;
+
+	DX::Check(device->CreateTexture2D(&texture_desc, 0, texture.ReleaseAndGetAddressOf()));
+
+	// Create a depth stencil view of each slice
+	for (uint32_t cascade = 0; cascade < MAX_SHADOW_CASCADES; ++cascade)
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC depth_view_desc = {};
+		depth_view_desc.Format = DXGI_FORMAT_D32_FLOAT;
+		depth_view_desc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+		depth_view_desc.Texture2DArray.FirstArraySlice = cascade;
+		depth_view_desc.Texture2DArray.ArraySize = 1;
+
+		DX::Check(device->CreateDepthStencilView(texture.Get(), &depth_view_desc, views[cascade].ReleaseAndGetAddressOf()));
+	}
+}
+
+void ShadowMap::CreateShadowAtlasTexture()
+{
+	ID3D11Device* device = m_Renderer->GetDevice();
+
+	// Create the atlas texture, one depth texture split into tiles
+	D3D11_TEXTURE2D_DESC texture_desc = {};
+	texture_desc.Width = SHADOW_ATLAS_SIZE;
+	texture_desc.Height = SHADOW_ATLAS_SIZE;
+	texture_desc.MipLevels = 1;
 	texture_desc.ArraySize = 1;
 	texture_desc.SampleDesc.Count = 1;
 	texture_desc.SampleDesc.Quality = 0;
@@ -56,20 +162,37 @@ void ShadowMap::CreateShadowMapTexture()
 	ComPtr<ID3D11Texture2D> texture = nullptr;
 	DX::Check(device->CreateTexture2D(&texture_desc, 0, texture.GetAddressOf()));
 
-	// Create depth stencil view
+	// Create the depth stencil view
 	D3D11_DEPTH_STENCIL_VIEW_DESC depth_view_desc = {};
 	depth_view_desc.Format = DXGI_FORMAT_D32_FLOAT;
 	depth_view_desc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
 
-	DX::Check(device->CreateDepthStencilView(texture.Get(), &depth_view_desc, m_DepthStencilView.GetAddressOf()));
+	DX::Check(device->CreateDepthStencilView(texture.Get(), &depth_view_desc, m_ShadowAtlasDepthStencilView.GetAddressOf()));
 
-	// Create shadow resource
+	// Create the shader resource
 	D3D11_SHADER_RESOURCE_VIEW_DESC shader_resource_view_desc = {};
 	shader_resource_view_desc.Format = DXGI_FORMAT_R32_FLOAT;
 	shader_resource_view_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
 	shader_resource_view_desc.Texture2D.MipLevels = 1;
 
-	DX::Check(device->CreateShaderResourceView(texture.Get(), &shader_resource_view_desc, m_ShadowMapTexture.GetAddressOf()));
+	DX::Check(device->CreateShaderResourceView(texture.Get(), &shader_resource_view_desc, m_ShadowAtlasTexture.GetAddressOf()));
+}
+
+void ShadowMap::CreateClearTile()
+{
+	ID3D11Device* device = m_Renderer->GetDevice();
+
+	// Create the vertex shader
+	DX::Check(device->CreateVertexShader(g_ClearTileVertexShader, sizeof(g_ClearTileVertexShader), nullptr, m_ClearTileVertexShader.ReleaseAndGetAddressOf()));
+
+	// Always write the depth
+	D3D11_DEPTH_STENCIL_DESC desc = {};
+	desc.DepthEnable = true;
+	desc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+	desc.DepthFunc = D3D11_COMPARISON_ALWAYS;
+	desc.StencilEnable = false;
+
+	DX::Check(device->CreateDepthStencilState(&desc, m_ClearTileDepthState.ReleaseAndGetAddressOf()));
 }
 
 void ShadowMap::CreateRasterModeBackCull()
@@ -88,6 +211,9 @@ void ShadowMap::CreateRasterModeBackCull()
 
 	ID3D11Device* device = m_Renderer->GetDevice();
 	DX::Check(device->CreateRasterizerState(&desc, m_RasterModelBackShadow.ReleaseAndGetAddressOf()));
+
+	desc.DepthClipEnable = true;
+	DX::Check(device->CreateRasterizerState(&desc, m_RasterModelBackShadowAtlas.ReleaseAndGetAddressOf()));
 }
 
 void ShadowMap::CreateShadowSampler()
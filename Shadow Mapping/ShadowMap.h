@@ -1,8 +1,11 @@
 #pragma once
 
 #include "Renderer.h"
+#include "ShadowCascades.h"
+#include "ShadowAtlas.h"
 
-const float SHADOW_MAP_SIZE = 4096.0f;
+// Size of each cascade's slice of the shadow map array
+const float SHADOW_MAP_SIZE = 2048.0f;
 
 class ShadowMap
 {
@@ -12,13 +15,28 @@ public:
 	ShadowMap(Renderer* renderer);
 	virtual ~ShadowMap() = default;
 
-	void Bind();
+	// Bind a cascade's slice as the depth target, clear is only needed once per frame
+	void Bind(uint32_t cascade, bool clear = true);
+
+	// Clear and bind a cascade's slice of the static cache, which keeps the depth of the casters that don't move between frames
+	void BindCache(uint32_t cascade);
+
+	// Copy a cascade's cached static depth into its slice of the shadow map, instead of clearing it
+	void RestoreCache(uint32_t cascade);
+
+	// Bind a tile of the shadow atlas, clear only resets that tile so the rest of the atlas keeps its depth
+	void BindAtlasTile(const ShadowAtlasTile& tile, bool clear);
 
 	inline ID3D11ShaderResourceView* GetShadowMapTexture() const
 	{
 		return m_ShadowMapTexture.Get();
 	}
 
+	inline ID3D11ShaderResourceView* GetShadowAtlasTexture() const
+	{
+		return m_ShadowAtlasTexture.Get();
+	}
+
 	inline ID3D11SamplerState* GetShadowSamplerState() const
 	{
 		return m_ShadowSampler.Get();
@@ -29,12 +47,34 @@ private:
 
 	// Create resources
 	void CreateShadowMapTexture();
+	ComPtr<ID3D11Texture2D> m_Texture = nullptr;
 	ComPtr<ID3D11ShaderResourceView> m_ShadowMapTexture = nullptr;
-	ComPtr<ID3D11DepthStencilView> m_DepthStencilView = nullptr;
+	ComPtr<ID3D11DepthStencilView> m_DepthStencilViews[MAX_SHADOW_CASCADES];
+
+	// Static cache, same size and format as the shadow map so slices can be copied across
+	ComPtr<ID3D11Texture2D> m_CacheTexture = nullptr;
+	ComPtr<ID3D11DepthStencilView> m_CacheDepthStencilViews[MAX_SHADOW_CASCADES];
+
+	// Create a depth texture with a slice per cascade and a depth stencil view of each
+	void CreateDepthArray(UINT bind_flags, ComPtr<ID3D11Texture2D>& texture, ComPtr<ID3D11DepthStencilView> views[MAX_SHADOW_CASCADES]);
+
+	// Bind a depth stencil view with the shadow viewport and raster state
+	void BindDepthStencil(ID3D11DepthStencilView* depth_stencil, bool clear);
+
+	// Shadow atlas of the local lights
+	void CreateShadowAtlasTexture();
+	ComPtr<ID3D11ShaderResourceView> m_ShadowAtlasTexture = nullptr;
+	ComPtr<ID3D11DepthStencilView> m_ShadowAtlasDepthStencilView = nullptr;
+
+	// A depth stencil view can only be cleared whole, so a tile is cleared by drawing the far depth over its viewport
+	void CreateClearTile();
+	ComPtr<ID3D11VertexShader> m_ClearTileVertexShader = nullptr;
+	ComPtr<ID3D11DepthStencilState> m_ClearTileDepthState = nullptr;
 
-	// Raster state
+	// Raster state, the atlas' perspective views keep depth clipping as nothing may be clamped onto the light's near plane
 	void CreateRasterModeBackCull();
 	ComPtr<ID3D11RasterizerState> m_RasterModelBackShadow = nullptr;
+	ComPtr<ID3D11RasterizerState> m_RasterModelBackShadowAtlas = nullptr;
 
 	// Shadow map sampler
 	void CreateShadowSampler();
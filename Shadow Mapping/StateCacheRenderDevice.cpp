@@ -0,0 +1,259 @@
+#include "StateCacheRenderDevice.h"
+
+StateCacheRenderDevice::StateCacheRenderDevice(RenderDevice* target) : m_Target(target)
+{
+}
+
+void StateCacheRenderDevice::SetTarget(RenderDevice* target)
+{
+	m_Target = target;
+	this->Invalidate();
+}
+
+void StateCacheRenderDevice::Invalidate()
+{
+	m_InputLayout.known = false;
+	m_IndexBuffer.known = false;
+	m_Topology.known = false;
+	m_VertexShader.known = false;
+	m_PixelShader.known = false;
+	m_RasterizerState.known = false;
+	m_DepthStencilState.known = false;
+	m_Viewport.known = false;
+	m_RenderTarget.known = false;
+
+	for (auto& state : m_VertexBuffers)
+		state.known = false;
+
+	for (auto& state : m_VertexConstantBuffers)
+		state.known = false;
+
+	for (auto& state : m_PixelConstantBuffers)
+		state.known = false;
+
+	for (auto& state : m_PixelShaderResources)
+		state.known = false;
+
+	for (auto& state : m_PixelSamplers)
+		state.known = false;
+}
+
+template<typename T>
+bool StateCacheRenderDevice::Change(CachedState<T>& state, const T& value)
+{
+	if (state.known && state.value == value)
+	{
+		m_Stats.filtered_calls++;
+		return false;
+	}
+
+	state.value = value;
+	state.known = true;
+	m_Stats.issued_calls++;
+	return true;
+}
+
+void StateCacheRenderDevice::SetInputLayout(ID3D11InputLayout* input_layout)
+{
+	if (Change(m_InputLayout, input_layout))
+		m_Target->SetInputLayout(input_layout);
+}
+
+void StateCacheRenderDevice::SetVertexBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t stride, uint32_t offset)
+{
+	if (slot >= MAX_VERTEX_BUFFERS)
+	{
+		m_Stats.issued_calls++;
+		m_Target->SetVertexBuffer(slot, buffer, stride, offset);
+		return;
+	}
+
+	if (Change(m_VertexBuffers[slot], VertexBufferBinding { buffer, stride, offset }))
+		m_Target->SetVertexBuffer(slot, buffer, stride, offset);
+}
+
+void StateCacheRenderDevice::SetIndexBuffer(ID3D11Buffer* buffer, IndexFormat format, uint32_t offset)
+{
+	if (Change(m_IndexBuffer, IndexBufferBinding { buffer, format, offset }))
+		m_Target->SetIndexBuffer(buffer, format, offset);
+}
+
+void StateCacheRenderDevice::SetPrimitiveTopology(PrimitiveTopology topology)
+{
+	if (Change(m_Topology, topology))
+		m_Target->SetPrimitiveTopology(topology);
+}
+
+void StateCacheRenderDevice::SetVertexShader(ID3D11VertexShader* shader)
+{
+	if (Change(m_VertexShader, shader))
+		m_Target->SetVertexShader(shader);
+}
+
+void StateCacheRenderDevice::SetPixelShader(ID3D11PixelShader* shader)
+{
+	if (Change(m_PixelShader, shader))
+		m_Target->SetPixelShader(shader);
+}
+
+void StateCacheRenderDevice::SetVertexConstantBuffer(uint32_t slot, ID3D11Buffer* buffer)
+{
+	if (slot >= MAX_CONSTANT_BUFFERS)
+	{
+		m_Stats.issued_calls++;
+		m_Target->SetVertexConstantBuffer(slot, buffer);
+		return;
+	}
+
+	if (Change(m_VertexConstantBuffers[slot], ConstantBufferBinding { buffer, 0, 0 }))
+		m_Target->SetVertexConstantBuffer(slot, buffer);
+}
+
+void StateCacheRenderDevice::SetPixelConstantBuffer(uint32_t slot, ID3D11Buffer* buffer)
+{
+	if (slot >= MAX_CONSTANT_BUFFERS)
+	{
+		m_Stats.issued_calls++;
+		m_Target->SetPixelConstantBuffer(slot, buffer);
+		return;
+	}
+
+	if (Change(m_PixelConstantBuffers[slot], ConstantBufferBinding { buffer, 0, 0 }))
+		m_Target->SetPixelConstantBuffer(slot, buffer);
+}
+
+void StateCacheRenderDevice::SetVertexConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t first_constant, uint32_t constant_count)
+{
+	if (slot >= MAX_CONSTANT_BUFFERS)
+	{
+		m_Stats.issued_calls++;
+		m_Target->SetVertexConstantBufferRange(slot, buffer, first_constant, constant_count);
+		return;
+	}
+
+	if (Change(m_VertexConstantBuffers[slot], ConstantBufferBinding { buffer, first_constant, constant_count }))
+		m_Target->SetVertexConstantBufferRange(slot, buffer, first_constant, constant_count);
+}
+
+void StateCacheRenderDevice::SetPixelConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t first_constant, uint32_t constant_count)
+{
+	if (slot >= MAX_CONSTANT_BUFFERS)
+	{
+		m_Stats.issued_calls++;
+		m_Target->SetPixelConstantBufferRange(slot, buffer, first_constant, constant_count);
+		return;
+	}
+
+	if (Change(m_PixelConstantBuffers[slot], ConstantBufferBinding { buffer, first_constant, constant_count }))
+		m_Target->SetPixelConstantBufferRange(slot, buffer, first_constant, constant_count);
+}
+
+void StateCacheRenderDevice::SetPixelShaderResource(uint32_t slot, ID3D11ShaderResourceView* view)
+{
+	if (slot >= MAX_SHADER_RESOURCES)
+	{
+		m_Stats.issued_calls++;
+		m_Target->SetPixelShaderResource(slot, view);
+		return;
+	}
+
+	if (Change(m_PixelShaderResources[slot], view))
+		m_Target->SetPixelShaderResource(slot, view);
+}
+
+void StateCacheRenderDevice::SetPixelSampler(uint32_t slot, ID3D11SamplerState* sampler)
+{
+	if (slot >= MAX_SAMPLERS)
+	{
+		m_Stats.issued_calls++;
+		m_Target->SetPixelSampler(slot, sampler);
+		return;
+	}
+
+	if (Change(m_PixelSamplers[slot], sampler))
+		m_Target->SetPixelSampler(slot, sampler);
+}
+
+void StateCacheRenderDevice::SetRasterizerState(ID3D11RasterizerState* state)
+{
+	if (Change(m_RasterizerState, state))
+		m_Target->SetRasterizerState(state);
+}
+
+void StateCacheRenderDevice::SetDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencil_ref)
+{
+	if (Change(m_DepthStencilState, DepthStencilBinding { state, stencil_ref }))
+		m_Target->SetDepthStencilState(state, stencil_ref);
+}
+
+void StateCacheRenderDevice::SetViewport(const RenderViewport& viewport)
+{
+	if (Change(m_Viewport, ViewportBinding { viewport }))
+		m_Target->SetViewport(viewport);
+}
+
+void StateCacheRenderDevice::SetRenderTarget(ID3D11RenderTargetView* render_target, ID3D11DepthStencilView* depth_stencil)
+{
+	if (!Change(m_RenderTarget, RenderTargetBinding { render_target, depth_stencil }))
+		return;
+
+	m_Target->SetRenderTarget(render_target, depth_stencil);
+
+	// Direct3D unbinds any shader resource that is now bound as an output, so the shadowed views can't be trusted
+	for (auto& state : m_PixelShaderResources)
+		state.known = false;
+}
+
+void StateCacheRenderDevice::ClearRenderTarget(ID3D11RenderTargetView* render_target, const float colour[4])
+{
+	m_Stats.forwarded_calls++;
+	m_Target->ClearRenderTarget(render_target, colour);
+}
+
+void StateCacheRenderDevice::ClearDepthStencil(ID3D11DepthStencilView* depth_stencil, uint32_t clear_flags, float depth, uint8_t stencil)
+{
+	m_Stats.forwarded_calls++;
+	m_Target->ClearDepthStencil(depth_stencil, clear_flags, depth, stencil);
+}
+
+void StateCacheRenderDevice::UpdateBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size)
+{
+	m_Stats.forwarded_calls++;
+	m_Target->UpdateBuffer(buffer, data, size);
+}
+
+void StateCacheRenderDevice::UpdateDynamicBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size)
+{
+	m_Stats.forwarded_calls++;
+	m_Target->UpdateDynamicBuffer(buffer, data, size);
+}
+
+void StateCacheRenderDevice::UpdateDynamicBufferRange(ID3D11Buffer* buffer, uint32_t offset, const void* data, uint32_t size, DynamicWrite write)
+{
+	m_Stats.forwarded_calls++;
+	m_Target->UpdateDynamicBufferRange(buffer, offset, data, size, write);
+}
+
+void StateCacheRenderDevice::CopyTexture(ID3D11Resource* destination, uint32_t destination_subresource, ID3D11Resource* source, uint32_t source_subresource)
+{
+	m_Stats.forwarded_calls++;
+	m_Target->CopyTexture(destination, destination_subresource, source, source_subresource);
+}
+
+void StateCacheRenderDevice::Draw(uint32_t vertex_count, uint32_t start_vertex)
+{
+	m_Stats.forwarded_calls++;
+	m_Target->Draw(vertex_count, start_vertex);
+}
+
+void StateCacheRenderDevice::DrawIndexed(uint32_t index_count, uint32_t start_index, int32_t base_vertex)
+{
+	m_Stats.forwarded_calls++;
+	m_Target->DrawIndexed(index_count, start_index, base_vertex);
+}
+
+void StateCacheRenderDevice::DrawIndexedInstanced(uint32_t index_count, uint32_t instance_count, uint32_t start_index, int32_t base_vertex, uint32_t start_instance)
+{
+	m_Stats.forwarded_calls++;
+	m_Target->DrawIndexedInstanced(index_count, instance_count, start_index, base_vertex, start_instance);
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "RenderDevice.h"
+
+// Number of calls that reached the target device and that were dropped
+struct StateCacheStats
+{
+	// State binds that changed something
+	uint64_t issued_calls = 0;
+
+	// State binds that matched what was already bound
+	uint64_t filtered_calls = 0;
+
+	// Clears, updates, copies and draws, which are always forwarded
+	uint64_t forwarded_calls = 0;
+};
+
+// Keeps a copy of the bound pipeline state and only forwards binds that change it
+// Everything is forgotten with Invalidate, which must be called whenever the target's state may have been changed behind the cache
+class StateCacheRenderDevice : public RenderDevice
+{
+public:
+	StateCacheRenderDevice(RenderDevice* target);
+	virtual ~StateCacheRenderDevice() = default;
+
+	// Change the device binds are forwarded to, this also invalidates the cache
+	void SetTarget(RenderDevice* target);
+
+	// Forget the shadowed state so the next bind of every slot is forwarded
+	void Invalidate();
+
+	// Counters
+	inline const StateCacheStats& GetStats() const { return m_Stats; }
+	inline void ResetStats() { m_Stats = StateCacheStats(); }
+
+	// Input assembler
+	void SetInputLayout(ID3D11InputLayout* input_layout) override;
+	void SetVertexBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t stride, uint32_t offset) override;
+	void SetIndexBuffer(ID3D11Buffer* buffer, IndexFormat format, uint32_t offset) override;
+	void SetPrimitiveTopology(PrimitiveTopology topology) override;
+
+	// Shaders and their resources
+	void SetVertexShader(ID3D11VertexShader* shader) override;
+	void SetPixelShader(ID3D11PixelShader* shader) override;
+	void SetVertexConstantBuffer(uint32_t slot, ID3D11Buffer* buffer) override;
+	void SetPixelConstantBuffer(uint32_t slot, ID3D11Buffer* buffer) override;
+	void SetVertexConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t first_constant, uint32_t constant_count) override;
+	void SetPixelConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t first_constant, uint32_t constant_count) override;
+	void SetPixelShaderResource(uint32_t slot, ID3D11ShaderResourceView* view) override;
+	void SetPixelSampler(uint32_t slot, ID3D11SamplerState* sampler) override;
+
+	// Rasterizer and output merger
+	void SetRasterizerState(ID3D11RasterizerState* state) override;
+	void SetDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencil_ref) override;
+	void SetViewport(const RenderViewport& viewport) override;
+	void SetRenderTarget(ID3D11RenderTargetView* render_target, ID3D11DepthStencilView* depth_stencil) override;
+	void ClearRenderTarget(ID3D11RenderTargetView* render_target, const float colour[4]) override;
+	void ClearDepthStencil(ID3D11DepthStencilView* depth_stencil, uint32_t clear_flags, float depth, uint8_t stencil) override;
+
+	// Buffers
+	void UpdateBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size) override;
+	void UpdateDynamicBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size) override;
+	void UpdateDynamicBufferRange(ID3D11Buffer* buffer, uint32_t offset, const void* data, uint32_t size, DynamicWrite write) override;
+
+	// Textures
+	void CopyTexture(ID3D11Resource* destination, uint32_t destination_subresource, ID3D11Resource* source, uint32_t source_subresource) override;
+
+	// Draws
+	void Draw(uint32_t vertex_count, uint32_t start_vertex) override;
+	void DrawIndexed(uint32_t index_count, uint32_t start_index, int32_t base_vertex) override;
+	void DrawIndexedInstanced(uint32_t index_count, uint32_t instance_count, uint32_t start_index, int32_t base_vertex, uint32_t start_instance) override;
+
+private:
+	RenderDevice* m_Target = nullptr;
+	StateCacheStats m_Stats;
+
+	// Slots beyond these are rarely used by the samples and are always forwarded
+	static const uint32_t MAX_VERTEX_BUFFERS = 8;
+	static const uint32_t MAX_CONSTANT_BUFFERS = 14;
+	static const uint32_t MAX_SHADER_RESOURCES = 16;
+	static const uint32_t MAX_SAMPLERS = 16;
+
+	// A shadowed value and whether it is known, unknown values never match
+	template<typename T>
+	struct CachedState
+	{
+		T value = {};
+		bool known = false;
+	};
+
+	// Store the new value, returns true if it differs from what is bound and must be forwarded
+	template<typename T>
+	bool Change(CachedState<T>& state, const T& value);
+
+	// Bound state
+	struct VertexBufferBinding
+	{
+		ID3D11Buffer* buffer;
+		uint32_t stride;
+		uint32_t offset;
+		bool operator==(const VertexBufferBinding& other) const { return buffer == other.buffer && stride == other.stride && offset == other.offset; }
+	};
+
+	struct IndexBufferBinding
+	{
+		ID3D11Buffer* buffer;
+		IndexFormat format;
+		uint32_t offset;
+		bool operator==(const IndexBufferBinding& other) const { return buffer == other.buffer && format == other.format && offset == other.offset; }
+	};
+
+	// A count of 0 binds the whole buffer
+	struct ConstantBufferBinding
+	{
+		ID3D11Buffer* buffer;
+		uint32_t first_constant;
+		uint32_t constant_count;
+		bool operator==(const ConstantBufferBinding& other) const { return buffer == other.buffer && first_constant == other.first_constant && constant_count == other.constant_count; }
+	};
+
+	struct DepthStencilBinding
+	{
+		ID3D11DepthStencilState* state;
+		uint32_t stencil_ref;
+		bool operator==(const DepthStencilBinding& other) const { return state == other.state && stencil_ref == other.stencil_ref; }
+	};
+
+	struct RenderTargetBinding
+	{
+		ID3D11RenderTargetView* render_target;
+		ID3D11DepthStencilView* depth_stencil;
+		bool operator==(const RenderTargetBinding& other) const { return render_target == other.render_target && depth_stencil == other.depth_stencil; }
+	};
+
+	struct ViewportBinding
+	{
+		RenderViewport viewport;
+		bool operator==(const ViewportBinding& other) const
+		{
+			return viewport.x == other.viewport.x && viewport.y == other.viewport.y && viewport.width == other.viewport.width &&
+				viewport.height == other.viewport.height && viewport.min_depth == other.viewport.min_depth && viewport.max_depth == other.viewport.max_depth;
+		}
+	};
+
+	// Input assembler
+	CachedState<ID3D11InputLayout*> m_InputLayout;
+	CachedState<VertexBufferBinding> m_VertexBuffers[MAX_VERTEX_BUFFERS];
+	CachedState<IndexBufferBinding> m_IndexBuffer;
+	CachedState<PrimitiveTopology> m_Topology;
+
+	// Shaders
+	CachedState<ID3D11VertexShader*> m_VertexShader;
+	CachedState<ID3D11PixelShader*> m_PixelShader;
+	CachedState<ConstantBufferBinding> m_VertexConstantBuffers[MAX_CONSTANT_BUFFERS];
+	CachedState<ConstantBufferBinding> m_PixelConstantBuffers[MAX_CONSTANT_BUFFERS];
+	CachedState<ID3D11ShaderResourceView*> m_PixelShaderResources[MAX_SHADER_RESOURCES];
+	CachedState<ID3D11SamplerState*> m_PixelSamplers[MAX_SAMPLERS];
+
+	// Rasterizer and output merger
+	CachedState<ID3D11RasterizerState*> m_RasterizerState;
+	CachedState<DepthStencilBinding> m_DepthStencilState;
+	CachedState<ViewportBinding> m_Viewport;
+	CachedState<RenderTargetBinding> m_RenderTarget;
+};
@@ -0,0 +1,200 @@
+#include "UploadQueue.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+UploadQueue::UploadQueue(uint32_t page_size) : m_PageSize(page_size)
+{
+}
+
+uint32_t UploadQueue::Align(uint32_t size)
+{
+	return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+uint64_t UploadQueue::QueueBuffer(void* buffer, uint32_t offset, const void* data, uint32_t size)
+{
+	UploadCommand command = {};
+	command.type = UploadType::Buffer;
+	command.destination = buffer;
+	command.data = data;
+	command.size = size;
+	command.destination_offset = offset;
+
+	return this->Queue(command);
+}
+
+uint64_t UploadQueue::QueueTexture(void* texture, uint32_t subresource, const void* data, uint32_t row_pitch, uint32_t depth_pitch, uint32_t size)
+{
+	UploadCommand command = {};
+	command.type = UploadType::Texture;
+	command.destination = texture;
+	command.data = data;
+	command.size = size;
+	command.subresource = subresource;
+	command.row_pitch = row_pitch;
+	command.depth_pitch = depth_pitch;
+
+	return this->Queue(command);
+}
+
+uint64_t UploadQueue::Queue(const UploadCommand& command)
+{
+	PendingUpload upload;
+	upload.command = command;
+	upload.command.data = this->Stage(command.data, command.size, upload.page);
+	upload.ticket = m_NextTicket++;
+	m_Pending.push_back(upload);
+
+	m_Stats.queued_count++;
+	m_Stats.queued_bytes += command.size;
+	m_Stats.pending_count++;
+	m_Stats.pending_bytes += command.size;
+
+	return upload.ticket;
+}
+
+uint8_t* UploadQueue::Stage(const void* data, uint32_t size, Page*& page)
+{
+	uint32_t aligned_size = Align(size);
+
+	// Start a new page if the current one is full
+	Page* current = m_Pages.empty() ? nullptr : m_Pages.back().get();
+	if (current == nullptr || current->used + aligned_size > current->size)
+	{
+		// The old page may already have been flushed, it only stayed because it was current
+		if (current != nullptr && current->pending == 0)
+		{
+			this->RetirePage(current);
+		}
+
+		std::unique_ptr<Page> new_page;
+		if (aligned_size <= m_PageSize && !m_FreePages.empty())
+		{
+			new_page = std::move(m_FreePages.back());
+			m_FreePages.pop_back();
+		}
+		else
+		{
+			new_page = std::make_unique<Page>();
+			new_page->size = std::max(m_PageSize, aligned_size);
+			new_page->memory.reset(new uint8_t[new_page->size]);
+
+			m_Stats.page_count++;
+			m_Stats.page_bytes += new_page->size;
+		}
+
+		new_page->used = 0;
+		new_page->pending = 0;
+		m_Pages.push_back(std::move(new_page));
+		current = m_Pages.back().get();
+	}
+
+	uint8_t* staged = current->memory.get() + current->used;
+	std::memcpy(staged, data, size);
+
+	current->used += aligned_size;
+	current->pending++;
+	page = current;
+	return staged;
+}
+
+void UploadQueue::RetirePage(Page* page)
+{
+	auto it = std::find_if(m_Pages.begin(), m_Pages.end(), [page](const std::unique_ptr<Page>& p) { return p.get() == page; });
+	if (it == m_Pages.end())
+		return;
+
+	std::unique_ptr<Page> retired = std::move(*it);
+	m_Pages.erase(it);
+
+	// Keep a few normal sized pages around, oversized ones are only for the upload they were made for
+	if (retired->size == m_PageSize && m_FreePages.size() < MAX_FREE_PAGES)
+	{
+		retired->used = 0;
+		m_FreePages.push_back(std::move(retired));
+	}
+	else
+	{
+		m_Stats.page_count--;
+		m_Stats.page_bytes -= retired->size;
+	}
+}
+
+uint32_t UploadQueue::Flush(UploadBackend& backend, uint64_t byte_budget)
+{
+	if (m_Pending.empty())
+		return 0;
+
+	// Take uploads in order until the budget is used, the staging space of the buffer uploads is needed up front
+	uint32_t count = 0;
+	uint64_t batch_bytes = 0;
+	uint32_t buffer_bytes = 0;
+	for (PendingUpload& upload : m_Pending)
+	{
+		if (count > 0 && batch_bytes + upload.command.size > byte_budget)
+			break;
+
+		if (upload.command.type == UploadType::Buffer)
+		{
+			upload.command.batch_offset = buffer_bytes;
+			buffer_bytes += Align(upload.command.size);
+		}
+
+		batch_bytes += upload.command.size;
+		count++;
+	}
+
+	backend.BeginBatch(buffer_bytes);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		backend.Upload(m_Pending[i].command);
+	}
+	backend.EndBatch();
+
+	// The staging memory can be reused once every upload in a page has gone
+	Page* current = m_Pages.back().get();
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const PendingUpload& upload = m_Pending.front();
+		m_CompletedTicket = upload.ticket;
+
+		Page* page = upload.page;
+		m_Pending.pop_front();
+
+		if (--page->pending == 0)
+		{
+			if (page != current)
+			{
+				this->RetirePage(page);
+			}
+			else
+			{
+				// Nothing left in the current page, fill it again from the start
+				page->used = 0;
+			}
+		}
+	}
+
+	m_Stats.flushed_count += count;
+	m_Stats.flushed_bytes += batch_bytes;
+	m_Stats.batch_count++;
+	m_Stats.largest_batch_bytes = std::max(m_Stats.largest_batch_bytes, batch_bytes);
+	m_Stats.pending_count -= count;
+	m_Stats.pending_bytes -= batch_bytes;
+
+	if (!m_Pending.empty())
+	{
+		m_Stats.deferred_count++;
+	}
+
+	return count;
+}
+
+void UploadQueue::Print() const
+{
+	std::cout << "Uploads: " << m_Stats.flushed_count << " of " << m_Stats.queued_count << " flushed (" << (m_Stats.flushed_bytes / 1024) << " of "
+		<< (m_Stats.queued_bytes / 1024) << " KB) in " << m_Stats.batch_count << " batches, largest " << (m_Stats.largest_batch_bytes / 1024) << " KB\n";
+	std::cout << "  " << m_Stats.pending_count << " pending (" << (m_Stats.pending_bytes / 1024) << " KB), " << m_Stats.deferred_count
+		<< " flushes over budget, " << m_Stats.page_count << " staging pages (" << (m_Stats.page_bytes / 1024) << " KB)\n";
+}
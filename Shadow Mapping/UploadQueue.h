@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// What an upload writes to
+enum class UploadType : uint8_t
+{
+	Buffer,
+	Texture,
+};
+
+// One upload handed to the backend, the data points into the queue's staging memory and is only valid during the flush
+struct UploadCommand
+{
+	UploadType type;
+
+	// ID3D11Buffer* for buffers, ID3D11Texture2D* for textures
+	void* destination;
+
+	const void* data;
+	uint32_t size;
+
+	// Buffers: byte offset in the destination and in the batch's staging buffer
+	uint32_t destination_offset;
+	uint32_t batch_offset;
+
+	// Textures: subresource and pitches of the data
+	uint32_t subresource;
+	uint32_t row_pitch;
+	uint32_t depth_pitch;
+};
+
+// Copies the uploads of a flush to the GPU
+class UploadBackend
+{
+public:
+	virtual ~UploadBackend() = default;
+
+	// Start a batch, buffer_bytes is the staging space the batch's buffer uploads need
+	virtual void BeginBatch(uint32_t buffer_bytes) = 0;
+
+	// Copy one upload
+	virtual void Upload(const UploadCommand& command) = 0;
+
+	// Issue the batch
+	virtual void EndBatch() = 0;
+};
+
+// Counters since the queue was created, except for the pending and staging counts which are current
+struct UploadStats
+{
+	uint64_t queued_count = 0;
+	uint64_t queued_bytes = 0;
+	uint64_t flushed_count = 0;
+	uint64_t flushed_bytes = 0;
+	uint64_t batch_count = 0;
+	uint64_t largest_batch_bytes = 0;
+
+	// Flushes that ran out of budget and left uploads for the next frame
+	uint64_t deferred_count = 0;
+
+	uint32_t pending_count = 0;
+	uint64_t pending_bytes = 0;
+	uint32_t page_count = 0;
+	uint64_t page_bytes = 0;
+};
+
+// Collects uploads of static data and hands them to the GPU in batches of at most a byte budget per flush
+//
+// The data is copied into large staging pages when queued, so the caller's memory can go straight away.
+// Uploads are flushed in the order they were queued, a ticket is complete once its upload and all before it have been flushed.
+// The first upload of a flush always goes even if it is over the budget, so a single large upload can't stall the queue
+class UploadQueue
+{
+public:
+	// Size of a staging page, bigger uploads get a page of their own
+	static constexpr uint32_t DEFAULT_PAGE_SIZE = 4 * 1024 * 1024;
+
+	// Empty pages kept for the next uploads rather than freed
+	static constexpr uint32_t MAX_FREE_PAGES = 2;
+
+	// Staging offsets of buffer uploads in a batch are aligned to this
+	static constexpr uint32_t ALIGNMENT = 16;
+
+	// Budget that flushes everything
+	static constexpr uint64_t UNLIMITED_BUDGET = ~0ull;
+
+	UploadQueue(uint32_t page_size = DEFAULT_PAGE_SIZE);
+	virtual ~UploadQueue() = default;
+
+	// Queue the data for a buffer or a texture subresource, returns the upload's ticket
+	uint64_t QueueBuffer(void* buffer, uint32_t offset, const void* data, uint32_t size);
+	uint64_t QueueTexture(void* texture, uint32_t subresource, const void* data, uint32_t row_pitch, uint32_t depth_pitch, uint32_t size);
+
+	// Hand the oldest uploads to the backend until the budget is used, returns the number flushed
+	uint32_t Flush(UploadBackend& backend, uint64_t byte_budget);
+
+	// Check if the upload with this ticket has been flushed, ticket 0 is always complete
+	inline bool IsComplete(uint64_t ticket) const { return ticket <= m_CompletedTicket; }
+
+	// Nothing is waiting
+	inline bool IsEmpty() const { return m_Pending.empty(); }
+
+	// Counters
+	inline const UploadStats& GetStats() const { return m_Stats; }
+	void Print() const;
+
+private:
+	struct Page
+	{
+		std::unique_ptr<uint8_t[]> memory;
+		uint32_t size = 0;
+		uint32_t used = 0;
+		uint32_t pending = 0;
+	};
+
+	struct PendingUpload
+	{
+		UploadCommand command;
+		Page* page;
+		uint64_t ticket;
+	};
+
+	uint32_t m_PageSize = 0;
+
+	// Pages with uploads waiting, the last one is being filled
+	std::vector<std::unique_ptr<Page>> m_Pages;
+	std::vector<std::unique_ptr<Page>> m_FreePages;
+
+	std::deque<PendingUpload> m_Pending;
+	uint64_t m_NextTicket = 1;
+	uint64_t m_CompletedTicket = 0;
+
+	UploadStats m_Stats;
+
+	// Copy data into the current page, starting a new one if it doesn't fit
+	uint8_t* Stage(const void* data, uint32_t size, Page*& page);
+	uint64_t Queue(const UploadCommand& command);
+
+	// Free or keep a page once its last upload is flushed
+	void RetirePage(Page* page);
+
+	static uint32_t Align(uint32_t size);
+};
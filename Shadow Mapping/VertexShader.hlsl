@@ -19,10 +19,10 @@ PixelInput main(VertexInput input)
     // Pass UV
     pixel_input.uv = input.uv;
     
-    // Calculate light position - used to sample the shadow map
-    pixel_input.lightViewProjection = mul(float4(input.position, 1.0f), cModelTransform);
-    pixel_input.lightViewProjection = mul(pixel_input.lightViewProjection, cLightView);
-    pixel_input.lightViewProjection = mul(pixel_input.lightViewProjection, cLightProjection);
+    // World position and depth in the cascade view - used to pick a cascade and sample the shadow map
+    float4 world_position = mul(float4(input.position, 1.0f), cModelTransform);
+    pixel_input.worldPosition = world_position.xyz;
+    pixel_input.cascadeDepth = mul(world_position, cCascadeView).z;
     
     return pixel_input;
 }
\ No newline at end of file
@@ -9,11 +9,16 @@
 #include "Camera.h"
 #include "RasterState.h"
 #include "TextureSampler.h"
+#include "CubeMapImage.h"
+#include "SphericalHarmonics.h"
+#include "../External/ThreadPool.h"
 
 #include <DirectXMath.h>
 using namespace DirectX;
 
 #include <windowsx.h>
+#include <chrono>
+#include <iostream>
 
 Application::Application()
 {
@@ -53,6 +58,9 @@ int Application::Execute()
 	m_Skybox = std::make_unique<Skybox>(m_Renderer.get());
 	m_Skybox->Create();
 
+	// Light the crate with the irradiance of the skybox
+	m_Shader->UpdateIrradianceBuffer(m_Skybox->GetIrradiance());
+
 	// Raster state
 	m_RasterState = std::make_unique<RasterState>(m_Renderer.get());
 
@@ -93,7 +101,8 @@ int Application::Execute()
 			// Bind texture sampler to the pipeline
 			m_TextureSampler->Use();
 
-			// Render crate
+			// Render crate with reflections of the skybox
+			m_Skybox->UseReflections();
 			m_Model->Render();
 
 			// Render skybox
@@ -180,7 +189,14 @@ void Application::OnKeyDown(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
 	if (!key_repeat)
 	{
-		m_RasterState->ToggleWireframe();
+		if (wParam == 'B')
+		{
+			this->RunIrradianceBenchmark();
+		}
+		else
+		{
+			m_RasterState->ToggleWireframe();
+		}
 	}
 }
 
@@ -209,7 +225,7 @@ void Application::ComputeModelViewProjectionMatrix()
 	matrix *= m_Camera->GetView();
 	matrix *= m_Camera->GetProjection();
 
-	m_Shader->UpdateModelViewProjectionBuffer(matrix);
+	m_Shader->UpdateModelViewProjectionBuffer(matrix, m_Camera->GetPosition());
 
 	// Skybox
 	const DirectX::XMFLOAT3& camera_position = m_Camera->GetPosition();
@@ -220,4 +236,51 @@ void Application::ComputeModelViewProjectionMatrix()
 	skybox_matrix *= m_Camera->GetProjection();
 
 	m_SkyboxShader->UpdateModelViewProjectionBuffer(skybox_matrix);
+}
+
+void Application::RunIrradianceBenchmark()
+{
+	const uint32_t face_sizes[] = { 32, 64, 128, 256, 512, 1024 };
+	const uint32_t thread_counts[] = { 1, 2, 3, 6 };
+	const int iterations = 8;
+
+	std::cout << "Irradiance projection (average of " << iterations << " runs)\n";
+
+	// Start the shared pool's workers now so the first timing doesn't include it
+	ThreadPool::GetShared();
+
+	for (uint32_t face_size : face_sizes)
+	{
+		// Fill the faces with a gradient so every texel contributes
+		CubeMapImage cube_map;
+		cube_map.Create(face_size);
+		for (uint32_t face = 0; face < CUBE_FACE_COUNT; ++face)
+		{
+			DirectX::XMFLOAT4* texels = cube_map.GetFace(face);
+			for (uint32_t i = 0; i < face_size * face_size; ++i)
+			{
+				float t = static_cast<float>(i) / static_cast<float>(face_size * face_size);
+				texels[i] = DirectX::XMFLOAT4(t, 1.0f - t, static_cast<float>(face) / CUBE_FACE_COUNT, 1.0f);
+			}
+		}
+
+		for (uint32_t thread_count : thread_counts)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+
+			SHIrradiance irradiance;
+			for (int i = 0; i < iterations; ++i)
+			{
+				irradiance = ProjectIrradiance(cube_map, thread_count);
+			}
+
+			auto end = std::chrono::high_resolution_clock::now();
+			double milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+
+			std::cout << "  " << face_size << "x" << face_size << " x6, " << thread_count << " thread(s): " << milliseconds << " ms"
+				<< " (L0 = " << irradiance.coefficients[0].x << ", " << irradiance.coefficients[0].y << ", " << irradiance.coefficients[0].z << ")\n";
+		}
+	}
+
+	std::cout << std::flush;
 }
\ No newline at end of file
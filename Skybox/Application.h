@@ -62,4 +62,7 @@ private:
 
 	// Compute model view projection of the camera
 	void ComputeModelViewProjectionMatrix();
+
+	// Time the irradiance projection over a range of cube map sizes and thread counts, bound to the B key
+	void RunIrradianceBenchmark();
 };
\ No newline at end of file
@@ -0,0 +1,529 @@
+#include "CubeMapImage.h"
+
+#include <DirectXPackedVector.h>
+using namespace DirectX;
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	// Subset of DXGI_FORMAT values, kept here so the loader does not depend on the Direct3D headers
+	const uint32_t FORMAT_R32G32B32A32_FLOAT = 2;
+	const uint32_t FORMAT_R16G16B16A16_FLOAT = 10;
+	const uint32_t FORMAT_R8G8B8A8_UNORM = 28;
+	const uint32_t FORMAT_R8G8B8A8_UNORM_SRGB = 29;
+	const uint32_t FORMAT_BC1_UNORM = 71;
+	const uint32_t FORMAT_BC1_UNORM_SRGB = 72;
+	const uint32_t FORMAT_BC2_UNORM = 74;
+	const uint32_t FORMAT_BC2_UNORM_SRGB = 75;
+	const uint32_t FORMAT_BC3_UNORM = 77;
+	const uint32_t FORMAT_BC3_UNORM_SRGB = 78;
+	const uint32_t FORMAT_B8G8R8A8_UNORM = 87;
+	const uint32_t FORMAT_B8G8R8A8_UNORM_SRGB = 91;
+
+	const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+	const uint32_t DDS_FOURCC = 0x00000004;
+	const uint32_t DDS_CUBEMAP = 0x00000200;
+	const uint32_t DDS_CUBEMAP_ALLFACES = 0x0000FE00;
+	const uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+
+	// Flags used when writing a header
+	const uint32_t DDS_HEADER_FLAGS_TEXTURE = 0x00001007; // Caps, height, width and pixel format
+	const uint32_t DDS_HEADER_FLAGS_MIPMAP = 0x00020000;
+	const uint32_t DDS_HEADER_FLAGS_PITCH = 0x00000008;
+	const uint32_t DDS_SURFACE_FLAGS_TEXTURE = 0x00001000;
+	const uint32_t DDS_SURFACE_FLAGS_MIPMAP = 0x00400008;
+	const uint32_t DDS_SURFACE_FLAGS_CUBEMAP = 0x00000008;
+	const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+	struct DDSPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+
+	struct DDSHeader
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DDSPixelFormat ddspf;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct DDSHeaderDXT10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+	}
+
+	// Work out the format from a legacy header
+	uint32_t GetLegacyFormat(const DDSPixelFormat& pixel_format)
+	{
+		if (pixel_format.flags & DDS_FOURCC)
+		{
+			switch (pixel_format.fourCC)
+			{
+				case MakeFourCC('D', 'X', 'T', '1'): return FORMAT_BC1_UNORM;
+				case MakeFourCC('D', 'X', 'T', '2'):
+				case MakeFourCC('D', 'X', 'T', '3'): return FORMAT_BC2_UNORM;
+				case MakeFourCC('D', 'X', 'T', '4'):
+				case MakeFourCC('D', 'X', 'T', '5'): return FORMAT_BC3_UNORM;
+				case 113: return FORMAT_R16G16B16A16_FLOAT; // D3DFMT_A16B16G16R16F
+				case 116: return FORMAT_R32G32B32A32_FLOAT; // D3DFMT_A32B32G32R32F
+			}
+
+			return 0;
+		}
+
+		if (pixel_format.RGBBitCount == 32)
+		{
+			if (pixel_format.RBitMask == 0x000000ff)
+				return FORMAT_R8G8B8A8_UNORM;
+
+			if (pixel_format.RBitMask == 0x00ff0000)
+				return FORMAT_B8G8R8A8_UNORM;
+		}
+
+		return 0;
+	}
+
+	// Bytes used by one face of a mip level
+	size_t GetSurfaceSize(uint32_t format, uint32_t width, uint32_t height)
+	{
+		const size_t blocks_wide = std::max(1u, (width + 3) / 4);
+		const size_t blocks_high = std::max(1u, (height + 3) / 4);
+
+		switch (format)
+		{
+			case FORMAT_R32G32B32A32_FLOAT: return static_cast<size_t>(width) * height * 16;
+			case FORMAT_R16G16B16A16_FLOAT: return static_cast<size_t>(width) * height * 8;
+			case FORMAT_BC1_UNORM:
+			case FORMAT_BC1_UNORM_SRGB: return blocks_wide * blocks_high * 8;
+			case FORMAT_BC2_UNORM:
+			case FORMAT_BC2_UNORM_SRGB:
+			case FORMAT_BC3_UNORM:
+			case FORMAT_BC3_UNORM_SRGB: return blocks_wide * blocks_high * 16;
+			default: return static_cast<size_t>(width) * height * 4;
+		}
+	}
+
+	bool IsSRGB(uint32_t format)
+	{
+		return format == FORMAT_R8G8B8A8_UNORM_SRGB || format == FORMAT_B8G8R8A8_UNORM_SRGB ||
+			format == FORMAT_BC1_UNORM_SRGB || format == FORMAT_BC2_UNORM_SRGB || format == FORMAT_BC3_UNORM_SRGB;
+	}
+
+	float SRGBToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	XMFLOAT4 Unpack565(uint16_t colour)
+	{
+		return XMFLOAT4(((colour >> 11) & 0x1f) / 31.0f, ((colour >> 5) & 0x3f) / 63.0f, (colour & 0x1f) / 31.0f, 1.0f);
+	}
+
+	// Decode the colour part of a BC1 - BC3 block, alpha is ignored as cube maps are opaque
+	void DecodeColourBlock(const uint8_t* block, bool bc1, XMFLOAT4 (&texels)[16])
+	{
+		uint16_t colour0 = 0;
+		uint16_t colour1 = 0;
+		uint32_t indices = 0;
+		std::memcpy(&colour0, block, 2);
+		std::memcpy(&colour1, block + 2, 2);
+		std::memcpy(&indices, block + 4, 4);
+
+		const XMFLOAT4 endpoint0 = Unpack565(colour0);
+		const XMFLOAT4 endpoint1 = Unpack565(colour1);
+
+		XMVECTOR palette[4];
+		palette[0] = XMLoadFloat4(&endpoint0);
+		palette[1] = XMLoadFloat4(&endpoint1);
+
+		// BC2 and BC3 always use the four colour mode
+		if (!bc1 || colour0 > colour1)
+		{
+			palette[2] = XMVectorLerp(palette[0], palette[1], 1.0f / 3.0f);
+			palette[3] = XMVectorLerp(palette[0], palette[1], 2.0f / 3.0f);
+		}
+		else
+		{
+			palette[2] = XMVectorLerp(palette[0], palette[1], 0.5f);
+			palette[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+		}
+
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			XMStoreFloat4(&texels[i], palette[(indices >> (i * 2)) & 0x3]);
+		}
+	}
+}
+
+void CubeMapImage::Create(uint32_t size)
+{
+	m_Size = size;
+	for (std::vector<XMFLOAT4>& face : m_Faces)
+	{
+		face.resize(static_cast<size_t>(size) * size);
+	}
+}
+
+bool CubeMapImage::LoadDDS(const std::wstring& path, uint32_t max_size)
+{
+	std::ifstream file(std::filesystem::path(path), std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (data.size() < sizeof(uint32_t) + sizeof(DDSHeader))
+		return false;
+
+	uint32_t magic = 0;
+	std::memcpy(&magic, data.data(), sizeof(uint32_t));
+	if (magic != DDS_MAGIC)
+		return false;
+
+	DDSHeader header = {};
+	std::memcpy(&header, data.data() + sizeof(uint32_t), sizeof(DDSHeader));
+	size_t offset = sizeof(uint32_t) + sizeof(DDSHeader);
+
+	// Work out the format and check it is a cube map
+	uint32_t format = 0;
+	bool cube_map = (header.caps2 & DDS_CUBEMAP) != 0;
+
+	if ((header.ddspf.flags & DDS_FOURCC) && header.ddspf.fourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		if (data.size() < offset + sizeof(DDSHeaderDXT10))
+			return false;
+
+		DDSHeaderDXT10 header_dxt10 = {};
+		std::memcpy(&header_dxt10, data.data() + offset, sizeof(DDSHeaderDXT10));
+		offset += sizeof(DDSHeaderDXT10);
+
+		format = header_dxt10.dxgiFormat;
+		cube_map = cube_map || (header_dxt10.miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE) != 0;
+	}
+	else
+	{
+		format = GetLegacyFormat(header.ddspf);
+	}
+
+	if (format == 0 || !cube_map || header.width != header.height)
+		return false;
+
+	// Find the first mip level that fits
+	const uint32_t mip_count = std::max(1u, header.mipMapCount);
+	uint32_t mip = 0;
+	while (max_size != 0 && mip + 1 < mip_count && (header.width >> mip) > max_size)
+	{
+		++mip;
+	}
+
+	// Faces are stored one after the other, each with its full mip chain
+	size_t face_size = 0;
+	size_t mip_offset = 0;
+	for (uint32_t i = 0; i < mip_count; ++i)
+	{
+		const uint32_t mip_width = std::max(1u, header.width >> i);
+		const size_t surface_size = GetSurfaceSize(format, mip_width, mip_width);
+
+		if (i < mip)
+			mip_offset += surface_size;
+
+		face_size += surface_size;
+	}
+
+	if (data.size() < offset + face_size * CUBE_FACE_COUNT)
+		return false;
+
+	this->Create(std::max(1u, header.width >> mip));
+
+	for (uint32_t face = 0; face < CUBE_FACE_COUNT; ++face)
+	{
+		if (!this->DecodeFace(data.data() + offset + face_size * face + mip_offset, format, face))
+			return false;
+	}
+
+	return true;
+}
+
+bool CubeMapImage::SaveDDS(const std::wstring& path, const std::vector<CubeMapImage>& mip_chain)
+{
+	if (mip_chain.empty() || mip_chain[0].GetSize() == 0)
+		return false;
+
+	const uint32_t size = mip_chain[0].GetSize();
+	for (size_t i = 1; i < mip_chain.size(); ++i)
+	{
+		if (mip_chain[i].GetSize() != std::max(1u, size >> i))
+			return false;
+	}
+
+	// Describe an RGBA16F cube map with the extended header
+	DDSHeader header = {};
+	header.size = sizeof(DDSHeader);
+	header.flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP | DDS_HEADER_FLAGS_PITCH;
+	header.width = size;
+	header.height = size;
+	header.pitchOrLinearSize = size * sizeof(PackedVector::XMHALF4);
+	header.mipMapCount = static_cast<uint32_t>(mip_chain.size());
+	header.ddspf.size = sizeof(DDSPixelFormat);
+	header.ddspf.flags = DDS_FOURCC;
+	header.ddspf.fourCC = MakeFourCC('D', 'X', '1', '0');
+	header.caps = DDS_SURFACE_FLAGS_TEXTURE | DDS_SURFACE_FLAGS_MIPMAP | DDS_SURFACE_FLAGS_CUBEMAP;
+	header.caps2 = DDS_CUBEMAP_ALLFACES;
+
+	DDSHeaderDXT10 header_dxt10 = {};
+	header_dxt10.dxgiFormat = FORMAT_R16G16B16A16_FLOAT;
+	header_dxt10.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+	header_dxt10.miscFlag = DDS_RESOURCE_MISC_TEXTURECUBE;
+	header_dxt10.arraySize = 1;
+
+	std::ofstream file(std::filesystem::path(path), std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(&header_dxt10), sizeof(header_dxt10));
+
+	// Faces are stored one after the other, each with its full mip chain
+	std::vector<PackedVector::XMHALF4> halfs;
+	for (uint32_t face = 0; face < CUBE_FACE_COUNT; ++face)
+	{
+		for (const CubeMapImage& mip : mip_chain)
+		{
+			const size_t texel_count = static_cast<size_t>(mip.GetSize()) * mip.GetSize();
+			const XMFLOAT4* texels = mip.GetFace(face);
+
+			halfs.resize(texel_count);
+			for (size_t i = 0; i < texel_count; ++i)
+			{
+				PackedVector::XMStoreHalf4(&halfs[i], XMLoadFloat4(&texels[i]));
+			}
+
+			file.write(reinterpret_cast<const char*>(halfs.data()), halfs.size() * sizeof(PackedVector::XMHALF4));
+		}
+	}
+
+	return file.good();
+}
+
+void CubeMapImage::Downsample(CubeMapImage& output) const
+{
+	const uint32_t output_size = std::max(1u, m_Size / 2);
+	output.Create(output_size);
+
+	// A 1x1 face can not be reduced further
+	if (m_Size == 1)
+	{
+		output.m_Faces = m_Faces;
+		return;
+	}
+
+	const XMVECTOR quarter = XMVectorReplicate(0.25f);
+	for (uint32_t face = 0; face < CUBE_FACE_COUNT; ++face)
+	{
+		const XMFLOAT4* source = m_Faces[face].data();
+		XMFLOAT4* destination = output.m_Faces[face].data();
+
+		for (uint32_t y = 0; y < output_size; ++y)
+		{
+			const XMFLOAT4* row0 = source + static_cast<size_t>(y * 2) * m_Size;
+			const XMFLOAT4* row1 = row0 + m_Size;
+
+			for (uint32_t x = 0; x < output_size; ++x)
+			{
+				XMVECTOR sum = XMVectorAdd(XMLoadFloat4(&row0[x * 2]), XMLoadFloat4(&row0[x * 2 + 1]));
+				sum = XMVectorAdd(sum, XMVectorAdd(XMLoadFloat4(&row1[x * 2]), XMLoadFloat4(&row1[x * 2 + 1])));
+				XMStoreFloat4(&destination[static_cast<size_t>(y) * output_size + x], XMVectorMultiply(sum, quarter));
+			}
+		}
+	}
+}
+
+XMVECTOR CubeMapImage::Sample(FXMVECTOR direction) const
+{
+	uint32_t face = 0;
+	float u = 0.0f;
+	float v = 0.0f;
+	GetFaceCoordinates(direction, face, u, v);
+
+	// Texel space with the centre of the first texel at 0
+	const float size = static_cast<float>(m_Size);
+	const float x = std::clamp((u * 0.5f + 0.5f) * size - 0.5f, 0.0f, size - 1.0f);
+	const float y = std::clamp((v * 0.5f + 0.5f) * size - 0.5f, 0.0f, size - 1.0f);
+
+	const uint32_t x0 = static_cast<uint32_t>(x);
+	const uint32_t y0 = static_cast<uint32_t>(y);
+	const uint32_t x1 = std::min(x0 + 1, m_Size - 1);
+	const uint32_t y1 = std::min(y0 + 1, m_Size - 1);
+	const float fx = x - static_cast<float>(x0);
+	const float fy = y - static_cast<float>(y0);
+
+	const XMFLOAT4* texels = m_Faces[face].data();
+	const XMVECTOR top = XMVectorLerp(XMLoadFloat4(&texels[y0 * m_Size + x0]), XMLoadFloat4(&texels[y0 * m_Size + x1]), fx);
+	const XMVECTOR bottom = XMVectorLerp(XMLoadFloat4(&texels[y1 * m_Size + x0]), XMLoadFloat4(&texels[y1 * m_Size + x1]), fx);
+
+	return XMVectorLerp(top, bottom, fy);
+}
+
+bool CubeMapImage::DecodeFace(const uint8_t* data, uint32_t format, uint32_t face)
+{
+	XMFLOAT4* texels = m_Faces[face].data();
+	const size_t texel_count = static_cast<size_t>(m_Size) * m_Size;
+
+	switch (format)
+	{
+		case FORMAT_R32G32B32A32_FLOAT:
+			std::memcpy(texels, data, texel_count * sizeof(XMFLOAT4));
+			break;
+
+		case FORMAT_R16G16B16A16_FLOAT:
+			for (size_t i = 0; i < texel_count; ++i)
+			{
+				PackedVector::XMHALF4 half;
+				std::memcpy(&half, data + i * sizeof(PackedVector::XMHALF4), sizeof(PackedVector::XMHALF4));
+				XMStoreFloat4(&texels[i], PackedVector::XMLoadHalf4(&half));
+			}
+			break;
+
+		case FORMAT_R8G8B8A8_UNORM:
+		case FORMAT_R8G8B8A8_UNORM_SRGB:
+		case FORMAT_B8G8R8A8_UNORM:
+		case FORMAT_B8G8R8A8_UNORM_SRGB:
+		{
+			const bool bgra = format == FORMAT_B8G8R8A8_UNORM || format == FORMAT_B8G8R8A8_UNORM_SRGB;
+			for (size_t i = 0; i < texel_count; ++i)
+			{
+				const uint8_t* texel = data + i * 4;
+				const float r = texel[bgra ? 2 : 0] / 255.0f;
+				const float g = texel[1] / 255.0f;
+				const float b = texel[bgra ? 0 : 2] / 255.0f;
+				texels[i] = XMFLOAT4(r, g, b, texel[3] / 255.0f);
+			}
+			break;
+		}
+
+		case FORMAT_BC1_UNORM:
+		case FORMAT_BC1_UNORM_SRGB:
+		case FORMAT_BC2_UNORM:
+		case FORMAT_BC2_UNORM_SRGB:
+		case FORMAT_BC3_UNORM:
+		case FORMAT_BC3_UNORM_SRGB:
+		{
+			const bool bc1 = format == FORMAT_BC1_UNORM || format == FORMAT_BC1_UNORM_SRGB;
+			const size_t block_size = bc1 ? 8 : 16;
+			const uint32_t blocks_wide = std::max(1u, (m_Size + 3) / 4);
+
+			XMFLOAT4 block_texels[16];
+			for (uint32_t by = 0; by < blocks_wide; ++by)
+			{
+				for (uint32_t bx = 0; bx < blocks_wide; ++bx)
+				{
+					// Colour is the last 8 bytes of a BC2 / BC3 block
+					const uint8_t* block = data + (static_cast<size_t>(by) * blocks_wide + bx) * block_size;
+					DecodeColourBlock(bc1 ? block : block + 8, bc1, block_texels);
+
+					for (uint32_t y = 0; y < 4 && by * 4 + y < m_Size; ++y)
+					{
+						for (uint32_t x = 0; x < 4 && bx * 4 + x < m_Size; ++x)
+						{
+							texels[static_cast<size_t>(by * 4 + y) * m_Size + bx * 4 + x] = block_texels[y * 4 + x];
+						}
+					}
+				}
+			}
+			break;
+		}
+
+		default:
+			return false;
+	}
+
+	// Lighting is calculated in linear space
+	if (IsSRGB(format))
+	{
+		for (size_t i = 0; i < texel_count; ++i)
+		{
+			texels[i].x = SRGBToLinear(texels[i].x);
+			texels[i].y = SRGBToLinear(texels[i].y);
+			texels[i].z = SRGBToLinear(texels[i].z);
+		}
+	}
+
+	return true;
+}
+
+XMVECTOR CubeMapImage::GetDirection(uint32_t face, float u, float v)
+{
+	// v points down the face as texture rows go from top to bottom
+	switch (face)
+	{
+		case 0: return XMVector3Normalize(XMVectorSet(1.0f, -v, -u, 0.0f));
+		case 1: return XMVector3Normalize(XMVectorSet(-1.0f, -v, u, 0.0f));
+		case 2: return XMVector3Normalize(XMVectorSet(u, 1.0f, v, 0.0f));
+		case 3: return XMVector3Normalize(XMVectorSet(u, -1.0f, -v, 0.0f));
+		case 4: return XMVector3Normalize(XMVectorSet(u, -v, 1.0f, 0.0f));
+		default: return XMVector3Normalize(XMVectorSet(-u, -v, -1.0f, 0.0f));
+	}
+}
+
+void CubeMapImage::GetFaceCoordinates(FXMVECTOR direction, uint32_t& face, float& u, float& v)
+{
+	const float x = XMVectorGetX(direction);
+	const float y = XMVectorGetY(direction);
+	const float z = XMVectorGetZ(direction);
+
+	const float ax = std::fabs(x);
+	const float ay = std::fabs(y);
+	const float az = std::fabs(z);
+
+	// Project onto the face of the largest axis
+	if (ax >= ay && ax >= az)
+	{
+		face = x >= 0.0f ? 0 : 1;
+		u = (x >= 0.0f ? -z : z) / ax;
+		v = -y / ax;
+	}
+	else if (ay >= az)
+	{
+		face = y >= 0.0f ? 2 : 3;
+		u = x / ay;
+		v = (y >= 0.0f ? z : -z) / ay;
+	}
+	else
+	{
+		face = z >= 0.0f ? 4 : 5;
+		u = (z >= 0.0f ? x : -x) / az;
+		v = -y / az;
+	}
+}
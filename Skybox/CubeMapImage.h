@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <DirectXMath.h>
+
+// Cube faces in the order Direct3D stores them: +X, -X, +Y, -Y, +Z, -Z
+const uint32_t CUBE_FACE_COUNT = 6;
+
+// CPU copy of one mip level of a cube map, decoded to floating point RGBA
+class CubeMapImage
+{
+public:
+	CubeMapImage() = default;
+	virtual ~CubeMapImage() = default;
+
+	// Allocate the faces
+	void Create(uint32_t size);
+
+	// Load the first mip level from a DDS cube map that is no larger than max_size, 0 loads the top level
+	// Supports RGBA8, BGRA8, RGBA16F, RGBA32F and the BC1 - BC3 block compressed formats
+	bool LoadDDS(const std::wstring& path, uint32_t max_size = 0);
+
+	// Write a mip chain as an RGBA16F DDS cube map that CreateDDSTextureFromFile can load, every level must be half the size of the last
+	static bool SaveDDS(const std::wstring& path, const std::vector<CubeMapImage>& mip_chain);
+
+	// Box filter into a cube map half the size
+	void Downsample(CubeMapImage& output) const;
+
+	// Bilinear sample in a direction, filtering stops at the edge of each face
+	DirectX::XMVECTOR Sample(DirectX::FXMVECTOR direction) const;
+
+	// Get the width and height of each face
+	inline uint32_t GetSize() const { return m_Size; }
+
+	// Get texels of a face, rows are tightly packed
+	inline DirectX::XMFLOAT4* GetFace(uint32_t face) { return m_Faces[face].data(); }
+	inline const DirectX::XMFLOAT4* GetFace(uint32_t face) const { return m_Faces[face].data(); }
+
+	// Direction through the centre of the texel, u and v are in the range [-1, 1]
+	static DirectX::XMVECTOR GetDirection(uint32_t face, float u, float v);
+
+	// Face and coordinates in the range [-1, 1] that a direction passes through, the inverse of GetDirection
+	static void GetFaceCoordinates(DirectX::FXMVECTOR direction, uint32_t& face, float& u, float& v);
+
+private:
+	uint32_t m_Size = 0;
+	std::array<std::vector<DirectX::XMFLOAT4>, CUBE_FACE_COUNT> m_Faces;
+
+	// Decode one face from the file data
+	bool DecodeFace(const uint8_t* data, uint32_t format, uint32_t face);
+};
@@ -1,5 +1,6 @@
 #include "DefaultShader.h"
 #include "Renderer.h"
+#include "SphericalHarmonics.h"
 
 #include <Windows.h>
 #include "CompiledPixelShader.hlsl.h"
@@ -12,6 +13,7 @@ namespace
 	struct ModelViewProjectionBuffer
 	{
 		DirectX::XMMATRIX modelViewProjection;
+		DirectX::XMFLOAT4 cameraPosition;
 	};
 }
 
@@ -24,6 +26,7 @@ void DefaultShader::Load()
 	this->LoadVertexShader();
 	this->LoadPixelShader();
 	this->CreateWorldViewProjectionConstantBuffer();
+	this->CreateIrradianceConstantBuffer();
 }
 
 void DefaultShader::Use()
@@ -42,6 +45,13 @@ void DefaultShader::Use()
 	// Bind the world constant buffer to the vertex shader
 	const int constant_buffer_slot = 0;
 	context->VSSetConstantBuffers(constant_buffer_slot, 1, m_ModelViewProjectionConstantBuffer.GetAddressOf());
+
+	// The pixel shader reads the camera position for reflections
+	context->PSSetConstantBuffers(constant_buffer_slot, 1, m_ModelViewProjectionConstantBuffer.GetAddressOf());
+
+	// Bind the irradiance constant buffer to the pixel shader
+	const int irradiance_buffer_slot = 1;
+	context->PSSetConstantBuffers(irradiance_buffer_slot, 1, m_IrradianceConstantBuffer.GetAddressOf());
 }
 
 void DefaultShader::LoadVertexShader()
@@ -55,7 +65,8 @@ void DefaultShader::LoadVertexShader()
 	D3D11_INPUT_ELEMENT_DESC layout[] =
 	{
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXTURE", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXTURE", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 	};
 
 	UINT number_elements = ARRAYSIZE(layout);
@@ -81,11 +92,31 @@ void DefaultShader::CreateWorldViewProjectionConstantBuffer()
 	DX::Check(device->CreateBuffer(&bd, nullptr, m_ModelViewProjectionConstantBuffer.ReleaseAndGetAddressOf()));
 }
 
-void DefaultShader::UpdateModelViewProjectionBuffer(const DirectX::XMMATRIX& matrix)
+void DefaultShader::CreateIrradianceConstantBuffer()
+{
+	ID3D11Device* device = m_Renderer->GetDevice();
+
+	// Create irradiance constant buffer
+	D3D11_BUFFER_DESC bd = {};
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.ByteWidth = sizeof(SHIrradiance);
+	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	DX::Check(device->CreateBuffer(&bd, nullptr, m_IrradianceConstantBuffer.ReleaseAndGetAddressOf()));
+}
+
+void DefaultShader::UpdateModelViewProjectionBuffer(const DirectX::XMMATRIX& matrix, const DirectX::XMFLOAT3& camera_position)
 {
 	ModelViewProjectionBuffer buffer = {};
 	buffer.modelViewProjection = DirectX::XMMatrixTranspose(matrix);
+	buffer.cameraPosition = DirectX::XMFLOAT4(camera_position.x, camera_position.y, camera_position.z, 1.0f);
 
 	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
 	context->UpdateSubresource(m_ModelViewProjectionConstantBuffer.Get(), 0, nullptr, &buffer, 0, 0);
+}
+
+void DefaultShader::UpdateIrradianceBuffer(const SHIrradiance& irradiance)
+{
+	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
+	context->UpdateSubresource(m_IrradianceConstantBuffer.Get(), 0, nullptr, &irradiance, 0, 0);
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 using Microsoft::WRL::ComPtr;
 
 class Renderer;
+struct SHIrradiance;
 
 class DefaultShader
 {
@@ -24,7 +25,10 @@ public:
 	void Use();
 
 	// Update the model view projection constant buffer
-	void UpdateModelViewProjectionBuffer(const DirectX::XMMATRIX& matrix);
+	void UpdateModelViewProjectionBuffer(const DirectX::XMMATRIX& matrix, const DirectX::XMFLOAT3& camera_position);
+
+	// Update the sky irradiance constant buffer
+	void UpdateIrradianceBuffer(const SHIrradiance& irradiance);
 
 private:
 	// Create vertex shader
@@ -39,4 +43,8 @@ private:
 	// ModelViewProjection constant buffer
 	ComPtr<ID3D11Buffer> m_ModelViewProjectionConstantBuffer = nullptr;
 	void CreateWorldViewProjectionConstantBuffer();
+
+	// Irradiance constant buffer
+	ComPtr<ID3D11Buffer> m_IrradianceConstantBuffer = nullptr;
+	void CreateIrradianceConstantBuffer();
 };
\ No newline at end of file
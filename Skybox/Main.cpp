@@ -1,5 +1,22 @@
 #include "Application.h"
+#include "SpecularPrefilter.h"
 #include <memory>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <charconv>
+#include <cstring>
+
+namespace
+{
+	// A whole number above zero and nothing after it
+	bool ParseCount(const char* text, uint32_t& value)
+	{
+		const char* end = text + std::strlen(text);
+		std::from_chars_result result = std::from_chars(text, end, value);
+		return result.ec == std::errc() && result.ptr == end && value > 0;
+	}
+}
 
 int main(int argc, char** argv)
 {
@@ -9,6 +26,25 @@ int main(int argc, char** argv)
 	// _CrtSetBreakAlloc(972);
 #endif
 
+	// Prefilter a cube map without creating a window: Skybox.exe --prefilter <input.dds> <output.dds> [size] [samples]
+	if (argc >= 4 && std::string(argv[1]) == "--prefilter")
+	{
+		SpecularPrefilterSettings settings;
+		if ((argc >= 5 && !ParseCount(argv[4], settings.size)) || (argc >= 6 && !ParseCount(argv[5], settings.sample_count)))
+		{
+			std::cout << "Usage: Skybox.exe --prefilter <input.dds> <output.dds> [size] [samples]\n";
+			return 1;
+		}
+
+		if (!PrefilterSpecularFile(std::filesystem::path(argv[2]).wstring(), std::filesystem::path(argv[3]).wstring(), settings))
+		{
+			std::cout << "Could not prefilter " << argv[2] << "\n";
+			return 1;
+		}
+
+		return 0;
+	}
+
 	std::unique_ptr<Application> application = std::make_unique<Application>();
 	return application->Execute();
-}
\ No newline at end of file
+}
@@ -1,8 +1,30 @@
 #include "ShaderData.hlsli"
 
+// Roughness of the crate
+static const float cRoughness = 0.6f;
+
 // Entry point for the vertex shader - will be executed for each pixel
 float4 main(PixelInput input) : SV_TARGET
 {
     float4 diffuse_texture = gTextureDiffuse.Sample(gTextureSampler, input.tex);
-    return diffuse_texture;
+
+    float3 normal = normalize(input.normal);
+    float3 view = normalize(cCameraPosition.xyz - input.world_position);
+
+    // Light the crate with the irradiance of the sky
+    float3 irradiance = EvaluateIrradiance(normal);
+
+    // Reflect the prefiltered sky, picking the level that matches the roughness
+    uint width, height, levels;
+    gSpecularMap.GetDimensions(0, width, height, levels);
+
+    float3 reflection = reflect(-view, normal);
+    float3 specular = gSpecularMap.SampleLevel(gTextureSampler, reflection, cRoughness * (levels - 1)).rgb;
+
+    // Schlick fresnel for a dielectric, reduced for rough surfaces
+    float n_dot_v = saturate(dot(normal, view));
+    float fresnel = 0.04f + (max(1.0f - cRoughness, 0.04f) - 0.04f) * pow(1.0f - n_dot_v, 5.0f);
+
+    float3 colour = diffuse_texture.rgb * irradiance * (1.0f - fresnel) + specular * fresnel;
+    return float4(colour, diffuse_texture.a);
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 struct VertexInput
 {
     float3 position : POSITION;
+    float3 normal : NORMAL;
     float2 tex : TEXTURE;
 };
 
@@ -9,6 +10,8 @@ struct VertexInput
 struct PixelInput
 {
     float4 position : SV_POSITION;
+    float3 world_position : POSITION;
+    float3 normal : NORMAL;
     float2 tex : TEXTURE;
 };
 
@@ -16,10 +19,38 @@ struct PixelInput
 cbuffer WorldBuffer : register(b0)
 {
     matrix cModelViewProjection;
+    float4 cCameraPosition;
+}
+
+// Sky irradiance constant buffer, spherical harmonic coefficients already convolved with the cosine lobe
+cbuffer IrradianceBuffer : register(b1)
+{
+    float4 cIrradiance[9];
+}
+
+// Evaluate the sky irradiance in the direction of the normal
+float3 EvaluateIrradiance(float3 n)
+{
+    float3 irradiance = cIrradiance[0].rgb * 0.282095f;
+
+    irradiance += cIrradiance[1].rgb * 0.488603f * n.y;
+    irradiance += cIrradiance[2].rgb * 0.488603f * n.z;
+    irradiance += cIrradiance[3].rgb * 0.488603f * n.x;
+
+    irradiance += cIrradiance[4].rgb * 1.092548f * n.x * n.y;
+    irradiance += cIrradiance[5].rgb * 1.092548f * n.y * n.z;
+    irradiance += cIrradiance[6].rgb * 0.315392f * (3.0f * n.z * n.z - 1.0f);
+    irradiance += cIrradiance[7].rgb * 1.092548f * n.x * n.z;
+    irradiance += cIrradiance[8].rgb * 0.546274f * (n.x * n.x - n.y * n.y);
+
+    return max(irradiance, 0.0f);
 }
 
 // Texture sampler
 SamplerState gTextureSampler : register(s0);
 
 // Textures
-Texture2D gTextureDiffuse : register(t0);
\ No newline at end of file
+Texture2D gTextureDiffuse : register(t0);
+
+// Skybox prefiltered for GGX, roughness goes from 0 at the top level to 1 at the last
+TextureCube gSpecularMap : register(t1);
\ No newline at end of file
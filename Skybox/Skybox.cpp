@@ -1,6 +1,8 @@
 #include "Skybox.h"
 #include "Renderer.h"
 #include "Vertex.h"
+#include "CubeMapImage.h"
+#include "SpecularPrefilter.h"
 #include "../External/DDSTextureLoader.h"
 #include <vector>
 #include <string>
@@ -127,6 +129,67 @@ void Skybox::LoadTexture()
 
 	ComPtr<ID3D11Resource> resource = nullptr;
 	DX::Check(DirectX::CreateDDSTextureFromFile(device, context, path.c_str(), resource.ReleaseAndGetAddressOf(), m_DiffuseTexture.ReleaseAndGetAddressOf()));
+
+	this->ComputeIrradiance(path);
+	this->LoadSpecularTexture(path);
+}
+
+void Skybox::ComputeIrradiance(const std::wstring& path)
+{
+	// Irradiance is very low frequency so a small mip gives the same result as the full texture
+	const uint32_t max_face_size = 128;
+
+	CubeMapImage cube_map;
+	if (!cube_map.LoadDDS(path, max_face_size))
+	{
+		std::wstring error = L"Could not read cube map for irradiance: " + path;
+		MessageBox(NULL, error.c_str(), L"Error", MB_OK);
+		return;
+	}
+
+	m_Irradiance = ProjectIrradiance(cube_map);
+}
+
+void Skybox::LoadSpecularTexture(const std::wstring& source_path)
+{
+	SpecularPrefilterSettings settings;
+
+	// The cached file is named after the source and the settings, so changing either of them can't load a stale result
+	std::filesystem::path source = source_path;
+	std::filesystem::path path = source.parent_path() / (source.stem().wstring() + L"_specular_" + std::to_wstring(settings.size) + L"_" +
+		std::to_wstring(settings.mip_count) + L"_" + std::to_wstring(settings.sample_count) + L".dds");
+
+	// Prefilter the skybox if it has not been done before or the source has been saved since, a time that can't be read counts as stale
+	std::error_code time_error;
+	std::filesystem::file_time_type cached_time = std::filesystem::last_write_time(path, time_error);
+	bool cached = !time_error;
+	std::filesystem::file_time_type source_time = std::filesystem::last_write_time(source, time_error);
+	cached = cached && !time_error && cached_time >= source_time;
+
+	if (!cached)
+	{
+		if (!PrefilterSpecularFile(source_path, path.wstring(), settings))
+		{
+			std::wstring error = L"Could not prefilter file: " + source_path;
+			MessageBox(NULL, error.c_str(), L"Error", MB_OK);
+			return;
+		}
+	}
+
+	// Load texture into a resource shader view
+	ID3D11Device* device = m_Renderer->GetDevice();
+	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
+
+	ComPtr<ID3D11Resource> resource = nullptr;
+	DX::Check(DirectX::CreateDDSTextureFromFile(device, context, path.c_str(), resource.ReleaseAndGetAddressOf(), m_SpecularTexture.ReleaseAndGetAddressOf()));
+}
+
+void Skybox::UseReflections()
+{
+	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
+
+	const int specular_texture_slot = 1;
+	context->PSSetShaderResources(specular_texture_slot, 1, m_SpecularTexture.GetAddressOf());
 }
 
 void Skybox::Render()
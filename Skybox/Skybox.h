@@ -1,6 +1,8 @@
 #pragma once
 
 #include <d3d11.h>
+#include <string>
+#include "SphericalHarmonics.h"
 
 // This include is requires for using DirectX smart pointers (ComPtr)
 #include <wrl\client.h>
@@ -22,6 +24,12 @@ public:
 	// Render the model
 	void Render();
 
+	// Diffuse irradiance of the sky, used to light the scene
+	inline const SHIrradiance& GetIrradiance() const { return m_Irradiance; }
+
+	// Bind the prefiltered specular cube map to the pixel shader for reflections
+	void UseReflections();
+
 private:
 	// Number of indices to draw
 	UINT m_IndexCount = 0;
@@ -38,6 +46,14 @@ private:
 	void LoadTexture();
 	ComPtr<ID3D11ShaderResourceView> m_DiffuseTexture = nullptr;
 
+	// Irradiance projected from a small mip of the texture on the CPU
+	void ComputeIrradiance(const std::wstring& path);
+	SHIrradiance m_Irradiance;
+
+	// Specular cube map prefiltered on the CPU, generated on first run and loaded from disk until the source or settings change
+	void LoadSpecularTexture(const std::wstring& source_path);
+	ComPtr<ID3D11ShaderResourceView> m_SpecularTexture = nullptr;
+
 	// Raster state
 	ComPtr<ID3D11RasterizerState> m_RasterState = nullptr;
 	void CreateRasterState();
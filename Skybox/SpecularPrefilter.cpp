@@ -0,0 +1,242 @@
+#include "SpecularPrefilter.h"
+#include "CubeMapImage.h"
+#include "../External/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+using namespace DirectX;
+
+namespace
+{
+	// Texels are filtered in square tiles so threads get an even share of each level
+	const uint32_t TILE_SIZE = 32;
+
+	// Smallest face size when the number of levels is picked automatically
+	const uint32_t MIN_FACE_SIZE = 4;
+
+	// A sample direction in the tangent space of the texel, N = V = R so every texel of a level uses the same set
+	struct PrefilterSample
+	{
+		XMFLOAT3 direction;
+		float weight;
+		float lod;
+	};
+
+	struct PrefilterTile
+	{
+		uint32_t mip;
+		uint32_t face;
+		uint32_t x;
+		uint32_t y;
+	};
+
+	// Van der Corput radical inverse for the second hammersley dimension
+	float RadicalInverse(uint32_t bits)
+	{
+		bits = (bits << 16) | (bits >> 16);
+		bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+		bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+		bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+		bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+		return static_cast<float>(bits) * 2.3283064365386963e-10f;
+	}
+
+	// Importance sample the GGX distribution and pick a source level from the sample's solid angle
+	std::vector<PrefilterSample> CreateSamples(float roughness, uint32_t sample_count, uint32_t source_size, uint32_t output_size)
+	{
+		std::vector<PrefilterSample> samples;
+
+		// A mirror only needs the texel straight ahead, read from the level that matches the output size
+		if (roughness <= 0.0f)
+		{
+			const float lod = std::max(0.0f, std::log2(static_cast<float>(source_size) / static_cast<float>(output_size)));
+			samples.push_back({ XMFLOAT3(0.0f, 0.0f, 1.0f), 1.0f, lod });
+			return samples;
+		}
+
+		const float alpha = roughness * roughness;
+		const float alpha_squared = alpha * alpha;
+		const float texel_solid_angle = 4.0f * XM_PI / (6.0f * static_cast<float>(source_size) * static_cast<float>(source_size));
+
+		samples.reserve(sample_count);
+		for (uint32_t i = 0; i < sample_count; ++i)
+		{
+			const float xi_x = static_cast<float>(i) / static_cast<float>(sample_count);
+			const float xi_y = RadicalInverse(i);
+
+			// Half vector around the normal
+			const float phi = XM_2PI * xi_x;
+			const float cos_theta = std::sqrt((1.0f - xi_y) / (1.0f + (alpha_squared - 1.0f) * xi_y));
+			const float sin_theta = std::sqrt(1.0f - cos_theta * cos_theta);
+
+			// Reflect the view direction, which is the normal, about the half vector
+			const XMFLOAT3 light(2.0f * cos_theta * sin_theta * std::cos(phi), 2.0f * cos_theta * sin_theta * std::sin(phi), 2.0f * cos_theta * cos_theta - 1.0f);
+			if (light.z <= 0.0f)
+				continue;
+
+			// With N = V the pdf of the reflected direction is D / 4
+			const float denominator = cos_theta * cos_theta * (alpha_squared - 1.0f) + 1.0f;
+			const float distribution = alpha_squared / (XM_PI * denominator * denominator);
+			const float pdf = distribution * 0.25f;
+
+			// Read from a lower level when the sample covers more than one texel, biased by one level to hide the pattern
+			const float sample_solid_angle = 1.0f / (static_cast<float>(sample_count) * pdf + 0.0001f);
+			const float lod = std::max(0.0f, 0.5f * std::log2(sample_solid_angle / texel_solid_angle) + 1.0f);
+
+			samples.push_back({ light, light.z, lod });
+		}
+
+		return samples;
+	}
+
+	// Trilinear lookup in the source pyramid
+	XMVECTOR SamplePyramid(const std::vector<const CubeMapImage*>& pyramid, FXMVECTOR direction, float lod)
+	{
+		lod = std::clamp(lod, 0.0f, static_cast<float>(pyramid.size() - 1));
+
+		const size_t level = static_cast<size_t>(lod);
+		const float blend = lod - static_cast<float>(level);
+
+		XMVECTOR colour = pyramid[level]->Sample(direction);
+		if (blend > 0.0f && level + 1 < pyramid.size())
+		{
+			colour = XMVectorLerp(colour, pyramid[level + 1]->Sample(direction), blend);
+		}
+
+		return colour;
+	}
+
+	void FilterTile(const std::vector<const CubeMapImage*>& pyramid, const std::vector<PrefilterSample>& samples, const PrefilterTile& tile, CubeMapImage& output)
+	{
+		const uint32_t size = output.GetSize();
+		const float texel_size = 2.0f / static_cast<float>(size);
+		XMFLOAT4* texels = output.GetFace(tile.face);
+
+		const uint32_t end_x = std::min(tile.x + TILE_SIZE, size);
+		const uint32_t end_y = std::min(tile.y + TILE_SIZE, size);
+
+		for (uint32_t y = tile.y; y < end_y; ++y)
+		{
+			const float v = (static_cast<float>(y) + 0.5f) * texel_size - 1.0f;
+
+			for (uint32_t x = tile.x; x < end_x; ++x)
+			{
+				const float u = (static_cast<float>(x) + 0.5f) * texel_size - 1.0f;
+				const XMVECTOR normal = CubeMapImage::GetDirection(tile.face, u, v);
+
+				// Tangent space around the normal
+				const XMVECTOR up = std::fabs(XMVectorGetZ(normal)) < 0.999f ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+				const XMVECTOR tangent = XMVector3Normalize(XMVector3Cross(up, normal));
+				const XMVECTOR bitangent = XMVector3Cross(normal, tangent);
+
+				XMVECTOR colour = XMVectorZero();
+				float total_weight = 0.0f;
+
+				for (const PrefilterSample& sample : samples)
+				{
+					XMVECTOR direction = XMVectorScale(tangent, sample.direction.x);
+					direction = XMVectorMultiplyAdd(bitangent, XMVectorReplicate(sample.direction.y), direction);
+					direction = XMVectorMultiplyAdd(normal, XMVectorReplicate(sample.direction.z), direction);
+
+					colour = XMVectorMultiplyAdd(SamplePyramid(pyramid, direction, sample.lod), XMVectorReplicate(sample.weight), colour);
+					total_weight += sample.weight;
+				}
+
+				colour = XMVectorScale(colour, 1.0f / total_weight);
+				XMStoreFloat4(&texels[static_cast<size_t>(y) * size + x], XMVectorSetW(colour, 1.0f));
+			}
+		}
+	}
+}
+
+void PrefilterSpecular(const CubeMapImage& source, const SpecularPrefilterSettings& settings, std::vector<CubeMapImage>& mip_chain)
+{
+	const uint32_t size = std::max(1u, settings.size);
+
+	// Work out how many levels to produce
+	uint32_t mip_count = settings.mip_count;
+	if (mip_count == 0)
+	{
+		mip_count = 1;
+		while ((size >> mip_count) >= MIN_FACE_SIZE)
+		{
+			++mip_count;
+		}
+	}
+
+	uint32_t full_chain = 1;
+	while ((size >> full_chain) > 0)
+	{
+		++full_chain;
+	}
+
+	mip_count = std::min(mip_count, full_chain);
+
+	// Reduce the source down to a single texel so wide lobes read from small levels
+	std::vector<CubeMapImage> reduced;
+	reduced.reserve(32);
+
+	std::vector<const CubeMapImage*> pyramid = { &source };
+	while (pyramid.back()->GetSize() > 1)
+	{
+		reduced.emplace_back();
+		pyramid.back()->Downsample(reduced.back());
+		pyramid.push_back(&reduced.back());
+	}
+
+	// Allocate the output and the samples of each level
+	mip_chain.resize(mip_count);
+	std::vector<std::vector<PrefilterSample>> level_samples(mip_count);
+	std::vector<PrefilterTile> tiles;
+
+	for (uint32_t mip = 0; mip < mip_count; ++mip)
+	{
+		const uint32_t mip_size = std::max(1u, size >> mip);
+		mip_chain[mip].Create(mip_size);
+
+		const float roughness = mip_count > 1 ? static_cast<float>(mip) / static_cast<float>(mip_count - 1) : 0.0f;
+		level_samples[mip] = CreateSamples(roughness, std::max(1u, settings.sample_count), source.GetSize(), mip_size);
+
+		for (uint32_t face = 0; face < CUBE_FACE_COUNT; ++face)
+		{
+			for (uint32_t y = 0; y < mip_size; y += TILE_SIZE)
+			{
+				for (uint32_t x = 0; x < mip_size; x += TILE_SIZE)
+				{
+					tiles.push_back({ mip, face, x, y });
+				}
+			}
+		}
+	}
+
+	// Threads take the next tile until there are none left, each texel is only written by one thread
+	std::atomic<size_t> next_tile = 0;
+	auto filter_tiles = [&]()
+	{
+		for (size_t i = next_tile++; i < tiles.size(); i = next_tile++)
+		{
+			const PrefilterTile& tile = tiles[i];
+			FilterTile(pyramid, level_samples[tile.mip], tile, mip_chain[tile.mip]);
+		}
+	};
+
+	uint32_t thread_count = settings.thread_count != 0 ? settings.thread_count : std::thread::hardware_concurrency();
+	thread_count = std::clamp(thread_count, 1u, static_cast<uint32_t>(tiles.size()));
+
+	ThreadPool::GetShared().Run(thread_count, filter_tiles);
+}
+
+bool PrefilterSpecularFile(const std::wstring& source_path, const std::wstring& output_path, const SpecularPrefilterSettings& settings)
+{
+	// Load a level with at least twice the resolution of the output so the mirror level stays sharp
+	CubeMapImage source;
+	if (!source.LoadDDS(source_path, settings.size * 2))
+		return false;
+
+	std::vector<CubeMapImage> mip_chain;
+	PrefilterSpecular(source, settings, mip_chain);
+
+	return CubeMapImage::SaveDDS(output_path, mip_chain);
+}
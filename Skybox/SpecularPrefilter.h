@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CubeMapImage;
+
+// Settings for prefiltering an environment map for GGX specular reflections
+struct SpecularPrefilterSettings
+{
+	// Width and height of the top level faces
+	uint32_t size = 128;
+
+	// Number of levels, roughness goes from 0 at the top level to 1 at the last, 0 stops at 4x4 faces
+	uint32_t mip_count = 0;
+
+	// Importance samples per texel
+	uint32_t sample_count = 128;
+
+	// Worker threads, 0 uses every core
+	uint32_t thread_count = 0;
+};
+
+// Convolve the source with the GGX distribution for each roughness level
+// Every texel uses the same hammersley sequence and no state is shared between threads, so the output is identical for any thread count
+void PrefilterSpecular(const CubeMapImage& source, const SpecularPrefilterSettings& settings, std::vector<CubeMapImage>& mip_chain);
+
+// Load a DDS cube map, prefilter it and write the mip chain as an RGBA16F DDS
+bool PrefilterSpecularFile(const std::wstring& source_path, const std::wstring& output_path, const SpecularPrefilterSettings& settings);
@@ -0,0 +1,250 @@
+#include "SphericalHarmonics.h"
+#include "CubeMapImage.h"
+#include "../External/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+using namespace DirectX;
+
+namespace
+{
+	// Basis function constants for the first three bands
+	const float SH_Y00 = 0.282095f;
+	const float SH_Y1 = 0.488603f;
+	const float SH_Y2 = 1.092548f;
+	const float SH_Y20 = 0.315392f;
+	const float SH_Y22 = 0.546274f;
+
+	// Convolution with the cosine lobe divided by pi for each band
+	const float SH_BAND_SCALE[SH_COEFFICIENT_COUNT] =
+	{
+		1.0f,
+		2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f,
+		0.25f, 0.25f, 0.25f, 0.25f, 0.25f,
+	};
+
+	// Direction of a texel before normalising is constant + u * u_axis + v * v_axis
+	// Matches CubeMapImage::GetDirection, stored per component so 4 texels can be worked on at once
+	struct FaceAxes
+	{
+		float constant[3];
+		float u_axis[3];
+		float v_axis[3];
+	};
+
+	const FaceAxes FACE_AXES[CUBE_FACE_COUNT] =
+	{
+		{ { +1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, -1.0f, 0.0f } },
+		{ { -1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, +1.0f }, { 0.0f, -1.0f, 0.0f } },
+		{ { 0.0f, +1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, +1.0f } },
+		{ { 0.0f, -1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f } },
+		{ { 0.0f, 0.0f, +1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f } },
+		{ { 0.0f, 0.0f, -1.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f } },
+	};
+
+	// Sum of one face, kept in double so large faces do not lose precision
+	struct FaceSum
+	{
+		double coefficients[SH_COEFFICIENT_COUNT][3] = {};
+		double weight = 0.0;
+	};
+
+	inline float HorizontalSum(FXMVECTOR value)
+	{
+		XMFLOAT4 lanes;
+		XMStoreFloat4(&lanes, value);
+		return (lanes.x + lanes.y) + (lanes.z + lanes.w);
+	}
+
+	// Project a single face, 4 texels of a row per iteration
+	void ProjectFace(const CubeMapImage& cube_map, uint32_t face, FaceSum& result)
+	{
+		const uint32_t size = cube_map.GetSize();
+		const XMFLOAT4* texels = cube_map.GetFace(face);
+		const FaceAxes& axes = FACE_AXES[face];
+
+		const float texel_size = 2.0f / static_cast<float>(size);
+		const XMVECTOR lane_offset = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
+
+		for (uint32_t y = 0; y < size; ++y)
+		{
+			const float v = (static_cast<float>(y) + 0.5f) * texel_size - 1.0f;
+			const XMVECTOR v_vector = XMVectorReplicate(v);
+
+			XMVECTOR sum_r[SH_COEFFICIENT_COUNT];
+			XMVECTOR sum_g[SH_COEFFICIENT_COUNT];
+			XMVECTOR sum_b[SH_COEFFICIENT_COUNT];
+			for (uint32_t i = 0; i < SH_COEFFICIENT_COUNT; ++i)
+			{
+				sum_r[i] = sum_g[i] = sum_b[i] = XMVectorZero();
+			}
+
+			XMVECTOR sum_weight = XMVectorZero();
+
+			const XMFLOAT4* row = texels + static_cast<size_t>(y) * size;
+			for (uint32_t x = 0; x < size; x += 4)
+			{
+				// Load 4 texels, the tail of a row smaller than 4 is padded with zero weight
+				const uint32_t count = std::min(4u, size - x);
+
+				XMMATRIX colour;
+				XMVECTOR lane_mask;
+				if (count == 4)
+				{
+					colour.r[0] = XMLoadFloat4(&row[x + 0]);
+					colour.r[1] = XMLoadFloat4(&row[x + 1]);
+					colour.r[2] = XMLoadFloat4(&row[x + 2]);
+					colour.r[3] = XMLoadFloat4(&row[x + 3]);
+					lane_mask = XMVectorTrueInt();
+				}
+				else
+				{
+					for (uint32_t i = 0; i < 4; ++i)
+					{
+						colour.r[i] = i < count ? XMLoadFloat4(&row[x + i]) : XMVectorZero();
+					}
+
+					lane_mask = XMVectorLess(lane_offset, XMVectorReplicate(static_cast<float>(count)));
+				}
+
+				// Rows become r, g, b and a across the 4 texels
+				colour = XMMatrixTranspose(colour);
+
+				// Texel centres along the row
+				XMVECTOR u = XMVectorAdd(XMVectorReplicate(static_cast<float>(x) + 0.5f), lane_offset);
+				u = XMVectorSubtract(XMVectorMultiply(u, XMVectorReplicate(texel_size)), XMVectorSplatOne());
+
+				// Unnormalised direction
+				XMVECTOR direction[3];
+				for (uint32_t axis = 0; axis < 3; ++axis)
+				{
+					direction[axis] = XMVectorReplicate(axes.constant[axis]);
+					direction[axis] = XMVectorMultiplyAdd(u, XMVectorReplicate(axes.u_axis[axis]), direction[axis]);
+					direction[axis] = XMVectorMultiplyAdd(v_vector, XMVectorReplicate(axes.v_axis[axis]), direction[axis]);
+				}
+
+				// Solid angle of a texel is proportional to 1 / (1 + u^2 + v^2)^(3/2)
+				XMVECTOR length_squared = XMVectorMultiplyAdd(u, u, XMVectorMultiplyAdd(v_vector, v_vector, XMVectorSplatOne()));
+				XMVECTOR inverse_length = XMVectorReciprocalSqrt(length_squared);
+				XMVECTOR weight = XMVectorMultiply(inverse_length, XMVectorMultiply(inverse_length, inverse_length));
+				weight = XMVectorAndInt(weight, lane_mask);
+
+				const XMVECTOR dx = XMVectorMultiply(direction[0], inverse_length);
+				const XMVECTOR dy = XMVectorMultiply(direction[1], inverse_length);
+				const XMVECTOR dz = XMVectorMultiply(direction[2], inverse_length);
+
+				// Basis functions scaled by the texel weight
+				XMVECTOR basis[SH_COEFFICIENT_COUNT];
+				basis[0] = XMVectorScale(weight, SH_Y00);
+				basis[1] = XMVectorMultiply(XMVectorScale(dy, SH_Y1), weight);
+				basis[2] = XMVectorMultiply(XMVectorScale(dz, SH_Y1), weight);
+				basis[3] = XMVectorMultiply(XMVectorScale(dx, SH_Y1), weight);
+				basis[4] = XMVectorMultiply(XMVectorScale(XMVectorMultiply(dx, dy), SH_Y2), weight);
+				basis[5] = XMVectorMultiply(XMVectorScale(XMVectorMultiply(dy, dz), SH_Y2), weight);
+				basis[6] = XMVectorMultiply(XMVectorScale(XMVectorSubtract(XMVectorScale(XMVectorMultiply(dz, dz), 3.0f), XMVectorSplatOne()), SH_Y20), weight);
+				basis[7] = XMVectorMultiply(XMVectorScale(XMVectorMultiply(dx, dz), SH_Y2), weight);
+				basis[8] = XMVectorMultiply(XMVectorScale(XMVectorSubtract(XMVectorMultiply(dx, dx), XMVectorMultiply(dy, dy)), SH_Y22), weight);
+
+				for (uint32_t i = 0; i < SH_COEFFICIENT_COUNT; ++i)
+				{
+					sum_r[i] = XMVectorMultiplyAdd(basis[i], colour.r[0], sum_r[i]);
+					sum_g[i] = XMVectorMultiplyAdd(basis[i], colour.r[1], sum_g[i]);
+					sum_b[i] = XMVectorMultiplyAdd(basis[i], colour.r[2], sum_b[i]);
+				}
+
+				sum_weight = XMVectorAdd(sum_weight, weight);
+			}
+
+			// Move the row into the double precision face sum
+			for (uint32_t i = 0; i < SH_COEFFICIENT_COUNT; ++i)
+			{
+				result.coefficients[i][0] += HorizontalSum(sum_r[i]);
+				result.coefficients[i][1] += HorizontalSum(sum_g[i]);
+				result.coefficients[i][2] += HorizontalSum(sum_b[i]);
+			}
+
+			result.weight += HorizontalSum(sum_weight);
+		}
+	}
+}
+
+SHIrradiance ProjectIrradiance(const CubeMapImage& cube_map, uint32_t thread_count)
+{
+	SHIrradiance irradiance;
+	if (cube_map.GetSize() == 0)
+		return irradiance;
+
+	if (thread_count == 0 || thread_count > CUBE_FACE_COUNT)
+	{
+		thread_count = CUBE_FACE_COUNT;
+	}
+
+	// Threads take the next face until there are none left, results are kept per face so the output does not depend on the thread count
+	FaceSum face_sums[CUBE_FACE_COUNT];
+
+	std::atomic<uint32_t> next_face(0);
+	auto project_faces = [&]()
+	{
+		for (uint32_t face = next_face++; face < CUBE_FACE_COUNT; face = next_face++)
+		{
+			ProjectFace(cube_map, face, face_sums[face]);
+		}
+	};
+
+	ThreadPool::GetShared().Run(thread_count, project_faces);
+
+	// Sum the faces in order
+	FaceSum total;
+	for (const FaceSum& face_sum : face_sums)
+	{
+		for (uint32_t i = 0; i < SH_COEFFICIENT_COUNT; ++i)
+		{
+			total.coefficients[i][0] += face_sum.coefficients[i][0];
+			total.coefficients[i][1] += face_sum.coefficients[i][1];
+			total.coefficients[i][2] += face_sum.coefficients[i][2];
+		}
+
+		total.weight += face_sum.weight;
+	}
+
+	// The weights sum to the area of the sphere
+	const double normalise = (4.0 * XM_PI) / total.weight;
+	for (uint32_t i = 0; i < SH_COEFFICIENT_COUNT; ++i)
+	{
+		const double scale = normalise * SH_BAND_SCALE[i];
+		irradiance.coefficients[i].x = static_cast<float>(total.coefficients[i][0] * scale);
+		irradiance.coefficients[i].y = static_cast<float>(total.coefficients[i][1] * scale);
+		irradiance.coefficients[i].z = static_cast<float>(total.coefficients[i][2] * scale);
+		irradiance.coefficients[i].w = 0.0f;
+	}
+
+	return irradiance;
+}
+
+XMVECTOR EvaluateIrradiance(const SHIrradiance& irradiance, FXMVECTOR normal)
+{
+	const float x = XMVectorGetX(normal);
+	const float y = XMVectorGetY(normal);
+	const float z = XMVectorGetZ(normal);
+
+	const float basis[SH_COEFFICIENT_COUNT] =
+	{
+		SH_Y00,
+		SH_Y1 * y,
+		SH_Y1 * z,
+		SH_Y1 * x,
+		SH_Y2 * x * y,
+		SH_Y2 * y * z,
+		SH_Y20 * (3.0f * z * z - 1.0f),
+		SH_Y2 * x * z,
+		SH_Y22 * (x * x - y * y),
+	};
+
+	XMVECTOR result = XMVectorZero();
+	for (uint32_t i = 0; i < SH_COEFFICIENT_COUNT; ++i)
+	{
+		result = XMVectorMultiplyAdd(XMLoadFloat4(&irradiance.coefficients[i]), XMVectorReplicate(basis[i]), result);
+	}
+
+	return XMVectorMax(result, XMVectorZero());
+}
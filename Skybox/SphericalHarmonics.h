@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <DirectXMath.h>
+
+class CubeMapImage;
+
+// Number of coefficients for the first three bands
+const uint32_t SH_COEFFICIENT_COUNT = 9;
+
+// Irradiance stored as 9 RGB spherical harmonic coefficients, w is unused
+// Already convolved with the cosine lobe and divided by pi, so a lambertian surface is albedo * Evaluate(normal)
+// Layout matches the IrradianceBuffer constant buffer
+struct SHIrradiance
+{
+	DirectX::XMFLOAT4 coefficients[SH_COEFFICIENT_COUNT] = {};
+};
+
+// Project the cube map into irradiance, weighting each texel by its solid angle
+// Faces are shared between up to thread_count threads, 0 uses one thread per face
+SHIrradiance ProjectIrradiance(const CubeMapImage& cube_map, uint32_t thread_count = 0);
+
+// Evaluate irradiance in a direction, same as EvaluateIrradiance in the pixel shader
+DirectX::XMVECTOR EvaluateIrradiance(const SHIrradiance& irradiance, DirectX::FXMVECTOR normal);
@@ -9,6 +9,15 @@ struct VertexPosition
 	float z = 0;
 };
 
+struct VertexNormal
+{
+	VertexNormal(float x, float y, float z) : x(x), y(y), z(z) {}
+
+	float x = 0;
+	float y = 0;
+	float z = 0;
+};
+
 struct VertexTextureUV
 {
 	VertexTextureUV(float u, float v) : u(u), v(v) {}
@@ -20,6 +29,7 @@ struct VertexTextureUV
 struct Vertex
 {
 	VertexPosition position;
+	VertexNormal normal;
 	VertexTextureUV texture;
 };
 
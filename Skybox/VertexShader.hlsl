@@ -8,6 +8,10 @@ PixelInput main(VertexInput input)
 	// Transform to homogeneous clip space
     pixel_input.position = mul(float4(input.position, 1.0f), cModelViewProjection);
 
+	// Model matrix is the identity so the position and normal are already in world space
+    pixel_input.world_position = input.position;
+    pixel_input.normal = input.normal;
+
 	// Set the vertex colour
     pixel_input.tex = input.tex;
 
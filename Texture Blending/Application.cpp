@@ -7,6 +7,8 @@
 #include "Camera.h"
 #include "RasterState.h"
 #include "TextureSampler.h"
+#include "MaterialLibrary.h"
+#include "MaterialTable.h"
 
 #include <DirectXMath.h>
 using namespace DirectX;
@@ -42,11 +44,12 @@ int Application::Execute()
 	// Model
 	m_ModelFloor = std::make_unique<Model>(m_Renderer.get());
 	m_ModelFloor->Create();
-	m_ModelFloor->LoadTextures(L"PavingStones142_1K-PNG_Color.png", L"Moss001_1K-PNG_Color.png", L"alpha_map.png");
 
 	m_ModelCube = std::make_unique<Model>(m_Renderer.get());
 	m_ModelCube->Create();
-	m_ModelCube->LoadTextures(L"water_basecolour.png", L"water_highlights2.png", L"water_highlights.png");
+
+	// Materials
+	this->CreateMaterials();
 
 	// Raster state
 	m_RasterState = std::make_unique<RasterState>(m_Renderer.get());
@@ -85,6 +88,9 @@ int Application::Execute()
 			// Bind texture sampler to the pipeline
 			m_TextureSampler->Use();
 
+			// Bind the texture arrays and material table, each model selects its material by index
+			m_MaterialTable->Use();
+
 			// Render the floor
 			{
 				m_Renderer->ResetBlendState();
@@ -92,7 +98,7 @@ int Application::Execute()
 				DirectX::XMMATRIX floor_world = DirectX::XMMatrixIdentity();
 				floor_world *= DirectX::XMMatrixScaling(5.0f, 0.01f, 5.0f);
 				floor_world *= DirectX::XMMatrixTranslation(0.0f, -2.0f, 0.0f);
-				this->ComputeModelViewProjectionMatrix(floor_world, TextureBlendMode::Interpolate);
+				this->ComputeModelViewProjectionMatrix(floor_world, m_ModelFloor.get());
 				m_ModelFloor->Render();
 			}
 
@@ -103,7 +109,7 @@ int Application::Execute()
 				DirectX::XMMATRIX model_world = DirectX::XMMatrixIdentity();
 				model_world *= DirectX::XMMatrixScaling(2.0f, 2.0f, 2.0f);
 				model_world *= DirectX::XMMatrixTranslation(0.0f, 0.0f, 0.0f);
-				this->ComputeModelViewProjectionMatrix(model_world, TextureBlendMode::Screen);
+				this->ComputeModelViewProjectionMatrix(model_world, m_ModelCube.get());
 				m_ModelCube->Render();
 			}
 
@@ -209,11 +215,40 @@ void Application::CalculateFrameStats(float delta_time)
 	}
 }
 
-void Application::ComputeModelViewProjectionMatrix(const DirectX::XMMATRIX& world, TextureBlendMode mode)
+void Application::CreateMaterials()
+{
+	MaterialLibrary library;
+
+	// Floor
+	const TextureSlot floor_textures[MATERIAL_TEXTURE_COUNT] =
+	{
+		library.AddTexture(L"PavingStones142_1K-PNG_Color.png"),
+		library.AddTexture(L"Moss001_1K-PNG_Color.png"),
+		library.AddTexture(L"alpha_map.png"),
+	};
+
+	m_ModelFloor->SetMaterial(library.AddMaterial(floor_textures, static_cast<int>(TextureBlendMode::Interpolate)));
+
+	// Water
+	const TextureSlot water_textures[MATERIAL_TEXTURE_COUNT] =
+	{
+		library.AddTexture(L"water_basecolour.png"),
+		library.AddTexture(L"water_highlights2.png"),
+		library.AddTexture(L"water_highlights.png"),
+	};
+
+	m_ModelCube->SetMaterial(library.AddMaterial(water_textures, static_cast<int>(TextureBlendMode::Screen)));
+
+	// Upload to the GPU
+	m_MaterialTable = std::make_unique<MaterialTable>(m_Renderer.get());
+	m_MaterialTable->Create(library);
+}
+
+void Application::ComputeModelViewProjectionMatrix(const DirectX::XMMATRIX& world, const Model* model)
 {
 	DirectX::XMMATRIX matrix = world;
 	matrix *= m_Camera->GetView();
 	matrix *= m_Camera->GetProjection();
 
-	m_Shader->UpdateModelViewProjectionBuffer(matrix, static_cast<int>(mode));
+	m_Shader->UpdateModelViewProjectionBuffer(matrix, model->GetMaterial());
 }
\ No newline at end of file
@@ -16,6 +16,7 @@ class Camera;
 class Model;
 class RasterState;
 class TextureSampler;
+class MaterialTable;
 
 enum class TextureBlendMode
 {
@@ -43,6 +44,7 @@ private:
 	std::unique_ptr<Camera> m_Camera = nullptr;
 	std::unique_ptr<RasterState> m_RasterState = nullptr;
 	std::unique_ptr<TextureSampler> m_TextureSampler = nullptr;
+	std::unique_ptr<MaterialTable> m_MaterialTable = nullptr;
 
 	std::unique_ptr<Model> m_ModelFloor = nullptr;
 	std::unique_ptr<Model> m_ModelCube = nullptr;
@@ -64,6 +66,9 @@ private:
 	void CalculateFrameStats(float delta_time);
 	int m_FrameCount = 0;
 
+	// Load the textures and materials into the material table
+	void CreateMaterials();
+
 	// Compute model view projection of the camera
-	void ComputeModelViewProjectionMatrix(const DirectX::XMMATRIX& world, TextureBlendMode mode);
+	void ComputeModelViewProjectionMatrix(const DirectX::XMMATRIX& world, const Model* model);
 };
\ No newline at end of file
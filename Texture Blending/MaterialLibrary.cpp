@@ -0,0 +1,79 @@
+#include "MaterialLibrary.h"
+
+#include <cstring>
+#include <stdexcept>
+
+TextureSlot MaterialLibrary::AddTexture(const std::wstring& path)
+{
+	// Share textures which have already been loaded
+	auto it = m_LoadedTextures.find(path);
+	if (it != m_LoadedTextures.end())
+		return it->second;
+
+	if (!m_ImageDecoder.DecodeFile(path, m_ImageBuffer))
+		throw std::runtime_error("Failed to decode texture");
+
+	TextureSlot slot = this->AddImage(m_ImageBuffer);
+	m_LoadedTextures.emplace(path, slot);
+
+	return slot;
+}
+
+TextureSlot MaterialLibrary::AddImage(const ImageBuffer& image)
+{
+	// Find an array with the same size and format
+	uint32_t array_index = 0;
+	for (; array_index < m_TextureArrays.size(); ++array_index)
+	{
+		const TextureArrayBucket& bucket = m_TextureArrays[array_index];
+		if (bucket.width == image.width && bucket.height == image.height && bucket.srgb == image.srgb)
+			break;
+	}
+
+	// Start a new array if none match
+	if (array_index == m_TextureArrays.size())
+	{
+		if (m_TextureArrays.size() == MAX_MATERIAL_TEXTURE_ARRAYS)
+			throw std::runtime_error("Too many texture array formats");
+
+		TextureArrayBucket bucket;
+		bucket.width = image.width;
+		bucket.height = image.height;
+		bucket.srgb = image.srgb;
+		m_TextureArrays.push_back(std::move(bucket));
+	}
+
+	// Append the image as a new slice, rows are copied as the image may have padding
+	TextureArrayBucket& bucket = m_TextureArrays[array_index];
+	const size_t slice_size = bucket.GetSliceSize();
+	const size_t row_size = static_cast<size_t>(bucket.width) * 4;
+
+	bucket.pixels.resize(slice_size * (static_cast<size_t>(bucket.slice_count) + 1));
+	uint8_t* destination = bucket.pixels.data() + slice_size * bucket.slice_count;
+
+	for (uint32_t y = 0; y < image.height; ++y)
+	{
+		std::memcpy(destination + row_size * y, image.pixels.data() + static_cast<size_t>(image.row_pitch) * y, row_size);
+	}
+
+	TextureSlot slot;
+	slot.array_index = array_index;
+	slot.slice = bucket.slice_count++;
+
+	return slot;
+}
+
+uint32_t MaterialLibrary::AddMaterial(const TextureSlot (&textures)[MATERIAL_TEXTURE_COUNT], int blend_mode)
+{
+	MaterialData material;
+	for (uint32_t i = 0; i < MATERIAL_TEXTURE_COUNT; ++i)
+	{
+		material.array_index[i] = textures[i].array_index;
+		material.slice[i] = textures[i].slice;
+	}
+
+	material.array_index[3] = static_cast<uint32_t>(blend_mode);
+
+	m_Materials.push_back(material);
+	return static_cast<uint32_t>(m_Materials.size() - 1);
+}
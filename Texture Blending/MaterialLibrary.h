@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../External/ImageDecoder.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Maximum number of texture arrays, each must be bound to its own register in the pixel shader
+const uint32_t MAX_MATERIAL_TEXTURE_ARRAYS = 4;
+
+// Number of textures blended together by each material
+const uint32_t MATERIAL_TEXTURE_COUNT = 3;
+
+// Location of a texture inside the shared texture arrays
+struct TextureSlot
+{
+	uint32_t array_index = 0;
+	uint32_t slice = 0;
+};
+
+// Textures of the same size and format packed together as the slices of one Texture2DArray
+struct TextureArrayBucket
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	bool srgb = false;
+	uint32_t slice_count = 0;
+
+	// Slices stored one after the other, each is width * height RGBA8
+	std::vector<uint8_t> pixels;
+
+	inline size_t GetSliceSize() const { return static_cast<size_t>(width) * height * 4; }
+	inline const uint8_t* GetSlice(uint32_t slice) const { return pixels.data() + GetSliceSize() * slice; }
+};
+
+// Material as laid out in the structured buffer, must match the Material struct in ShaderData.hlsli
+struct MaterialData
+{
+	// xyz texture arrays, w blend mode
+	uint32_t array_index[4] = {};
+
+	// xyz texture array slice
+	uint32_t slice[4] = {};
+};
+
+// Builds the texture arrays and material table on the CPU, does not touch Direct3D
+class MaterialLibrary
+{
+public:
+	MaterialLibrary() = default;
+	virtual ~MaterialLibrary() = default;
+
+	// Load a texture from file, textures already loaded from the same path are shared
+	TextureSlot AddTexture(const std::wstring& path);
+
+	// Pack a decoded image into a texture array of matching size and format
+	TextureSlot AddImage(const ImageBuffer& image);
+
+	// Add a material blending the textures, returns the material index
+	uint32_t AddMaterial(const TextureSlot (&textures)[MATERIAL_TEXTURE_COUNT], int blend_mode);
+
+	// Get the texture arrays
+	inline const std::vector<TextureArrayBucket>& GetTextureArrays() const { return m_TextureArrays; }
+
+	// Get the material table
+	inline const std::vector<MaterialData>& GetMaterials() const { return m_Materials; }
+
+private:
+	std::vector<TextureArrayBucket> m_TextureArrays;
+	std::vector<MaterialData> m_Materials;
+
+	// Textures already loaded keyed by path
+	std::unordered_map<std::wstring, TextureSlot> m_LoadedTextures;
+
+	// Decoder and buffer reused across textures
+	StbImageDecoder m_ImageDecoder;
+	ImageBuffer m_ImageBuffer;
+};
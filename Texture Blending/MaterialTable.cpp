@@ -0,0 +1,99 @@
+#include "MaterialTable.h"
+#include "Renderer.h"
+
+MaterialTable::MaterialTable(Renderer* renderer) : m_Renderer(renderer)
+{
+}
+
+void MaterialTable::Create(const MaterialLibrary& library)
+{
+	const std::vector<TextureArrayBucket>& buckets = library.GetTextureArrays();
+
+	m_TextureArrays.resize(buckets.size());
+	for (size_t i = 0; i < buckets.size(); ++i)
+	{
+		this->CreateTextureArray(buckets[i], m_TextureArrays[i]);
+	}
+
+	this->CreateMaterialBuffer(library.GetMaterials());
+}
+
+void MaterialTable::Use()
+{
+	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
+
+	// Bind the texture arrays to t0 - t3, unused registers are left empty
+	ID3D11ShaderResourceView* texture_arrays[MAX_MATERIAL_TEXTURE_ARRAYS] = {};
+	for (size_t i = 0; i < m_TextureArrays.size(); ++i)
+	{
+		texture_arrays[i] = m_TextureArrays[i].Get();
+	}
+
+	context->PSSetShaderResources(0, MAX_MATERIAL_TEXTURE_ARRAYS, texture_arrays);
+
+	// Bind the material table after the texture arrays
+	const UINT material_buffer_slot = MAX_MATERIAL_TEXTURE_ARRAYS;
+	context->PSSetShaderResources(material_buffer_slot, 1, m_MaterialBufferView.GetAddressOf());
+}
+
+void MaterialTable::CreateTextureArray(const TextureArrayBucket& bucket, ComPtr<ID3D11ShaderResourceView>& texture_view)
+{
+	ID3D11Device* device = m_Renderer->GetDevice();
+	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
+
+	// Describe the texture array, mipmaps are generated on the GPU
+	D3D11_TEXTURE2D_DESC texture_desc = {};
+	texture_desc.Width = bucket.width;
+	texture_desc.Height = bucket.height;
+	texture_desc.MipLevels = 0;
+	texture_desc.ArraySize = bucket.slice_count;
+	texture_desc.Format = bucket.srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+	texture_desc.SampleDesc.Count = 1;
+	texture_desc.SampleDesc.Quality = 0;
+	texture_desc.Usage = D3D11_USAGE_DEFAULT;
+	texture_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+	texture_desc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+	ComPtr<ID3D11Texture2D> texture = nullptr;
+	DX::Check(device->CreateTexture2D(&texture_desc, nullptr, texture.ReleaseAndGetAddressOf()));
+
+	// Query how many mip levels were created so we can find the top level of each slice
+	texture->GetDesc(&texture_desc);
+
+	const UINT row_pitch = bucket.width * 4;
+	for (uint32_t slice = 0; slice < bucket.slice_count; ++slice)
+	{
+		UINT subresource = D3D11CalcSubresource(0, slice, texture_desc.MipLevels);
+		context->UpdateSubresource(texture.Get(), subresource, nullptr, bucket.GetSlice(slice), row_pitch, 0);
+	}
+
+	DX::Check(device->CreateShaderResourceView(texture.Get(), nullptr, texture_view.ReleaseAndGetAddressOf()));
+	context->GenerateMips(texture_view.Get());
+}
+
+void MaterialTable::CreateMaterialBuffer(const std::vector<MaterialData>& materials)
+{
+	ID3D11Device* device = m_Renderer->GetDevice();
+
+	// Create structured buffer
+	D3D11_BUFFER_DESC buffer_desc = {};
+	buffer_desc.Usage = D3D11_USAGE_IMMUTABLE;
+	buffer_desc.ByteWidth = static_cast<UINT>(sizeof(MaterialData) * materials.size());
+	buffer_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	buffer_desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	buffer_desc.StructureByteStride = sizeof(MaterialData);
+
+	D3D11_SUBRESOURCE_DATA buffer_subdata = {};
+	buffer_subdata.pSysMem = materials.data();
+
+	DX::Check(device->CreateBuffer(&buffer_desc, &buffer_subdata, m_MaterialBuffer.ReleaseAndGetAddressOf()));
+
+	// Create the shader resource view
+	D3D11_SHADER_RESOURCE_VIEW_DESC view_desc = {};
+	view_desc.Format = DXGI_FORMAT_UNKNOWN;
+	view_desc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	view_desc.Buffer.FirstElement = 0;
+	view_desc.Buffer.NumElements = static_cast<UINT>(materials.size());
+
+	DX::Check(device->CreateShaderResourceView(m_MaterialBuffer.Get(), &view_desc, m_MaterialBufferView.ReleaseAndGetAddressOf()));
+}
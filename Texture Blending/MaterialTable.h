@@ -0,0 +1,38 @@
+#pragma once
+
+#include "MaterialLibrary.h"
+
+#include <d3d11.h>
+#include <vector>
+
+// This include is requires for using DirectX smart pointers (ComPtr)
+#include <wrl\client.h>
+using Microsoft::WRL::ComPtr;
+
+class Renderer;
+
+// Uploads the material library as texture arrays and a structured buffer of materials
+class MaterialTable
+{
+	Renderer* m_Renderer = nullptr;
+
+public:
+	MaterialTable(Renderer* renderer);
+	virtual ~MaterialTable() = default;
+
+	// Create the GPU resources from the library
+	void Create(const MaterialLibrary& library);
+
+	// Bind every texture array and the material table, only needs to be done once per frame
+	void Use();
+
+private:
+	// Texture arrays
+	void CreateTextureArray(const TextureArrayBucket& bucket, ComPtr<ID3D11ShaderResourceView>& texture_view);
+	std::vector<ComPtr<ID3D11ShaderResourceView>> m_TextureArrays;
+
+	// Material structured buffer
+	void CreateMaterialBuffer(const std::vector<MaterialData>& materials);
+	ComPtr<ID3D11Buffer> m_MaterialBuffer = nullptr;
+	ComPtr<ID3D11ShaderResourceView> m_MaterialBufferView = nullptr;
+};
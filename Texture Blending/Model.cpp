@@ -1,7 +1,6 @@
 #include "Model.h"
 #include "Renderer.h"
 #include "Vertex.h"
-#include "../External/WICTextureLoader.h"
 #include <vector>
 #include <string>
 #include <filesystem>
@@ -105,18 +104,6 @@ void Model::CreateIndexBuffer()
 	DX::Check(device->CreateBuffer(&index_buffer_desc, &index_subdata, m_IndexBuffer.ReleaseAndGetAddressOf()));
 }
 
-void Model::LoadTextures(const std::wstring& path1, const std::wstring& path2, const std::wstring& path3)
-{
-	// Load texture into a resource shader view
-	ID3D11Device* device = m_Renderer->GetDevice();
-	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
-
-	ComPtr<ID3D11Resource> resource = nullptr;
-	DX::Check(DirectX::CreateWICTextureFromFile(device, context, path1.c_str(), resource.ReleaseAndGetAddressOf(), m_DiffuseTexture1.ReleaseAndGetAddressOf()));
-	DX::Check(DirectX::CreateWICTextureFromFile(device, context, path2.c_str(), resource.ReleaseAndGetAddressOf(), m_DiffuseTexture2.ReleaseAndGetAddressOf()));
-	DX::Check(DirectX::CreateWICTextureFromFile(device, context, path3.c_str(), resource.ReleaseAndGetAddressOf(), m_DiffuseTexture3.ReleaseAndGetAddressOf()));
-}
-
 void Model::Render()
 {
 	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
@@ -134,11 +121,6 @@ void Model::Render()
 	// Bind the geometry topology to the pipeline's Input Assembler stage
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-	// Bind texture to the pixel shader
-	context->PSSetShaderResources(0, 1, m_DiffuseTexture1.GetAddressOf());
-	context->PSSetShaderResources(1, 1, m_DiffuseTexture2.GetAddressOf());
-	context->PSSetShaderResources(2, 1, m_DiffuseTexture3.GetAddressOf());
-
 	// Render geometry
 	context->DrawIndexed(m_IndexCount, 0, 0);
 }
\ No newline at end of file
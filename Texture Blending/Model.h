@@ -1,7 +1,7 @@
 #pragma once
 
 #include <d3d11.h>
-#include <string>
+#include <cstdint>
 
 // This include is requires for using DirectX smart pointers (ComPtr)
 #include <wrl\client.h>
@@ -23,8 +23,11 @@ public:
 	// Render the model
 	void Render();
 
-	// Load all textures
-	void LoadTextures(const std::wstring& path1, const std::wstring& path2, const std::wstring& path3);
+	// Set the index of the material in the material table
+	inline void SetMaterial(uint32_t material) { m_Material = material; }
+
+	// Get the index of the material in the material table
+	inline uint32_t GetMaterial() const { return m_Material; }
 
 private:
 	// Number of indices to draw
@@ -38,8 +41,6 @@ private:
 	void CreateIndexBuffer();
 	ComPtr<ID3D11Buffer> m_IndexBuffer = nullptr;
 
-	// Texture buffer
-	ComPtr<ID3D11ShaderResourceView> m_DiffuseTexture1 = nullptr;
-	ComPtr<ID3D11ShaderResourceView> m_DiffuseTexture2 = nullptr;
-	ComPtr<ID3D11ShaderResourceView> m_DiffuseTexture3 = nullptr;
+	// Material index
+	uint32_t m_Material = 0;
 };
\ No newline at end of file
@@ -1,23 +1,45 @@
 #include "ShaderData.hlsli"
 
+// Resource arrays can't be indexed dynamically in shader model 5.0 so select the array with a branch
+float4 SampleTextureArray(uint array_index, uint slice, float2 tex)
+{
+    float3 coords = float3(tex, slice);
+
+    [branch]
+    switch (array_index)
+    {
+        case 1:
+            return gTextureArray1.Sample(gTextureSampler, coords);
+        case 2:
+            return gTextureArray2.Sample(gTextureSampler, coords);
+        case 3:
+            return gTextureArray3.Sample(gTextureSampler, coords);
+        default:
+            return gTextureArray0.Sample(gTextureSampler, coords);
+    }
+}
+
 // Entry point for the vertex shader - will be executed for each pixel
 float4 main(PixelInput input) : SV_TARGET
 {
+    // Look up the material
+    Material material = gMaterials[cMaterial.x];
+
     // Sample textures
-    float4 texture1 = gTextureDiffuse1.Sample(gTextureSampler, input.tex);
-    float4 texture2 = gTextureDiffuse2.Sample(gTextureSampler, input.tex);
-    float4 texture3 = gTextureDiffuse3.Sample(gTextureSampler, input.tex);
+    float4 texture1 = SampleTextureArray(material.arrays.x, material.slices.x, input.tex);
+    float4 texture2 = SampleTextureArray(material.arrays.y, material.slices.y, input.tex);
+    float4 texture3 = SampleTextureArray(material.arrays.z, material.slices.z, input.tex);
 
-    const int interpolate = 1;
-    const int screen = 2;
+    const uint interpolate = 1;
+    const uint screen = 2;
     
-    if (padding.x == interpolate)
+    if (material.arrays.w == interpolate)
     {
         // Interpolate with mask
         float4 final_colour = lerp(texture1, texture2, texture3);
         return float4(final_colour.rgb, 1.0f);
     }
-    else if (padding.x == screen)
+    else if (material.arrays.w == screen)
     {
         // Screen
         float4 final_colour = 1.0 - (1.0 - texture1) * (1.0 - texture3);
@@ -25,4 +47,4 @@ float4 main(PixelInput input) : SV_TARGET
     }
     
     return float4(1.0f, 0.0f, 0.0f, 1.0f);
-}
\ No newline at end of file
+}
@@ -12,7 +12,7 @@ namespace
 	struct ModelViewProjectionBuffer
 	{
 		DirectX::XMMATRIX modelViewProjection;
-		DirectX::XMINT4 textureBlendMode;
+		DirectX::XMUINT4 material;
 	};
 }
 
@@ -83,11 +83,11 @@ void Shader::CreateWorldViewProjectionConstantBuffer()
 	DX::Check(device->CreateBuffer(&bd, nullptr, m_ModelViewProjectionConstantBuffer.ReleaseAndGetAddressOf()));
 }
 
-void Shader::UpdateModelViewProjectionBuffer(const DirectX::XMMATRIX& matrix, int texture_blend_mode)
+void Shader::UpdateModelViewProjectionBuffer(const DirectX::XMMATRIX& matrix, uint32_t material)
 {
 	ModelViewProjectionBuffer buffer = {};
 	buffer.modelViewProjection = DirectX::XMMatrixTranspose(matrix);
-	buffer.textureBlendMode.x = texture_blend_mode;
+	buffer.material.x = material;
 
 	ID3D11DeviceContext* context = m_Renderer->GetDeviceContext();
 	context->UpdateSubresource(m_ModelViewProjectionConstantBuffer.Get(), 0, nullptr, &buffer, 0, 0);
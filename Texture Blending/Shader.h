@@ -2,6 +2,7 @@
 
 #include <d3d11.h>
 #include <DirectXMath.h>
+#include <cstdint>
 
 // This include is requires for using DirectX smart pointers (ComPtr)
 #include <wrl\client.h>
@@ -24,7 +25,7 @@ public:
 	void Use();
 
 	// Update the model view projection constant buffer
-	void UpdateModelViewProjectionBuffer(const DirectX::XMMATRIX& matrix, int texture_blend_mode);
+	void UpdateModelViewProjectionBuffer(const DirectX::XMMATRIX& matrix, uint32_t material);
 
 private:
 	// Create vertex shader
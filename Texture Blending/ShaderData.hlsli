@@ -16,13 +16,27 @@ struct PixelInput
 cbuffer WorldBuffer : register(b0)
 {
     matrix cModelViewProjection;
-    int4 padding;
+    uint4 cMaterial;
 }
 
+// Material - must match MaterialData in MaterialLibrary.h
+struct Material
+{
+    // xyz texture array, w blend mode
+    uint4 arrays;
+
+    // xyz texture array slice
+    uint4 slices;
+};
+
 // Texture sampler
 SamplerState gTextureSampler : register(s0);
 
-// Textures
-Texture2D gTextureDiffuse1 : register(t0);
-Texture2D gTextureDiffuse2 : register(t1);
-Texture2D gTextureDiffuse3 : register(t2);
\ No newline at end of file
+// Textures of the same size and format are packed into the same array
+Texture2DArray gTextureArray0 : register(t0);
+Texture2DArray gTextureArray1 : register(t1);
+Texture2DArray gTextureArray2 : register(t2);
+Texture2DArray gTextureArray3 : register(t3);
+
+// Material table
+StructuredBuffer<Material> gMaterials : register(t4);